@@ -0,0 +1,98 @@
+# vi:set sw=2 et:
+
+#
+# Builds surge-testrunner once per engine block size, runs --block-size-benchmark in each build
+# and prints the results side by side. BLOCK_SIZE is a compile-time constant, so this is the only
+# way to compare the sizes against each other.
+#
+# Usage: cmake -D SURGE_SOURCE_DIR=<repo> -D BENCHMARK_BINARY_DIR=<dir> [-D SECONDS=20]
+#              [-D BLOCK_SIZES="32;128"] [-D CMAKE_GENERATOR=Ninja] -P block-size-benchmark.cmake
+#
+if(NOT SURGE_SOURCE_DIR OR NOT BENCHMARK_BINARY_DIR)
+  message(FATAL_ERROR "block-size-benchmark.cmake needs SURGE_SOURCE_DIR and BENCHMARK_BINARY_DIR")
+endif()
+if(NOT SECONDS)
+  set(SECONDS 20)
+endif()
+if(NOT BLOCK_SIZES)
+  set(BLOCK_SIZES 8 16 32 64 128 256)
+endif()
+if(CMAKE_GENERATOR)
+  set(generator_args -G "${CMAKE_GENERATOR}")
+endif()
+
+set(number "([0-9.e+-]+)")
+set(columns "block size" "idle us/block" "idle realtime%" "chord us/block" "chord realtime%")
+set(rows "")
+
+function(print_row)
+  set(line "")
+  foreach(index RANGE 4)
+    list(GET ARGN ${index} cell)
+    list(GET columns ${index} heading)
+    string(LENGTH "${heading}" width)
+    string(LENGTH "${cell}" length)
+    math(EXPR pad "${width} - ${length}")
+    if(pad GREATER 0)
+      string(REPEAT " " ${pad} padding)
+    else()
+      set(padding "")
+    endif()
+    string(APPEND line "${padding}${cell}  ")
+  endforeach()
+  string(REGEX REPLACE " +$" "" line "${line}")
+  message("${line}")
+endfunction()
+
+foreach(size ${BLOCK_SIZES})
+  set(build_dir "${BENCHMARK_BINARY_DIR}/block-size-${size}")
+  message(STATUS "Building surge-testrunner with SURGE_COMPILE_BLOCK_SIZE=${size} in ${build_dir}")
+
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} ${generator_args} -S ${SURGE_SOURCE_DIR} -B ${build_dir}
+      -DCMAKE_BUILD_TYPE=Release -DSURGE_COMPILE_BLOCK_SIZE=${size}
+      -DSURGE_BUILD_TESTRUNNER=ON -DSURGE_BUILD_FX=OFF -DSURGE_BUILD_XT=OFF
+    RESULT_VARIABLE result
+    OUTPUT_QUIET
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Configuring the block size ${size} build failed")
+  endif()
+
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${build_dir} --config Release --target surge-testrunner --parallel
+    RESULT_VARIABLE result
+    OUTPUT_QUIET
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Building the block size ${size} test runner failed")
+  endif()
+
+  file(GLOB_RECURSE runner LIST_DIRECTORIES FALSE
+    "${build_dir}/surge-testrunner" "${build_dir}/surge-testrunner.exe")
+  if(NOT runner)
+    message(FATAL_ERROR "No surge-testrunner was built in ${build_dir}")
+  endif()
+  list(GET runner 0 runner)
+
+  execute_process(
+    COMMAND ${runner} --non-test --block-size-benchmark ${SECONDS}
+    WORKING_DIRECTORY ${SURGE_SOURCE_DIR}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+  )
+  if(NOT result EQUAL 0 OR NOT output MATCHES
+      "BLOCK_SIZE=${size} .*idle us/block=${number} idle realtime%=${number} chord us/block=${number} chord realtime%=${number}")
+    message(FATAL_ERROR "The block size ${size} benchmark failed:\n${output}")
+  endif()
+
+  list(APPEND rows "${size},${CMAKE_MATCH_1},${CMAKE_MATCH_2},${CMAKE_MATCH_3},${CMAKE_MATCH_4}")
+endforeach()
+
+# Per block times grow with the block, so the realtime percentages are the columns to compare
+message("")
+print_row(${columns})
+foreach(row ${rows})
+  string(REPLACE "," ";" row "${row}")
+  print_row(${row})
+endforeach()
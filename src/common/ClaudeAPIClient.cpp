@@ -17,6 +17,7 @@
 #include "PatchVectorDB.h"
 #include "SurgeStorage.h"
 #include "UserDefaults.h"
+#include "ClaudeStreaming.h"
 #include "juce_core/juce_core.h"
 #include "juce_events/juce_events.h"
 #include <regex>
@@ -29,9 +30,71 @@ APIClient::APIClient(SurgeStorage *storage) : storage(storage)
 {
     // Load API key from user defaults
     apiKey = Surge::Storage::getUserDefaultValue(storage, Surge::Storage::ClaudeAPIKey, "");
+
+    if (storage)
+        responseCache.setDirectory(path_to_string(storage->userDataPath / "ClaudeResponseCache"));
+
+    updateConnectionSettings();
+    executor = std::make_unique<RequestExecutor>(2, 32);
 }
 
-APIClient::~APIClient() = default;
+/*
+ * Registers a worker's connection for the length of a request. Cancelling a
+ * WebInputStream unblocks a connect or read in progress and fails any later
+ * one, so an open request can't hold the destructor up for its timeout.
+ */
+struct APIClient::OpenStream
+{
+    OpenStream(APIClient &c, juce::WebInputStream &s) : client(c), stream(s)
+    {
+        std::lock_guard<std::mutex> g(client.openStreamsMutex);
+        client.openStreams.insert(&stream);
+        if (client.closing)
+            stream.cancel();
+    }
+
+    ~OpenStream()
+    {
+        std::lock_guard<std::mutex> g(client.openStreamsMutex);
+        client.openStreams.erase(&stream);
+    }
+
+    APIClient &client;
+    juce::WebInputStream &stream;
+};
+
+APIClient::~APIClient()
+{
+    /*
+     * Workers reference this, so they have to stop before anything else goes
+     * away. Cancel their connections so they come back straight away, and
+     * stop delivering first so neither they nor the jobs dropped from the
+     * queue call back into an owner which is being torn down.
+     */
+    *alive = false;
+    {
+        std::lock_guard<std::mutex> g(openStreamsMutex);
+        closing = true;
+        for (auto *s : openStreams)
+            s->cancel();
+    }
+    executor->shutdown();
+}
+
+void APIClient::setEndpoint(const std::string &url)
+{
+    endpoint = url;
+    updateConnectionSettings();
+}
+
+void APIClient::updateConnectionSettings()
+{
+    // Built once per change rather than once per request; requests capture a copy
+    endpointURL = juce::URL(juce::String(endpoint));
+    requestHeaders = "Content-Type: application/json\r\n"
+                     "x-api-key: " + juce::String(apiKey) + "\r\n"
+                     "anthropic-version: 2023-06-01\r\n";
+}
 
 void APIClient::setVectorDatabase(std::shared_ptr<Surge::PatchDB::VectorDatabase> db)
 {
@@ -41,6 +104,7 @@ void APIClient::setVectorDatabase(std::shared_ptr<Surge::PatchDB::VectorDatabase
 void APIClient::setAPIKey(const std::string &key)
 {
     apiKey = key;
+    updateConnectionSettings();
     Surge::Storage::updateUserDefaultValue(storage, Surge::Storage::ClaudeAPIKey, key);
 }
 
@@ -58,10 +122,13 @@ bool APIClient::isAPIKeyValid() const
 }
 
 void APIClient::generatePatch(const std::string &prompt, 
-                             std::function<void(const ClaudeResponse&)> callback)
+                             std::function<void(const ClaudeResponse&)> callback,
+                             ModificationCallback onModifications,
+                             const RequestOptions &options)
 {
     // Use RAG-enhanced prompt if vector database is available
-    std::string enhancedPrompt = vectorDatabase ? generateEnhancedPrompt(prompt) : prompt;
+    std::string ragContext = vectorDatabase ? generateRAGContext(prompt) : "";
+    std::string enhancedPrompt = prompt + ragContext;
     
     std::string context = R"(
 You are a Surge XT synthesizer patch designer. Create a patch based on the user's description.
@@ -91,12 +158,14 @@ Provide 5-10 parameter changes. Use normalized values (0.0-1.0) for continuous p
 
 User request: )";
     
-    makeAPIRequest(enhancedPrompt, context, callback);
+    makeAPIRequest(enhancedPrompt, context, callback, ragContext, onModifications, options);
 }
 
 void APIClient::modifyPatch(const std::string &prompt, 
                            const std::string &currentPatchXML,
-                           std::function<void(const ClaudeResponse&)> callback)
+                           std::function<void(const ClaudeResponse&)> callback,
+                           ModificationCallback onModifications,
+                           const RequestOptions &options)
 {
     std::string context = R"(
 You are modifying an existing Surge XT synthesizer patch.
@@ -123,20 +192,26 @@ Available parameters (use these exact names):
 
 User modification request: )";
 
-    makeAPIRequest(prompt, context, callback);
+    makeAPIRequest(prompt, context, callback, "", onModifications, options);
 }
 
 void APIClient::makeAPIRequest(const std::string &prompt, 
                               const std::string &context,
-                              std::function<void(const ClaudeResponse&)> callback)
+                              std::function<void(const ClaudeResponse&)> callback,
+                              const std::string &ragContext,
+                              ModificationCallback onModifications,
+                              const RequestOptions &options)
 {
-    std::cout << "DEBUG: makeAPIRequest called with prompt: " << prompt << std::endl;
-    std::cout << "DEBUG: API key valid: " << isAPIKeyValid() << std::endl;
-    std::cout << "DEBUG: API key: " << apiKey.substr(0, 10) << "..." << std::endl;
+    if (logging)
+    {
+        std::cout << "DEBUG: makeAPIRequest called with prompt: " << prompt << std::endl;
+        std::cout << "DEBUG: API key valid: " << isAPIKeyValid() << std::endl;
+    }
     
     if (!isAPIKeyValid())
     {
-        std::cout << "DEBUG: API key validation failed" << std::endl;
+        if (logging)
+            std::cout << "DEBUG: API key validation failed" << std::endl;
         ClaudeResponse response;
         response.success = false;
         response.errorMessage = "Invalid API key. Please set a valid Claude API key in settings.";
@@ -144,6 +219,42 @@ void APIClient::makeAPIRequest(const std::string &prompt,
         return;
     }
 
+    /*
+     * Identical requests wait on the one already in flight, or are answered
+     * from the cache. The in-flight entry is claimed before the lookup so two
+     * identical requests can't both miss and both go to the network, but the
+     * lock covers only the claim: the lookup may read the disk, and a
+     * callback may well make another request.
+     */
+    auto key = ResponseCache::makeKey(model, context + prompt, ragContext);
+    {
+        std::lock_guard<std::mutex> g(inFlightMutex);
+        auto pending = inFlight.find(key);
+        if (pending != inFlight.end())
+        {
+            if (logging)
+                std::cout << "DEBUG: Joining identical in-flight request" << std::endl;
+            pending->second.push_back({callback, onModifications, options.token});
+            responseCache.noteCoalesced();
+            return;
+        }
+
+        inFlight[key].push_back({callback, onModifications, options.token});
+    }
+
+    std::string cachedText;
+    if (responseCache.lookup(key, cachedText))
+    {
+        if (logging)
+            std::cout << "DEBUG: Response served from cache" << std::endl;
+        ClaudeResponse response;
+        response.success = true;
+        response.responseText = cachedText;
+        response.modifications = extractModifications(cachedText);
+        finishRequest(key, response, true);
+        return;
+    }
+
     // Create the request JSON properly
     juce::String fullPrompt = juce::String(context) + juce::String(prompt);
     
@@ -154,184 +265,452 @@ void APIClient::makeAPIRequest(const std::string &prompt,
                                           .replace("\r", "\\r")
                                           .replace("\t", "\\t");
     
-    juce::String jsonRequest = "{\"model\":\"claude-3-5-sonnet-20241022\","
-                              "\"max_tokens\":2048,"
+    // Streaming sends content_block_delta events as the text is generated
+    bool streaming = (bool)onModifications;
+    
+    juce::String jsonRequest = "{\"model\":\"" + juce::String(model) + "\","
+                              "\"max_tokens\":2048," +
+                              juce::String(streaming ? "\"stream\":true," : "") +
                               "\"messages\":[{\"role\":\"user\",\"content\":\"" + 
                               escapedPrompt + "\"}]}";
     
-    // Create URL
-    juce::URL url("https://api.anthropic.com/v1/messages");
-    
-    std::cout << "DEBUG: Making HTTP request to Claude API" << std::endl;
-    std::cout << "DEBUG: JSON Request: " << jsonRequest.toStdString() << std::endl;
+    if (logging)
+    {
+        std::cout << "DEBUG: Making HTTP request to Claude API" << std::endl;
+        std::cout << "DEBUG: JSON Request: " << jsonRequest.toStdString() << std::endl;
+    }
     
-    // Make the HTTP request
-    juce::Thread::launch([jsonRequest, callback, this]() {
-        std::cout << "DEBUG: HTTP thread started" << std::endl;
+    /*
+     * Queue the HTTP request on the worker pool. It is cancelled once every
+     * caller waiting on it has cancelled, and gives up at the deadline of
+     * the caller which made it, queue time included.
+     */
+    RequestExecutor::Job job;
+    job.priority = options.priority;
+    job.deadline = RequestExecutor::Clock::now() + std::chrono::milliseconds(options.timeoutMs);
+    job.isCancelled = [this, key]() { return !*alive || allWaitersCancelled(key); };
+    job.run = [this, jsonRequest, key, onModifications, url = endpointURL,
+               headers = requestHeaders](const RequestExecutor::Context &ctx) {
+        if (logging)
+            std::cout << "DEBUG: HTTP worker started" << std::endl;
         
+        auto response = onModifications
+                             ? performStreamingRequest(url, headers, jsonRequest, ctx,
+                                                       [this, onModifications](const std::vector<PatchModification> &mods) {
+                                                           deliverModifications(onModifications, mods);
+                                                       })
+                             : performRequest(url, headers, jsonRequest, ctx);
+        finishRequest(key, response);
+    };
+    job.onDropped = [this, key](RequestExecutor::Outcome outcome) {
         ClaudeResponse response;
+        response.success = false;
+        switch (outcome)
+        {
+        case RequestExecutor::Outcome::Cancelled:
+            response.errorMessage = "Request cancelled";
+            break;
+        case RequestExecutor::Outcome::DeadlineExpired:
+            response.errorMessage = "Request timed out before it could be sent";
+            break;
+        case RequestExecutor::Outcome::Rejected:
+            response.errorMessage = "Too many requests queued, please try again";
+            break;
+        default:
+            response.errorMessage = "Request abandoned";
+            break;
+        }
+        finishRequest(key, response);
+    };
+    
+    executor->submit(std::move(job));
+}
+
+bool APIClient::allWaitersCancelled(const std::string &key)
+{
+    std::lock_guard<std::mutex> g(inFlightMutex);
+    auto pending = inFlight.find(key);
+    if (pending == inFlight.end())
+        return true;
+    
+    for (const auto &w : pending->second)
+        if (!w.token.isCancelled())
+            return false;
+    return true;
+}
+
+void APIClient::finishRequest(const std::string &key, const ClaudeResponse &response,
+                              bool fromCache)
+{
+    // Only successes are cached; errors are worth retrying
+    if (response.success && !fromCache)
+        responseCache.store(key, response.responseText);
+    
+    std::vector<PendingRequest> waiting;
+    {
+        std::lock_guard<std::mutex> g(inFlightMutex);
+        auto pending = inFlight.find(key);
+        if (pending != inFlight.end())
+        {
+            waiting.swap(pending->second);
+            inFlight.erase(pending);
+        }
+    }
+    
+    /*
+     * The first waiter is the one which made the request and, unless the
+     * reply came from the cache, has already had its modifications streamed.
+     * Anyone else who asked for them gets the full set in one go. Callers
+     * who cancelled are told so, whatever happened to the request.
+     */
+    for (size_t i = 0; i < waiting.size(); ++i)
+    {
+        if (waiting[i].token.isCancelled())
+        {
+            ClaudeResponse cancelled;
+            cancelled.success = false;
+            cancelled.errorMessage = "Request cancelled";
+            deliver(waiting[i].callback, cancelled);
+            continue;
+        }
         
-        try {
-            // Create URL with headers
-            juce::URL url("https://api.anthropic.com/v1/messages");
-            url = url.withPOSTData(jsonRequest);
-            
-            // JUCE uses headers string for custom headers
-            juce::String headersString = 
-                "Content-Type: application/json\r\n"
-                "x-api-key: " + juce::String(apiKey) + "\r\n"
-                "anthropic-version: 2023-06-01\r\n";
-            
-            std::cout << "DEBUG: Making request to: " << url.toString(true).toStdString() << std::endl;
-            
-            // Create input stream with timeout
-            int statusCode = 0;
-            juce::StringPairArray responseHeaders;
-            auto stream = url.createInputStream(false, nullptr, nullptr, headersString, 30000, &responseHeaders, &statusCode);
-            
-            if (stream != nullptr)
+        if ((i > 0 || fromCache) && waiting[i].onModifications && response.success &&
+            !response.modifications.empty())
+            deliverModifications(waiting[i].onModifications, response.modifications);
+        deliver(waiting[i].callback, response);
+    }
+}
+
+void APIClient::deliverModifications(ModificationCallback callback,
+                                     const std::vector<PatchModification> &modifications)
+{
+    if (!*alive)
+        return;
+
+    auto run = [callback, modifications, live = alive]() {
+        if (*live)
+            callback(modifications);
+    };
+
+    if (dispatcher)
+    {
+        dispatcher(run);
+        return;
+    }
+    
+    juce::MessageManager::callAsync(run);
+}
+
+void APIClient::deliver(std::function<void(const ClaudeResponse&)> callback,
+                        const ClaudeResponse &response)
+{
+    if (!*alive)
+        return;
+
+    // The client may be destroyed between posting this and it running
+    auto run = [callback, response, live = alive]() {
+        if (*live)
+            callback(response);
+    };
+
+    if (dispatcher)
+    {
+        dispatcher(run);
+        return;
+    }
+    
+    // Call the callback on the message thread
+    juce::MessageManager::callAsync(run);
+}
+
+ClaudeResponse APIClient::performRequest(const juce::URL &endpointURL, const juce::String &headersString,
+                                         const juce::String &jsonRequest,
+                                         const RequestExecutor::Context &ctx)
+{
+    ClaudeResponse response;
+    
+    try {
+        auto url = endpointURL.withPOSTData(jsonRequest);
+        
+        if (logging)
+            std::cout << "DEBUG: Making request to: " << url.toString(true).toStdString()
+                      << std::endl;
+        
+        // Create input stream with timeout, cancellable by the destructor
+        juce::WebInputStream stream(url, false);
+        stream.withExtraHeaders(headersString)
+            .withConnectionTimeout(std::max(ctx.remainingMs(30000), 1));
+        OpenStream open(*this, stream);
+        
+        if (stream.connect(nullptr))
+        {
+            int statusCode = stream.getStatusCode();
+            juce::String responseString = stream.readEntireStreamAsString();
+            if (logging)
             {
-                juce::String responseString = stream->readEntireStreamAsString();
                 std::cout << "DEBUG: Response status code: " << statusCode << std::endl;
                 std::cout << "DEBUG: Response length: " << responseString.length() << std::endl;
-                std::cout << "DEBUG: First 200 chars: " << responseString.substring(0, 200).toStdString() << std::endl;
+                std::cout << "DEBUG: First 200 chars: "
+                          << responseString.substring(0, 200).toStdString() << std::endl;
+            }
+            
+            // Parse JSON response
+            if (statusCode == 200 && responseString.contains("\"content\""))
+            {
+                if (logging)
+                    std::cout << "DEBUG: Full response: " << responseString.toStdString()
+                              << std::endl;
                 
-                // Parse JSON response
-                if (statusCode == 200 && responseString.contains("\"content\""))
+                // Claude's response format: {"content":[{"text":"...","type":"text"}],...}
+                // Look for the text content more carefully
+                int contentArrayStart = responseString.indexOf("\"content\":[");
+                if (contentArrayStart >= 0)
                 {
-                    std::cout << "DEBUG: Full response: " << responseString.toStdString() << std::endl;
+                    // Find the text field within the content array
+                    int searchFrom = contentArrayStart + 11; // Skip past "content":["
+                    int textFieldStart = responseString.indexOf(searchFrom, juce::String("\"text\":"));
                     
-                    // Claude's response format: {"content":[{"text":"...","type":"text"}],...}
-                    // Look for the text content more carefully
-                    int contentArrayStart = responseString.indexOf("\"content\":[");
-                    if (contentArrayStart >= 0)
+                    if (textFieldStart >= 0)
                     {
-                        // Find the text field within the content array
-                        int searchFrom = contentArrayStart + 11; // Skip past "content":["
-                        int textFieldStart = responseString.indexOf(searchFrom, juce::String("\"text\":"));
+                        // Find the actual text value start (after "text":")
+                        int textValueStart = textFieldStart + 7; // Skip "text":"
                         
-                        if (textFieldStart >= 0)
+                        // Handle both quoted and unquoted text
+                        if (responseString[textValueStart] == '"')
                         {
-                            // Find the actual text value start (after "text":")
-                            int textValueStart = textFieldStart + 7; // Skip "text":"
+                            textValueStart++; // Skip opening quote
                             
-                            // Handle both quoted and unquoted text
-                            if (responseString[textValueStart] == '"')
+                            // Find the closing quote, handling escaped quotes
+                            int textEnd = textValueStart;
+                            bool escaped = false;
+                            while (textEnd < responseString.length())
                             {
-                                textValueStart++; // Skip opening quote
-                                
-                                // Find the closing quote, handling escaped quotes
-                                int textEnd = textValueStart;
-                                bool escaped = false;
-                                while (textEnd < responseString.length())
+                                if (!escaped && responseString[textEnd] == '"')
                                 {
-                                    if (!escaped && responseString[textEnd] == '"')
-                                    {
-                                        break;
-                                    }
-                                    escaped = (!escaped && responseString[textEnd] == '\\');
-                                    textEnd++;
+                                    break;
                                 }
+                                escaped = (!escaped && responseString[textEnd] == '\\');
+                                textEnd++;
+                            }
+                            
+                            if (textEnd < responseString.length())
+                            {
+                                juce::String textContent = responseString.substring(textValueStart, textEnd);
+                                
+                                // Unescape JSON string
+                                textContent = textContent.replace("\\n", "\n")
+                                                       .replace("\\r", "\r")
+                                                       .replace("\\t", "\t")
+                                                       .replace("\\\"", "\"")
+                                                       .replace("\\\\/", "/")
+                                                       .replace("\\\\", "\\");
                                 
-                                if (textEnd < responseString.length())
+                                response.success = true;
+                                response.responseText = textContent.toStdString();
+                                response.modifications = extractModifications(response.responseText);
+                                if (logging)
                                 {
-                                    juce::String textContent = responseString.substring(textValueStart, textEnd);
-                                    
-                                    // Unescape JSON string
-                                    textContent = textContent.replace("\\n", "\n")
-                                                           .replace("\\r", "\r")
-                                                           .replace("\\t", "\t")
-                                                           .replace("\\\"", "\"")
-                                                           .replace("\\\\/", "/")
-                                                           .replace("\\\\", "\\");
-                                    
-                                    response.success = true;
-                                    response.responseText = textContent.toStdString();
-                                    response.modifications = extractModifications(response.responseText);
                                     std::cout << "DEBUG: Successfully parsed response" << std::endl;
-                                    std::cout << "DEBUG: Response text: " << response.responseText << std::endl;
-                                }
-                                else
-                                {
-                                    response.success = false;
-                                    response.errorMessage = "Failed to find end of text content";
+                                    std::cout << "DEBUG: Response text: " << response.responseText
+                                              << std::endl;
                                 }
                             }
                             else
                             {
                                 response.success = false;
-                                response.errorMessage = "Unexpected text format in response";
+                                response.errorMessage = "Failed to find end of text content";
                             }
                         }
                         else
                         {
                             response.success = false;
-                            response.errorMessage = "No text field found in content array";
+                            response.errorMessage = "Unexpected text format in response";
                         }
                     }
                     else
                     {
                         response.success = false;
-                        response.errorMessage = "No content array found in response";
+                        response.errorMessage = "No text field found in content array";
                     }
                 }
-                else if (statusCode >= 400 || responseString.contains("\"error\":"))
-                {
-                    response.success = false;
-                    
-                    // Log the full error response for debugging
-                    std::cout << "DEBUG: Full error response: " << responseString.toStdString() << std::endl;
-                    
-                    // Try to extract error message
-                    int errorMsgStart = responseString.indexOf("\"message\":\"") + 11;
-                    int errorMsgEnd = responseString.indexOfChar('"', errorMsgStart);
-                    
-                    if (errorMsgStart > 10 && errorMsgEnd > errorMsgStart)
-                    {
-                        response.errorMessage = responseString.substring(errorMsgStart, errorMsgEnd).toStdString();
-                    }
-                    else
-                    {
-                        // Try alternative error format
-                        int errorStart = responseString.indexOf("\"error\":");
-                        if (errorStart >= 0)
-                        {
-                            response.errorMessage = "API error (status " + std::to_string(statusCode) + "): " + 
-                                                  responseString.substring(errorStart).toStdString();
-                        }
-                        else
-                        {
-                            response.errorMessage = "API error occurred (status: " + std::to_string(statusCode) + ")";
-                        }
-                    }
-                    std::cout << "DEBUG: API Error: " << response.errorMessage << std::endl;
-                }
                 else
                 {
                     response.success = false;
-                    response.errorMessage = "Unexpected API response (status: " + std::to_string(statusCode) + ")";
-                    std::cout << "DEBUG: Unexpected response format" << std::endl;
+                    response.errorMessage = "No content array found in response";
                 }
             }
+            else if (statusCode >= 400 || responseString.contains("\"error\":"))
+            {
+                response = parseErrorResponse(statusCode, responseString);
+            }
             else
             {
                 response.success = false;
-                response.errorMessage = "Failed to connect to Claude API - check your internet connection";
-                std::cout << "DEBUG: Failed to create input stream" << std::endl;
+                response.errorMessage = "Unexpected API response (status: " + std::to_string(statusCode) + ")";
+                if (logging)
+                    std::cout << "DEBUG: Unexpected response format" << std::endl;
             }
         }
-        catch (const std::exception& e)
+        else
         {
             response.success = false;
-            response.errorMessage = std::string("Exception: ") + e.what();
+            response.errorMessage = "Failed to connect to Claude API - check your internet connection";
+            if (logging)
+                std::cout << "DEBUG: Failed to create input stream" << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        response.success = false;
+        response.errorMessage = std::string("Exception: ") + e.what();
+        if (logging)
             std::cout << "DEBUG: Exception caught: " << e.what() << std::endl;
+    }
+    
+    return response;
+}
+
+ClaudeResponse APIClient::performStreamingRequest(const juce::URL &endpointURL,
+                                                  const juce::String &baseHeaders,
+                                                  const juce::String &jsonRequest,
+                                                  const RequestExecutor::Context &ctx,
+                                                  ModificationCallback onModifications)
+{
+    ClaudeResponse response;
+    response.success = false;
+    
+    try {
+        auto url = endpointURL.withPOSTData(jsonRequest);
+        auto headersString = baseHeaders + "Accept: text/event-stream\r\n";
+        
+        if (logging)
+            std::cout << "DEBUG: Making streaming request to: " << url.toString(true).toStdString()
+                      << std::endl;
+        
+        juce::WebInputStream stream(url, false);
+        stream.withExtraHeaders(headersString)
+            .withConnectionTimeout(std::max(ctx.remainingMs(30000), 1));
+        OpenStream open(*this, stream);
+        
+        if (!stream.connect(nullptr))
+        {
+            response.errorMessage = "Failed to connect to Claude API - check your internet connection";
+            if (logging)
+                std::cout << "DEBUG: Failed to create input stream" << std::endl;
+            return response;
         }
         
-        // Call the callback on the message thread
-        juce::MessageManager::callAsync([callback, response]() {
-            callback(response);
+        // Errors before the stream starts come back as a normal JSON body
+        int statusCode = stream.getStatusCode();
+        if (statusCode != 200)
+            return parseErrorResponse(statusCode, stream.readEntireStreamAsString());
+        
+        ModificationStreamParser modParser;
+        std::string streamError;
+        
+        SSEParser sse([&](const std::string &event, const std::string &data) {
+            if (event == "content_block_delta")
+            {
+                std::string text;
+                if (extractJSONStringField(data, "text", text))
+                {
+                    auto mods = modParser.feed(text);
+                    if (!mods.empty())
+                        onModifications(mods);
+                }
+            }
+            else if (event == "error")
+            {
+                if (!extractJSONStringField(data, "message", streamError) || streamError.empty())
+                    streamError = "Stream error: " + data;
+            }
         });
-    });
+        
+        // readNextLine returns as soon as a line is complete, so events are handled as they arrive
+        while (!ctx.shouldStop() && !stream.isExhausted())
+            sse.feedLine(stream.readNextLine().toStdString());
+        sse.finish();
+        
+        if (ctx.cancelled())
+        {
+            response.errorMessage = "Request cancelled";
+            return response;
+        }
+        if (!stream.isExhausted())
+        {
+            response.errorMessage = "Request timed out while streaming";
+            return response;
+        }
+        
+        auto remaining = modParser.finish();
+        if (!remaining.empty())
+            onModifications(remaining);
+        
+        if (logging)
+            std::cout << "DEBUG: Stream finished, " << modParser.getModificationCount()
+                      << " modifications streamed" << std::endl;
+        
+        if (!streamError.empty())
+        {
+            response.errorMessage = streamError;
+        }
+        else if (modParser.getText().empty())
+        {
+            response.errorMessage = "No content in streamed response";
+        }
+        else
+        {
+            response.success = true;
+            response.responseText = modParser.getText();
+            response.modifications = extractModifications(response.responseText);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        response.success = false;
+        response.errorMessage = std::string("Exception: ") + e.what();
+        if (logging)
+            std::cout << "DEBUG: Exception caught: " << e.what() << std::endl;
+    }
+    
+    return response;
+}
+
+ClaudeResponse APIClient::parseErrorResponse(int statusCode, const juce::String &responseString)
+{
+    ClaudeResponse response;
+    response.success = false;
+    
+    // Log the full error response for debugging
+    if (logging)
+        std::cout << "DEBUG: Full error response: " << responseString.toStdString() << std::endl;
+    
+    // Try to extract error message
+    int errorMsgStart = responseString.indexOf("\"message\":\"") + 11;
+    int errorMsgEnd = responseString.indexOfChar('"', errorMsgStart);
+    
+    if (errorMsgStart > 10 && errorMsgEnd > errorMsgStart)
+    {
+        response.errorMessage = responseString.substring(errorMsgStart, errorMsgEnd).toStdString();
+    }
+    else
+    {
+        // Try alternative error format
+        int errorStart = responseString.indexOf("\"error\":");
+        if (errorStart >= 0)
+        {
+            response.errorMessage = "API error (status " + std::to_string(statusCode) + "): " + 
+                                  responseString.substring(errorStart).toStdString();
+        }
+        else
+        {
+            response.errorMessage = "API error occurred (status: " + std::to_string(statusCode) + ")";
+        }
+    }
+    if (logging)
+        std::cout << "DEBUG: API Error: " << response.errorMessage << std::endl;
+    
+    return response;
 }
 
 ClaudeResponse APIClient::parseResponse(const std::string &jsonResponse)
@@ -347,14 +726,19 @@ std::vector<PatchModification> APIClient::extractModifications(const std::string
 {
     std::vector<PatchModification> modifications;
     
-    std::cout << "DEBUG: Extracting modifications from response text" << std::endl;
-    std::cout << "DEBUG: Full response for parameter extraction:\n" << responseText << std::endl;
+    if (logging)
+    {
+        std::cout << "DEBUG: Extracting modifications from response text" << std::endl;
+        std::cout << "DEBUG: Full response for parameter extraction:\n" << responseText
+                  << std::endl;
+    }
     
     // Look for PARAMETERS: section
     size_t parametersPos = responseText.find("PARAMETERS:");
     if (parametersPos == std::string::npos)
     {
-        std::cout << "DEBUG: No PARAMETERS: section found" << std::endl;
+        if (logging)
+            std::cout << "DEBUG: No PARAMETERS: section found" << std::endl;
         // Try case-insensitive search
         std::string lowerResponse = responseText;
         std::transform(lowerResponse.begin(), lowerResponse.end(), lowerResponse.begin(), ::tolower);
@@ -362,7 +746,9 @@ std::vector<PatchModification> APIClient::extractModifications(const std::string
         if (lowerPos != std::string::npos)
         {
             parametersPos = lowerPos;
-            std::cout << "DEBUG: Found lowercase 'parameters:' at position " << parametersPos << std::endl;
+            if (logging)
+                std::cout << "DEBUG: Found lowercase 'parameters:' at position " << parametersPos
+                          << std::endl;
         }
         else
         {
@@ -371,7 +757,8 @@ std::vector<PatchModification> APIClient::extractModifications(const std::string
     }
 
     std::string parametersSection = responseText.substr(parametersPos);
-    std::cout << "DEBUG: Found parameters section: " << parametersSection << std::endl;
+    if (logging)
+        std::cout << "DEBUG: Found parameters section: " << parametersSection << std::endl;
     
     // Parse parameter lines using regex - match lines like "- param_name: value (description)" or "- param_name: value"
     // Make the description part optional
@@ -400,16 +787,19 @@ std::vector<PatchModification> APIClient::extractModifications(const std::string
             mod.description = (match.size() > 3 && match[3].matched) ? match[3].str() : "";
             modifications.push_back(mod);
             
-            std::cout << "DEBUG: Extracted parameter " << ++count << ": " 
-                      << mod.parameterName << " = " << mod.value 
-                      << " (" << mod.description << ")" << std::endl;
+            if (logging)
+                std::cout << "DEBUG: Extracted parameter " << ++count << ": " 
+                          << mod.parameterName << " = " << mod.value 
+                          << " (" << mod.description << ")" << std::endl;
         }
     }
     
     // If no parameters found with dash format, try without dash
     if (modifications.empty())
     {
-        std::cout << "DEBUG: No parameters found with dash format, trying alternative format" << std::endl;
+        if (logging)
+            std::cout << "DEBUG: No parameters found with dash format, trying alternative format"
+                      << std::endl;
         std::sregex_iterator altIter(parametersSection.begin(), parametersSection.end(), altParamRegex);
         
         for (; altIter != end; ++altIter)
@@ -432,57 +822,58 @@ std::vector<PatchModification> APIClient::extractModifications(const std::string
                 mod.description = (match.size() > 3 && match[3].matched) ? match[3].str() : "";
                 modifications.push_back(mod);
                 
-                std::cout << "DEBUG: Extracted parameter (alt format) " << ++count << ": " 
-                          << mod.parameterName << " = " << mod.value 
-                          << " (" << mod.description << ")" << std::endl;
+                if (logging)
+                    std::cout << "DEBUG: Extracted parameter (alt format) " << ++count << ": " 
+                              << mod.parameterName << " = " << mod.value 
+                              << " (" << mod.description << ")" << std::endl;
             }
         }
     }
     
-    std::cout << "DEBUG: Total parameters extracted: " << modifications.size() << std::endl;
+    if (logging)
+        std::cout << "DEBUG: Total parameters extracted: " << modifications.size() << std::endl;
     return modifications;
 }
 
 std::string APIClient::generateEnhancedPrompt(const std::string &userPrompt)
+{
+    return userPrompt + generateRAGContext(userPrompt);
+}
+
+std::string APIClient::generateRAGContext(const std::string &userPrompt)
 {
     if (!vectorDatabase) {
-        return userPrompt;
+        return "";
     }
     
     // Extract search terms from user prompt
     auto searchTerms = extractSearchTerms(userPrompt);
     
-    // Find similar patches for each search term
-    std::vector<Surge::PatchDB::PatchVector> allSimilarPatches;
-    for (const auto& term : searchTerms) {
-        auto patches = vectorDatabase->findSimilarByText(term, 3);
-        allSimilarPatches.insert(allSimilarPatches.end(), patches.begin(), patches.end());
-    }
-    
-    // Remove duplicates (simple name-based)
-    std::sort(allSimilarPatches.begin(), allSimilarPatches.end(), 
-              [](const auto& a, const auto& b) { return a.name < b.name; });
-    allSimilarPatches.erase(
-        std::unique(allSimilarPatches.begin(), allSimilarPatches.end(),
-                   [](const auto& a, const auto& b) { return a.name == b.name; }),
-        allSimilarPatches.end());
+    // Find similar patches for all search terms in one pass, merged by patch index
+    auto hits = vectorDatabase->searchMany(searchTerms, 3);
     
     // Limit to top 5 patches to avoid prompt bloat
-    if (allSimilarPatches.size() > 5) {
-        allSimilarPatches.resize(5);
+    if (hits.size() > 5) {
+        hits.resize(5);
+    }
+    
+    std::vector<Surge::PatchDB::PatchVector> allSimilarPatches;
+    allSimilarPatches.reserve(hits.size());
+    for (const auto& h : hits) {
+        allSimilarPatches.push_back(vectorDatabase->patches[h.index]);
     }
     
     if (allSimilarPatches.empty()) {
-        return userPrompt;
+        return "";
     }
     
-    // Format enhanced prompt
-    std::string enhancedPrompt = userPrompt + "\n\n";
-    enhancedPrompt += "For reference, here are some similar patches from the factory library:\n";
-    enhancedPrompt += formatSimilarPatches(allSimilarPatches);
-    enhancedPrompt += "\nUse these as inspiration but create something new based on the user's request.";
+    // Format the reference section appended to the user's prompt
+    std::string ragContext = "\n\n";
+    ragContext += "For reference, here are some similar patches from the factory library:\n";
+    ragContext += formatSimilarPatches(allSimilarPatches);
+    ragContext += "\nUse these as inspiration but create something new based on the user's request.";
     
-    return enhancedPrompt;
+    return ragContext;
 }
 
 std::vector<std::string> APIClient::extractSearchTerms(const std::string &prompt)
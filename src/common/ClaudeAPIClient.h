@@ -18,7 +18,13 @@
 
 #include <string>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "ClaudeRequestExecutor.h"
+#include "ClaudeResponseCache.h"
 #include "juce_core/juce_core.h"
 #include "juce_events/juce_events.h"
 
@@ -52,6 +58,20 @@ struct ClaudeResponse
     std::vector<PatchModification> modifications;
 };
 
+/*
+ * Requests run on a small fixed worker pool. Interactive requests jump ahead
+ * of queued background ones, timeoutMs is a deadline covering the time spent
+ * queued as well as on the wire, and cancelling the token makes the callback
+ * report "Request cancelled" (and stops the request itself once nobody else
+ * is waiting on it).
+ */
+struct RequestOptions
+{
+    RequestPriority priority{RequestPriority::Interactive};
+    int timeoutMs{30000};
+    CancellationToken token;
+};
+
 class APIClient
 {
   public:
@@ -65,33 +85,128 @@ class APIClient
     // Set RAG database for enhanced patch generation
     void setVectorDatabase(std::shared_ptr<Surge::PatchDB::VectorDatabase> db);
 
+    /*
+     * When onModifications is given the request streams (server-sent events)
+     * and each batch of parameter changes is delivered as soon as its line
+     * of the reply is complete, well before the final callback. The final
+     * callback still receives the whole response and every modification.
+     */
+    typedef std::function<void(const std::vector<PatchModification>&)> ModificationCallback;
+
     void generatePatch(const std::string &prompt, 
-                      std::function<void(const ClaudeResponse&)> callback);
+                      std::function<void(const ClaudeResponse&)> callback,
+                      ModificationCallback onModifications = nullptr,
+                      const RequestOptions &options = RequestOptions());
 
     void modifyPatch(const std::string &prompt, 
                     const std::string &currentPatchXML,
-                    std::function<void(const ClaudeResponse&)> callback);
+                    std::function<void(const ClaudeResponse&)> callback,
+                    ModificationCallback onModifications = nullptr,
+                    const RequestOptions &options = RequestOptions());
 
     // Public for testing
     std::vector<PatchModification> extractModifications(const std::string &responseText);
 
+    /*
+     * Identical requests (same model, prompt and RAG context) are answered
+     * from the response cache, and an identical request made while one is
+     * still in flight waits for that one rather than opening a second
+     * connection. The cache lives in memory and under the user data path.
+     */
+    ResponseCache &getResponseCache() { return responseCache; }
+    ResponseCache::Stats getCacheStats() const { return responseCache.getStats(); }
+
+    // Request and response tracing on stdout, off by default as it includes whole bodies
+    void setLoggingEnabled(bool b) { logging = b; }
+    bool isLoggingEnabled() const { return logging; }
+
+    void setModel(const std::string &m) { model = m; }
+    const std::string &getModel() const { return model; }
+
+    // The messages endpoint; tests point this at a local server
+    void setEndpoint(const std::string &url);
+    const std::string &getEndpoint() const { return endpoint; }
+
+    /*
+     * Callbacks are delivered on the message thread by default. Code without
+     * a running message loop (the test runner, for instance) can provide its
+     * own way of running them.
+     */
+    typedef std::function<void(std::function<void()>)> CallbackDispatcher;
+    void setCallbackDispatcher(CallbackDispatcher d) { dispatcher = std::move(d); }
+
+    RequestExecutor::Metrics getRequestMetrics() const { return executor->getMetrics(); }
+    RequestExecutor &getExecutor() { return *executor; }
+
   private:
     SurgeStorage *storage;
     std::string apiKey;
-    std::unique_ptr<juce::WebInputStream> currentRequest;
+    std::string model{"claude-3-5-sonnet-20241022"};
+    std::string endpoint{"https://api.anthropic.com/v1/messages"};
+    juce::URL endpointURL;
+    juce::String requestHeaders;
     std::shared_ptr<Surge::PatchDB::VectorDatabase> vectorDatabase;
+    std::atomic<bool> logging{false};
+
+    ResponseCache responseCache;
+    CallbackDispatcher dispatcher;
+
+    // Callbacks waiting on each in-flight cache key, the one which made the request first
+    struct PendingRequest
+    {
+        std::function<void(const ClaudeResponse&)> callback;
+        ModificationCallback onModifications;
+        CancellationToken token;
+    };
+    std::mutex inFlightMutex;
+    std::map<std::string, std::vector<PendingRequest>> inFlight;
+
+    /*
+     * Cleared by the destructor. Every delivery, including the ones already
+     * posted to the message thread, checks it first, so nothing reaches a
+     * callback once the client (and usually its owner) has gone away.
+     */
+    std::shared_ptr<std::atomic<bool>> alive{std::make_shared<std::atomic<bool>>(true)};
+
+    // Connections open on the workers, which the destructor cancels rather than waits out
+    struct OpenStream;
+    std::mutex openStreamsMutex;
+    std::set<juce::WebInputStream *> openStreams;
+    bool closing{false};
 
     void makeAPIRequest(const std::string &prompt, 
                        const std::string &context,
-                       std::function<void(const ClaudeResponse&)> callback);
+                       std::function<void(const ClaudeResponse&)> callback,
+                       const std::string &ragContext = "",
+                       ModificationCallback onModifications = nullptr,
+                       const RequestOptions &options = RequestOptions());
+    void updateConnectionSettings();
+    bool allWaitersCancelled(const std::string &key);
+    void finishRequest(const std::string &key, const ClaudeResponse &response,
+                       bool fromCache = false);
+    ClaudeResponse performRequest(const juce::URL &url, const juce::String &headers,
+                                  const juce::String &jsonRequest,
+                                  const RequestExecutor::Context &ctx);
+    ClaudeResponse performStreamingRequest(const juce::URL &url, const juce::String &headers,
+                                           const juce::String &jsonRequest,
+                                           const RequestExecutor::Context &ctx,
+                                           ModificationCallback onModifications);
+    ClaudeResponse parseErrorResponse(int statusCode, const juce::String &responseString);
+    void deliver(std::function<void(const ClaudeResponse&)> callback, const ClaudeResponse &response);
+    void deliverModifications(ModificationCallback callback,
+                              const std::vector<PatchModification> &modifications);
     
     // RAG helper methods
     std::string generateEnhancedPrompt(const std::string &userPrompt);
+    std::string generateRAGContext(const std::string &userPrompt);
     std::vector<std::string> extractSearchTerms(const std::string &prompt);
     std::string formatSimilarPatches(const std::vector<Surge::PatchDB::PatchVector>& patches);
 
     ClaudeResponse parseResponse(const std::string &jsonResponse);
 
+    // Declared last so it is destroyed first, while everything its jobs touch is still alive
+    std::unique_ptr<RequestExecutor> executor;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(APIClient)
 };
 
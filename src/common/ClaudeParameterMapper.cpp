@@ -117,99 +117,46 @@ ParameterMapper::~ParameterMapper() = default;
 
 void ParameterMapper::buildParameterMaps()
 {
-    nameToIndexMap.clear();
-    oscNameToIndexMap.clear();
-    aliasToIndexMap.clear();
-    
-    std::cout << "DEBUG: Building parameter maps. Total parameters: " << synth->storage.getPatch().param_ptr.size() << std::endl;
-    
-    for (int i = 0; i < synth->storage.getPatch().param_ptr.size(); ++i)
+    resolver.clear();
+
+    auto &patch = synth->storage.getPatch();
+    for (int i = 0; i < patch.param_ptr.size(); ++i)
     {
-        auto *param = synth->storage.getPatch().param_ptr[i];
+        auto *param = patch.param_ptr[i];
         if (param)
         {
-            // Full display name mapping
             char txt[256];
             synth->getParameterName(synth->idForParameter(param), txt);
-            std::string fullName = txt;
-            nameToIndexMap[fullName] = i;
-            nameToIndexMap[toLower(fullName)] = i;
-            
-            // Print some common parameters for debugging
-            if (fullName.find("Filter") != std::string::npos || 
-                fullName.find("Cutoff") != std::string::npos ||
-                fullName.find("Resonance") != std::string::npos ||
-                fullName.find("Volume") != std::string::npos ||
-                fullName.find("Osc") != std::string::npos)
-            {
-                std::cout << "DEBUG: Parameter[" << i << "]: " << fullName << std::endl;
-            }
-            
-            // OSC name mapping
-            std::string oscName = param->get_osc_name();
-            if (!oscName.empty())
-            {
-                oscNameToIndexMap[oscName] = i;
-                oscNameToIndexMap[toLower(oscName)] = i;
-            }
-            
-            // Internal name mapping
-            std::string internalName = param->get_name();
-            if (!internalName.empty())
-            {
-                nameToIndexMap[internalName] = i;
-                nameToIndexMap[toLower(internalName)] = i;
-            }
+            resolver.addName(txt, i, param->scene, ParameterNameResolver::Source::FullName);
+            resolver.addName(param->get_name(), i, param->scene,
+                             ParameterNameResolver::Source::ShortName);
+            resolver.addName(param->get_osc_name(), i, param->scene,
+                             ParameterNameResolver::Source::OSCName);
         }
     }
-    
-    buildAliasMap();
-}
 
-void ParameterMapper::buildAliasMap()
-{
-    for (const auto &alias : parameterAliases)
+    auto unresolved = resolver.build(parameterAliases);
+
+    if (logging)
     {
-        // Try exact match first
-        auto it = nameToIndexMap.find(alias.second);
-        if (it != nameToIndexMap.end())
-        {
-            aliasToIndexMap[alias.first] = it->second;
-            aliasToIndexMap[toLower(alias.first)] = it->second;
-            std::cout << "DEBUG: Mapped alias '" << alias.first << "' to '" << alias.second << "' at index " << it->second << std::endl;
-        }
-        else
-        {
-            // If exact match fails, try to find the parameter in any scene
-            bool found = false;
-            for (const auto &pair : nameToIndexMap)
-            {
-                if (pair.first.find(alias.second) != std::string::npos)
-                {
-                    aliasToIndexMap[alias.first] = pair.second;
-                    aliasToIndexMap[toLower(alias.first)] = pair.second;
-                    std::cout << "DEBUG: Mapped alias '" << alias.first << "' to '" << pair.first << "' at index " << pair.second << std::endl;
-                    found = true;
-                    break;
-                }
-            }
-            
-            if (!found)
-            {
-                std::cout << "DEBUG: Could not find parameter for alias '" << alias.first << "' -> '" << alias.second << "'" << std::endl;
-            }
-        }
+        std::cout << "DEBUG: Built parameter resolver. Total parameters: " << patch.param_ptr.size()
+                  << ", exact keys: " << resolver.exactKeyCount() << std::endl;
+        for (const auto &alias : unresolved)
+            std::cout << "DEBUG: Could not find parameter for alias '" << alias << "' -> '"
+                      << parameterAliases.at(alias) << "'" << std::endl;
     }
 }
 
 bool ParameterMapper::setParameterFromName(const std::string &paramName, float value)
 {
-    std::cout << "DEBUG: Trying to set parameter: " << paramName << " = " << value << std::endl;
+    if (logging)
+        std::cout << "DEBUG: Trying to set parameter: " << paramName << " = " << value << std::endl;
     
     int paramIndex = findParameterIndex(paramName);
     if (paramIndex >= 0)
     {
-        std::cout << "DEBUG: Found parameter at index: " << paramIndex << std::endl;
+        if (logging)
+            std::cout << "DEBUG: Found parameter at index: " << paramIndex << std::endl;
         
         // Special handling for certain parameter types
         auto param = synth->storage.getPatch().param_ptr[paramIndex];
@@ -220,7 +167,8 @@ bool ParameterMapper::setParameterFromName(const std::string &paramName, float v
             // For discrete parameters like oscillator types, use the value directly
             if (param->valtype == vt_int || paramName.find("_type") != std::string::npos)
             {
-                std::cout << "DEBUG: Setting discrete parameter" << std::endl;
+                if (logging)
+                    std::cout << "DEBUG: Setting discrete parameter" << std::endl;
                 int intValue = static_cast<int>(value);
                 
                 // Clamp to valid range
@@ -248,14 +196,16 @@ bool ParameterMapper::setParameterFromName(const std::string &paramName, float v
                 // Clamp to 0-1 range
                 normalizedValue = std::max(0.0f, std::min(1.0f, normalizedValue));
                 
-                std::cout << "DEBUG: Setting continuous parameter with normalized value: " << normalizedValue << std::endl;
+                if (logging)
+                    std::cout << "DEBUG: Setting continuous parameter with normalized value: " << normalizedValue << std::endl;
                 
                 // Set via the synth's parameter system to ensure proper notification
                 synth->setParameter01(synth->idForParameter(param), normalizedValue, false);
             }
             
             float newValue = param->get_value_f01();
-            std::cout << "DEBUG: Parameter changed from " << oldValue << " to " << newValue << std::endl;
+            if (logging)
+                std::cout << "DEBUG: Parameter changed from " << oldValue << " to " << newValue << std::endl;
             
             // Force parameter update
             synth->storage.getPatch().isDirty = true;
@@ -270,78 +220,22 @@ bool ParameterMapper::setParameterFromName(const std::string &paramName, float v
 
 int ParameterMapper::findParameterIndex(const std::string &name)
 {
-    std::string lowerName = toLower(name);
-    
-    std::cout << "DEBUG: Looking for parameter: '" << name << "' (lower: '" << lowerName << "')" << std::endl;
-    
-    // 1. Try alias map first (most common Claude responses)
-    auto aliasIt = aliasToIndexMap.find(lowerName);
-    if (aliasIt != aliasToIndexMap.end())
-    {
-        std::cout << "DEBUG: Found in alias map at index " << aliasIt->second << std::endl;
-        return aliasIt->second;
-    }
-    
-    // 2. Try exact name match
-    auto it = nameToIndexMap.find(name);
-    if (it != nameToIndexMap.end())
-    {
-        std::cout << "DEBUG: Found exact match at index " << it->second << std::endl;
-        return it->second;
-    }
-    
-    // 3. Try lowercase name match
-    auto lowerIt = nameToIndexMap.find(lowerName);
-    if (lowerIt != nameToIndexMap.end())
-    {
-        std::cout << "DEBUG: Found lowercase match at index " << lowerIt->second << std::endl;
-        return lowerIt->second;
-    }
-    
-    // 4. Try OSC name match
-    auto oscIt = oscNameToIndexMap.find(lowerName);
-    if (oscIt != oscNameToIndexMap.end())
-    {
-        std::cout << "DEBUG: Found OSC name match at index " << oscIt->second << std::endl;
-        return oscIt->second;
-    }
-    
-    // 5. Try partial match - look for the first parameter that contains our search term
-    std::cout << "DEBUG: Trying partial match..." << std::endl;
-    
-    // First try to find in Scene A (which is usually what we want)
-    for (const auto &pair : nameToIndexMap)
-    {
-        std::string pairLower = toLower(pair.first);
-        // Skip Scene B parameters when looking for generic names
-        if (pairLower.find(" b ") != std::string::npos || pairLower.find("scene b") != std::string::npos)
-            continue;
-            
-        if (pairLower.find(lowerName) != std::string::npos)
-        {
-            std::cout << "DEBUG: Found partial match '" << pair.first << "' at index " << pair.second << std::endl;
-            return pair.second;
-        }
-    }
-    
-    // If not found in Scene A, try all parameters
-    for (const auto &pair : nameToIndexMap)
+    auto index = resolver.resolve(name);
+
+    if (logging)
     {
-        if (toLower(pair.first).find(lowerName) != std::string::npos)
-        {
-            std::cout << "DEBUG: Found partial match '" << pair.first << "' at index " << pair.second << std::endl;
-            return pair.second;
-        }
+        if (index >= 0)
+            std::cout << "DEBUG: Resolved parameter '" << name << "' to index " << index
+                      << std::endl;
+        else
+            std::cout << "DEBUG: Parameter '" << name << "' not found!" << std::endl;
     }
-    
-    std::cout << "DEBUG: Parameter not found!" << std::endl;
-    return -1; // Not found
+
+    return index;
 }
 
 bool ParameterMapper::tryParameterVariations(const std::string &baseName, float value)
 {
-    std::string lower = toLower(baseName);
-    
     // Common variations to try
     std::vector<std::string> variations = {
         "A " + baseName,
@@ -357,7 +251,8 @@ bool ParameterMapper::tryParameterVariations(const std::string &baseName, float
         int index = findParameterIndex(variation);
         if (index >= 0)
         {
-            std::cout << "DEBUG: Found parameter variation: " << variation << " at index " << index << std::endl;
+            if (logging)
+                std::cout << "DEBUG: Found parameter variation: " << variation << " at index " << index << std::endl;
             
             auto param = synth->storage.getPatch().param_ptr[index];
             if (param) {
@@ -367,7 +262,8 @@ bool ParameterMapper::tryParameterVariations(const std::string &baseName, float
                 // For discrete parameters like oscillator types, use the value directly
                 if (param->valtype == vt_int || baseName.find("_type") != std::string::npos)
                 {
-                    std::cout << "DEBUG: Setting discrete parameter variation" << std::endl;
+                    if (logging)
+                        std::cout << "DEBUG: Setting discrete parameter variation" << std::endl;
                     int intValue = static_cast<int>(value);
                     
                     // Clamp to valid range
@@ -395,14 +291,16 @@ bool ParameterMapper::tryParameterVariations(const std::string &baseName, float
                     // Clamp to 0-1 range
                     normalizedValue = std::max(0.0f, std::min(1.0f, normalizedValue));
                     
-                    std::cout << "DEBUG: Setting continuous parameter variation with normalized value: " << normalizedValue << std::endl;
+                    if (logging)
+                        std::cout << "DEBUG: Setting continuous parameter variation with normalized value: " << normalizedValue << std::endl;
                     
                     // Set via the synth's parameter system to ensure proper notification
                     synth->setParameter01(synth->idForParameter(param), normalizedValue, false);
                 }
                 
                 float newValue = param->get_value_f01();
-                std::cout << "DEBUG: Parameter variation changed from " << oldValue << " to " << newValue << std::endl;
+                if (logging)
+                    std::cout << "DEBUG: Parameter variation changed from " << oldValue << " to " << newValue << std::endl;
                 
                 // Force parameter update
                 synth->storage.getPatch().isDirty = true;
@@ -412,7 +310,8 @@ bool ParameterMapper::tryParameterVariations(const std::string &baseName, float
         }
     }
     
-    std::cout << "DEBUG: No parameter variations found for: " << baseName << std::endl;
+    if (logging)
+        std::cout << "DEBUG: No parameter variations found for: " << baseName << std::endl;
     return false;
 }
 
@@ -469,46 +368,43 @@ bool ParameterMapper::applyModifications(const std::vector<PatchModification> &m
     bool allSuccess = true;
     int successCount = 0;
     
-    std::cout << "DEBUG: Applying " << modifications.size() << " modifications to synth" << std::endl;
+    if (logging)
+        std::cout << "DEBUG: Applying " << modifications.size() << " modifications to synth" << std::endl;
     
     for (const auto &mod : modifications)
     {
         bool success = setParameterFromName(mod.parameterName, mod.value);
         if (!success)
         {
-            std::cout << "Warning: Could not apply parameter modification: " 
-                      << mod.parameterName << " = " << mod.value 
-                      << " (" << mod.description << ")" << std::endl;
+            if (logging)
+                std::cout << "Warning: Could not apply parameter modification: " 
+                          << mod.parameterName << " = " << mod.value 
+                          << " (" << mod.description << ")" << std::endl;
             allSuccess = false;
         }
         else
         {
-            std::cout << "Applied: " << mod.parameterName << " = " << mod.value 
-                      << " (" << mod.description << ")" << std::endl;
+            if (logging)
+                std::cout << "Applied: " << mod.parameterName << " = " << mod.value 
+                          << " (" << mod.description << ")" << std::endl;
             successCount++;
         }
     }
     
-    std::cout << "DEBUG: Successfully applied " << successCount << " out of " << modifications.size() << " modifications" << std::endl;
+    if (logging)
+        std::cout << "DEBUG: Successfully applied " << successCount << " out of " << modifications.size() << " modifications" << std::endl;
     
     // Always mark patch as dirty if we applied any changes
     if (successCount > 0)
     {
         synth->storage.getPatch().isDirty = true;
         
-        std::cout << "DEBUG: Marked patch as dirty" << std::endl;
+        if (logging)
+            std::cout << "DEBUG: Marked patch as dirty" << std::endl;
     }
     
     return allSuccess;
 }
 
-std::string ParameterMapper::toLower(const std::string &str)
-{
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), 
-                   [](unsigned char c) { return std::tolower(c); });
-    return result;
-}
-
 } // namespace Claude
 } // namespace Surge
\ No newline at end of file
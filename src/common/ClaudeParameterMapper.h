@@ -20,6 +20,7 @@
 #include <unordered_map>
 #include <vector>
 #include "ClaudeAPIClient.h"
+#include "ClaudeParameterResolver.h"
 
 class SurgeSynthesizer;
 
@@ -40,14 +41,17 @@ class ParameterMapper
     std::string exportCurrentPatchInfo();
     bool applyModifications(const std::vector<PatchModification> &modifications);
 
+    // Off by default, so that resolving and applying a response does no console I/O
+    void setLoggingEnabled(bool b) { logging = b; }
+    bool isLoggingEnabled() const { return logging; }
+
+    const ParameterNameResolver &getResolver() const { return resolver; }
+
   private:
     SurgeSynthesizer *synth;
-    std::unordered_map<std::string, int> nameToIndexMap;
-    std::unordered_map<std::string, int> oscNameToIndexMap;
-    std::unordered_map<std::string, int> aliasToIndexMap;
-    
-    void buildAliasMap();
-    std::string toLower(const std::string &str);
+    ParameterNameResolver resolver;
+    bool logging{false};
+
     bool tryParameterVariations(const std::string &baseName, float value);
     
     // Common parameter aliases for natural language mapping
@@ -0,0 +1,348 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "ClaudeParameterResolver.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace Surge
+{
+namespace Claude
+{
+
+namespace
+{
+// A bucket which can't be placed in this many tries grows the table instead
+static constexpr uint32_t maxDisplacementTries = 1 << 16;
+
+uint64_t hashKey(const std::string &s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (auto c : s)
+    {
+        h ^= (uint8_t)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+size_t slotFor(uint64_t h, uint32_t displacement, size_t slotCount)
+{
+    return mix(h ^ (displacement * 0x9e3779b97f4a7c15ULL)) % slotCount;
+}
+
+uint32_t packTrigram(const std::string &s, size_t i)
+{
+    return ((uint32_t)(uint8_t)s[i] << 16) | ((uint32_t)(uint8_t)s[i + 1] << 8) |
+           (uint32_t)(uint8_t)s[i + 2];
+}
+
+int sceneRank(int scene) { return scene == 2 ? 1 : 0; }
+} // namespace
+
+void ParameterNameResolver::clear()
+{
+    names.clear();
+    displacements.clear();
+    slots.clear();
+    emptySlots = 0;
+    trigrams.clear();
+}
+
+std::string ParameterNameResolver::normalize(const std::string &name)
+{
+    std::string res;
+    res.reserve(name.size() + 4);
+
+    bool separate = false;
+    for (auto ch : name)
+    {
+        auto c = (unsigned char)ch;
+        // Bytes of multibyte UTF-8 characters are kept as letters
+        if (c < 0x80 && !std::isalnum(c))
+        {
+            separate = true;
+            continue;
+        }
+
+        if (c < 0x80)
+            c = (unsigned char)std::tolower(c);
+
+        if (!res.empty())
+        {
+            bool wasDigit = std::isdigit((unsigned char)res.back());
+            bool isDigit = std::isdigit(c);
+            if (separate || wasDigit != isDigit)
+                res += ' ';
+        }
+        res += (char)c;
+        separate = false;
+    }
+
+    return res;
+}
+
+void ParameterNameResolver::addName(const std::string &name, int index, int scene, Source source)
+{
+    auto key = normalize(name);
+    if (!key.empty())
+        names.push_back({std::move(key), index, scene, source});
+}
+
+bool ParameterNameResolver::ranksAbove(const Name &a, const Name &b) const
+{
+    if (sceneRank(a.scene) != sceneRank(b.scene))
+        return sceneRank(a.scene) < sceneRank(b.scene);
+    if (a.source != b.source)
+        return a.source < b.source;
+    if (a.key.size() != b.key.size())
+        return a.key.size() < b.key.size();
+    return a.index < b.index;
+}
+
+std::vector<std::string>
+ParameterNameResolver::build(const std::unordered_map<std::string, std::string> &aliases)
+{
+    trigrams.clear();
+    for (uint32_t id = 0; id < names.size(); ++id)
+    {
+        const auto &key = names[id].key;
+        // OSC addresses only ever match exactly
+        if (names[id].source == Source::OSCName || key.size() < 3)
+            continue;
+
+        for (size_t i = 0; i + 3 <= key.size(); ++i)
+        {
+            auto &postings = trigrams[packTrigram(key, i)];
+            if (postings.empty() || postings.back() != id)
+                postings.push_back(id);
+        }
+    }
+
+    std::unordered_map<std::string, size_t> best;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        auto res = best.emplace(names[i].key, i);
+        if (!res.second && ranksAbove(names[i], names[res.first->second]))
+            res.first->second = i;
+    }
+
+    std::vector<Slot> keys;
+    std::unordered_map<std::string, size_t> keyPosition;
+    keys.reserve(best.size() + aliases.size());
+    for (const auto &b : best)
+    {
+        keyPosition[b.first] = keys.size();
+        keys.push_back({b.first, names[b.second].index});
+    }
+
+    // Sorted so that aliases normalizing to the same key resolve the same way every time
+    std::vector<std::pair<std::string, std::string>> sortedAliases(aliases.begin(), aliases.end());
+    std::sort(sortedAliases.begin(), sortedAliases.end());
+
+    std::vector<std::string> unresolved;
+    for (const auto &alias : sortedAliases)
+    {
+        auto key = normalize(alias.first);
+        auto target = normalize(alias.second);
+
+        auto it = best.find(target);
+        int index = it != best.end() ? names[it->second].index : searchKey(target);
+        if (index < 0 || key.empty())
+        {
+            unresolved.push_back(alias.first);
+            continue;
+        }
+
+        auto pos = keyPosition.find(key);
+        if (pos != keyPosition.end())
+        {
+            keys[pos->second].index = index;
+        }
+        else
+        {
+            keyPosition[key] = keys.size();
+            keys.push_back({key, index});
+        }
+    }
+
+    buildPerfectHash(std::move(keys));
+    return unresolved;
+}
+
+void ParameterNameResolver::buildPerfectHash(std::vector<Slot> keys)
+{
+    displacements.clear();
+    slots.clear();
+    emptySlots = 0;
+
+    auto n = keys.size();
+    if (n == 0)
+        return;
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::vector<uint32_t>> buckets(n / 3 + 1);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        hashes[i] = hashKey(keys[i].key);
+        buckets[mix(hashes[i]) % buckets.size()].push_back(i);
+    }
+
+    // Largest buckets are the hardest to place, so they go while the table is emptiest
+    std::vector<uint32_t> order(buckets.size());
+    for (uint32_t b = 0; b < buckets.size(); ++b)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&buckets](auto a, auto b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    auto slotCount = n + n / 4 + 1;
+    std::vector<size_t> placed;
+    while (true)
+    {
+        displacements.assign(buckets.size(), 0);
+        std::vector<bool> used(slotCount, false);
+        bool ok = true;
+
+        for (auto b : order)
+        {
+            if (buckets[b].empty())
+                break;
+
+            bool fits = false;
+            for (uint32_t d = 1; d < maxDisplacementTries && !fits; ++d)
+            {
+                placed.clear();
+                fits = true;
+                for (auto k : buckets[b])
+                {
+                    auto s = slotFor(hashes[k], d, slotCount);
+                    if (used[s] || std::find(placed.begin(), placed.end(), s) != placed.end())
+                    {
+                        fits = false;
+                        break;
+                    }
+                    placed.push_back(s);
+                }
+
+                if (fits)
+                {
+                    for (auto s : placed)
+                        used[s] = true;
+                    displacements[b] = d;
+                }
+            }
+
+            if (!fits)
+            {
+                ok = false;
+                break;
+            }
+        }
+
+        if (ok)
+            break;
+        slotCount += slotCount / 8 + 1;
+    }
+
+    slots.resize(slotCount);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        auto d = displacements[mix(hashes[i]) % buckets.size()];
+        slots[slotFor(hashes[i], d, slotCount)] = std::move(keys[i]);
+    }
+    emptySlots = slotCount - n;
+}
+
+int ParameterNameResolver::lookupKey(const std::string &key) const
+{
+    if (slots.empty())
+        return -1;
+
+    auto h = hashKey(key);
+    auto d = displacements[mix(h) % displacements.size()];
+    if (d == 0)
+        return -1;
+
+    const auto &slot = slots[slotFor(h, d, slots.size())];
+    return slot.key == key ? slot.index : -1;
+}
+
+int ParameterNameResolver::searchKey(const std::string &key) const
+{
+    if (key.empty())
+        return -1;
+
+    const Name *found = nullptr;
+    auto consider = [&](const Name &n) {
+        if (n.source == Source::OSCName || n.key.find(key) == std::string::npos)
+            return;
+        if (!found || ranksAbove(n, *found))
+            found = &n;
+    };
+
+    if (key.size() < 3)
+    {
+        for (const auto &n : names)
+            consider(n);
+        return found ? found->index : -1;
+    }
+
+    // Every match contains every trigram of the key, so the rarest one bounds the candidates
+    const std::vector<uint32_t> *rarest = nullptr;
+    for (size_t i = 0; i + 3 <= key.size(); ++i)
+    {
+        auto it = trigrams.find(packTrigram(key, i));
+        if (it == trigrams.end())
+            return -1;
+        if (!rarest || it->second.size() < rarest->size())
+            rarest = &it->second;
+    }
+
+    for (auto id : *rarest)
+        consider(names[id]);
+    return found ? found->index : -1;
+}
+
+int ParameterNameResolver::resolveExact(const std::string &name) const
+{
+    return lookupKey(normalize(name));
+}
+
+int ParameterNameResolver::resolvePartial(const std::string &name) const
+{
+    return searchKey(normalize(name));
+}
+
+int ParameterNameResolver::resolve(const std::string &name) const
+{
+    auto key = normalize(name);
+    auto index = lookupKey(key);
+    return index >= 0 ? index : searchKey(key);
+}
+
+} // namespace Claude
+} // namespace Surge
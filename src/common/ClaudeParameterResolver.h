@@ -0,0 +1,116 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_CLAUDEPARAMETERRESOLVER_H
+#define SURGE_SRC_COMMON_CLAUDEPARAMETERRESOLVER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Surge
+{
+namespace Claude
+{
+
+/*
+ * Resolves the loose parameter names found in a response ("filter1_cutoff",
+ * "Filter 1 Cutoff", "cutoff") to an index into param_ptr.
+ *
+ * Every name is normalized first: lower case, any run of punctuation or space
+ * becomes one space, and letters and digits are split apart, so "Osc1-Pitch"
+ * and "osc 1 pitch" are the same key. Exact and alias keys live in a perfect
+ * hash built once, so a hit costs one hash of the query and a single
+ * string compare. Everything else falls back to a substring search through a
+ * trigram index, which only verifies names sharing the query's rarest
+ * trigram.
+ *
+ * An alias always owns its key. Otherwise, when names collide, scene A or the
+ * global section beats scene B, then full names beat short names which beat
+ * OSC names. Partial matches rank the same way and then prefer the shortest
+ * name, which is the tightest fit.
+ */
+class ParameterNameResolver
+{
+  public:
+    // In priority order
+    enum class Source : uint8_t
+    {
+        Alias,
+        FullName,
+        ShortName,
+        OSCName
+    };
+
+    void clear();
+
+    // scene follows Parameter::scene: 0 = patch, 1 = scene A, 2 = scene B
+    void addName(const std::string &name, int index, int scene, Source source);
+
+    /*
+     * Builds the lookup tables from the names added so far, then resolves each
+     * alias target through them. Returns the aliases whose target matched
+     * nothing.
+     */
+    std::vector<std::string>
+    build(const std::unordered_map<std::string, std::string> &aliases = {});
+
+    // -1 if nothing matches
+    int resolve(const std::string &name) const;
+    int resolveExact(const std::string &name) const;
+    int resolvePartial(const std::string &name) const;
+
+    size_t exactKeyCount() const { return slots.size() - emptySlots; }
+    size_t indexedNameCount() const { return names.size(); }
+
+    static std::string normalize(const std::string &name);
+
+  private:
+    struct Name
+    {
+        std::string key;
+        int index;
+        int scene;
+        Source source;
+    };
+
+    struct Slot
+    {
+        std::string key;
+        int index{-1};
+    };
+
+    std::vector<Name> names;
+
+    // The perfect hash: a key's bucket picks a displacement which places it
+    // in a slot of its own
+    std::vector<uint32_t> displacements;
+    std::vector<Slot> slots;
+    size_t emptySlots{0};
+
+    // Trigram to the names containing it, ascending and without repeats
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+
+    bool ranksAbove(const Name &a, const Name &b) const;
+    int lookupKey(const std::string &key) const;
+    int searchKey(const std::string &key) const;
+    void buildPerfectHash(std::vector<Slot> keys);
+};
+
+} // namespace Claude
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_CLAUDEPARAMETERRESOLVER_H
@@ -0,0 +1,205 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "ClaudeRequestExecutor.h"
+
+#include <algorithm>
+
+namespace Surge
+{
+namespace Claude
+{
+
+constexpr std::array<double, RequestExecutor::Metrics::latencyBuckets - 1>
+    RequestExecutor::Metrics::bucketUpperMs;
+
+int RequestExecutor::Context::remainingMs(int cap) const
+{
+    if (deadline == Clock::time_point::max())
+        return cap;
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return (int)std::clamp<int64_t>(ms, 0, cap);
+}
+
+size_t RequestExecutor::Metrics::bucketFor(double ms)
+{
+    for (size_t i = 0; i < bucketUpperMs.size(); ++i)
+        if (ms <= bucketUpperMs[i])
+            return i;
+    return latencyBuckets - 1;
+}
+
+RequestExecutor::RequestExecutor(size_t workers, size_t maxQueueDepth)
+    : maxQueueDepth(std::max(maxQueueDepth, (size_t)1))
+{
+    workers = std::max(workers, (size_t)1);
+    metrics.workers = workers;
+
+    threads.reserve(workers);
+    for (size_t i = 0; i < workers; ++i)
+        threads.emplace_back([this]() { workerLoop(); });
+}
+
+RequestExecutor::~RequestExecutor() { shutdown(); }
+
+bool RequestExecutor::runsBefore(const Queued &a, const Queued &b)
+{
+    if (a.job.priority != b.job.priority)
+        return a.job.priority > b.job.priority;
+    return a.sequence < b.sequence;
+}
+
+bool RequestExecutor::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        metrics.submitted++;
+
+        if (!stopping && queue.size() < maxQueueDepth)
+        {
+            queue.push_back({std::move(job), nextSequence++, Clock::now()});
+            // std heaps keep the largest on top, so invert runsBefore
+            std::push_heap(queue.begin(), queue.end(),
+                           [](const Queued &a, const Queued &b) { return runsBefore(b, a); });
+
+            metrics.queueDepth = queue.size();
+            metrics.peakQueueDepth = std::max(metrics.peakQueueDepth, queue.size());
+            cv.notify_one();
+            return true;
+        }
+
+        metrics.rejected++;
+    }
+
+    if (job.onDropped)
+        job.onDropped(Outcome::Rejected);
+    return false;
+}
+
+void RequestExecutor::drop(Job &job, Outcome o)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        if (o == Outcome::Cancelled)
+            metrics.cancelled++;
+        else if (o == Outcome::DeadlineExpired)
+            metrics.expired++;
+    }
+
+    if (job.onDropped)
+        job.onDropped(o);
+}
+
+void RequestExecutor::workerLoop()
+{
+    while (true)
+    {
+        Queued item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+
+            if (queue.empty())
+                return;
+
+            std::pop_heap(queue.begin(), queue.end(),
+                          [](const Queued &a, const Queued &b) { return runsBefore(b, a); });
+            item = std::move(queue.back());
+            queue.pop_back();
+
+            metrics.queueDepth = queue.size();
+            metrics.activeJobs++;
+        }
+
+        Context ctx{item.job.deadline, item.job.isCancelled};
+        auto startedAt = Clock::now();
+
+        if (ctx.cancelled())
+        {
+            drop(item.job, Outcome::Cancelled);
+        }
+        else if (ctx.expired())
+        {
+            drop(item.job, Outcome::DeadlineExpired);
+        }
+        else
+        {
+            if (item.job.run)
+                item.job.run(ctx);
+
+            auto done = Clock::now();
+            auto latency = std::chrono::duration<double, std::milli>(done - item.submittedAt).count();
+            auto wait = std::chrono::duration<double, std::milli>(startedAt - item.submittedAt).count();
+
+            std::lock_guard<std::mutex> g(mutex);
+            metrics.completed++;
+            metrics.latencyHistogram[Metrics::bucketFor(latency)]++;
+            metrics.totalLatencyMs += latency;
+            metrics.maxLatencyMs = std::max(metrics.maxLatencyMs, latency);
+            metrics.totalQueueWaitMs += wait;
+        }
+
+        std::lock_guard<std::mutex> g(mutex);
+        metrics.activeJobs--;
+    }
+}
+
+void RequestExecutor::shutdown()
+{
+    std::vector<Queued> dropped;
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        if (stopping && threads.empty())
+            return;
+
+        stopping = true;
+        dropped.swap(queue);
+        metrics.queueDepth = 0;
+    }
+    cv.notify_all();
+
+    for (auto &q : dropped)
+        if (q.job.onDropped)
+            q.job.onDropped(Outcome::ShutDown);
+
+    for (auto &t : threads)
+        if (t.joinable())
+            t.join();
+    threads.clear();
+}
+
+RequestExecutor::Metrics RequestExecutor::getMetrics() const
+{
+    std::lock_guard<std::mutex> g(mutex);
+    return metrics;
+}
+
+void RequestExecutor::resetMetrics()
+{
+    std::lock_guard<std::mutex> g(mutex);
+    auto workers = metrics.workers;
+    auto depth = metrics.queueDepth;
+    auto active = metrics.activeJobs;
+
+    metrics = Metrics();
+    metrics.workers = workers;
+    metrics.queueDepth = depth;
+    metrics.peakQueueDepth = depth;
+    metrics.activeJobs = active;
+}
+
+} // namespace Claude
+} // namespace Surge
@@ -0,0 +1,162 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_CLAUDEREQUESTEXECUTOR_H
+#define SURGE_SRC_COMMON_CLAUDEREQUESTEXECUTOR_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Surge
+{
+namespace Claude
+{
+
+/*
+ * A copyable cancellation flag. Every copy shares the same state, so the
+ * caller keeps one and the request checks another.
+ */
+class CancellationToken
+{
+  public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { *flag = true; }
+    bool isCancelled() const { return *flag; }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+enum class RequestPriority
+{
+    Background,
+    Normal,
+    Interactive
+};
+
+/*
+ * A fixed pool of worker threads serving a bounded priority queue. Higher
+ * priorities run first and equal priorities run in submission order. A job
+ * which is cancelled, or whose deadline passes, while it is still queued is
+ * never run; a running job is handed a Context it can poll to stop early.
+ *
+ * Every submitted job ends in exactly one of two ways: run is called, or
+ * onDropped is called with the reason it wasn't.
+ */
+class RequestExecutor
+{
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class Outcome
+    {
+        Completed,
+        Cancelled,
+        DeadlineExpired,
+        Rejected, // the queue was full
+        ShutDown
+    };
+
+    struct Context
+    {
+        Clock::time_point deadline;
+        std::function<bool()> isCancelled;
+
+        bool cancelled() const { return isCancelled && isCancelled(); }
+        bool expired() const { return Clock::now() >= deadline; }
+        bool shouldStop() const { return cancelled() || expired(); }
+
+        // Milliseconds until the deadline, clamped to [0, cap]
+        int remainingMs(int cap) const;
+    };
+
+    struct Job
+    {
+        RequestPriority priority{RequestPriority::Normal};
+        Clock::time_point deadline{Clock::time_point::max()};
+        std::function<bool()> isCancelled;
+        std::function<void(const Context &)> run;
+        std::function<void(Outcome)> onDropped;
+    };
+
+    struct Metrics
+    {
+        static constexpr size_t latencyBuckets = 10;
+        // Upper bounds of all but the last bucket, which is open ended
+        static constexpr std::array<double, latencyBuckets - 1> bucketUpperMs{
+            {10, 50, 100, 250, 500, 1000, 2500, 5000, 10000}};
+
+        size_t workers{0};
+        size_t queueDepth{0}, peakQueueDepth{0}, activeJobs{0};
+        uint64_t submitted{0}, completed{0}, cancelled{0}, expired{0}, rejected{0};
+
+        // Submission to completion, completed jobs only
+        std::array<uint64_t, latencyBuckets> latencyHistogram{};
+        double totalLatencyMs{0}, maxLatencyMs{0};
+        double totalQueueWaitMs{0};
+
+        double meanLatencyMs() const { return completed ? totalLatencyMs / completed : 0.0; }
+        double meanQueueWaitMs() const { return completed ? totalQueueWaitMs / completed : 0.0; }
+        static size_t bucketFor(double ms);
+    };
+
+    explicit RequestExecutor(size_t workers = 2, size_t maxQueueDepth = 32);
+    ~RequestExecutor();
+
+    // Returns false, after calling job.onDropped(Rejected), if the queue is full or shut down
+    bool submit(Job job);
+
+    // Drops everything queued with ShutDown and joins the workers once running jobs finish
+    void shutdown();
+
+    Metrics getMetrics() const;
+    void resetMetrics();
+
+  private:
+    struct Queued
+    {
+        Job job;
+        uint64_t sequence;
+        Clock::time_point submittedAt;
+    };
+
+    size_t maxQueueDepth;
+    std::vector<std::thread> threads;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Queued> queue; // a heap, see runsBefore
+    uint64_t nextSequence{0};
+    bool stopping{false};
+    Metrics metrics;
+
+    static bool runsBefore(const Queued &a, const Queued &b);
+    void workerLoop();
+    void drop(Job &job, Outcome o);
+};
+
+} // namespace Claude
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_CLAUDEREQUESTEXECUTOR_H
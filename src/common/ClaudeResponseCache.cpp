@@ -0,0 +1,256 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "ClaudeResponseCache.h"
+#include "filesystem/import.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace Surge
+{
+namespace Claude
+{
+
+namespace
+{
+static constexpr const char *cacheFileExtension = ".resp";
+
+uint64_t fnv1a64(const std::string &s, uint64_t h)
+{
+    for (auto c : s)
+    {
+        h ^= (uint8_t)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void appendHex(std::string &out, uint64_t v)
+{
+    static const char *digits = "0123456789abcdef";
+    for (int i = 60; i >= 0; i -= 4)
+        out += digits[(v >> i) & 0xF];
+}
+} // namespace
+
+ResponseCache::ResponseCache(size_t memoryCapacity, size_t diskCapacity)
+    : memoryCapacity(std::max(memoryCapacity, (size_t)1)), diskCapacity(diskCapacity)
+{
+}
+
+void ResponseCache::setDirectory(const std::string &dir)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    directory = dir;
+}
+
+std::string ResponseCache::getDirectory() const
+{
+    std::lock_guard<std::mutex> g(mutex);
+    return directory;
+}
+
+std::string ResponseCache::makeKey(const std::string &model, const std::string &prompt,
+                                   const std::string &ragContext)
+{
+    /*
+     * Each part is length prefixed so that moving text between the prompt and
+     * the context can't produce the same key, and the whole thing is hashed
+     * twice with different offsets for a 128 bit file name.
+     */
+    std::string material;
+    material.reserve(model.size() + prompt.size() + ragContext.size() + 64);
+    for (const auto *part : {&model, &prompt, &ragContext})
+    {
+        material += std::to_string(part->size());
+        material += ':';
+        material += *part;
+    }
+
+    std::string key;
+    key.reserve(32);
+    appendHex(key, fnv1a64(material, 0xcbf29ce484222325ULL));
+    appendHex(key, fnv1a64(material, 0x84222325cbf29ce4ULL));
+    return key;
+}
+
+bool ResponseCache::lookup(const std::string &key, std::string &responseText)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            lru.splice(lru.begin(), lru, it->second);
+            responseText = it->second->second;
+            memoryHits++;
+            return true;
+        }
+    }
+
+    if (readDisk(key, responseText))
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        insertMemory(key, responseText);
+        diskHits++;
+        return true;
+    }
+
+    misses++;
+    return false;
+}
+
+void ResponseCache::store(const std::string &key, const std::string &responseText)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        insertMemory(key, responseText);
+    }
+    writeDisk(key, responseText);
+}
+
+void ResponseCache::insertMemory(const std::string &key, const std::string &responseText)
+{
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+        it->second->second = responseText;
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+
+    lru.emplace_front(key, responseText);
+    entries[key] = lru.begin();
+
+    while (lru.size() > memoryCapacity)
+    {
+        entries.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+bool ResponseCache::readDisk(const std::string &key, std::string &responseText) const
+{
+    auto dir = getDirectory();
+    if (dir.empty())
+        return false;
+
+    std::ifstream in(string_to_path(dir) / (key + cacheFileExtension), std::ios::binary);
+    if (!in)
+        return false;
+
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    responseText = ss.str();
+    return true;
+}
+
+void ResponseCache::writeDisk(const std::string &key, const std::string &responseText) const
+{
+    auto dir = getDirectory();
+    if (dir.empty() || diskCapacity == 0)
+        return;
+
+    try
+    {
+        auto dirPath = string_to_path(dir);
+        fs::create_directories(dirPath);
+
+        auto target = dirPath / (key + cacheFileExtension);
+        auto tmp = dirPath / (key + ".tmp");
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+            out.write(responseText.data(), responseText.size());
+            if (!out)
+                return;
+        }
+        fs::rename(tmp, target);
+
+        pruneDisk();
+    }
+    catch (const fs::filesystem_error &)
+    {
+        // The disk tier is best effort; the memory tier still has the entry
+    }
+}
+
+void ResponseCache::pruneDisk() const
+{
+    auto dirPath = string_to_path(getDirectory());
+
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    for (const auto &e : fs::directory_iterator(dirPath))
+    {
+        if (e.is_regular_file() && e.path().extension() == cacheFileExtension)
+            files.emplace_back(e.last_write_time(), e.path());
+    }
+
+    if (files.size() <= diskCapacity)
+        return;
+
+    // Oldest first
+    std::sort(files.begin(), files.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    std::error_code ec;
+    for (size_t i = 0; i < files.size() - diskCapacity; ++i)
+        fs::remove(files[i].second, ec);
+}
+
+void ResponseCache::clear(bool alsoDisk)
+{
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        lru.clear();
+        entries.clear();
+    }
+
+    auto dir = getDirectory();
+    if (!alsoDisk || dir.empty())
+        return;
+
+    std::error_code ec;
+    for (const auto &e : fs::directory_iterator(string_to_path(dir), ec))
+    {
+        if (e.path().extension() == cacheFileExtension)
+            fs::remove(e.path(), ec);
+    }
+}
+
+ResponseCache::Stats ResponseCache::getStats() const
+{
+    Stats s;
+    s.memoryHits = memoryHits;
+    s.diskHits = diskHits;
+    s.misses = misses;
+    s.coalesced = coalesced;
+    return s;
+}
+
+void ResponseCache::resetStats()
+{
+    memoryHits = 0;
+    diskHits = 0;
+    misses = 0;
+    coalesced = 0;
+}
+
+} // namespace Claude
+} // namespace Surge
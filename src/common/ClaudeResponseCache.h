@@ -0,0 +1,94 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_CLAUDERESPONSECACHE_H
+#define SURGE_SRC_COMMON_CLAUDERESPONSECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Surge
+{
+namespace Claude
+{
+
+/*
+ * A content addressed cache of Claude response texts. Entries are keyed on
+ * the model, the full prompt and the RAG context, so an identical request
+ * never goes back to the network. Lookups try a small in-memory LRU first
+ * and then one file per entry in an on-disk directory, which survives
+ * restarts. Disk hits are promoted into memory.
+ *
+ * Only successful responses should be stored; errors are worth retrying.
+ * All methods are safe to call from any thread.
+ */
+class ResponseCache
+{
+  public:
+    struct Stats
+    {
+        uint64_t memoryHits{0};
+        uint64_t diskHits{0};
+        uint64_t misses{0};
+        uint64_t coalesced{0}; // requests which waited on an identical one already in flight
+
+        uint64_t hits() const { return memoryHits + diskHits; }
+    };
+
+    explicit ResponseCache(size_t memoryCapacity = 64, size_t diskCapacity = 1024);
+
+    // An empty directory disables the disk tier
+    void setDirectory(const std::string &dir);
+    std::string getDirectory() const;
+
+    static std::string makeKey(const std::string &model, const std::string &prompt,
+                               const std::string &ragContext);
+
+    bool lookup(const std::string &key, std::string &responseText);
+    void store(const std::string &key, const std::string &responseText);
+
+    // Drops the memory tier, and the disk tier too if alsoDisk is set
+    void clear(bool alsoDisk = false);
+
+    void noteCoalesced() { coalesced++; }
+    Stats getStats() const;
+    void resetStats();
+
+  private:
+    typedef std::list<std::pair<std::string, std::string>> LRUList;
+
+    size_t memoryCapacity, diskCapacity;
+    std::string directory;
+
+    mutable std::mutex mutex;
+    LRUList lru; // most recently used first
+    std::unordered_map<std::string, LRUList::iterator> entries;
+
+    std::atomic<uint64_t> memoryHits{0}, diskHits{0}, misses{0}, coalesced{0};
+
+    void insertMemory(const std::string &key, const std::string &responseText);
+    bool readDisk(const std::string &key, std::string &responseText) const;
+    void writeDisk(const std::string &key, const std::string &responseText) const;
+    void pruneDisk() const;
+};
+
+} // namespace Claude
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_CLAUDERESPONSECACHE_H
@@ -0,0 +1,318 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "ClaudeStreaming.h"
+#include "ClaudeAPIClient.h"
+
+#include <algorithm>
+#include <regex>
+
+namespace Surge
+{
+namespace Claude
+{
+
+void SSEParser::feed(const char *bytes, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto c = bytes[i];
+        if (c == '\n')
+        {
+            if (!pendingLine.empty() && pendingLine.back() == '\r')
+                pendingLine.pop_back();
+            feedLine(pendingLine);
+            pendingLine.clear();
+        }
+        else
+        {
+            pendingLine += c;
+        }
+    }
+}
+
+void SSEParser::feedLine(const std::string &line)
+{
+    if (line.empty())
+    {
+        dispatch();
+        return;
+    }
+
+    if (line[0] == ':')
+        return;
+
+    auto colon = line.find(':');
+    auto field = line.substr(0, colon);
+    std::string value;
+    if (colon != std::string::npos)
+    {
+        value = line.substr(colon + 1);
+        if (!value.empty() && value[0] == ' ')
+            value.erase(0, 1);
+    }
+
+    if (field == "event")
+    {
+        eventName = value;
+    }
+    else if (field == "data")
+    {
+        if (hasData)
+            data += '\n';
+        data += value;
+        hasData = true;
+    }
+}
+
+void SSEParser::finish()
+{
+    if (!pendingLine.empty())
+    {
+        feedLine(pendingLine);
+        pendingLine.clear();
+    }
+    dispatch();
+}
+
+void SSEParser::dispatch()
+{
+    if (hasData)
+        onEvent(eventName.empty() ? "message" : eventName, data);
+
+    eventName.clear();
+    data.clear();
+    hasData = false;
+}
+
+bool extractJSONStringField(const std::string &json, const std::string &field, std::string &out)
+{
+    auto key = "\"" + field + "\"";
+    size_t pos = 0;
+
+    while ((pos = json.find(key, pos)) != std::string::npos)
+    {
+        pos += key.size();
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t'))
+            pos++;
+
+        // A match that isn't followed by a colon was a value, not a key
+        if (pos >= json.size() || json[pos] != ':')
+            continue;
+        pos++;
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t'))
+            pos++;
+
+        if (pos >= json.size() || json[pos] != '"')
+            return false;
+        pos++;
+
+        out.clear();
+        while (pos < json.size() && json[pos] != '"')
+        {
+            auto c = json[pos++];
+            if (c != '\\' || pos >= json.size())
+            {
+                out += c;
+                continue;
+            }
+
+            auto e = json[pos++];
+            switch (e)
+            {
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u':
+            {
+                if (pos + 4 > json.size())
+                    return false;
+                auto cp = (uint32_t)std::stoul(json.substr(pos, 4), nullptr, 16);
+                pos += 4;
+
+                // Surrogate pairs for characters outside the BMP
+                if (cp >= 0xD800 && cp < 0xDC00 && pos + 6 <= json.size() && json[pos] == '\\' &&
+                    json[pos + 1] == 'u')
+                {
+                    auto lo = (uint32_t)std::stoul(json.substr(pos + 2, 4), nullptr, 16);
+                    pos += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+
+                if (cp < 0x80)
+                {
+                    out += (char)cp;
+                }
+                else if (cp < 0x800)
+                {
+                    out += (char)(0xC0 | (cp >> 6));
+                    out += (char)(0x80 | (cp & 0x3F));
+                }
+                else if (cp < 0x10000)
+                {
+                    out += (char)(0xE0 | (cp >> 12));
+                    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                    out += (char)(0x80 | (cp & 0x3F));
+                }
+                else
+                {
+                    out += (char)(0xF0 | (cp >> 18));
+                    out += (char)(0x80 | ((cp >> 12) & 0x3F));
+                    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                    out += (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                // \" \\ \/
+                out += e;
+                break;
+            }
+        }
+
+        return pos < json.size();
+    }
+
+    return false;
+}
+
+std::vector<PatchModification> ModificationStreamParser::feed(const std::string &chunk)
+{
+    std::vector<PatchModification> res;
+    text += chunk;
+
+    for (auto c : chunk)
+    {
+        if (c == '\n')
+        {
+            parseLine(pendingLine, res);
+            pendingLine.clear();
+        }
+        else
+        {
+            pendingLine += c;
+        }
+    }
+
+    emitted += res.size();
+    return res;
+}
+
+std::vector<PatchModification> ModificationStreamParser::finish()
+{
+    std::vector<PatchModification> res;
+    if (!pendingLine.empty())
+    {
+        parseLine(pendingLine, res);
+        pendingLine.clear();
+    }
+
+    if (emitted + res.size() == 0)
+        res.swap(undashed);
+    undashed.clear();
+
+    emitted += res.size();
+    return res;
+}
+
+void ModificationStreamParser::parseLine(std::string line, std::vector<PatchModification> &out)
+{
+    // The same patterns extractModifications uses, applied to a single line
+    static const std::regex paramRegex(
+        R"(-\s*([a-zA-Z0-9_\s]+):\s*([-+]?[0-9]*\.?[0-9]+(?:[eE][-+]?[0-9]+)?)(?:\s*\(([^)]*)\))?)");
+    static const std::regex altParamRegex(
+        R"(([a-zA-Z0-9_\s]+):\s*([-+]?[0-9]*\.?[0-9]+(?:[eE][-+]?[0-9]+)?)(?:\s*\(([^)]*)\))?)");
+
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+
+    if (!inParameters)
+    {
+        std::string lower = line;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        auto header = lower.find("parameters:");
+        if (header == std::string::npos)
+            return;
+
+        inParameters = true;
+        line = line.substr(header);
+    }
+
+    auto toModification = [](const std::smatch &match, PatchModification &mod) {
+        std::string paramName = match[1].str();
+        paramName.erase(0, paramName.find_first_not_of(" \t\r\n"));
+        paramName.erase(paramName.find_last_not_of(" \t\r\n") + 1);
+        mod.parameterName = paramName;
+        mod.value = std::stof(match[2].str());
+        mod.description = (match.size() > 3 && match[3].matched) ? match[3].str() : "";
+    };
+
+    bool dashed = false;
+    for (std::sregex_iterator it(line.begin(), line.end(), paramRegex), end; it != end; ++it)
+    {
+        PatchModification mod;
+        toModification(*it, mod);
+        out.push_back(mod);
+        dashed = true;
+    }
+
+    if (dashed || emitted + out.size() > 0)
+        return;
+
+    for (std::sregex_iterator it(line.begin(), line.end(), altParamRegex), end; it != end; ++it)
+    {
+        PatchModification mod;
+        toModification(*it, mod);
+        if (mod.parameterName == "PARAMETERS" || mod.parameterName.empty())
+            continue;
+        undashed.push_back(mod);
+    }
+}
+
+void StreamedModificationApplier::streamed(const std::vector<PatchModification> &mods)
+{
+    if (mods.empty())
+        return;
+
+    apply(mods);
+    applied += mods.size();
+}
+
+size_t StreamedModificationApplier::finish(const std::vector<PatchModification> &all)
+{
+    // The stream parser hands back the batch parser's modifications in order
+    if (all.size() <= applied)
+        return 0;
+
+    std::vector<PatchModification> rest(all.begin() + applied, all.end());
+    apply(rest);
+    applied = all.size();
+    return rest.size();
+}
+
+} // namespace Claude
+} // namespace Surge
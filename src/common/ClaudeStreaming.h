@@ -0,0 +1,125 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_CLAUDESTREAMING_H
+#define SURGE_SRC_COMMON_CLAUDESTREAMING_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Surge
+{
+namespace Claude
+{
+
+struct PatchModification;
+
+/*
+ * Splits a text/event-stream into events. Bytes can arrive in arbitrary
+ * chunks; an event is dispatched when its terminating blank line arrives.
+ * Multiple data lines are joined with newlines, comments are ignored.
+ */
+class SSEParser
+{
+  public:
+    typedef std::function<void(const std::string &event, const std::string &data)> EventCallback;
+
+    explicit SSEParser(EventCallback cb) : onEvent(std::move(cb)) {}
+
+    void feed(const char *bytes, size_t n);
+
+    // One line without its terminator, as juce::InputStream::readNextLine returns it
+    void feedLine(const std::string &line);
+
+    // Dispatches any event left without a trailing blank line at end of stream
+    void finish();
+
+  private:
+    EventCallback onEvent;
+    std::string pendingLine, eventName, data;
+    bool hasData{false};
+
+    void dispatch();
+};
+
+/*
+ * Extracts a string field from a flat JSON object and unescapes it, for
+ * pulling "text" out of a content_block_delta without a JSON library.
+ * Returns false if the field is absent.
+ */
+bool extractJSONStringField(const std::string &json, const std::string &field, std::string &out);
+
+/*
+ * The line by line counterpart of APIClient::extractModifications. Text is
+ * fed as it streams in, and every "- name: value" line in the PARAMETERS
+ * section is handed back as soon as its newline arrives.
+ *
+ * Like the batch parser, undashed "name: value" lines only count when no
+ * dashed ones were found. They are held back until finish() decides.
+ */
+class ModificationStreamParser
+{
+  public:
+    // Returns the modifications completed by this chunk of text
+    std::vector<PatchModification> feed(const std::string &text);
+
+    // Parses the unterminated last line and resolves the undashed fallback
+    std::vector<PatchModification> finish();
+
+    const std::string &getText() const { return text; }
+    size_t getModificationCount() const { return emitted; }
+
+  private:
+    std::string text, pendingLine;
+    bool inParameters{false};
+    size_t emitted{0};
+    std::vector<PatchModification> undashed;
+
+    void parseLine(std::string line, std::vector<PatchModification> &out);
+};
+
+/*
+ * Applies each parameter change of a reply once. Streamed batches are applied as they arrive,
+ * and since the final response repeats every modification, finish() only applies the ones
+ * the stream didn't deliver. Otherwise a control the user moved while the reply streamed
+ * would be set back by the final response.
+ */
+class StreamedModificationApplier
+{
+  public:
+    typedef std::function<void(const std::vector<PatchModification> &)> ApplyFunction;
+
+    explicit StreamedModificationApplier(ApplyFunction fn) : apply(std::move(fn)) {}
+
+    // Call before each request
+    void reset() { applied = 0; }
+
+    void streamed(const std::vector<PatchModification> &mods);
+
+    // Applies what is left of the final response's modifications and returns how many that was
+    size_t finish(const std::vector<PatchModification> &all);
+
+    size_t getAppliedCount() const { return applied; }
+
+  private:
+    ApplyFunction apply;
+    size_t applied{0};
+};
+
+} // namespace Claude
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_CLAUDESTREAMING_H
@@ -23,10 +23,58 @@
 #ifndef SURGE_SRC_COMMON_MEMORYPOOL_H
 #define SURGE_SRC_COMMON_MEMORYPOOL_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
 namespace Surge
 {
 namespace Memory
 {
+/*
+ * A fixed size queue of pointers between exactly one producer thread and one
+ * consumer thread, which never locks or allocates.
+ */
+template <typename T, size_t size> struct PointerHandoff
+{
+    bool push(T *t)
+    {
+        auto w = writePos.load(std::memory_order_relaxed);
+        if (w - readPos.load(std::memory_order_acquire) >= size)
+            return false;
+        slots[w % size] = t;
+        writePos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+    T *pop()
+    {
+        auto r = readPos.load(std::memory_order_relaxed);
+        if (r == writePos.load(std::memory_order_acquire))
+            return nullptr;
+        auto t = slots[r % size];
+        readPos.store(r + 1, std::memory_order_release);
+        return t;
+    }
+    size_t count() const
+    {
+        return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T *, size> slots{};
+    std::atomic<size_t> writePos{0}, readPos{0};
+};
+
+/*
+ * The pool itself belongs to one thread, which for us is the audio thread. When
+ * it runs low, it asks for more items rather than making them, and a refill
+ * thread calls serviceRefills to make them and hand them over. Items given back
+ * with releaseToPreAllocSize go the other way to be deleted. The owning thread
+ * only allocates in getItem if the pool is completely empty because the refill
+ * thread hasn't caught up.
+ */
 // pre-alloc must be at least one
 template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> struct MemoryPool
 {
@@ -39,9 +87,14 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
     {
         for (size_t i = 0; i < position; ++i)
             delete pool[i];
+        while (auto t = fresh.pop())
+            delete t;
+        while (auto t = retired.pop())
+            delete t;
     }
     template <typename... Args> T *getItem(Args &&...args)
     {
+        takeRefills();
         if (position == 0)
         {
             refreshPool(std::forward<Args>(args)...);
@@ -49,6 +102,9 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
         auto q = pool[position - 1];
         pool[position - 1] = nullptr; // just to flag bugs
         position--;
+
+        if (position < preAlloc)
+            requestPoolSize(preAlloc + growBy);
         return q;
     }
     void returnItem(T *t)
@@ -58,8 +114,7 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
     }
     template <typename... Args> void refreshPool(Args &&...args)
     {
-        // In an ideal world, this grow would be off thread.
-        // For XT 1 leave it here and have a reasonable prealloc
+        // Only when the refill thread is behind, so this allocates on the owning thread
         assert(position < (growBy + capacity));
         for (size_t i = 0; i < growBy; ++i)
         {
@@ -68,6 +123,34 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
         }
     }
 
+    // Owning thread: ask the refill thread to bring the pool up to at least upTo items
+    void requestPoolSize(size_t upTo)
+    {
+        upTo = std::min(upTo, capacity);
+        auto have = position + fresh.count();
+        if (have < upTo)
+            refillWanted.store(upTo - have, std::memory_order_release);
+    }
+
+    // Refill thread: make whatever was asked for and delete whatever was given back
+    template <typename... Args> void serviceRefills(Args &&...args)
+    {
+        auto n = refillWanted.exchange(0, std::memory_order_acq_rel);
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto t = new T(std::forward<Args>(args)...);
+            if (!fresh.push(t))
+            {
+                delete t;
+                break;
+            }
+        }
+
+        while (auto t = retired.pop())
+            delete t;
+    }
+
+    // Allocates right here, so not for the audio thread; use requestPoolSize there
     template <typename... Args> void setupPoolToSize(size_t upTo, Args &&...args)
     {
         while (position < upTo)
@@ -87,6 +170,20 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
         }
     }
 
+    // Like returnToPreAllocSize, but the refill thread does the deleting
+    void releaseToPreAllocSize()
+    {
+        while (position > preAlloc)
+        {
+            auto t = pool[position - 1];
+            pool[position - 1] = nullptr;
+            position--;
+
+            if (!retired.push(t))
+                delete t;
+        }
+    }
+
     std::array<T *, capacity> pool;
 
     /*
@@ -95,6 +192,22 @@ template <typename T, size_t preAlloc, size_t growBy, size_t capacity = 16384> s
      * position -1. position == 0 is a sentinel to rebuild.
      */
     size_t position{0};
+
+  private:
+    PointerHandoff<T, capacity> fresh, retired;
+    std::atomic<size_t> refillWanted{0};
+
+    void takeRefills()
+    {
+        while (position < capacity)
+        {
+            auto t = fresh.pop();
+            if (!t)
+                break;
+            pool[position] = t;
+            position++;
+        }
+    }
 };
 } // namespace Memory
 } // namespace Surge
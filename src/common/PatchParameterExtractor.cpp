@@ -18,9 +18,15 @@
 #include "Parameter.h"
 #include "PatchFileHeaderStructs.h"
 #include "filesystem/import.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 using namespace sst::basic_blocks::mechanics;
 
@@ -147,13 +153,29 @@ bool PatchParameterExtractor::extractFromFile(const std::string& fxpPath, Extrac
 {
     lastError.clear();
     
+    try
+    {
+        // Create a temporary patch object to load the data
+        SurgePatch tempPatch(storage);
+        return extractWithPatch(fxpPath, tempPatch, outData, lastError);
+    }
+    catch (const std::exception& e)
+    {
+        lastError = "Error extracting from file: " + std::string(e.what());
+        return false;
+    }
+}
+
+bool PatchParameterExtractor::extractWithPatch(const std::string& fxpPath, SurgePatch& patch,
+                                               ExtractedPatchData& outData, std::string& error)
+{
     try
     {
         // Read the entire FXP file
         std::ifstream file(fxpPath, std::ios::binary);
         if (!file.is_open())
         {
-            lastError = "Cannot open file: " + fxpPath;
+            error = "Cannot open file: " + fxpPath;
             return false;
         }
         
@@ -166,7 +188,7 @@ bool PatchParameterExtractor::extractFromFile(const std::string& fxpPath, Extrac
         const size_t MAX_PATCH_SIZE = 4 * 1024 * 1024; // 4MB limit
         if (fileSize > MAX_PATCH_SIZE)
         {
-            lastError = "File too large (possibly corrupted): " + fxpPath + " (" + std::to_string(fileSize) + " bytes)";
+            error = "File too large (possibly corrupted): " + fxpPath + " (" + std::to_string(fileSize) + " bytes)";
             return false;
         }
         
@@ -177,18 +199,16 @@ bool PatchParameterExtractor::extractFromFile(const std::string& fxpPath, Extrac
         
         if (fileSize == 0)
         {
-            lastError = "Empty file: " + fxpPath;
+            error = "Empty file: " + fxpPath;
             return false;
         }
         
-        // Create a temporary patch object to load the data
-        SurgePatch tempPatch(storage);
-        
-        // Load the patch data using Surge's existing loader
-        tempPatch.load_patch(fileData.data(), static_cast<int>(fileSize), true);
+        // Reset whatever the previous file left behind, then use Surge's existing loader
+        patch.init_default_values();
+        patch.load_patch(fileData.data(), static_cast<int>(fileSize), true);
         
         // Extract parameters from the loaded patch
-        bool success = extractFromPatch(tempPatch, outData);
+        bool success = extractPatchData(patch, outData, error);
         
         // If patch name is empty, use filename as fallback
         if (success && outData.name.empty())
@@ -208,7 +228,7 @@ bool PatchParameterExtractor::extractFromFile(const std::string& fxpPath, Extrac
     }
     catch (const std::exception& e)
     {
-        lastError = "Error extracting from file: " + std::string(e.what());
+        error = "Error extracting from file: " + std::string(e.what());
         return false;
     }
 }
@@ -216,7 +236,12 @@ bool PatchParameterExtractor::extractFromFile(const std::string& fxpPath, Extrac
 bool PatchParameterExtractor::extractFromPatch(const SurgePatch& patch, ExtractedPatchData& outData)
 {
     lastError.clear();
-    
+    return extractPatchData(patch, outData, lastError);
+}
+
+bool PatchParameterExtractor::extractPatchData(const SurgePatch& patch, ExtractedPatchData& outData,
+                                               std::string& error)
+{
     try
     {
         // Extract metadata
@@ -239,7 +264,7 @@ bool PatchParameterExtractor::extractFromPatch(const SurgePatch& patch, Extracte
     }
     catch (const std::exception& e)
     {
-        lastError = "Error extracting patch parameters: " + std::string(e.what());
+        error = "Error extracting patch parameters: " + std::string(e.what());
         return false;
     }
 }
@@ -326,6 +351,17 @@ std::vector<ExtractedPatchData> PatchParameterExtractor::extractFromDirectory(co
 {
     std::vector<ExtractedPatchData> results;
     lastError.clear();
+    lastStats = ExtractionStats();
+    
+    auto startTime = std::chrono::steady_clock::now();
+    
+    struct FileEntry
+    {
+        std::string path;
+        int64_t mtime;
+        uintmax_t size;
+    };
+    std::vector<FileEntry> files;
     
     try
     {
@@ -339,16 +375,9 @@ std::vector<ExtractedPatchData> PatchParameterExtractor::extractFromDirectory(co
         {
             if (entry.is_regular_file() && entry.path().extension() == ".fxp")
             {
-                ExtractedPatchData data;
-                if (extractFromFile(entry.path().string(), data))
-                {
-                    results.push_back(std::move(data));
-                }
-                else
-                {
-                    std::cout << "Warning: Failed to extract " << entry.path() 
-                             << " - " << lastError << std::endl;
-                }
+                files.push_back({entry.path().string(),
+                                 (int64_t)entry.last_write_time().time_since_epoch().count(),
+                                 entry.file_size()});
             }
         }
     }
@@ -357,6 +386,134 @@ std::vector<ExtractedPatchData> PatchParameterExtractor::extractFromDirectory(co
         lastError = "Error scanning directory: " + std::string(e.what());
     }
     
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.path < b.path; });
+    lastStats.filesScanned = files.size();
+    
+    // Anything whose path, mtime and size match the manifest doesn't need parsing again
+    std::vector<size_t> work;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        auto it = manifest.find(files[i].path);
+        if (it == manifest.end() || it->second.mtime != files[i].mtime || it->second.size != files[i].size)
+            work.push_back(i);
+    }
+    
+    std::vector<ExtractedPatchData> parsed(work.size());
+    std::vector<std::string> errors(work.size());
+    std::vector<char> ok(work.size(), 0);
+    
+    /*
+     * Each worker owns a contiguous slice of the work list and a private
+     * storage whose patch is reused for every file. A worker which finishes
+     * its slice steals from the others by bumping their cursors, so one slow
+     * directory doesn't leave the rest of the pool idle.
+     */
+    int nThreads = maxThreads > 0 ? maxThreads : (int)std::thread::hardware_concurrency();
+    nThreads = std::max(1, std::min(nThreads, (int)(work.size() / 16)));
+    lastStats.threads = nThreads;
+    
+    if (nThreads == 1)
+    {
+        try
+        {
+            SurgePatch patch(storage);
+            for (size_t w = 0; w < work.size(); ++w)
+                ok[w] = extractWithPatch(files[work[w]].path, patch, parsed[w], errors[w]);
+        }
+        catch (const std::exception& e)
+        {
+            lastError = "Error extracting from directory: " + std::string(e.what());
+        }
+    }
+    else
+    {
+        struct Slice
+        {
+            std::atomic<size_t> next{0};
+            size_t end{0};
+        };
+        std::vector<Slice> slices(nThreads);
+        for (int t = 0; t < nThreads; ++t)
+        {
+            slices[t].next = work.size() * t / nThreads;
+            slices[t].end = work.size() * (t + 1) / nThreads;
+        }
+        
+        // Storage construction isn't thread safe, so build the worker storages up front
+        std::vector<std::unique_ptr<SurgeStorage>> workerStorage;
+        SurgeStorage::SurgeStorageConfig config;
+        config.suppliedDataPath = storage->datapath.u8string();
+        config.createUserDirectory = false;
+        config.scanWavetableAndPatches = false;
+        for (int t = 0; t < nThreads; ++t)
+            workerStorage.push_back(std::make_unique<SurgeStorage>(config));
+        
+        auto worker = [&](int self) {
+            auto& patch = workerStorage[self]->getPatch();
+            for (int v = 0; v < nThreads; ++v)
+            {
+                auto& slice = slices[(self + v) % nThreads];
+                for (auto w = slice.next.fetch_add(1); w < slice.end; w = slice.next.fetch_add(1))
+                    ok[w] = extractWithPatch(files[work[w]].path, patch, parsed[w], errors[w]);
+            }
+        };
+        
+        std::vector<std::thread> threads;
+        for (int t = 1; t < nThreads; ++t)
+            threads.emplace_back(worker, t);
+        worker(0);
+        for (auto& t : threads)
+            t.join();
+    }
+    
+    for (size_t w = 0; w < work.size(); ++w)
+    {
+        const auto& f = files[work[w]];
+        if (ok[w])
+        {
+            manifest[f.path] = {f.mtime, f.size, std::move(parsed[w])};
+            lastStats.extracted++;
+        }
+        else
+        {
+            manifest.erase(f.path);
+            lastStats.failed++;
+            std::cout << "Warning: Failed to extract " << f.path 
+                     << " - " << errors[w] << std::endl;
+        }
+    }
+    
+    /*
+     * Forget files under this directory which have been removed since the
+     * last run. Scanned paths are dirPath joined with the rest, so match on
+     * dirPath plus a separator, or ".../User" would claim ".../User Backup".
+     */
+    auto under = dirPath;
+    auto sep = (char)fs::path::preferred_separator;
+    if (!under.empty() && under.back() != '/' && under.back() != sep)
+        under += sep;
+
+    std::unordered_set<std::string> present;
+    for (const auto& f : files)
+        present.insert(f.path);
+    for (auto it = manifest.begin(); it != manifest.end();)
+    {
+        if (it->first.compare(0, under.size(), under) == 0 && present.count(it->first) == 0)
+            it = manifest.erase(it);
+        else
+            ++it;
+    }
+    
+    results.reserve(files.size());
+    for (const auto& f : files)
+    {
+        auto it = manifest.find(f.path);
+        if (it != manifest.end())
+            results.push_back(it->second.data);
+    }
+    lastStats.reused = results.size() - lastStats.extracted;
+    
+    lastStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     return results;
 }
 
@@ -19,6 +19,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <cstdint>
 
 class SurgeStorage;
 class SurgePatch;
@@ -96,6 +97,22 @@ struct ExtractedPatchData
     static std::unordered_map<std::string, float> getParameterWeights();
 };
 
+// Counters from the most recent extractFromDirectory call
+struct ExtractionStats
+{
+    size_t filesScanned = 0;
+    size_t extracted = 0;      // Parsed this run
+    size_t reused = 0;         // Unchanged since the last run, served from the manifest
+    size_t failed = 0;
+    int threads = 0;
+    double seconds = 0.0;
+
+    double patchesPerSecond() const
+    {
+        return seconds > 0.0 ? (extracted + reused) / seconds : 0.0;
+    }
+};
+
 class PatchParameterExtractor
 {
 public:
@@ -108,9 +125,22 @@ public:
     // Extract parameters from loaded patch
     bool extractFromPatch(const SurgePatch& patch, ExtractedPatchData& outData);
     
-    // Batch extract from directory
+    /*
+     * Batch extract from directory. Files are parsed on a pool of worker
+     * threads, each with its own storage and patch which is reused for every
+     * file it handles. Results are remembered in a manifest keyed on path,
+     * modification time and size, so calling this again only re-parses files
+     * which changed. Results come back in path order regardless of threading.
+     */
     std::vector<ExtractedPatchData> extractFromDirectory(const std::string& dirPath);
     
+    // 0 means use the hardware concurrency; 1 extracts on the calling thread
+    void setMaxThreads(int t) { maxThreads = t; }
+    const ExtractionStats& getLastExtractionStats() const { return lastStats; }
+    
+    void clearManifest() { manifest.clear(); }
+    size_t getManifestSize() const { return manifest.size(); }
+    
     // Get error messages
     const std::string& getLastError() const { return lastError; }
     
@@ -118,6 +148,26 @@ private:
     SurgeStorage* storage;
     std::string lastError;
     
+    int maxThreads = 0;
+    ExtractionStats lastStats;
+    
+    struct ManifestEntry
+    {
+        int64_t mtime = 0;
+        uintmax_t size = 0;
+        ExtractedPatchData data;
+    };
+    std::unordered_map<std::string, ManifestEntry> manifest;
+    
+    /*
+     * Parses one file into patch, which is reset first so it can be reused.
+     * Only touches its arguments, so it is safe to call from several threads
+     * as long as each has its own patch (and that patch its own storage).
+     */
+    bool extractWithPatch(const std::string& fxpPath, SurgePatch& patch,
+                          ExtractedPatchData& outData, std::string& error);
+    bool extractPatchData(const SurgePatch& patch, ExtractedPatchData& outData, std::string& error);
+    
     // Helper functions
     bool loadFXPFile(const std::string& fxpPath, std::vector<char>& outData);
     void extractSceneParameters(const SurgePatch& patch, int scene, 
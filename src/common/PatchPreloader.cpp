@@ -0,0 +1,231 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#include "PatchPreloader.h"
+#include "PatchFileHeaderStructs.h"
+#include "SurgeStorage.h"
+
+#include "sst/basic-blocks/mechanics/endian-ops.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace mech = sst::basic_blocks::mechanics;
+
+namespace Surge
+{
+namespace Storage
+{
+
+namespace
+{
+// Bounds how late a switch notification can be if its wakeup is missed
+static constexpr auto workerPollInterval = std::chrono::milliseconds(50);
+} // namespace
+
+PatchPreloader::~PatchPreloader()
+{
+    {
+        std::lock_guard<std::mutex> g(queueMutex);
+        running = false;
+    }
+    queueCV.notify_all();
+
+    if (worker && worker->joinable())
+        worker->join();
+}
+
+void PatchPreloader::preload(int patchId, int categoryId, const std::string &name,
+                             const fs::path &path)
+{
+    if (isPreloaded(patchId))
+        return;
+
+    {
+        std::lock_guard<std::mutex> g(queueMutex);
+        Entry e;
+        e.patchId = patchId;
+        e.categoryId = categoryId;
+        e.name = name;
+        e.path = path;
+        queue.push_back(std::move(e));
+        startWorkerIfNeeded();
+    }
+    queueCV.notify_one();
+}
+
+void PatchPreloader::setQueue(std::vector<Entry> &&patches)
+{
+    if (patches.size() > maxPreloaded)
+        patches.resize(maxPreloaded);
+
+    {
+        std::lock_guard<std::mutex> g(cacheMutex);
+        cache.erase(std::remove_if(cache.begin(), cache.end(),
+                                   [&patches](const auto &c) {
+                                       return std::none_of(
+                                           patches.begin(), patches.end(),
+                                           [&c](const auto &p) { return p.patchId == c->patchId; });
+                                   }),
+                    cache.end());
+    }
+
+    {
+        std::lock_guard<std::mutex> g(queueMutex);
+        queue.clear();
+        for (auto &p : patches)
+        {
+            if (!isPreloaded(p.patchId))
+                queue.push_back(std::move(p));
+        }
+        if (!queue.empty())
+            startWorkerIfNeeded();
+    }
+    queueCV.notify_one();
+}
+
+bool PatchPreloader::isPreloaded(int patchId)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return std::any_of(cache.begin(), cache.end(),
+                       [patchId](const auto &e) { return e->patchId == patchId; });
+}
+
+void PatchPreloader::postPatchSwitched(int patchId)
+{
+    switchedPatchId = patchId;
+    // Not under the mutex, since this comes from the audio thread; the worker polls anyway
+    queueCV.notify_one();
+}
+
+bool PatchPreloader::readPatchChunk(const fs::path &path, std::unique_ptr<char[]> &data,
+                                    int &size)
+{
+    using namespace sst::io;
+
+    std::filebuf f;
+    if (!f.open(path, std::ios::binary | std::ios::in))
+        return false;
+
+    fxChunkSetCustom fxp;
+    if (f.sgetn(reinterpret_cast<char *>(&fxp), sizeof(fxp)) != sizeof(fxp) ||
+        mech::endian_read_int32BE(fxp.chunkMagic) != 'CcnK' ||
+        mech::endian_read_int32BE(fxp.fxMagic) != 'FPCh' ||
+        mech::endian_read_int32BE(fxp.fxID) != 'cjs3')
+        return false;
+
+    size = mech::endian_read_int32BE(fxp.chunkSize);
+    if (size <= 0)
+        return false;
+
+    data.reset(new char[size]);
+    return f.sgetn(data.get(), size) == size;
+}
+
+bool PatchPreloader::parsePatchXML(const char *data, int size, TiXmlDocument &doc)
+{
+    using namespace sst::io;
+
+    if (size >= 4 && !memcmp(data, "sub3", 4))
+    {
+        if (size < (int)sizeof(patch_header))
+            return false;
+
+        patch_header ph;
+        memcpy(&ph, data, sizeof(ph));
+        int xmlSize = mech::endian_read_int32LE(ph.xmlsize);
+        if (xmlSize < 0 || xmlSize > size - (int)sizeof(patch_header))
+            return false;
+
+        return SurgePatch::parse_xml(data + sizeof(patch_header), xmlSize, doc);
+    }
+
+    return SurgePatch::parse_xml(data, size, doc);
+}
+
+void PatchPreloader::startWorkerIfNeeded()
+{
+    // Called holding queueMutex
+    if (!worker)
+        worker = std::make_unique<std::thread>([this]() { workerLoop(); });
+}
+
+void PatchPreloader::workerLoop()
+{
+    while (true)
+    {
+        Entry next;
+        bool haveNext{false};
+
+        {
+            std::unique_lock<std::mutex> g(queueMutex);
+            queueCV.wait_for(g, workerPollInterval, [this]() {
+                return !running || !queue.empty() || switchedPatchId >= 0;
+            });
+
+            if (!running)
+                return;
+
+            if (!queue.empty())
+            {
+                next = std::move(queue.front());
+                queue.erase(queue.begin());
+                haveNext = true;
+            }
+        }
+
+        auto switched = switchedPatchId.exchange(-1);
+        if (switched >= 0 && onPatchSwitched)
+            onPatchSwitched(switched);
+
+        if (!haveNext || isPreloaded(next.patchId))
+            continue;
+
+        auto e = std::make_unique<Entry>(std::move(next));
+        // A file which won't read just stays out, so switching to it takes the usual path
+        // and reports the problem there
+        try
+        {
+            e->xml = std::make_unique<TiXmlDocument>();
+            if (readPatchChunk(e->path, e->data, e->size) &&
+                parsePatchXML(e->data.get(), e->size, *e->xml))
+                addToCache(std::move(e));
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+}
+
+void PatchPreloader::addToCache(std::unique_ptr<Entry> e)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (cache.size() >= maxPreloaded)
+        cache.erase(cache.begin());
+    cache.push_back(std::move(e));
+}
+
+} // namespace Storage
+} // namespace Surge
@@ -0,0 +1,140 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#ifndef SURGE_SRC_COMMON_PATCHPRELOADER_H
+#define SURGE_SRC_COMMON_PATCHPRELOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem/import.h"
+#include "tinyxml/tinyxml.h"
+
+namespace Surge
+{
+namespace Storage
+{
+
+/*
+ * Patches read into memory ahead of time, so that switching to one doesn't
+ * have to wait on the disk.
+ *
+ * Normally a patch change fades the synth out, halts the engine and starts a
+ * thread which reads the .fxp and loads it, and the output stays silent until
+ * that thread is done. A patch which is preloaded here already has its chunk
+ * in memory, so the synth can load it right on the audio thread at a block
+ * boundary, the same way it loads state from the DAW, with only a short fade
+ * either side.
+ *
+ * Files are read, and their xml parsed, on a worker thread of our own, which only starts once
+ * something asks for a preload. setQueue is meant for setlists: give it the
+ * next few patches and it keeps exactly those in memory. The audio thread only
+ * ever try_locks the cache, so while it's being changed a lookup just misses.
+ */
+class PatchPreloader
+{
+  public:
+    struct Entry
+    {
+        int patchId{-1};
+        int categoryId{-1};
+        std::string name;
+        fs::path path;
+
+        // The patch chunk which follows the .fxp header, as loadRaw takes it
+        std::unique_ptr<char[]> data;
+        int size{0};
+        // Its xml, parsed here so the switch only has to apply it
+        std::unique_ptr<TiXmlDocument> xml;
+    };
+
+    static constexpr int maxPreloaded = 16;
+
+    PatchPreloader() = default;
+    ~PatchPreloader();
+
+    // Not from the audio thread. Each of these is the patch_list entry for the id.
+    void preload(int patchId, int categoryId, const std::string &name, const fs::path &path);
+    // Drops whatever isn't in the list, then preloads the rest of it, in order
+    void setQueue(std::vector<Entry> &&patches);
+
+    /*
+     * Audio thread. Calls f with the entry for the patch, if it's in memory and the
+     * cache isn't busy, and returns whether it did. The entry is only valid during f.
+     */
+    template <typename F> bool withPreloadedPatch(int patchId, F &&f)
+    {
+        std::unique_lock<std::mutex> g(cacheMutex, std::try_to_lock);
+        if (!g.owns_lock())
+            return false;
+
+        for (auto &e : cache)
+        {
+            if (e->patchId == patchId)
+            {
+                f(*e);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isPreloaded(int patchId);
+
+    /*
+     * The audio thread can't call the patch loaded listeners itself, so after it
+     * switches patch it posts the id here, and the worker calls this with it.
+     */
+    std::function<void(int patchId)> onPatchSwitched;
+    void postPatchSwitched(int patchId);
+
+    // Reads and checks the .fxp, returning false if it isn't a Surge patch
+    static bool readPatchChunk(const fs::path &path, std::unique_ptr<char[]> &data, int &size);
+    // Parses the xml in a chunk as SurgePatch::load_patch finds it
+    static bool parsePatchXML(const char *data, int size, TiXmlDocument &doc);
+
+  private:
+    std::mutex cacheMutex;
+    std::vector<std::unique_ptr<Entry>> cache;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCV;
+    std::vector<Entry> queue;
+    bool running{true};
+    std::unique_ptr<std::thread> worker;
+    std::atomic<int> switchedPatchId{-1};
+
+    void startWorkerIfNeeded();
+    void workerLoop();
+    void addToCache(std::unique_ptr<Entry> e);
+};
+
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_PATCHPRELOADER_H
@@ -0,0 +1,325 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "PatchTextIndex.h"
+#include "PatchVectorDB.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <iterator>
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+namespace
+{
+// Feature kinds are mixed into the hash so a word and a trigram with the same letters differ
+static constexpr uint32_t wordSeed = 0x811c9dc5;
+static constexpr uint32_t trigramSeed = 0x9e3779b9;
+
+// Name matches matter most, the generated description least
+static constexpr float nameWeight = 2.0f;
+static constexpr float categoryWeight = 1.0f;
+static constexpr float descriptionWeight = 0.5f;
+static constexpr float trigramWeight = 0.5f;
+
+inline uint32_t fnv1a(const char *s, size_t n, uint32_t seed)
+{
+    auto h = seed;
+    for (size_t i = 0; i < n; ++i)
+    {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+inline void forEachTrigram(const std::string &bordered, uint32_t seed,
+                           const std::function<void(uint32_t)> &f)
+{
+    for (size_t i = 0; i + 3 <= bordered.size(); ++i)
+        f(fnv1a(bordered.data() + i, 3, seed));
+}
+
+std::vector<uint32_t> intersectSorted(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+{
+    std::vector<uint32_t> res;
+    res.reserve(std::min(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
+    return res;
+}
+} // namespace
+
+std::vector<std::string> TextIndex::tokenize(const std::string &text)
+{
+    std::vector<std::string> res;
+    std::string cur;
+
+    for (auto c : text)
+    {
+        auto u = (unsigned char)c;
+        // Bytes >= 128 are kept so UTF-8 names still tokenize into words
+        if (std::isalnum(u) || u >= 128)
+        {
+            cur += (char)std::tolower(u);
+        }
+        else if (!cur.empty())
+        {
+            res.push_back(cur);
+            cur.clear();
+        }
+    }
+
+    if (!cur.empty())
+        res.push_back(cur);
+
+    return res;
+}
+
+void TextIndex::clear()
+{
+    idf.clear();
+    documentCount = 0;
+    trigramPostings.clear();
+    shortTokenPostings.clear();
+    matrix.clear();
+}
+
+void TextIndex::accumulateFeatures(const std::string &text, float weight,
+                                   std::vector<float> &tf) const
+{
+    for (const auto &tok : tokenize(text))
+    {
+        tf[fnv1a(tok.data(), tok.size(), wordSeed) % embeddingDims] += weight;
+
+        auto bordered = "#" + tok + "#";
+        forEachTrigram(bordered, trigramSeed,
+                       [&](uint32_t h) { tf[h % embeddingDims] += weight * trigramWeight; });
+    }
+}
+
+void TextIndex::documentFeatures(const PatchVector &pv, std::vector<float> &tf) const
+{
+    tf.assign(embeddingDims, 0.f);
+    accumulateFeatures(pv.name, nameWeight, tf);
+    accumulateFeatures(pv.category, categoryWeight, tf);
+    accumulateFeatures(pv.description, descriptionWeight, tf);
+}
+
+void TextIndex::fitIDF(const std::vector<uint32_t> &documentFrequency)
+{
+    idf.resize(embeddingDims);
+    for (size_t b = 0; b < embeddingDims; ++b)
+        idf[b] = std::log((1.f + documentCount) / (1.f + documentFrequency[b])) + 1.f;
+}
+
+std::vector<float> TextIndex::weightAndNormalize(std::vector<float> &tf) const
+{
+    if (!idf.empty())
+    {
+        for (size_t b = 0; b < embeddingDims; ++b)
+            tf[b] *= idf[b];
+    }
+
+    std::vector<float> res(embeddingDims, 0.f);
+    PatchMatrix::AlignedBuffer tmp(embeddingDims / PatchMatrix::floatsPerBlock);
+    if (PatchMatrix::normalizeInto(tf.data(), embeddingDims, tmp.front().v, embeddingDims))
+        std::copy(tmp.front().v, tmp.front().v + embeddingDims, res.begin());
+    return res;
+}
+
+std::vector<float> TextIndex::embed(const std::string &text) const
+{
+    std::vector<float> tf(embeddingDims, 0.f);
+    accumulateFeatures(text, 1.f, tf);
+    return weightAndNormalize(tf);
+}
+
+void TextIndex::indexDocument(const PatchVector &pv, uint32_t id)
+{
+    auto post = [id](std::vector<uint32_t> &list) {
+        // Ids only ever increase, so checking the tail is enough to dedupe within a document
+        if (list.empty() || list.back() != id)
+            list.push_back(id);
+    };
+
+    for (const auto *field : {&pv.name, &pv.category, &pv.description})
+    {
+        for (const auto &tok : tokenize(*field))
+        {
+            if (tok.size() < 3)
+                post(shortTokenPostings[tok]);
+            else
+                forEachTrigram(tok, trigramSeed, [&](uint32_t h) { post(trigramPostings[h]); });
+        }
+    }
+}
+
+void TextIndex::build(std::vector<PatchVector> &patches)
+{
+    clear();
+    documentCount = patches.size();
+
+    std::vector<float> tf;
+    std::vector<uint32_t> documentFrequency(embeddingDims, 0);
+    for (const auto &pv : patches)
+    {
+        documentFeatures(pv, tf);
+        for (size_t b = 0; b < embeddingDims; ++b)
+            if (tf[b] > 0.f)
+                documentFrequency[b]++;
+    }
+    fitIDF(documentFrequency);
+
+    for (size_t i = 0; i < patches.size(); ++i)
+    {
+        documentFeatures(patches[i], tf);
+        patches[i].textEmbedding = weightAndNormalize(tf);
+        matrix.append(patches[i].textEmbedding);
+        indexDocument(patches[i], (uint32_t)i);
+    }
+}
+
+void TextIndex::add(PatchVector &pv)
+{
+    /*
+     * Refitting the IDF here would leave every row already stored weighted
+     * differently from this one and from the queries, so the weights stay as
+     * built and the owner rebuilds once enough has been added.
+     */
+    std::vector<float> tf;
+    documentFeatures(pv, tf);
+
+    auto id = (uint32_t)matrix.rows();
+    pv.textEmbedding = weightAndNormalize(tf);
+    matrix.append(pv.textEmbedding);
+    indexDocument(pv, id);
+}
+
+void TextIndex::candidates(const std::vector<std::string> &tokens, std::vector<uint32_t> &out) const
+{
+    out.clear();
+
+    for (const auto &tok : tokens)
+    {
+        if (tok.size() < 3)
+        {
+            auto it = shortTokenPostings.find(tok);
+            if (it != shortTokenPostings.end())
+                out.insert(out.end(), it->second.begin(), it->second.end());
+            continue;
+        }
+
+        // A patch contains the word only if it contains all of its trigrams
+        std::vector<const std::vector<uint32_t> *> lists;
+        bool missing = false;
+        forEachTrigram(tok, trigramSeed, [&](uint32_t h) {
+            auto it = trigramPostings.find(h);
+            if (it == trigramPostings.end())
+                missing = true;
+            else
+                lists.push_back(&it->second);
+        });
+
+        if (missing || lists.empty())
+            continue;
+
+        std::sort(lists.begin(), lists.end(),
+                  [](const auto *a, const auto *b) { return a->size() < b->size(); });
+
+        auto hits = *lists.front();
+        for (size_t i = 1; i < lists.size() && !hits.empty(); ++i)
+            hits = intersectSorted(hits, *lists[i]);
+
+        out.insert(out.end(), hits.begin(), hits.end());
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void TextIndex::search(const std::string &text, TopKSelector &selector) const
+{
+    if (matrix.empty())
+        return;
+
+    std::vector<uint32_t> cands;
+    candidates(tokenize(text), cands);
+    if (cands.empty())
+        return;
+
+    PatchMatrix::AlignedBuffer query;
+    if (!matrix.prepareQuery(embed(text), query))
+        return;
+
+    for (auto c : cands)
+    {
+        auto s = matrix.score(query.front().v, c);
+        if (s > 0.f)
+            selector.push(c, s);
+    }
+}
+
+void TextIndex::searchMany(const std::vector<std::string> &queries,
+                           std::vector<TopKSelector> &selectors) const
+{
+    if (matrix.empty() || selectors.size() < queries.size())
+        return;
+
+    // Candidate lists come back sorted by row, which the block walk below relies on
+    std::vector<PatchMatrix::AlignedBuffer> prepared(queries.size());
+    std::vector<std::vector<uint32_t>> cands(queries.size());
+    std::vector<size_t> cursor(queries.size(), 0);
+
+    for (size_t q = 0; q < queries.size(); ++q)
+    {
+        candidates(tokenize(queries[q]), cands[q]);
+        if (cands[q].empty() || !matrix.prepareQuery(embed(queries[q]), prepared[q]))
+            cands[q].clear();
+    }
+
+    for (size_t blockStart = 0; blockStart < matrix.rows(); blockStart += rowsPerScoringBlock)
+    {
+        auto blockEnd = blockStart + rowsPerScoringBlock;
+
+        for (size_t q = 0; q < queries.size(); ++q)
+        {
+            const auto &c = cands[q];
+            auto &i = cursor[q];
+            const auto *qv = c.empty() ? nullptr : prepared[q].front().v;
+
+            for (; i < c.size() && c[i] < blockEnd; ++i)
+            {
+                auto s = matrix.score(qv, c[i]);
+                if (s > 0.f)
+                    selectors[q].push(c[i], s);
+            }
+        }
+    }
+}
+
+std::vector<SearchHit> TextIndex::search(const std::string &text, size_t topK) const
+{
+    TopKSelector selector(std::min(topK, matrix.rows()));
+    search(text, selector);
+    return selector.take();
+}
+
+} // namespace PatchDB
+} // namespace Surge
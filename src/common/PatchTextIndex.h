@@ -0,0 +1,100 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_PATCHTEXTINDEX_H
+#define SURGE_SRC_COMMON_PATCHTEXTINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PatchVectorSearch.h"
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+/*
+ * A small local text embedding for patch search. Each token contributes its
+ * own hash and the hashes of its character trigrams (with word boundary
+ * markers) to a fixed size TF-IDF vector, so "basses" still lands near
+ * "bass" without any model files. The IDF weights are fitted on the patch
+ * set when the index is built and stay fixed until the next build, so every
+ * stored row and every query is weighted the same way.
+ *
+ * Next to the embeddings sits an inverted index from trigrams to patches.
+ * A query only scores patches which contain every trigram of at least one
+ * query word (the old substring rule), so the cost is proportional to the
+ * matches rather than the size of the library.
+ */
+class TextIndex
+{
+  public:
+    static constexpr size_t embeddingDims = 256;
+
+    // Embeds every patch (filling PatchVector::textEmbedding) and indexes it
+    void build(std::vector<PatchVector> &patches);
+
+    // Embeds and indexes one more patch with the IDF weights fitted at build
+    void add(PatchVector &pv);
+
+    void clear();
+    size_t size() const { return matrix.rows(); }
+
+    // How many patches the IDF weights were fitted on; rebuild once size() outgrows it
+    size_t fittedSize() const { return documentCount; }
+
+    std::vector<float> embed(const std::string &text) const;
+
+    // The best topK indexed patches matching the query, scored by cosine similarity
+    std::vector<SearchHit> search(const std::string &text, size_t topK) const;
+    void search(const std::string &text, TopKSelector &selector) const;
+
+    /*
+     * Scores several queries in one pass over the matrix. Rows are visited a
+     * block at a time and every query scores its candidates in that block
+     * before moving on, so a row is pulled into cache once however many
+     * queries match it. selectors[i] receives the hits for
+     * queries[i] and must already be sized for the k wanted.
+     */
+    void searchMany(const std::vector<std::string> &queries,
+                    std::vector<TopKSelector> &selectors) const;
+    static constexpr size_t rowsPerScoringBlock = 32;
+
+    static std::vector<std::string> tokenize(const std::string &text);
+
+  private:
+    std::vector<float> idf;
+    size_t documentCount{0};
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigramPostings;
+    std::unordered_map<std::string, std::vector<uint32_t>> shortTokenPostings;
+
+    PatchMatrix matrix;
+
+    void fitIDF(const std::vector<uint32_t> &documentFrequency);
+    void accumulateFeatures(const std::string &text, float weight, std::vector<float> &tf) const;
+    void documentFeatures(const PatchVector &pv, std::vector<float> &tf) const;
+    std::vector<float> weightAndNormalize(std::vector<float> &tf) const;
+    void indexDocument(const PatchVector &pv, uint32_t id);
+    void candidates(const std::vector<std::string> &tokens, std::vector<uint32_t> &out) const;
+};
+
+} // namespace PatchDB
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_PATCHTEXTINDEX_H
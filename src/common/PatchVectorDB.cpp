@@ -17,7 +17,9 @@
 #include "PatchParameterExtractor.h"
 #include "SurgeStorage.h"
 #include "filesystem/import.h"
+#include "juce_core/juce_core.h"
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
@@ -27,20 +29,108 @@ namespace Surge
 namespace PatchDB
 {
 
+namespace
+{
+/*
+ * On-disk layout for saveToFile / loadFromFile. Everything is written in
+ * native byte order; the endian tag makes a file from a foreign machine fail
+ * to load (and get rebuilt) rather than load garbage.
+ */
+static constexpr char dbFileMagic[8] = {'S', 'U', 'R', 'G', 'E', 'P', 'V', 'D'};
+static constexpr uint32_t dbFileVersion = 2;
+static constexpr uint32_t dbFileEndianTag = 0x01020304;
+
+struct DBFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t endianTag;
+    uint32_t dims;
+    uint32_t stride;
+    uint32_t reserved;
+    uint64_t patchCount;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t rawOffset;
+    uint64_t normalizedOffset;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+    uint64_t fileSize;
+    uint64_t sourceFileCount;
+    int64_t sourceNewestMTime;
+    uint64_t sourceTotalSize;
+};
+
+enum DBStringField
+{
+    dbs_name = 0,
+    dbs_category,
+    dbs_author,
+    dbs_description,
+    dbs_filePath,
+    dbs_tags,
+
+    n_dbs_fields
+};
+
+struct DBPatchRecord
+{
+    uint32_t offset[n_dbs_fields];
+    uint32_t length[n_dbs_fields];
+    uint32_t hasParameters;
+    uint32_t reserved;
+};
+
+uint64_t alignUp(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+
+// Tags are stored as key=value lines in a single string
+std::string encodeTags(const std::unordered_map<std::string, std::string>& tags)
+{
+    std::string res;
+    for (const auto& t : tags)
+        res += t.first + "=" + t.second + "\n";
+    return res;
+}
+
+void decodeTags(const char* s, size_t n, std::unordered_map<std::string, std::string>& tags)
+{
+    size_t start = 0;
+    while (start < n)
+    {
+        auto end = start;
+        while (end < n && s[end] != '\n')
+            end++;
+
+        auto eq = start;
+        while (eq < end && s[eq] != '=')
+            eq++;
+
+        if (eq < end)
+            tags[std::string(s + start, eq - start)] = std::string(s + eq + 1, end - eq - 1);
+
+        start = end + 1;
+    }
+}
+} // namespace
+
 float PatchVector::cosineSimilarity(const PatchVector& other) const
 {
-    if (parameterVector.size() != other.parameterVector.size())
+    auto a = parameters();
+    auto b = other.parameters();
+    if (a.size() != b.size())
         return 0.0f;
     
     float dotProduct = 0.0f;
     float normA = 0.0f;
     float normB = 0.0f;
     
-    for (size_t i = 0; i < parameterVector.size(); ++i)
+    for (size_t i = 0; i < a.size(); ++i)
     {
-        dotProduct += parameterVector[i] * other.parameterVector[i];
-        normA += parameterVector[i] * parameterVector[i];
-        normB += other.parameterVector[i] * other.parameterVector[i];
+        dotProduct += a[i] * b[i];
+        normA += a[i] * a[i];
+        normB += b[i] * b[i];
     }
     
     if (normA == 0.0f || normB == 0.0f)
@@ -51,13 +141,15 @@ float PatchVector::cosineSimilarity(const PatchVector& other) const
 
 float PatchVector::euclideanDistance(const PatchVector& other) const
 {
-    if (parameterVector.size() != other.parameterVector.size())
+    auto a = parameters();
+    auto b = other.parameters();
+    if (a.size() != b.size())
         return std::numeric_limits<float>::max();
     
     float sum = 0.0f;
-    for (size_t i = 0; i < parameterVector.size(); ++i)
+    for (size_t i = 0; i < a.size(); ++i)
     {
-        float diff = parameterVector[i] - other.parameterVector[i];
+        float diff = a[i] - b[i];
         sum += diff * diff;
     }
     
@@ -73,6 +165,7 @@ VectorDatabase::~VectorDatabase() = default;
 void VectorDatabase::buildFromFactoryPatches()
 {
     patches.clear();
+    invalidateSearchIndex();
     
     // Get factory patch directories  
     auto factoryPath = fs::path(storage->datapath) / "patches_factory";
@@ -118,6 +211,9 @@ void VectorDatabase::buildFromFactoryPatches()
     }
     
     std::cout << "Loaded " << patches.size() << " patches into vector database" << std::endl;
+
+    rebuildSearchIndex();
+    ensureTextIndex();
 }
 
 void VectorDatabase::addPatch(const std::string& path)
@@ -133,6 +229,7 @@ void VectorDatabase::addPatch(const std::string& path)
         pv.parameterVector = patchData.toNormalizedVector();
         
         patches.push_back(pv);
+        appendToSearchIndex(patches.back());
     }
     else
     {
@@ -165,76 +262,471 @@ PatchVector VectorDatabase::extractPatchVector(const std::string& patchPath)
     return pv;
 }
 
-std::vector<PatchVector> VectorDatabase::findSimilarPatches(const PatchVector& query, int topK)
+void VectorDatabase::rebuildSearchIndex()
 {
-    std::vector<std::pair<float, size_t>> similarities;
-    
-    for (size_t i = 0; i < patches.size(); ++i)
+    parameterMatrix.build(patches);
+    if (annIndex)
+        annIndex->build(parameterMatrix);
+    searchIndexDirty = false;
+}
+
+void VectorDatabase::ensureSearchIndex()
+{
+    if (searchIndexDirty || parameterMatrix.rows() != patches.size())
+        rebuildSearchIndex();
+}
+
+void VectorDatabase::ensureTextIndex()
+{
+    if (textIndexDirty || textIndex.size() != patches.size())
     {
-        float sim = query.cosineSimilarity(patches[i]);
-        similarities.push_back({sim, i});
+        textIndex.build(patches);
+        textIndexDirty = false;
     }
-    
-    // Sort by similarity (descending)
-    std::sort(similarities.begin(), similarities.end(), 
-              [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    // Return top K
+}
+
+void VectorDatabase::appendToSearchIndex(PatchVector &pv)
+{
+    /*
+     * If an index was already stale, the next search rebuilds it anyway. The
+     * text index keeps the IDF weights it was built with, so it is also
+     * rebuilt once the library has doubled since then.
+     */
+    if (textIndexDirty || textIndex.size() + 1 != patches.size() ||
+        patches.size() > 2 * std::max(textIndex.fittedSize(), (size_t)16))
+        textIndexDirty = true;
+    else
+        textIndex.add(pv);
+
+    auto params = pv.parameters();
+    if (searchIndexDirty || parameterMatrix.rows() + 1 != patches.size() ||
+        !parameterMatrix.append(params.begin(), params.size()))
+    {
+        searchIndexDirty = true;
+        return;
+    }
+
+    if (annIndex)
+        annIndex->add(parameterMatrix, parameterMatrix.rows() - 1);
+}
+
+void VectorDatabase::setNearestNeighbourIndex(std::unique_ptr<NearestNeighbourIndex> index)
+{
+    annIndex = std::move(index);
+    invalidateSearchIndex();
+}
+
+std::vector<PatchVector> VectorDatabase::copyHits(const std::vector<SearchHit> &hits) const
+{
     std::vector<PatchVector> results;
-    for (int i = 0; i < std::min(topK, (int)similarities.size()); ++i)
+    results.reserve(hits.size());
+    for (const auto &h : hits)
     {
-        results.push_back(patches[similarities[i].second]);
+        // Results may outlive the mapping the stored patches point into
+        results.push_back(patches[h.index]);
+        results.back().materializeParameters();
     }
-    
     return results;
 }
 
+std::vector<SearchHit> VectorDatabase::findSimilarPatchHitsExact(const std::vector<float> &params,
+                                                                 int topK)
+{
+    ensureSearchIndex();
+
+    TopKSelector selector(std::max(topK, 0));
+    PatchMatrix::AlignedBuffer query;
+
+    if (parameterMatrix.prepareQuery(params, query))
+    {
+        parameterMatrix.scoreAll(query.front().v, selector);
+    }
+    else
+    {
+        // A query we can't compare scores 0 against everything, same as cosineSimilarity
+        for (size_t i = 0; i < patches.size(); ++i)
+            selector.push(i, 0.f);
+    }
+
+    return selector.take();
+}
+
+std::vector<SearchHit> VectorDatabase::findSimilarPatchHits(const std::vector<float> &params,
+                                                            int topK)
+{
+    ensureSearchIndex();
+
+    PatchMatrix::AlignedBuffer query;
+    if (annIndex && topK > 0 && parameterMatrix.prepareQuery(params, query))
+        return annIndex->search(parameterMatrix, query.front().v, topK);
+
+    return findSimilarPatchHitsExact(params, topK);
+}
+
+std::vector<PatchVector> VectorDatabase::findSimilarPatches(const PatchVector& query, int topK)
+{
+    return copyHits(findSimilarPatchHits(query.parameters().toVector(), topK));
+}
+
+std::vector<PatchVector> VectorDatabase::findSimilarByParameters(const std::vector<float>& params, int topK)
+{
+    return copyHits(findSimilarPatchHits(params, topK));
+}
+
+std::vector<float> VectorDatabase::generateTextEmbedding(const std::string& text)
+{
+    ensureTextIndex();
+    return textIndex.embed(text);
+}
+
 std::vector<PatchVector> VectorDatabase::findSimilarByText(const std::string& description, int topK)
 {
-    // Simple text matching for now
-    std::vector<std::pair<float, size_t>> scores;
-    
-    // Convert description to lowercase
-    std::string queryLower = description;
-    std::transform(queryLower.begin(), queryLower.end(), queryLower.begin(), ::tolower);
-    
+    ensureTextIndex();
+
+    TopKSelector selector(std::max(topK, 0));
+    textIndex.search(description, selector);
+    return copyHits(selector.take());
+}
+
+std::vector<SearchHit> VectorDatabase::searchMany(const std::vector<std::string>& queries, int topK)
+{
+    if (queries.empty() || topK <= 0)
+        return {};
+
+    ensureTextIndex();
+
+    std::vector<TopKSelector> selectors(queries.size(), TopKSelector(topK));
+    textIndex.searchMany(queries, selectors);
+
+    std::unordered_map<size_t, float> best;
+    for (auto& sel : selectors)
+    {
+        for (const auto& h : sel.take())
+        {
+            auto it = best.find(h.index);
+            if (it == best.end())
+                best.emplace(h.index, h.score);
+            else
+                it->second = std::max(it->second, h.score);
+        }
+    }
+
+    std::vector<SearchHit> merged;
+    merged.reserve(best.size());
+    for (const auto& b : best)
+        merged.push_back({b.first, b.second});
+    std::sort(merged.begin(), merged.end(), TopKSelector::ranksAbove);
+    return merged;
+}
+
+std::vector<PatchVector> VectorDatabase::hybridSearch(const std::string& text,
+                                                     const std::vector<float>& params,
+                                                     float textWeight,
+                                                     int topK)
+{
+    ensureSearchIndex();
+
+    textWeight = std::clamp(textWeight, 0.0f, 1.0f);
+    if (topK <= 0)
+        return {};
+
+    /*
+     * Candidates are the union of oversampled text and parameter searches
+     * (the latter through the ANN index when there is one). They are then
+     * rescored exactly with both terms, text scores scaled into [0,1].
+     */
+    ensureTextIndex();
+    auto textScores = textIndex.search(text, std::max(topK * 4, 32));
+    float maxText = 0.0f;
+    for (const auto& ts : textScores)
+        maxText = std::max(maxText, ts.score);
+
+    std::unordered_map<size_t, float> candidates;
+    for (const auto& ts : textScores)
+        candidates[ts.index] = ts.score / maxText;
+
+    PatchMatrix::AlignedBuffer query;
+    bool hasQuery = parameterMatrix.prepareQuery(params, query);
+    if (hasQuery)
+    {
+        for (const auto& h : findSimilarPatchHits(params, std::max(topK * 4, 32)))
+            candidates.emplace(h.index, 0.0f);
+    }
+
+    TopKSelector selector(topK);
+    for (const auto& c : candidates)
+    {
+        float paramScore = hasQuery ? std::max(0.0f, parameterMatrix.score(query.front().v, c.first)) : 0.0f;
+        selector.push(c.first, textWeight * c.second + (1.0f - textWeight) * paramScore);
+    }
+
+    return copyHits(selector.take());
+}
+
+VectorDatabase::SourceFingerprint VectorDatabase::fingerprintPatchDirectories() const
+{
+    SourceFingerprint res;
+
+    for (auto sub : {"patches_factory", "patches_3rdparty"})
+    {
+        auto dir = fs::path(storage->datapath) / sub;
+        std::error_code ec;
+        if (!fs::is_directory(dir, ec))
+            continue;
+
+        for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (!it->is_regular_file(ec) || it->path().extension() != ".fxp")
+                continue;
+
+            res.fileCount++;
+            res.totalSize += it->file_size(ec);
+            res.newestMTime = std::max(res.newestMTime,
+                                       (int64_t)it->last_write_time(ec).time_since_epoch().count());
+        }
+    }
+
+    return res;
+}
+
+std::string VectorDatabase::getDefaultCachePath(SurgeStorage* storage)
+{
+    return (fs::path(storage->userDataPath) / "SurgePatchVectors.bin").u8string();
+}
+
+bool VectorDatabase::saveToFile(const std::string& path)
+{
+    ensureSearchIndex();
+
+    auto dims = parameterMatrix.dims();
+    auto stride = parameterMatrix.stride();
+    auto matrixBytes = (uint64_t)patches.size() * stride * sizeof(float);
+
+    std::vector<DBPatchRecord> records(patches.size());
+    std::string strings;
+
     for (size_t i = 0; i < patches.size(); ++i)
     {
-        std::string nameLower = patches[i].name;
-        std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-        
-        // Simple substring matching score
-        float score = 0.0f;
-        if (nameLower.find(queryLower) != std::string::npos)
-            score = 1.0f;
-        else if (queryLower.find(nameLower) != std::string::npos)
-            score = 0.8f;
-        
-        // Check individual words
-        std::istringstream iss(queryLower);
-        std::string word;
-        while (iss >> word)
+        const auto& p = patches[i];
+        auto& r = records[i];
+        std::memset(&r, 0, sizeof(r));
+
+        std::string fields[n_dbs_fields] = {p.name, p.category, p.author, p.description,
+                                            p.filePath, encodeTags(p.tags)};
+        for (int f = 0; f < n_dbs_fields; ++f)
         {
-            if (nameLower.find(word) != std::string::npos)
-                score += 0.3f;
+            r.offset[f] = (uint32_t)strings.size();
+            r.length[f] = (uint32_t)fields[f].size();
+            strings += fields[f];
         }
-        
-        if (score > 0)
-            scores.push_back({score, i});
+        r.hasParameters = (dims > 0 && p.parameters().size() == dims) ? 1 : 0;
     }
-    
-    // Sort by score
-    std::sort(scores.begin(), scores.end(),
-              [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    // Return top K
-    std::vector<PatchVector> results;
-    for (int i = 0; i < std::min(topK, (int)scores.size()); ++i)
+
+    // Saved alongside the matrix so a load doesn't have to rebuild it
+    std::vector<char> indexImage;
+    if (annIndex && annIndex->size() == parameterMatrix.rows())
+        annIndex->save(indexImage);
+
+    auto fp = fingerprintPatchDirectories();
+
+    DBFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, dbFileMagic, sizeof(h.magic));
+    h.version = dbFileVersion;
+    h.headerSize = sizeof(DBFileHeader);
+    h.endianTag = dbFileEndianTag;
+    h.dims = (uint32_t)dims;
+    h.stride = (uint32_t)stride;
+    h.patchCount = patches.size();
+    h.recordsOffset = alignUp(sizeof(DBFileHeader), PatchMatrix::alignment);
+    h.stringsOffset = h.recordsOffset + records.size() * sizeof(DBPatchRecord);
+    h.stringsSize = strings.size();
+    h.rawOffset = alignUp(h.stringsOffset + h.stringsSize, PatchMatrix::alignment);
+    h.normalizedOffset = h.rawOffset + matrixBytes;
+    h.indexOffset = h.normalizedOffset + matrixBytes;
+    h.indexSize = indexImage.size();
+    h.fileSize = h.indexOffset + h.indexSize;
+    h.sourceFileCount = fp.fileCount;
+    h.sourceNewestMTime = fp.newestMTime;
+    h.sourceTotalSize = fp.totalSize;
+
+    // Write to a temporary and rename, so a crash never leaves a half written database
+    auto tmpPath = path + ".tmp";
+    {
+        std::ofstream out(fs::path(tmpPath), std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cout << "Cannot write vector database to " << tmpPath << std::endl;
+            return false;
+        }
+
+        auto pad = [&out](uint64_t to) {
+            static const char zeros[PatchMatrix::alignment] = {};
+            auto at = (uint64_t)out.tellp();
+            if (to > at)
+                out.write(zeros, to - at);
+        };
+
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        pad(h.recordsOffset);
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(DBPatchRecord));
+        out.write(strings.data(), strings.size());
+
+        pad(h.rawOffset);
+        std::vector<float> row(stride);
+        for (const auto& p : patches)
+        {
+            std::fill(row.begin(), row.end(), 0.f);
+            auto params = p.parameters();
+            if (dims > 0 && params.size() == dims)
+                std::copy(params.begin(), params.end(), row.begin());
+            out.write(reinterpret_cast<const char*>(row.data()), stride * sizeof(float));
+        }
+
+        for (size_t i = 0; i < patches.size(); ++i)
+            out.write(reinterpret_cast<const char*>(parameterMatrix.row(i)), stride * sizeof(float));
+
+        out.write(indexImage.data(), indexImage.size());
+
+        if (!out.good())
+        {
+            std::cout << "Failed writing vector database to " << tmpPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(fs::path(tmpPath), fs::path(path), ec);
+    if (ec)
     {
-        results.push_back(patches[scores[i].second]);
+        std::cout << "Cannot replace vector database " << path << ": " << ec.message() << std::endl;
+        fs::remove(fs::path(tmpPath), ec);
+        return false;
     }
-    
-    return results;
+
+    return true;
+}
+
+bool VectorDatabase::loadFromFile(const std::string& path)
+{
+    auto file = juce::File(juce::String::fromUTF8(path.c_str()));
+    if (!file.existsAsFile())
+        return false;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    auto* base = static_cast<const char*>(mapped->getData());
+    auto size = (uint64_t)mapped->getSize();
+
+    if (!base || size < sizeof(DBFileHeader))
+        return false;
+
+    DBFileHeader h;
+    std::memcpy(&h, base, sizeof(h));
+
+    if (std::memcmp(h.magic, dbFileMagic, sizeof(h.magic)) != 0 || h.version != dbFileVersion ||
+        h.headerSize != sizeof(DBFileHeader) || h.endianTag != dbFileEndianTag || h.fileSize != size)
+    {
+        std::cout << "Vector database " << path << " has an unknown format, ignoring it" << std::endl;
+        return false;
+    }
+
+    auto matrixBytes = h.patchCount * h.stride * sizeof(float);
+    if (h.stride % PatchMatrix::floatsPerBlock != 0 || h.dims > h.stride ||
+        h.rawOffset % PatchMatrix::alignment != 0 || h.normalizedOffset != h.rawOffset + matrixBytes ||
+        h.indexOffset != h.normalizedOffset + matrixBytes || h.indexOffset > size ||
+        h.indexSize != size - h.indexOffset || h.stringsOffset + h.stringsSize > size ||
+        h.recordsOffset + h.patchCount * sizeof(DBPatchRecord) > h.stringsOffset)
+    {
+        std::cout << "Vector database " << path << " is corrupt, ignoring it" << std::endl;
+        return false;
+    }
+
+    auto* records = reinterpret_cast<const DBPatchRecord*>(base + h.recordsOffset);
+    auto* strings = base + h.stringsOffset;
+    auto* raw = reinterpret_cast<const float*>(base + h.rawOffset);
+    auto* normalized = reinterpret_cast<const float*>(base + h.normalizedOffset);
+
+    std::vector<PatchVector> loaded(h.patchCount);
+    for (uint64_t i = 0; i < h.patchCount; ++i)
+    {
+        const auto& r = records[i];
+        for (int f = 0; f < n_dbs_fields; ++f)
+        {
+            if ((uint64_t)r.offset[f] + r.length[f] > h.stringsSize)
+            {
+                std::cout << "Vector database " << path << " is corrupt, ignoring it" << std::endl;
+                return false;
+            }
+        }
+
+        auto str = [&](int f) { return std::string(strings + r.offset[f], r.length[f]); };
+
+        auto& pv = loaded[i];
+        pv.name = str(dbs_name);
+        pv.category = str(dbs_category);
+        pv.author = str(dbs_author);
+        pv.description = str(dbs_description);
+        pv.filePath = str(dbs_filePath);
+        decodeTags(strings + r.offset[dbs_tags], r.length[dbs_tags], pv.tags);
+
+        if (r.hasParameters)
+        {
+            pv.mappedParameters = raw + i * h.stride;
+            pv.mappedParameterCount = h.dims;
+        }
+    }
+
+    // Drop the view of any previous mapping before that mapping goes away
+    parameterMatrix.clear();
+    patches = std::move(loaded);
+    mappedFile = std::move(mapped);
+
+    if (h.dims > 0 && h.patchCount > 0)
+        parameterMatrix.adopt(normalized, h.patchCount, h.dims, h.stride);
+    searchIndexDirty = false;
+
+    // The file holds no text index, and a same-size library would otherwise keep the old one
+    textIndexDirty = true;
+
+    if (annIndex && (h.indexSize == 0 ||
+                     !annIndex->load(base + h.indexOffset, h.indexSize, parameterMatrix)))
+        annIndex->build(parameterMatrix);
+
+    return true;
+}
+
+bool VectorDatabase::isFileStale(const std::string& path)
+{
+    std::ifstream in(fs::path(path), std::ios::binary);
+    if (!in.is_open())
+        return true;
+
+    DBFileHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+        return true;
+
+    if (std::memcmp(h.magic, dbFileMagic, sizeof(h.magic)) != 0 || h.version != dbFileVersion ||
+        h.endianTag != dbFileEndianTag)
+        return true;
+
+    SourceFingerprint saved;
+    saved.fileCount = h.sourceFileCount;
+    saved.newestMTime = h.sourceNewestMTime;
+    saved.totalSize = h.sourceTotalSize;
+
+    return !(saved == fingerprintPatchDirectories());
+}
+
+void VectorDatabase::buildFromFactoryPatchesCached(const std::string& cachePath)
+{
+    if (!isFileStale(cachePath) && loadFromFile(cachePath))
+    {
+        std::cout << "Loaded " << patches.size() << " patches from vector database cache" << std::endl;
+        return;
+    }
+
+    buildFromFactoryPatches();
+    saveToFile(cachePath);
 }
 
 } // namespace PatchDB
@@ -23,13 +23,35 @@
 
 class SurgeStorage;
 
+namespace juce
+{
+class MemoryMappedFile;
+}
+
 #include "PatchParameterExtractor.h"
+#include "PatchVectorSearch.h"
+#include "PatchVectorIndex.h"
+#include "PatchTextIndex.h"
 
 namespace Surge
 {
 namespace PatchDB
 {
 
+// A read-only run of parameter values, wherever they are stored
+struct ParameterView
+{
+    const float *data{nullptr};
+    size_t count{0};
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const float *begin() const { return data; }
+    const float *end() const { return data + count; }
+    float operator[](size_t i) const { return data[i]; }
+    std::vector<float> toVector() const { return std::vector<float>(begin(), end()); }
+};
+
 // Simple vector representation of a patch
 struct PatchVector
 {
@@ -43,6 +65,31 @@ struct PatchVector
     
     // Metadata
     std::unordered_map<std::string, std::string> tags;
+
+    /*
+     * Patches loaded from a saved database leave parameterVector empty and
+     * point at their row of the memory mapped file instead, which stays valid
+     * until the database loads another file or is destroyed. A non-empty
+     * parameterVector wins. Read parameters through parameters(), and call
+     * materializeParameters before keeping a copy beyond the database.
+     */
+    const float *mappedParameters{nullptr};
+    size_t mappedParameterCount{0};
+
+    ParameterView parameters() const
+    {
+        if (!parameterVector.empty() || !mappedParameters)
+            return {parameterVector.data(), parameterVector.size()};
+        return {mappedParameters, mappedParameterCount};
+    }
+
+    void materializeParameters()
+    {
+        if (parameterVector.empty() && mappedParameters)
+            parameterVector.assign(mappedParameters, mappedParameters + mappedParameterCount);
+        mappedParameters = nullptr;
+        mappedParameterCount = 0;
+    }
     
     float cosineSimilarity(const PatchVector& other) const;
     float euclideanDistance(const PatchVector& other) const;
@@ -60,10 +107,24 @@ public:
     // Add a single patch
     void addPatch(const std::string& path);
     
+    /*
+     * Index based search over the normalized parameter matrix. The returned
+     * hits index into patches and are ordered best first.
+     */
+    std::vector<SearchHit> findSimilarPatchHits(const std::vector<float> &params, int topK = 5);
+
     // Search functions
     std::vector<PatchVector> findSimilarPatches(const PatchVector& query, int topK = 5);
     std::vector<PatchVector> findSimilarByText(const std::string& description, int topK = 5);
     std::vector<PatchVector> findSimilarByParameters(const std::vector<float>& params, int topK = 5);
+
+    /*
+     * Runs several text queries in a single pass over the index, keeping the
+     * best topK per query. The per-query results are merged by patch index,
+     * a patch found by more than one query keeping its best score, and
+     * returned best first.
+     */
+    std::vector<SearchHit> searchMany(const std::vector<std::string>& queries, int topK = 5);
     
     // Hybrid search combining text and parameters
     std::vector<PatchVector> hybridSearch(const std::string& text, 
@@ -71,19 +132,80 @@ public:
                                          float textWeight = 0.5f,
                                          int topK = 5);
     
-    // Save/Load database
-    void saveToFile(const std::string& path);
-    void loadFromFile(const std::string& path);
+    /*
+     * Save/Load database. The file is a versioned binary image: a header, a
+     * table of per-patch string offsets, one string table and two 32 byte
+     * aligned float matrices (raw and normalized parameters), followed by the
+     * nearest neighbour index if there is one. loadFromFile memory maps it,
+     * searches the normalized matrix in place and points each PatchVector at
+     * its raw row, so the only work on load is creating the PatchVector
+     * strings and reading the index's graph back. The header records a
+     * fingerprint of the factory and third party patch directories at save
+     * time, which isFileStale compares against the disk.
+     */
+    bool saveToFile(const std::string& path);
+    bool loadFromFile(const std::string& path);
+    bool isFileStale(const std::string& path);
+    
+    // Loads the saved database at cachePath if it is current, otherwise builds and saves it
+    void buildFromFactoryPatchesCached(const std::string& cachePath);
+    static std::string getDefaultCachePath(SurgeStorage* storage);
     
     // Get all patches in a category
     std::vector<PatchVector> getPatchesByCategory(const std::string& category);
     
     // Public access for testing
     std::vector<PatchVector> patches;
+
+    /*
+     * The search matrix is rebuilt lazily when the patch count changes. Code
+     * which edits or replaces entries in patches in place must call this.
+     */
+    void invalidateSearchIndex()
+    {
+        searchIndexDirty = true;
+        textIndexDirty = true;
+    }
+    void rebuildSearchIndex();
+
+    /*
+     * Puts an approximate nearest neighbour index in front of the exact
+     * matrix scan. Once set, parameter and hybrid searches go through it and
+     * addPatch inserts into it incrementally. Passing nullptr returns to
+     * exact search.
+     */
+    void setNearestNeighbourIndex(std::unique_ptr<NearestNeighbourIndex> index);
+    NearestNeighbourIndex *getNearestNeighbourIndex() const { return annIndex.get(); }
+
+    // Always scans the whole matrix, regardless of any index. Useful as a recall baseline.
+    std::vector<SearchHit> findSimilarPatchHitsExact(const std::vector<float> &params, int topK = 5);
     
 private:
     SurgeStorage* storage;
     PatchParameterExtractor extractor;
+
+    PatchMatrix parameterMatrix;
+    std::unique_ptr<NearestNeighbourIndex> annIndex;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    bool searchIndexDirty{true};
+    TextIndex textIndex;
+    bool textIndexDirty{true};
+    void appendToSearchIndex(PatchVector &pv);
+    void ensureSearchIndex();
+    void ensureTextIndex();
+    std::vector<PatchVector> copyHits(const std::vector<SearchHit> &hits) const;
+    
+    struct SourceFingerprint
+    {
+        uint64_t fileCount = 0;
+        int64_t newestMTime = 0;
+        uint64_t totalSize = 0;
+        bool operator==(const SourceFingerprint& o) const
+        {
+            return fileCount == o.fileCount && newestMTime == o.newestMTime && totalSize == o.totalSize;
+        }
+    };
+    SourceFingerprint fingerprintPatchDirectories() const;
     
     // Helper functions
     PatchVector extractPatchVector(const std::string& patchPath);
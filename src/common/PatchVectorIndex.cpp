@@ -0,0 +1,402 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "PatchVectorIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+namespace
+{
+// Orders a priority_queue so the best scoring hit is on top
+struct BestOnTop
+{
+    bool operator()(const SearchHit &a, const SearchHit &b) const { return a.score < b.score; }
+};
+
+// Orders a priority_queue so the worst scoring hit is on top
+struct WorstOnTop
+{
+    bool operator()(const SearchHit &a, const SearchHit &b) const { return a.score > b.score; }
+};
+
+/*
+ * The saved graph is a run of native uint32s: magic, version, node count,
+ * entry point and layer count, then for each node its layer count followed
+ * by each layer's link count and links.
+ */
+static constexpr uint32_t hnswImageMagic = 0x57534e48; // "HNSW"
+static constexpr uint32_t hnswImageVersion = 1;
+
+// Far more layers than any real graph reaches, so a damaged count can't allocate wildly
+static constexpr uint32_t hnswMaxLayers = 64;
+
+/*
+ * Visited marks for searchLayer, tagged with a generation so they never need
+ * clearing. They belong to the thread rather than the index, which is what
+ * lets concurrent searches share a const index.
+ */
+struct VisitedMarks
+{
+    std::vector<uint32_t> marks;
+    uint32_t generation{0};
+
+    void begin(size_t nodeCount)
+    {
+        if (marks.size() < nodeCount)
+            marks.resize(nodeCount, 0);
+
+        if (++generation == 0)
+        {
+            std::fill(marks.begin(), marks.end(), 0);
+            generation = 1;
+        }
+    }
+
+    // Marks n and returns whether it was already marked in this generation
+    bool visit(uint32_t n)
+    {
+        if (marks[n] == generation)
+            return true;
+        marks[n] = generation;
+        return false;
+    }
+};
+
+thread_local VisitedMarks visitedMarks;
+} // namespace
+
+HNSWIndex::HNSWIndex(const Config &c) : config(c)
+{
+    config.M = std::max(config.M, (size_t)2);
+    levelMult = 1.0 / std::log((double)config.M);
+    clear();
+}
+
+void HNSWIndex::clear()
+{
+    nodes.clear();
+    entryPoint = 0;
+    maxLevel = -1;
+    rng.seed(config.seed);
+}
+
+int HNSWIndex::randomLevel()
+{
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    auto r = std::max(dist(rng), 1e-12);
+    return (int)(-std::log(r) * levelMult);
+}
+
+void HNSWIndex::build(const PatchMatrix &matrix)
+{
+    clear();
+    nodes.reserve(matrix.rows());
+    for (size_t i = 0; i < matrix.rows(); ++i)
+        add(matrix, i);
+}
+
+uint32_t HNSWIndex::greedyClosest(const PatchMatrix &m, const float *q, uint32_t from,
+                                  int level) const
+{
+    auto cur = from;
+    auto curScore = m.score(q, cur);
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+        for (auto n : nodes[cur].links[level])
+        {
+            auto s = m.score(q, n);
+            if (s > curScore)
+            {
+                curScore = s;
+                cur = n;
+                changed = true;
+            }
+        }
+    }
+
+    return cur;
+}
+
+std::vector<SearchHit> HNSWIndex::searchLayer(const PatchMatrix &m, const float *q, uint32_t from,
+                                              size_t ef, int level) const
+{
+    auto &visited = visitedMarks;
+    visited.begin(nodes.size());
+
+    std::priority_queue<SearchHit, std::vector<SearchHit>, BestOnTop> candidates;
+    std::priority_queue<SearchHit, std::vector<SearchHit>, WorstOnTop> results;
+
+    SearchHit start{from, m.score(q, from)};
+    candidates.push(start);
+    results.push(start);
+    visited.visit(from);
+
+    while (!candidates.empty())
+    {
+        auto c = candidates.top();
+        if (c.score < results.top().score && results.size() >= ef)
+            break;
+        candidates.pop();
+
+        for (auto n : nodes[c.index].links[level])
+        {
+            if (visited.visit(n))
+                continue;
+
+            auto s = m.score(q, n);
+            if (results.size() < ef || s > results.top().score)
+            {
+                candidates.push({n, s});
+                results.push({n, s});
+                if (results.size() > ef)
+                    results.pop();
+            }
+        }
+    }
+
+    std::vector<SearchHit> res(results.size());
+    for (auto i = res.size(); i > 0; --i)
+    {
+        res[i - 1] = results.top();
+        results.pop();
+    }
+    return res;
+}
+
+std::vector<uint32_t> HNSWIndex::selectNeighbours(const PatchMatrix &m,
+                                                  std::vector<SearchHit> &candidates,
+                                                  size_t count) const
+{
+    std::sort(candidates.begin(), candidates.end(), TopKSelector::ranksAbove);
+
+    std::vector<uint32_t> res;
+    std::vector<uint32_t> pruned;
+    res.reserve(count);
+
+    /*
+     * The HNSW heuristic: only keep a candidate if it is closer to the base
+     * than to any neighbour we already kept. This spreads the links out in
+     * different directions, which is what keeps clustered data navigable.
+     */
+    for (const auto &c : candidates)
+    {
+        if (res.size() >= count)
+            break;
+
+        bool keep = true;
+        for (auto r : res)
+        {
+            if (dotProduct(m.row(c.index), m.row(r), m.stride()) > c.score)
+            {
+                keep = false;
+                break;
+            }
+        }
+
+        if (keep)
+            res.push_back((uint32_t)c.index);
+        else
+            pruned.push_back((uint32_t)c.index);
+    }
+
+    // Top up with the closest pruned candidates so small graphs stay well connected
+    for (auto p : pruned)
+    {
+        if (res.size() >= count)
+            break;
+        res.push_back(p);
+    }
+
+    return res;
+}
+
+void HNSWIndex::shrinkLinks(const PatchMatrix &m, uint32_t node, int level)
+{
+    auto &links = nodes[node].links[level];
+    const auto *base = m.row(node);
+
+    std::vector<SearchHit> cands;
+    cands.reserve(links.size());
+    for (auto l : links)
+        cands.push_back({l, dotProduct(base, m.row(l), m.stride())});
+
+    links = selectNeighbours(m, cands, maxLinks(level));
+}
+
+void HNSWIndex::add(const PatchMatrix &matrix, size_t row)
+{
+    assert(row == nodes.size());
+    assert(row < matrix.rows());
+
+    auto id = (uint32_t)nodes.size();
+    auto level = randomLevel();
+
+    nodes.emplace_back();
+    nodes.back().links.resize(level + 1);
+
+    if (maxLevel < 0)
+    {
+        entryPoint = id;
+        maxLevel = level;
+        return;
+    }
+
+    const auto *q = matrix.row(row);
+    auto cur = entryPoint;
+
+    for (int l = maxLevel; l > level; --l)
+        cur = greedyClosest(matrix, q, cur, l);
+
+    for (int l = std::min(level, maxLevel); l >= 0; --l)
+    {
+        auto cands = searchLayer(matrix, q, cur, config.efConstruction, l);
+        cur = (uint32_t)cands.front().index;
+
+        auto neighbours = selectNeighbours(matrix, cands, config.M);
+        nodes[id].links[l] = neighbours;
+
+        for (auto n : neighbours)
+        {
+            nodes[n].links[l].push_back(id);
+            if (nodes[n].links[l].size() > maxLinks(l))
+                shrinkLinks(matrix, n, l);
+        }
+    }
+
+    if (level > maxLevel)
+    {
+        entryPoint = id;
+        maxLevel = level;
+    }
+}
+
+std::vector<SearchHit> HNSWIndex::search(const PatchMatrix &matrix, const float *query,
+                                         size_t k) const
+{
+    if (nodes.empty() || k == 0)
+        return {};
+
+    auto cur = entryPoint;
+    for (int l = maxLevel; l > 0; --l)
+        cur = greedyClosest(matrix, query, cur, l);
+
+    auto res = searchLayer(matrix, query, cur, std::max(config.efSearch, k), 0);
+    if (res.size() > k)
+        res.resize(k);
+    return res;
+}
+
+void HNSWIndex::save(std::vector<char> &out) const
+{
+    auto put = [&out](uint32_t v) {
+        auto at = out.size();
+        out.resize(at + sizeof(v));
+        std::memcpy(out.data() + at, &v, sizeof(v));
+    };
+
+    put(hnswImageMagic);
+    put(hnswImageVersion);
+    put((uint32_t)nodes.size());
+    put(entryPoint);
+    put((uint32_t)(maxLevel + 1));
+
+    for (const auto &n : nodes)
+    {
+        put((uint32_t)n.links.size());
+        for (const auto &layer : n.links)
+        {
+            put((uint32_t)layer.size());
+            for (auto l : layer)
+                put(l);
+        }
+    }
+}
+
+bool HNSWIndex::load(const char *image, size_t size, const PatchMatrix &matrix)
+{
+    clear();
+
+    size_t pos = 0;
+    auto get = [&](uint32_t &v) {
+        if (size - pos < sizeof(v))
+            return false;
+        std::memcpy(&v, image + pos, sizeof(v));
+        pos += sizeof(v);
+        return true;
+    };
+
+    auto fail = [this]() {
+        clear();
+        return false;
+    };
+
+    uint32_t magic, version, count, entry, layers;
+    if (!get(magic) || magic != hnswImageMagic || !get(version) || version != hnswImageVersion ||
+        !get(count) || count != matrix.rows() || !get(entry) || !get(layers) ||
+        layers > hnswMaxLayers || (count > 0) != (layers > 0) || (count > 0 && entry >= count))
+        return fail();
+
+    nodes.resize(count);
+    for (auto &n : nodes)
+    {
+        uint32_t nodeLayers;
+        if (!get(nodeLayers) || nodeLayers == 0 || nodeLayers > layers)
+            return fail();
+
+        n.links.resize(nodeLayers);
+        for (auto &layer : n.links)
+        {
+            uint32_t linkCount;
+            if (!get(linkCount) || linkCount > (size - pos) / sizeof(uint32_t))
+                return fail();
+
+            layer.resize(linkCount);
+            if (linkCount > 0)
+                std::memcpy(layer.data(), image + pos, linkCount * sizeof(uint32_t));
+            pos += linkCount * sizeof(uint32_t);
+
+            for (auto l : layer)
+                if (l >= count)
+                    return fail();
+        }
+    }
+
+    if (pos != size || (count > 0 && nodes[entry].links.size() != layers))
+        return fail();
+
+    entryPoint = entry;
+    maxLevel = (int)layers - 1;
+
+    // Draw the levels these nodes used, so later inserts match an index built from scratch
+    for (uint32_t i = 0; i < count; ++i)
+        randomLevel();
+
+    return true;
+}
+
+} // namespace PatchDB
+} // namespace Surge
@@ -0,0 +1,131 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_PATCHVECTORINDEX_H
+#define SURGE_SRC_COMMON_PATCHVECTORINDEX_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "PatchVectorSearch.h"
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+/*
+ * An approximate nearest neighbour index over the rows of a PatchMatrix.
+ * The index only stores row numbers and always reads the vectors back from
+ * the matrix it was built against, so the matrix must outlive it and rows
+ * must be added to the index in the order they were appended to the matrix.
+ */
+class NearestNeighbourIndex
+{
+  public:
+    virtual ~NearestNeighbourIndex() = default;
+
+    virtual void build(const PatchMatrix &matrix) = 0;
+    virtual void add(const PatchMatrix &matrix, size_t row) = 0;
+    virtual void clear() = 0;
+    virtual size_t size() const = 0;
+
+    // query must be prepared with PatchMatrix::prepareQuery
+    virtual std::vector<SearchHit> search(const PatchMatrix &matrix, const float *query,
+                                          size_t k) const = 0;
+
+    /*
+     * Lets VectorDatabase keep the index in its file instead of rebuilding it
+     * on every load. save appends an image of the index to out. load replaces
+     * the index with a saved image, returning false and leaving it empty if
+     * the image is damaged, from another kind of index, or doesn't cover the
+     * rows of matrix. An index which can't be saved writes nothing.
+     */
+    virtual void save(std::vector<char> &out) const {}
+    virtual bool load(const char *image, size_t size, const PatchMatrix &matrix) { return false; }
+};
+
+/*
+ * Hierarchical Navigable Small World graph (Malkov & Yashunin). Inserts are
+ * incremental, so adding a patch never rebuilds the graph. efSearch is the
+ * recall/latency knob: larger values visit more of the graph and get closer
+ * to the exact answer at the cost of query time. It can be changed at any
+ * time without rebuilding.
+ *
+ * Searches keep their scratch space per thread, so any number may run at
+ * once. Nothing may search while build, add or load is changing the graph.
+ */
+class HNSWIndex : public NearestNeighbourIndex
+{
+  public:
+    struct Config
+    {
+        size_t M{16};               // links per node on the upper layers, 2 * M on layer 0
+        size_t efConstruction{128}; // candidate list size while inserting
+        size_t efSearch{64};        // candidate list size while searching
+        uint32_t seed{0x5eed};      // layer assignment is deterministic for a given seed
+    };
+
+    HNSWIndex() : HNSWIndex(Config()) {}
+    explicit HNSWIndex(const Config &c);
+
+    void build(const PatchMatrix &matrix) override;
+    void add(const PatchMatrix &matrix, size_t row) override;
+    void clear() override;
+    size_t size() const override { return nodes.size(); }
+
+    std::vector<SearchHit> search(const PatchMatrix &matrix, const float *query,
+                                  size_t k) const override;
+
+    // Only the graph is saved, so a loaded index keeps its own Config
+    void save(std::vector<char> &out) const override;
+    bool load(const char *image, size_t size, const PatchMatrix &matrix) override;
+
+    void setEfSearch(size_t ef) { config.efSearch = ef; }
+    size_t getEfSearch() const { return config.efSearch; }
+    const Config &getConfig() const { return config; }
+
+  private:
+    struct Node
+    {
+        // links[l] are the neighbours on layer l, 0 <= l <= level
+        std::vector<std::vector<uint32_t>> links;
+        int level() const { return (int)links.size() - 1; }
+    };
+
+    Config config;
+    double levelMult;
+    std::mt19937 rng;
+
+    std::vector<Node> nodes;
+    uint32_t entryPoint{0};
+    int maxLevel{-1};
+
+    int randomLevel();
+    size_t maxLinks(int level) const { return level == 0 ? config.M * 2 : config.M; }
+
+    uint32_t greedyClosest(const PatchMatrix &m, const float *q, uint32_t from, int level) const;
+    std::vector<SearchHit> searchLayer(const PatchMatrix &m, const float *q, uint32_t from,
+                                       size_t ef, int level) const;
+    std::vector<uint32_t> selectNeighbours(const PatchMatrix &m, std::vector<SearchHit> &candidates,
+                                           size_t count) const;
+    void shrinkLinks(const PatchMatrix &m, uint32_t node, int level);
+};
+
+} // namespace PatchDB
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_PATCHVECTORINDEX_H
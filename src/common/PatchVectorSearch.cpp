@@ -0,0 +1,200 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#include "PatchVectorSearch.h"
+#include "PatchVectorDB.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "sst/basic-blocks/simd/setup.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+float dotProductScalar(const float *a, const float *b, size_t n)
+{
+    float res = 0.f;
+    for (size_t i = 0; i < n; ++i)
+        res += a[i] * b[i];
+    return res;
+}
+
+float dotProduct(const float *a, const float *b, size_t n)
+{
+    size_t i = 0;
+    float res = 0.f;
+
+#if defined(__AVX__)
+    auto acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+
+    auto acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+#else
+    // Two independent accumulators hide the add latency and consume one 32 byte block per turn
+    auto acc0 = SIMD_MM(setzero_ps)();
+    auto acc1 = SIMD_MM(setzero_ps)();
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = SIMD_MM(add_ps)(acc0,
+                               SIMD_MM(mul_ps)(SIMD_MM(load_ps)(a + i), SIMD_MM(load_ps)(b + i)));
+        acc1 = SIMD_MM(add_ps)(
+            acc1, SIMD_MM(mul_ps)(SIMD_MM(load_ps)(a + i + 4), SIMD_MM(load_ps)(b + i + 4)));
+    }
+    auto acc4 = SIMD_MM(add_ps)(acc0, acc1);
+#endif
+
+    float lanes alignas(16)[4];
+    SIMD_MM(store_ps)(lanes, acc4);
+    res = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < n; ++i)
+        res += a[i] * b[i];
+
+    return res;
+}
+
+bool PatchMatrix::normalizeInto(const float *src, size_t n, float *dst, size_t stride)
+{
+    double norm = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        norm += (double)src[i] * src[i];
+
+    std::memset(dst, 0, stride * sizeof(float));
+
+    if (norm <= 0.0)
+        return false;
+
+    auto inv = (float)(1.0 / std::sqrt(norm));
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = src[i] * inv;
+
+    return true;
+}
+
+void PatchMatrix::clear()
+{
+    data.clear();
+    base = nullptr;
+    nRows = 0;
+    nDims = 0;
+    nStride = 0;
+}
+
+void PatchMatrix::build(const std::vector<PatchVector> &patches)
+{
+    clear();
+
+    // The first non-empty vector defines the dimension of the matrix
+    for (const auto &p : patches)
+    {
+        if (!p.parameters().empty())
+        {
+            nDims = p.parameters().size();
+            break;
+        }
+    }
+
+    if (nDims == 0)
+        return;
+
+    auto blocksPerRow = (nDims + floatsPerBlock - 1) / floatsPerBlock;
+    nStride = blocksPerRow * floatsPerBlock;
+    nRows = patches.size();
+    data.resize(nRows * blocksPerRow);
+
+    for (size_t r = 0; r < nRows; ++r)
+    {
+        auto *dst = data[r * blocksPerRow].v;
+        auto src = patches[r].parameters();
+
+        if (src.size() != nDims)
+            std::memset(dst, 0, nStride * sizeof(float));
+        else
+            normalizeInto(src.begin(), nDims, dst, nStride);
+    }
+
+    base = data.front().v;
+}
+
+void PatchMatrix::adopt(const float *rows, size_t rowCount, size_t dimension, size_t rowStride)
+{
+    clear();
+    base = rows;
+    nRows = rowCount;
+    nDims = dimension;
+    nStride = rowStride;
+}
+
+bool PatchMatrix::append(const float *v, size_t n)
+{
+    if (nDims == 0)
+    {
+        if (nRows != 0 || n == 0)
+            return false;
+
+        nDims = n;
+        nStride = ((nDims + floatsPerBlock - 1) / floatsPerBlock) * floatsPerBlock;
+    }
+
+    auto blocksPerRow = nStride / floatsPerBlock;
+
+    if (isView())
+    {
+        data.resize(nRows * blocksPerRow);
+        std::memcpy(data.front().v, base, nRows * nStride * sizeof(float));
+    }
+
+    data.resize(data.size() + blocksPerRow);
+
+    auto *dst = data[nRows * blocksPerRow].v;
+    if (n != nDims)
+        std::memset(dst, 0, nStride * sizeof(float));
+    else
+        normalizeInto(v, nDims, dst, nStride);
+
+    base = data.front().v;
+    nRows++;
+    return true;
+}
+
+bool PatchMatrix::prepareQuery(const std::vector<float> &q, AlignedBuffer &out) const
+{
+    if (nDims == 0 || q.size() != nDims)
+        return false;
+
+    out.resize(nStride / floatsPerBlock);
+    return normalizeInto(q.data(), nDims, out.front().v, nStride);
+}
+
+void PatchMatrix::scoreAll(const float *query, TopKSelector &selector) const
+{
+    if (nRows == 0)
+        return;
+
+    const float *r = base;
+    for (size_t i = 0; i < nRows; ++i, r += nStride)
+        selector.push(i, dotProduct(query, r, nStride));
+}
+
+} // namespace PatchDB
+} // namespace Surge
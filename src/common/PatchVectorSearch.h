@@ -0,0 +1,193 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ */
+
+#ifndef SURGE_SRC_COMMON_PATCHVECTORSEARCH_H
+#define SURGE_SRC_COMMON_PATCHVECTORSEARCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace Surge
+{
+namespace PatchDB
+{
+
+struct PatchVector;
+
+/*
+ * A search result is an index into VectorDatabase::patches plus its score.
+ * Searches hand these back rather than PatchVector copies so that ranking
+ * ten thousand patches never touches their strings or tag maps.
+ */
+struct SearchHit
+{
+    size_t index{0};
+    float score{0.f};
+};
+
+/*
+ * Dot product kernels. dotProduct expects both pointers to be aligned to
+ * PatchMatrix::alignment and uses SSE2 (or NEON via simde) 4-wide lanes, or
+ * AVX when the build enables it. Any tail which isn't a multiple of the lane
+ * width falls back to scalar code, so n does not have to be padded.
+ */
+float dotProduct(const float *a, const float *b, size_t n);
+float dotProductScalar(const float *a, const float *b, size_t n);
+
+/*
+ * Keeps the best k hits seen so far in a bounded min-heap, so selecting the
+ * top k from n candidates is O(n log k) with no allocation after reset.
+ * Ties on score are broken by lower index to keep results deterministic.
+ */
+class TopKSelector
+{
+  public:
+    explicit TopKSelector(size_t k = 0) { reset(k); }
+
+    void reset(size_t newK)
+    {
+        k = newK;
+        heap.clear();
+        heap.reserve(k);
+    }
+
+    inline void push(size_t index, float score)
+    {
+        if (k == 0)
+            return;
+
+        SearchHit h{index, score};
+        if (heap.size() < k)
+        {
+            heap.push_back(h);
+            std::push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+        else if (ranksAbove(h, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), ranksAbove);
+            heap.back() = h;
+            std::push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+    }
+
+    // The score a candidate has to beat to get in, -inf until we are full
+    float threshold() const
+    {
+        if (heap.size() < k || heap.empty())
+            return -std::numeric_limits<float>::infinity();
+        return heap.front().score;
+    }
+
+    size_t size() const { return heap.size(); }
+
+    // Returns the retained hits, best first, and leaves the selector empty
+    std::vector<SearchHit> take()
+    {
+        std::sort_heap(heap.begin(), heap.end(), ranksAbove);
+        std::vector<SearchHit> res;
+        res.swap(heap);
+        heap.reserve(k);
+        return res;
+    }
+
+    static bool ranksAbove(const SearchHit &a, const SearchHit &b)
+    {
+        return a.score > b.score || (a.score == b.score && a.index < b.index);
+    }
+
+  private:
+    size_t k{0};
+    std::vector<SearchHit> heap;
+};
+
+/*
+ * PatchMatrix holds the parameter vectors of a patch set as one contiguous,
+ * row-major block of L2-normalized floats. Each row is padded to a multiple of
+ * eight floats and starts on a 32 byte boundary, so cosine similarity against
+ * a prepared query is a single aligned dot product per row.
+ *
+ * Rows whose dimension doesn't match the matrix (or which are all zero) are
+ * stored as zeros and always score 0, which is what
+ * PatchVector::cosineSimilarity returns for those cases.
+ */
+class PatchMatrix
+{
+  public:
+    static constexpr size_t alignment = 32;
+    static constexpr size_t floatsPerBlock = alignment / sizeof(float);
+
+    struct alignas(alignment) Block
+    {
+        float v[floatsPerBlock];
+    };
+    typedef std::vector<Block> AlignedBuffer;
+
+    void build(const std::vector<PatchVector> &patches);
+    void clear();
+
+    /*
+     * Appends one row without touching the others. Returns false if the
+     * matrix has no dimension yet and v can't provide one, in which case the
+     * caller has to fall back to build().
+     */
+    bool append(const float *v, size_t n);
+    bool append(const std::vector<float> &v) { return append(v.data(), v.size()); }
+
+    /*
+     * Makes the matrix a read-only view of rows owned by someone else, for
+     * instance a memory mapped database file. rows must already be normalized
+     * and aligned to alignment, and must outlive the view. Appending to a view
+     * first copies it into owned storage.
+     */
+    void adopt(const float *rows, size_t rowCount, size_t dimension, size_t rowStride);
+    bool isView() const { return nRows > 0 && data.empty(); }
+
+    size_t rows() const { return nRows; }
+    size_t dims() const { return nDims; }
+    size_t stride() const { return nStride; }
+    bool empty() const { return nRows == 0; }
+
+    const float *row(size_t i) const { return base + i * nStride; }
+
+    /*
+     * Copies q into an aligned, stride-sized buffer and normalizes it. Returns
+     * false if the query can never match anything (wrong dimension or zero).
+     */
+    bool prepareQuery(const std::vector<float> &q, AlignedBuffer &out) const;
+
+    // Scores every row against a prepared query and offers it to the selector
+    void scoreAll(const float *query, TopKSelector &selector) const;
+
+    // Scores a single row against a prepared query
+    float score(const float *query, size_t rowIndex) const
+    {
+        return dotProduct(query, row(rowIndex), nStride);
+    }
+
+    // Normalizes src into dst (which has stride floats), returning false if src is zero
+    static bool normalizeInto(const float *src, size_t n, float *dst, size_t stride);
+
+  private:
+    AlignedBuffer data;
+    const float *base{nullptr};
+    size_t nRows{0}, nDims{0}, nStride{0};
+};
+
+} // namespace PatchDB
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_PATCHVECTORSEARCH_H
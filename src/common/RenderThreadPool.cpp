@@ -0,0 +1,322 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#include "RenderThreadPool.h"
+#include "sst/basic-blocks/simd/setup.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
+
+#if WINDOWS
+#include "windows.h"
+#elif MAC
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Surge
+{
+namespace Threading
+{
+
+namespace
+{
+/*
+ * Blocks arrive back to back within a host callback, so a worker spins
+ * through the short gaps between them and parks once nothing has arrived for
+ * a while. With more than one instance on the pool the gaps are another
+ * synth's, so workers park straight away rather than burn a core each. The
+ * park timeout only matters if a wakeup is missed, in which case the calling
+ * thread does the work itself until the worker comes back.
+ */
+static constexpr auto spinWindow = std::chrono::microseconds(50);
+static constexpr auto parkTimeout = std::chrono::milliseconds(100);
+
+inline void cpuPause() { SIMD_MM(pause)(); }
+
+/*
+ * A thread's scheduling as one number which orders by urgency, 0 being
+ * ordinary time sharing: the SCHED_FIFO or SCHED_RR priority on Linux, the
+ * thread priority on Windows, and 1 for a time constraint policy on macOS,
+ * whose computation and constraint go in detail.
+ */
+static constexpr int unsetLevel = std::numeric_limits<int>::max();
+
+int getCurrentThreadLevel(uint64_t &detail)
+{
+    detail = 0;
+#if WINDOWS
+    return GetThreadPriority(GetCurrentThread());
+#elif MAC
+    thread_time_constraint_policy_data_t policy;
+    mach_msg_type_number_t count = THREAD_TIME_CONSTRAINT_POLICY_COUNT;
+    boolean_t getDefault = false;
+    if (thread_policy_get(pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+                          (thread_policy_t)&policy, &count, &getDefault) != KERN_SUCCESS ||
+        getDefault)
+        return 0;
+
+    detail = ((uint64_t)policy.computation << 32) | policy.constraint;
+    return 1;
+#else
+    int policy;
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 ||
+        (policy != SCHED_FIFO && policy != SCHED_RR))
+        return 0;
+    return param.sched_priority;
+#endif
+}
+
+// Where the platform refuses (Linux without rtprio, say) the worker keeps what it has
+void setCurrentThreadLevel(int level, uint64_t detail)
+{
+#if WINDOWS
+    SetThreadPriority(GetCurrentThread(), level);
+#elif MAC
+    auto thread = pthread_mach_thread_np(pthread_self());
+    if (level > 0)
+    {
+        thread_time_constraint_policy_data_t policy;
+        policy.period = 0;
+        policy.computation = (uint32_t)(detail >> 32);
+        policy.constraint = (uint32_t)detail;
+        policy.preemptible = true;
+        thread_policy_set(thread, THREAD_TIME_CONSTRAINT_POLICY, (thread_policy_t)&policy,
+                          THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    }
+    else
+    {
+        thread_standard_policy_data_t policy{};
+        thread_policy_set(thread, THREAD_STANDARD_POLICY, (thread_policy_t)&policy,
+                          THREAD_STANDARD_POLICY_COUNT);
+    }
+#else
+    sched_param param{};
+    param.sched_priority = level;
+    pthread_setschedparam(pthread_self(), level > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+#endif
+}
+
+std::atomic<uint64_t> poolSerial{0};
+} // namespace
+
+RenderThreadPool::RenderThreadPool(int workers) : priorityLevel(unsetLevel), serial(++poolSerial)
+{
+    for (int i = 0; i < workers; ++i)
+        threads.emplace_back([this, i]() { workerLoop(i); });
+}
+
+std::shared_ptr<RenderThreadPool> RenderThreadPool::acquireShared(int workers)
+{
+    static std::mutex sharedMutex;
+    static std::weak_ptr<RenderThreadPool> shared;
+
+    std::lock_guard<std::mutex> g(sharedMutex);
+    auto pool = shared.lock();
+    if (!pool)
+    {
+        pool = std::make_shared<RenderThreadPool>(workers);
+        shared = pool;
+    }
+
+    // Each caller gets a handle of its own, so the pool knows how many instances share it
+    pool->users++;
+    return std::shared_ptr<RenderThreadPool>(pool.get(), [pool](RenderThreadPool *p) mutable {
+        p->users--;
+        pool.reset();
+    });
+}
+
+void RenderThreadPool::matchCallingThreadPriority()
+{
+    uint64_t detail;
+    auto level = getCurrentThreadLevel(detail);
+
+    auto current = priorityLevel.load(std::memory_order_relaxed);
+    while (level < current)
+    {
+        if (priorityLevel.compare_exchange_weak(current, level, std::memory_order_relaxed))
+        {
+            priorityDetail.store(detail, std::memory_order_relaxed);
+            priorityGeneration.fetch_add(1, std::memory_order_release);
+            break;
+        }
+    }
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> g(parkMutex);
+        running = false;
+    }
+    parkCV.notify_all();
+
+    for (auto &t : threads)
+        if (t.joinable())
+            t.join();
+}
+
+void RenderThreadPool::run(int n, int maxWorkers, TaskFn fn, void *ctx)
+{
+    assert(n <= maxTasks);
+    if (n <= 0)
+        return;
+
+    // Another instance's block has the workers, so this one is done inline
+    if (maxWorkers <= 0 || n == 1 || inUse.exchange(true, std::memory_order_acquire))
+    {
+        for (int i = 0; i < n; ++i)
+            fn(ctx, i);
+        return;
+    }
+
+    // A pool started after this thread last called is a different one, hence the serial
+    static thread_local uint64_t matchedSerial{0};
+    if (matchedSerial != serial)
+    {
+        matchCallingThreadPriority();
+        matchedSerial = serial;
+    }
+
+    taskFn = fn;
+    taskCtx = ctx;
+    remaining.store(n, std::memory_order_relaxed);
+    batchWorkers.store(maxWorkers, std::memory_order_relaxed);
+
+    batch++;
+    claim.store(((uint64_t)batch << 32) | ((uint64_t)n << 16), std::memory_order_seq_cst);
+
+    /*
+     * Wake parked workers without ever blocking. A worker only decides to
+     * park while holding parkMutex, so if try_lock succeeds none is between
+     * checking for work and waiting, and the notify can't be lost. If it
+     * fails the notify may be, which costs no more than doing this batch inline.
+     */
+    if (parked.load(std::memory_order_seq_cst) > 0)
+    {
+        if (parkMutex.try_lock())
+            parkMutex.unlock();
+        parkCV.notify_all();
+    }
+
+    while (runNextTask(batch))
+        ;
+
+    /*
+     * Everything is claimed; wait for tasks still running on workers. A worker
+     * runs no higher than we do, so if it shares our core it only gets to
+     * finish when we yield now and then.
+     */
+    for (int spins = 1; remaining.load(std::memory_order_acquire) > 0; ++spins)
+    {
+        cpuPause();
+        if ((spins & 1023) == 0)
+            std::this_thread::yield();
+    }
+
+    inUse.store(false, std::memory_order_release);
+}
+
+bool RenderThreadPool::runNextTask(uint32_t forBatch)
+{
+    auto c = claim.load(std::memory_order_acquire);
+    while (true)
+    {
+        if ((uint32_t)(c >> 32) != forBatch)
+            return false;
+
+        auto index = (int)(c & 0xFFFF);
+        auto count = (int)((c >> 16) & 0xFFFF);
+        if (index >= count)
+            return false;
+
+        if (claim.compare_exchange_weak(c, c + 1, std::memory_order_acq_rel,
+                                        std::memory_order_acquire))
+        {
+            // The batch can't finish, and so taskFn can't change, until this task is counted
+            taskFn(taskCtx, index);
+            remaining.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+void RenderThreadPool::workerLoop(int index)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t finishedBatch = 0, appliedPriority = 0;
+    auto idleSince = Clock::now();
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        auto generation = priorityGeneration.load(std::memory_order_acquire);
+        if (generation != appliedPriority)
+        {
+            setCurrentThreadLevel(priorityLevel.load(std::memory_order_relaxed),
+                                  priorityDetail.load(std::memory_order_relaxed));
+            appliedPriority = generation;
+        }
+
+        auto current = (uint32_t)(claim.load(std::memory_order_acquire) >> 32);
+        if (current != finishedBatch)
+        {
+            // Workers past what the caller asked for sit this batch out
+            if (index < batchWorkers.load(std::memory_order_relaxed) && runNextTask(current))
+            {
+                tasksRunOnWorkers.fetch_add(1, std::memory_order_relaxed);
+                idleSince = Clock::now();
+                continue;
+            }
+            finishedBatch = current;
+        }
+
+        if (users.load(std::memory_order_relaxed) <= 1 && Clock::now() - idleSince < spinWindow)
+        {
+            cpuPause();
+            continue;
+        }
+
+        // Nothing for a while, so sleep until run() publishes a new batch
+        {
+            std::unique_lock<std::mutex> lock(parkMutex);
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            parkCV.wait_for(lock, parkTimeout, [this, finishedBatch]() {
+                return !running ||
+                       (uint32_t)(claim.load(std::memory_order_seq_cst) >> 32) != finishedBatch;
+            });
+            parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+        idleSince = Clock::now();
+    }
+}
+
+} // namespace Threading
+} // namespace Surge
@@ -0,0 +1,131 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#ifndef SURGE_SRC_COMMON_RENDERTHREADPOOL_H
+#define SURGE_SRC_COMMON_RENDERTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Surge
+{
+namespace Threading
+{
+
+/*
+ * A fork/join pool for splitting one block of rendering across cores, shared
+ * by every synth instance in the process.
+ *
+ * parallelFor publishes a batch of tasks with one atomic store, and the
+ * calling thread and the workers then claim task indices from the same
+ * counter. The calling thread never sleeps or takes a lock. It claims
+ * whatever the workers haven't yet, so a worker that is asleep or descheduled
+ * just means more work is done inline. Once nothing is left to claim, it
+ * spins only until tasks already running elsewhere finish. Only one batch
+ * runs at a time; an instance whose audio thread finds the pool busy with
+ * another's renders its block inline.
+ *
+ * Workers start at normal priority. The first time a thread calls
+ * parallelFor they may rise to its priority, but with several callers they
+ * take the lowest, so a worker is never more urgent than any audio thread it
+ * works for and can't starve the host or another instance. They spin briefly while work keeps
+ * arriving, not at all once several instances share the pool, and park on a
+ * condition variable once it stops; parallelFor wakes them without blocking.
+ */
+class RenderThreadPool
+{
+  public:
+    static constexpr int maxTasks = 0xFFFF;
+
+    explicit RenderThreadPool(int workers);
+    ~RenderThreadPool();
+
+    /*
+     * A handle on the process-wide pool, started with this many workers by
+     * whoever needs it first and stopped when the last handle goes.
+     */
+    static std::shared_ptr<RenderThreadPool> acquireShared(int workers);
+
+    int getWorkerCount() const { return (int)threads.size(); }
+    int getUserCount() const { return users; }
+
+    // Calls fn(i) for every i in [0, n) on up to maxWorkers workers and returns once all have run
+    template <typename F> void parallelFor(int n, int maxWorkers, F &&fn)
+    {
+        using Fn = std::remove_reference_t<F>;
+        run(
+            n, maxWorkers, [](void *ctx, int i) { (*static_cast<Fn *>(ctx))(i); },
+            const_cast<void *>(static_cast<const void *>(&fn)));
+    }
+
+    // How many tasks ran on a worker rather than the calling thread
+    uint64_t getTasksRunOnWorkers() const { return tasksRunOnWorkers; }
+
+  private:
+    typedef void (*TaskFn)(void *ctx, int index);
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> running{true};
+    std::atomic<bool> inUse{false};
+    std::atomic<int> users{0};
+    std::atomic<int> parked{0};
+    std::mutex parkMutex;
+    std::condition_variable parkCV;
+
+    // Batch number in the top 32 bits, task count in the next 16, next index in the low 16
+    std::atomic<uint64_t> claim{0};
+    std::atomic<int> remaining{0};
+    std::atomic<int> batchWorkers{0};
+    uint32_t batch{0};
+    TaskFn taskFn{nullptr};
+    void *taskCtx{nullptr};
+
+    std::atomic<uint64_t> tasksRunOnWorkers{0};
+
+    /*
+     * The lowest priority level of the calling threads seen so far, with the
+     * computation and constraint of a macOS time constraint policy packed in
+     * priorityDetail. Workers adopt it whenever the generation moves.
+     */
+    std::atomic<int> priorityLevel;
+    std::atomic<uint64_t> priorityDetail{0};
+    std::atomic<uint32_t> priorityGeneration{0};
+
+    // Told how high each new calling thread runs, which parallelFor does itself
+    const uint64_t serial;
+    void matchCallingThreadPriority();
+
+    void run(int n, int maxWorkers, TaskFn fn, void *ctx);
+    bool runNextTask(uint32_t forBatch);
+    void workerLoop(int index);
+};
+
+} // namespace Threading
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_RENDERTHREADPOOL_H
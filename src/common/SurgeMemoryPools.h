@@ -27,13 +27,75 @@
 #include "MemoryPool.h"
 #include "SSESincDelayLine.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace Surge
 {
 namespace Memory
 {
+/*
+ * Marks the current thread as rendering audio while in scope. It costs a
+ * thread_local increment, and lets a test build count the heap allocations
+ * made on the audio thread (SURGE_CHECK_AUDIO_THREAD_ALLOCATIONS in the test
+ * runner).
+ */
+struct AudioThreadScope
+{
+    AudioThreadScope() { depth++; }
+    ~AudioThreadScope() { depth--; }
+    AudioThreadScope(const AudioThreadScope &) = delete;
+    AudioThreadScope &operator=(const AudioThreadScope &) = delete;
+
+    static bool active() { return depth > 0; }
+
+  private:
+    static inline thread_local int depth{0};
+};
+
+struct SurgeMemoryPools;
+
+/*
+ * One thread refills the pools of every SurgeMemoryPools in the process, however many
+ * storages there are, and releases wavetable data once the audio thread is done with it.
+ * It starts with the first storage and stops with the last.
+ *
+ * It polls rather than being woken, since the audio thread can't notify without risking a
+ * lock. A pool only asks for more once it's below its pre-allocation, so there's still
+ * some left to hand out in the meantime.
+ */
+class PoolRefillService
+{
+  public:
+    static void add(SurgeMemoryPools *p);
+    static void remove(SurgeMemoryPools *p);
+
+  private:
+    static constexpr auto refillInterval = std::chrono::milliseconds(5);
+
+    static inline std::mutex mutex;
+    static inline std::condition_variable cv;
+    static inline std::vector<SurgeMemoryPools *> pools;
+    static inline std::thread thread;
+    // A thread runs while this is the generation it was started with
+    static inline uint64_t generation{0};
+
+    static void run(uint64_t startedAt);
+};
+
 struct SurgeMemoryPools
 {
-    SurgeMemoryPools(SurgeStorage *s) : stringDelayLines(s->sinctable) {}
+    SurgeMemoryPools(SurgeStorage *s) : ownerStorage(s), stringDelayLines(s->sinctable)
+    {
+        PoolRefillService::add(this);
+    }
+    ~SurgeMemoryPools() { PoolRefillService::remove(this); }
+
+    SurgeStorage *ownerStorage;
 
     /*
      * The largest number of oscillator instances of a particular
@@ -45,6 +107,8 @@ struct SurgeMemoryPools
      * The string needs 2 delay lines per oscillator
      */
     MemoryPool<SSESincDelayLine<16384>, 8, 4, 2 * maxosc + 100> stringDelayLines;
+
+    // These run on the audio thread, so they only ask the refill thread for delay lines
     void resetAllPools(SurgeStorage *storage) { resetOscillatorPools(storage); }
     void resetOscillatorPools(SurgeStorage *storage)
     {
@@ -68,15 +132,66 @@ struct SurgeMemoryPools
         if (hasString)
         {
             int maxUsed = nString * 2 * storage->getPatch().polylimit.val.i;
-            stringDelayLines.setupPoolToSize((int)(maxUsed * 0.5), storage->sinctable);
+            stringDelayLines.requestPoolSize((int)(maxUsed * 0.5));
         }
         else
         {
-            stringDelayLines.returnToPreAllocSize();
+            stringDelayLines.releaseToPreAllocSize();
         }
     }
+
+    // The refill service's thread
+    void serviceRefills() { stringDelayLines.serviceRefills(ownerStorage->sinctable); }
 };
 
+inline void PoolRefillService::add(SurgeMemoryPools *p)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    pools.push_back(p);
+    if (pools.size() == 1)
+    {
+        auto startedAt = ++generation;
+        thread = std::thread([startedAt]() { run(startedAt); });
+    }
+}
+
+inline void PoolRefillService::remove(SurgeMemoryPools *p)
+{
+    std::thread finished;
+    {
+        // Taking the lock also waits out a refill of p which is under way
+        std::lock_guard<std::mutex> g(mutex);
+        pools.erase(std::remove(pools.begin(), pools.end(), p), pools.end());
+        if (pools.empty())
+        {
+            ++generation;
+            finished = std::move(thread);
+        }
+    }
+
+    if (finished.joinable())
+    {
+        cv.notify_all();
+        finished.join();
+    }
+}
+
+inline void PoolRefillService::run(uint64_t startedAt)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (generation == startedAt)
+    {
+        cv.wait_for(lock, refillInterval, [startedAt]() { return generation != startedAt; });
+        if (generation != startedAt)
+            break;
+
+        for (auto *p : pools)
+            p->serviceRefills();
+
+        WavetableCache::releaseRetired();
+    }
+}
+
 } // namespace Memory
 } // namespace Surge
 #endif // SURGE_SURGEMEMORYPOOLS_H
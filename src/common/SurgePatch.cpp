@@ -1110,7 +1110,8 @@ void SurgePatch::update_controls(
     }
 }
 
-void SurgePatch::load_patch(const void *data, int datasize, bool preset)
+void SurgePatch::load_patch(const void *data, int datasize, bool preset,
+                            TiXmlDocument *parsedXml)
 {
     using namespace sst::io;
 
@@ -1122,10 +1123,16 @@ void SurgePatch::load_patch(const void *data, int datasize, bool preset)
     patch_header *ph = (patch_header *)data;
     ph->xmlsize = mech::endian_read_int32LE(ph->xmlsize);
 
+    // A wavetable still loading for the old patch mustn't land on top of this one
+    storage->cancel_background_wtloads();
+
     if (!memcmp(ph->tag, "sub3", 4))
     {
         char *dr = (char *)data + sizeof(patch_header);
-        load_xml(dr, ph->xmlsize, preset);
+        if (parsedXml)
+            load_xml(*parsedXml, preset);
+        else
+            load_xml(dr, ph->xmlsize, preset);
         dr += ph->xmlsize;
 
         for (int sc = 0; sc < n_scenes; sc++)
@@ -1186,6 +1193,10 @@ void SurgePatch::load_patch(const void *data, int datasize, bool preset)
             }
         }
     }
+    else if (parsedXml)
+    {
+        load_xml(*parsedXml, preset);
+    }
     else
     {
         load_xml(data, datasize, preset);
@@ -1290,13 +1301,27 @@ float convert_v11_reso_to_v12_2P(float reso)
 
 float convert_v11_reso_to_v12_4P(float reso) { return reso * (0.99f / 1.05f); }
 
+bool SurgePatch::parse_xml(const void *data, int datasize, TiXmlDocument &doc)
+{
+    if (datasize >= maxPatchXMLSize)
+        return false;
+
+    if (datasize)
+    {
+        char *temp = (char *)malloc(datasize + 1);
+        memcpy(temp, data, datasize);
+        *(temp + datasize) = 0;
+        doc.Parse(temp, nullptr, TIXML_ENCODING_LEGACY);
+        free(temp);
+    }
+    return true;
+}
+
 void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
 {
     TiXmlDocument doc;
-    int j;
-    double d;
 
-    if (datasize >= (1 << 22))
+    if (!parse_xml(data, datasize, doc))
     {
         auto msg = fmt::format(
             "The patch that we attempted to load has a very large header ({:d} bytes), "
@@ -1310,14 +1335,13 @@ void SurgePatch::load_xml(const void *data, int datasize, bool is_preset)
         return;
     }
 
-    if (datasize)
-    {
-        char *temp = (char *)malloc(datasize + 1);
-        memcpy(temp, data, datasize);
-        *(temp + datasize) = 0;
-        doc.Parse(temp, nullptr, TIXML_ENCODING_LEGACY);
-        free(temp);
-    }
+    load_xml(doc, is_preset);
+}
+
+void SurgePatch::load_xml(TiXmlDocument &doc, bool is_preset)
+{
+    int j;
+    double d;
 
     // clear old modulation routings
     for (int sc = 0; sc < n_scenes; sc++)
@@ -27,6 +27,8 @@
 #include <cctype>
 #include <map>
 #include <queue>
+#include <algorithm>
+#include <thread>
 #include "UserDefaults.h"
 #if HAS_JUCE
 #include "SurgeSharedBinary.h"
@@ -50,6 +52,8 @@
 #include "FxPresetAndClipboardManager.h"
 #include "ModulatorPresetManager.h"
 #include "SurgeMemoryPools.h"
+#include "WavetableLoader.h"
+#include "RenderThreadPool.h"
 #include "sst/basic-blocks/tables/SincTableProvider.h"
 
 // FIXME probably remove this when we remove the hardcoded hack below
@@ -1261,11 +1265,55 @@ void SurgeStorage::refresh_wtlistFrom(bool isUser, const fs::path &p, const std:
         wt_list, wt_category);
 }
 
+void SurgeStorage::setBackgroundWavetableLoading(bool b)
+{
+    if (b && !wavetableLoader)
+        wavetableLoader = std::make_unique<Surge::Storage::WavetableLoader>(this);
+    else if (!b)
+        wavetableLoader.reset();
+}
+
+void SurgeStorage::setRenderThreadCount(int n)
+{
+    if (n > 1 && !renderPool)
+    {
+        auto cores = (int)std::thread::hardware_concurrency();
+        auto workers = std::clamp(cores - 1, 1, maxRenderThreads - 1);
+        renderPool = Surge::Threading::RenderThreadPool::acquireShared(workers);
+    }
+
+    n = renderPool ? std::clamp(n, 1, renderPool->getWorkerCount() + 1) : 1;
+    renderThreadCount.store(n, std::memory_order_release);
+}
+
+void SurgeStorage::cancel_background_wtloads()
+{
+    if (wavetableLoader)
+        wavetableLoader->cancelPending();
+}
+
 void SurgeStorage::perform_queued_wtloads()
 {
     SurgePatch &patch =
         getPatch(); // Change here is for performance and ease of debugging, simply not calling
                     // getPatch so many times. Code should behave identically.
+
+    if (wavetableLoader)
+    {
+        wavetableLoader->installCompleted(patch);
+
+        for (int sc = 0; sc < n_scenes; sc++)
+        {
+            for (int o = 0; o < n_oscs; o++)
+            {
+                auto &osc = patch.scene[sc].osc[o];
+                if (osc.wt.queue_id != -1 || osc.wt.queue_filename[0])
+                    wavetableLoader->request(sc, o, osc);
+            }
+        }
+        return;
+    }
+
     for (int sc = 0; sc < n_scenes; sc++)
     {
         for (int o = 0; o < n_oscs; o++)
@@ -2559,6 +2607,10 @@ void SurgeStorage::load_midi_controllers()
 
 SurgeStorage::~SurgeStorage()
 {
+    // The loader's worker calls back into us, so it goes first
+    wavetableLoader.reset();
+    renderPool.reset();
+
 #ifndef SURGE_SKIP_ODDSOUND_MTS
     if (oddsound_mts_active_as_main)
         disconnect_as_oddsound_main();
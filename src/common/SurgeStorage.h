@@ -853,6 +853,21 @@ struct MSEGStorage
     float durationLoopStartToLoopEnd;
     float envelopeModeDuration = -1, envelopeModeNV1 = -2; // -2 as sentinel since NV1 is -1/1
 
+    /*
+     * Also rebuilt by rebuildCache, for the evaluator. The parts of each segment's curve which
+     * only depend on its control point, and how many segments were found to lie end to end in
+     * time order, which lets the evaluator find the segment at a given time by bisection.
+     */
+    struct segmentCurve
+    {
+        // What the rest was worked out from, so an edit without a rebuild is noticed
+        float cpv = NAN;
+        float a, expAm1;          // control point exponent of linear and s-curve segments
+        int oscSteps, stairSteps; // cycles of the periodic shapes and steps of the stair shapes
+    };
+    std::array<segmentCurve, max_msegs> segmentCurves;
+    int orderedSegments = 0;
+
     /*
      * These "UI" type things we decided, late in 1.8, are actually a critical part of
      * the modelling experience, so even if they aren't required to actually evaluate
@@ -1167,6 +1182,11 @@ class SurgePatch
     // void load_xml();
     // void save_xml();
     void load_xml(const void *data, int size, bool preset);
+    // The same, from a document parse_xml has already parsed
+    void load_xml(TiXmlDocument &doc, bool preset);
+    // False, leaving doc alone, if the xml is too large to be trusted
+    static bool parse_xml(const void *data, int size, TiXmlDocument &doc);
+    static constexpr int maxPatchXMLSize = 1 << 22;
     unsigned int save_xml(void **data);
     unsigned int save_RIFF(void **data);
 
@@ -1178,7 +1198,8 @@ class SurgePatch
     void formulaToXMLElement(FormulaModulatorStorage *ms, TiXmlElement &parent) const;
     void formulaFromXMLElement(FormulaModulatorStorage *ms, TiXmlElement *parent) const;
 
-    void load_patch(const void *data, int size, bool preset);
+    // parsedXml, if given, is the patch's xml already parsed, which is used instead
+    void load_patch(const void *data, int size, bool preset, TiXmlDocument *parsedXml = nullptr);
     unsigned int save_patch(void **data);
     Parameter *parameterFromOSCName(std::string stName);
 
@@ -1330,6 +1351,7 @@ struct ScenesOutputData
 
 struct FxUserPreset;
 struct ModulatorPreset;
+class WavetableLoader;
 } // namespace Storage
 namespace Memory
 {
@@ -1339,6 +1361,10 @@ namespace Formula
 {
 struct GlobalData;
 }
+namespace Threading
+{
+class RenderThreadPool;
+}
 } // namespace Surge
 
 namespace sst::basic_blocks::tables
@@ -1511,6 +1537,32 @@ class alignas(16) SurgeStorage
 
     void perform_queued_wtloads();
 
+    /*
+     * Off by default. When on, perform_queued_wtloads hands queued loads to a worker
+     * thread and swaps each finished table in on a later block, rather than reading
+     * the file and building the mipmaps inline. Change it before audio starts.
+     */
+    void setBackgroundWavetableLoading(bool b);
+    bool isBackgroundWavetableLoading() const { return wavetableLoader != nullptr; }
+    void cancel_background_wtloads();
+    std::unique_ptr<Surge::Storage::WavetableLoader> wavetableLoader;
+
+    /*
+     * How many threads render voices, counting the audio thread. At 1, the default,
+     * voices render inline. Above that, each block's quad filter groups are split across
+     * the process-wide render pool, which every instance shares, joined the first time
+     * this goes above 1 and kept until we go away. Not from the audio thread.
+     */
+    static constexpr int maxRenderThreads = 16;
+    void setRenderThreadCount(int n);
+    int getRenderThreadCount() const { return renderThreadCount.load(std::memory_order_acquire); }
+    Surge::Threading::RenderThreadPool *getRenderPool() const { return renderPool.get(); }
+  private:
+    std::shared_ptr<Surge::Threading::RenderThreadPool> renderPool;
+    std::atomic<int> renderThreadCount{1};
+
+  public:
+
     void load_wt(int id, Wavetable *wt, OscillatorStorage *);
     void load_wt(std::string filename, Wavetable *wt, OscillatorStorage *);
     bool load_wt_wt(std::string filename, Wavetable *wt, std::string &metadata);
@@ -1875,6 +1927,13 @@ class alignas(16) SurgeStorage
         std::uniform_int_distribution<uint32_t> u32;
     } rngGen;
 
+    /*
+     * While a voice renders, the calls below on its thread draw from the voice's own
+     * generator instead, so a voice gets the same numbers whichever thread renders it.
+     */
+    static inline thread_local RNGGen *renderRNG{nullptr};
+    inline RNGGen &currentRNG() { return renderRNG ? *renderRNG : rngGen; }
+
 #define DEBUG_RNG_THREADING 0
 #if DEBUG_RNG_THREADING
     std::thread::id audioThreadID{0};
@@ -1889,7 +1948,7 @@ class alignas(16) SurgeStorage
 #define runningOnAudioThread() (void *)0;
 #endif
     /*
-     * These API points are only thread safe on the AUDIO thread.
+     * These API points are only thread safe on the AUDIO thread, or inside a voice render.
      * If you want to have an independent RNG on another thread, manage
      * your lifecycle yourself or if you want make a new instance of the
      * Storage::RNGGen utility class above
@@ -1897,22 +1956,26 @@ class alignas(16) SurgeStorage
     inline int rand()
     {
         runningOnAudioThread();
-        return rngGen.d(rngGen.g);
+        auto &r = currentRNG();
+        return r.d(r.g);
     }
     inline uint32_t rand_u32()
     {
         runningOnAudioThread();
-        return rngGen.u32(rngGen.g);
+        auto &r = currentRNG();
+        return r.u32(r.g);
     }
     inline float rand_pm1()
     {
         runningOnAudioThread();
-        return rngGen.pm1(rngGen.g);
+        auto &r = currentRNG();
+        return r.pm1(r.g);
     }
     inline float rand_01()
     {
         runningOnAudioThread();
-        return rngGen.z1(rngGen.g);
+        auto &r = currentRNG();
+        return r.z1(r.g);
     }
 // void seed_rand(int s) { rngGen.g.seed(s); }
 #else
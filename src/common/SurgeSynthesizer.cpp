@@ -40,6 +40,7 @@
 #endif
 
 #include "SurgeMemoryPools.h"
+#include "RenderThreadPool.h"
 
 #include "sst/basic-blocks/mechanics/block-ops.h"
 #include "sst/basic-blocks/dsp/Clippers.h"
@@ -109,8 +110,12 @@ SurgeSynthesizer::SurgeSynthesizer(PluginLayer *parent, const std::string &suppl
         voices_usedby[1][i] = 0;
     }
 
+    globalRoutingSnapshot.reserve(routingSnapshotCapacity);
+
     for (int sc = 0; sc < n_scenes; sc++)
     {
+        voices[sc].bindSlots(voices_array[sc].data());
+        sceneRoutingSnapshot[sc].reserve(routingSnapshotCapacity);
         FBQ[sc] = new QuadFilterChainState[MAX_VOICES >> 2]();
 
         for (int i = 0; i < (MAX_VOICES >> 2); ++i)
@@ -245,6 +250,17 @@ SurgeSynthesizer::SurgeSynthesizer(PluginLayer *parent, const std::string &suppl
     patchid_file[0] = 0;
     patchid = -1;
     CC0 = 0;
+
+    // A preloaded patch is switched to on the audio thread, so its listeners run from here
+    patchPreloader.onPatchSwitched = [this](int id) {
+        if (id < 0 || id >= storage.patch_list.size())
+            return;
+
+        auto path = storage.patch_list[id].path;
+        storage.lastLoadedPatch = path;
+        for (auto &it : patchLoadedListeners)
+            (it.second)(path);
+    };
     CC32 = 0;
     PCH = 0;
 
@@ -545,7 +561,7 @@ void SurgeSynthesizer::playNoteByFrequency(float freq, char velocity, int32_t id
 
 void SurgeSynthesizer::softkillVoice(int s)
 {
-    list<SurgeVoice *>::iterator iter, max_playing, max_released;
+    Surge::Voice::VoiceSet::iterator iter, max_playing, max_released;
     int max_age = -1, max_age_release = -1;
     iter = voices[s].begin();
 
@@ -580,7 +596,7 @@ void SurgeSynthesizer::softkillVoice(int s)
 // only allow 'margin' number of voices to be softkilled simultaneously
 void SurgeSynthesizer::enforcePolyphonyLimit(int s, int margin)
 {
-    list<SurgeVoice *>::iterator iter;
+    Surge::Voice::VoiceSet::iterator iter;
 
     int paddedPoly = std::min((storage.getPatch().polylimit.val.i + margin), MAX_VOICES - 1);
     if (voices[s].size() > paddedPoly)
@@ -675,26 +691,11 @@ void SurgeSynthesizer::freeVoice(SurgeVoice *v)
         }
     }
 
-    int foundScene{-1}, foundIndex{-1};
-    for (int i = 0; i < MAX_VOICES; i++)
-    {
-        if (voices_usedby[0][i] && (v == &voices_array[0][i]))
-        {
-            assert(foundScene == -1);
-            assert(foundIndex == -1);
-            foundScene = 0;
-            foundIndex = i;
-            voices_usedby[0][i] = 0;
-        }
-        if (voices_usedby[1][i] && (v == &voices_array[1][i]))
-        {
-            assert(foundScene == -1);
-            assert(foundIndex == -1);
-            foundScene = 1;
-            foundIndex = i;
-            voices_usedby[1][i] = 0;
-        }
-    }
+    int foundScene = v->state.scene_id;
+    int foundIndex = (int)(v - voices_array[foundScene].data());
+    assert(foundIndex >= 0 && foundIndex < MAX_VOICES);
+    assert(voices_usedby[foundScene][foundIndex]);
+    voices_usedby[foundScene][foundIndex] = 0;
     v->freeAllocatedElements();
 
     /*
@@ -745,6 +746,9 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
     int16_t host_originating_key = (int16_t)key;
     int16_t host_originating_channel = (int16_t)channel;
 
+    // So a note started right after a routing edit has it from the first sample
+    updateModulationRoutingSnapshot();
+
     if (override_hostkey >= 0)
         host_originating_key = override_hostkey;
     if (override_hostchan >= 0)
@@ -843,7 +847,8 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
                     storage.getPatch().scenedataOrig[scene], key, velocity, channel, scene, detune,
                     &channelState[channel].keyState[key], &channelState[mpeMainChannel],
                     &channelState[channel], mpeEnabled, voiceCounter++, host_noteid,
-                    host_originating_key, host_originating_channel, 0.f, 0.f);
+                    host_originating_key, host_originating_channel, 0.f, 0.f,
+                    &voiceModulationPlan[scene]);
             }
         }
         break;
@@ -852,7 +857,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
     case pm_mono_fp:
     case pm_latch:
     {
-        list<SurgeVoice *>::const_iterator iter;
+        Surge::Voice::VoiceSet::const_iterator iter;
         bool glide = false;
 
         int primode = storage.getPatch().scene[scene].monoVoicePriorityMode;
@@ -988,7 +993,8 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
                         storage.getPatch().scenedataOrig[scene], key, velocity, channel, scene,
                         detune, &channelState[channel].keyState[key], &channelState[mpeMainChannel],
                         &channelState[channel], mpeEnabled, voiceCounter++, host_noteid,
-                        host_originating_key, host_originating_channel, aegReuse, fegReuse);
+                        host_originating_key, host_originating_channel, aegReuse, fegReuse,
+                        &voiceModulationPlan[scene]);
 
                     if (wasGated && pkeyToReuse > 0)
                     {
@@ -1078,7 +1084,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
 
         if (createVoice)
         {
-            list<SurgeVoice *>::const_iterator iter;
+            Surge::Voice::VoiceSet::const_iterator iter;
             SurgeVoice *recycleThis{nullptr};
             float aegStart{0.}, fegStart{0.};
             for (iter = voices[scene].begin(); iter != voices[scene].end(); iter++)
@@ -1133,7 +1139,8 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
                         storage.getPatch().scenedataOrig[scene], key, velocity, channel, scene,
                         detune, &channelState[channel].keyState[key], &channelState[mpeMainChannel],
                         &channelState[channel], mpeEnabled, voiceCounter++, host_noteid,
-                        host_originating_key, host_originating_channel, aegStart, fegStart);
+                        host_originating_key, host_originating_channel, aegStart, fegStart,
+                        &voiceModulationPlan[scene]);
                 }
             }
             else
@@ -1174,7 +1181,7 @@ void SurgeSynthesizer::playVoice(int scene, char channel, char key, char velocit
 
 void SurgeSynthesizer::releaseScene(int s)
 {
-    list<SurgeVoice *>::const_iterator iter;
+    Surge::Voice::VoiceSet::const_iterator iter;
     for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
     {
         freeVoice(*iter);
@@ -1320,7 +1327,7 @@ void SurgeSynthesizer::releaseNotePostHoldCheck(int scene, char channel, char ke
                                                 int32_t host_noteid)
 {
     channelState[channel].keyState[key].keystate = 0;
-    list<SurgeVoice *>::const_iterator iter;
+    Surge::Voice::VoiceSet::const_iterator iter;
     for (int s = 0; s < n_scenes; s++)
     {
         bool do_switch = false;
@@ -2588,7 +2595,7 @@ void SurgeSynthesizer::stopSound()
 
     for (int s = 0; s < n_scenes; s++)
     {
-        list<SurgeVoice *>::const_iterator iter;
+        Surge::Voice::VoiceSet::const_iterator iter;
         for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
         {
             freeVoice(*iter);
@@ -2988,7 +2995,7 @@ void SurgeSynthesizer::switch_toggled()
 {
     for (int s = 0; s < n_scenes; s++)
     {
-        list<SurgeVoice *>::iterator iter;
+        Surge::Voice::VoiceSet::iterator iter;
         for (iter = voices[s].begin(); iter != voices[s].end(); iter++)
         {
             SurgeVoice *v = *iter;
@@ -3620,31 +3627,19 @@ void SurgeSynthesizer::prepareModsourceDoProcess(int scenemask)
                 }
             }
 
-            for (int j = 0; j < 3; j++)
-            {
-                vector<ModulationRouting> *modlist;
-
-                switch (j)
-                {
-                case 0:
-                    modlist = &storage.getPatch().modulation_global;
-                    break;
-                case 1:
-                    modlist = &storage.getPatch().scene[scene].modulation_scene;
-                    break;
-                case 2:
-                    modlist = &storage.getPatch().scene[scene].modulation_voice;
-                    break;
-                }
-
-                int n = modlist->size();
-                for (int i = 0; i < n; i++)
+            // This runs on the audio thread, so it reads the routing snapshot
+            auto markUsed = [this, scene](const auto &routings) {
+                for (const auto &r : routings)
                 {
-                    int id = modlist->at(i).source_id;
+                    int id = r.source_id;
                     assert((id > 0) && (id < n_modsources));
                     storage.getPatch().scene[scene].modsource_doprocess[id] = true;
                 }
-            }
+            };
+
+            markUsed(globalRoutingSnapshot);
+            markUsed(sceneRoutingSnapshot[scene]);
+            markUsed(voiceModulationPlan[scene].voiceRoutings());
         }
     }
 }
@@ -4336,9 +4331,28 @@ void SurgeSynthesizer::enqueueFXOff(int whichFX)
     load_fx_needed = true;
 }
 
+bool SurgeSynthesizer::updateModulationRoutingSnapshot()
+{
+    if (!storage.modRoutingMutex.try_lock())
+    {
+        return false;
+    }
+
+    for (int s = 0; s < n_scenes; s++)
+    {
+        sceneRoutingSnapshot[s] = storage.getPatch().scene[s].modulation_scene;
+        voiceModulationPlan[s].updateRoutings(storage.getPatch().scene[s]);
+    }
+    globalRoutingSnapshot = storage.getPatch().modulation_global;
+
+    storage.modRoutingMutex.unlock();
+    return true;
+}
+
 void SurgeSynthesizer::processControl()
 {
     processEnqueuedPatchIfNeeded();
+    updateModulationRoutingSnapshot();
 
     storage.perform_queued_wtloads();
     int sm = storage.getPatch().scenemode.val.i;
@@ -4456,19 +4470,19 @@ void SurgeSynthesizer::processControl()
             // for(int i=0; i<n_lfos_scene; i++)
             // storage.getPatch().scene[s].modsources[ms_slfo1+i]->process_block();
 
-            int n = storage.getPatch().scene[s].modulation_scene.size();
+            int n = sceneRoutingSnapshot[s].size();
             for (int i = 0; i < n; i++)
             {
-                int src_id = storage.getPatch().scene[s].modulation_scene[i].source_id;
-                int src_index = storage.getPatch().scene[s].modulation_scene[i].source_index;
+                int src_id = sceneRoutingSnapshot[s][i].source_id;
+                int src_index = sceneRoutingSnapshot[s][i].source_index;
                 if (storage.getPatch().scene[s].modsources[src_id])
                 {
-                    int dst_id = storage.getPatch().scene[s].modulation_scene[i].destination_id;
-                    float depth = storage.getPatch().scene[s].modulation_scene[i].depth;
+                    int dst_id = sceneRoutingSnapshot[s][i].destination_id;
+                    float depth = sceneRoutingSnapshot[s][i].depth;
                     storage.getPatch().scenedata[s][dst_id].f +=
                         depth *
                         storage.getPatch().scene[s].modsources[src_id]->get_output(src_index) *
-                        (1.0 - storage.getPatch().scene[s].modulation_scene[i].muted);
+                        (1.0 - sceneRoutingSnapshot[s][i].muted);
                 }
             }
 
@@ -4489,21 +4503,27 @@ void SurgeSynthesizer::processControl()
         }
     }
 
+    // The scene data is final for this block, so work out what the voices need to refresh
+    for (int s = 0; s < n_scenes; s++)
+    {
+        voiceModulationPlan[s].compile(storage.getPatch().scenedata[s]);
+    }
+
     loadOscalgos();
 
-    int n = storage.getPatch().modulation_global.size();
+    int n = globalRoutingSnapshot.size();
     for (int i = 0; i < n; i++)
     {
-        int src_id = storage.getPatch().modulation_global[i].source_id;
-        int src_index = storage.getPatch().modulation_global[i].source_index;
-        int dst_id = storage.getPatch().modulation_global[i].destination_id;
-        float depth = storage.getPatch().modulation_global[i].depth;
-        int source_scene = storage.getPatch().modulation_global[i].source_scene;
+        int src_id = globalRoutingSnapshot[i].source_id;
+        int src_index = globalRoutingSnapshot[i].source_index;
+        int dst_id = globalRoutingSnapshot[i].destination_id;
+        float depth = globalRoutingSnapshot[i].depth;
+        int source_scene = globalRoutingSnapshot[i].source_scene;
 
         storage.getPatch().globaldata[dst_id].f +=
             depth *
             storage.getPatch().scene[source_scene].modsources[src_id]->get_output(src_index) *
-            (1 - storage.getPatch().modulation_global[i].muted);
+            (1 - globalRoutingSnapshot[i].muted);
     }
 
     if (switch_toggled_queued)
@@ -4512,8 +4532,13 @@ void SurgeSynthesizer::processControl()
         switch_toggled_queued = false;
     }
 
-    if (load_fx_needed)
+    // Reordering FX rewrites the slots under the routing mutex, so if an editor is in the
+    // middle of that, pick up the change next block rather than wait
+    if (load_fx_needed && storage.modRoutingMutex.try_lock())
+    {
         loadFx(false, false);
+        storage.modRoutingMutex.unlock();
+    }
 
     if (fx_suspend_bitmask)
     {
@@ -4561,8 +4586,251 @@ void SurgeSynthesizer::processControl()
 #endif
 }
 
+int SurgeSynthesizer::processSceneVoices(int s)
+{
+    int FBentry = 0;
+    auto iter = voices[s].begin();
+
+    // Every voice's LFOs run first, so that their formulas can be evaluated together
+    bool batchFormulas = batchFormulaLFOs && voices[s].size() > 1 && sceneHasFormulaLFOs(s);
+    if (batchFormulas)
+    {
+        for (auto v : voices[s])
+        {
+            SurgeStorage::renderRNG = &v->rng;
+            v->processLFOs(&formulaBatch);
+            SurgeStorage::renderRNG = nullptr;
+        }
+        formulaBatch.evaluate(&storage);
+    }
+
+    while (iter != voices[s].end())
+    {
+        // The voices which will share the next quad filter entry
+        SurgeVoice *group[4];
+        int n = 0;
+        for (auto it = iter; it != voices[s].end() && n < 4; ++it)
+            group[n++] = *it;
+
+        if (batchFormulas)
+        {
+            for (int i = 0; i < n; i++)
+                group[i]->retriggerEnvelopesFromLFOs();
+            SurgeVoice::processEnvelopesQuad(group, n);
+        }
+        else
+        {
+            processGroupEnvelopes(group, n);
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            SurgeVoice *v = group[i];
+            assert(v);
+            SurgeStorage::renderRNG = &v->rng;
+            bool resume = v->process_block(FBQ[s][FBentry >> 2], FBentry & 3, true);
+            SurgeStorage::renderRNG = nullptr;
+            FBentry++;
+
+            if (!resume)
+            {
+                freeVoice(v);
+                iter = voices[s].erase(iter);
+            }
+            else
+                iter++;
+        }
+    }
+
+    return FBentry;
+}
+
+void SurgeSynthesizer::processGroupEnvelopes(SurgeVoice *const *group, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        SurgeStorage::renderRNG = &group[i]->rng;
+        group[i]->processModulatorsBeforeEnvelopes();
+        SurgeStorage::renderRNG = nullptr;
+    }
+
+    SurgeVoice::processEnvelopesQuad(group, n);
+}
+
+void SurgeSynthesizer::prepareSceneFilterBlock(int s)
+{
+    using sst::filters::FilterType, sst::filters::FilterSubType;
+    auto &g = sceneFBGlobal[s];
+    if (storage.getPatch().scene[s].filterunit[0].type.deactivated)
+    {
+        g.FU1ptr = nullptr;
+    }
+    else
+    {
+        g.FU1ptr = sst::filters::GetQFPtrFilterUnit(
+            static_cast<FilterType>(storage.getPatch().scene[s].filterunit[0].type.val.i),
+            static_cast<FilterSubType>(storage.getPatch().scene[s].filterunit[0].subtype.val.i));
+    }
+    if (storage.getPatch().scene[s].filterunit[1].type.deactivated)
+    {
+        g.FU2ptr = nullptr;
+    }
+    else
+    {
+        g.FU2ptr = sst::filters::GetQFPtrFilterUnit(
+            static_cast<FilterType>(storage.getPatch().scene[s].filterunit[1].type.val.i),
+            static_cast<FilterSubType>(storage.getPatch().scene[s].filterunit[1].subtype.val.i));
+    }
+
+    if (storage.getPatch().scene[s].wsunit.type.deactivated)
+    {
+        g.WSptr = nullptr;
+    }
+    else
+    {
+        g.WSptr = sst::waveshapers::GetQuadWaveshaper(static_cast<sst::waveshapers::WaveshaperType>(
+            storage.getPatch().scene[s].wsunit.type.val.i));
+    }
+
+    sceneProcessQuadFB[s] =
+        GetFBQPointer(storage.getPatch().scene[s].filterblock_configuration.val.i,
+                      g.FU1ptr != 0, g.WSptr != 0, g.FU2ptr != 0);
+}
+
+void SurgeSynthesizer::processFilterGroup(int s, int group, int FBentry, float *outL, float *outR)
+{
+    auto &Q = FBQ[s][group];
+    int units = FBentry - (group << 2);
+    for (int i = units; i < 4; i++)
+    {
+        Q.FU[0].active[i] = 0;
+        Q.FU[1].active[i] = 0;
+        Q.FU[2].active[i] = 0;
+        Q.FU[3].active[i] = 0;
+    }
+    sceneProcessQuadFB[s](Q, sceneFBGlobal[s], outL, outR);
+}
+
+void SurgeSynthesizer::processSceneFilterBlocks(int s, int FBentry)
+{
+    prepareSceneFilterBlock(s);
+
+    for (int e = 0; e < FBentry; e += 4)
+    {
+        processFilterGroup(s, e >> 2, FBentry, sceneout[s][0], sceneout[s][1]);
+    }
+
+    // save filter state in voices after quad processing is done
+    for (auto v : voices[s])
+    {
+        assert(v);
+        v->GetQFB();
+    }
+}
+
+bool SurgeSynthesizer::sceneHasFormulaLFOs(int s) const
+{
+    for (int l = 0; l < n_lfos_voice; l++)
+    {
+        if (storage.getPatch().scene[s].lfo[l].shape.val.i == lt_formula)
+            return true;
+    }
+
+    return false;
+}
+
+bool SurgeSynthesizer::canRenderSceneOnPool(int s) const
+{
+    if (storage.getRenderThreadCount() < 2 || voices[s].empty())
+        return false;
+
+    // Formula modulators share one Lua state, which only the audio thread may use
+    return !sceneHasFormulaLFOs(s);
+}
+
+void SurgeSynthesizer::renderQuadGroup(int s, int group, int FBentry)
+{
+    int first = group << 2, last = std::min(FBentry, first + 4);
+
+    processGroupEnvelopes(&renderVoices[s][first], last - first);
+
+    for (int e = first; e < last; e++)
+    {
+        auto v = renderVoices[s][e];
+        SurgeStorage::renderRNG = &v->rng;
+        renderVoiceEnded[s][e] = !v->process_block(FBQ[s][group], e & 3, true);
+        SurgeStorage::renderRNG = nullptr;
+    }
+
+    mech::clear_block<BLOCK_SIZE_OS>(groupout[s][group][0]);
+    mech::clear_block<BLOCK_SIZE_OS>(groupout[s][group][1]);
+    processFilterGroup(s, group, FBentry, groupout[s][group][0], groupout[s][group][1]);
+
+    for (int e = first; e < last; e++)
+    {
+        if (!renderVoiceEnded[s][e])
+            renderVoices[s][e]->GetQFB();
+    }
+}
+
+void SurgeSynthesizer::renderScenesOnPool(int firstScene, int endScene, int *FBentry)
+{
+    int tasks = 0;
+    for (int s = firstScene; s < endScene; s++)
+    {
+        int n = 0;
+        for (auto v : voices[s])
+            renderVoices[s][n++] = v;
+
+        FBentry[s] = n;
+        prepareSceneFilterBlock(s);
+
+        for (int group = 0; group < (n + 3) >> 2; group++)
+            renderTasks[tasks++] = {s, group};
+    }
+
+    auto workers = storage.getRenderThreadCount() - 1;
+    storage.getRenderPool()->parallelFor(tasks, workers, [this, FBentry](int t) {
+        Surge::Memory::AudioThreadScope audioThread;
+        auto &task = renderTasks[t];
+        renderQuadGroup(task.scene, task.group, FBentry[task.scene]);
+    });
+
+    for (int s = firstScene; s < endScene; s++)
+    {
+        // Each group went to a buffer of its own, and adding them up in voice order here
+        // is exactly what ProcessQuadFB does inline, so the output is bit-identical
+        for (int group = 0; group < (FBentry[s] + 3) >> 2; group++)
+        {
+            mech::accumulate_from_to<BLOCK_SIZE_OS>(groupout[s][group][0], sceneout[s][0]);
+            mech::accumulate_from_to<BLOCK_SIZE_OS>(groupout[s][group][1], sceneout[s][1]);
+        }
+
+        // freeVoice looks through both scenes, so ended voices go once every task is done
+        int e = 0;
+        auto iter = voices[s].begin();
+        while (iter != voices[s].end())
+        {
+            if (renderVoiceEnded[s][e++])
+            {
+                freeVoice(*iter);
+                iter = voices[s].erase(iter);
+            }
+            else
+                iter++;
+        }
+    }
+}
+
+void SurgeSynthesizer::setParallelSceneRendering(bool b)
+{
+    storage.setRenderThreadCount(b ? std::max(2, storage.getRenderThreadCount()) : 1);
+}
+
 void SurgeSynthesizer::process()
 {
+    Surge::Memory::AudioThreadScope audioThread;
+
 #if DEBUG_RNG_THREADING
     storage.audioThreadID = std::this_thread::get_id();
 #endif
@@ -4599,8 +4867,34 @@ void SurgeSynthesizer::process()
         mech::clear_block<BLOCK_SIZE>(output[1]);
         return;
     }
+    else if (patchid_queue >= 0 && !has_patchid_file && isPreloadedPatchReady(patchid_queue))
+    {
+        /*
+         * The patch is already in memory, so rather than go silent while a thread loads it,
+         * fade out over a few blocks, load it here once the fade is done, and start the new
+         * patch's fade in with the same block. If a lock it needs is busy, it stays faded
+         * out and tries again next block.
+         */
+        if (masterfade < 0.0001f)
+        {
+            std::unique_lock<std::mutex> mg(patchLoadSpawnMutex, std::try_to_lock);
+            int id = patchid_queue;
+            if (mg.owns_lock() && id >= 0 && loadPreloadedPatch(id))
+            {
+                patchid_queue = -1;
+                masterfade = preloadedPatchFadeStep;
+                fadingInPreloadedPatch = true;
+            }
+        }
+        else
+        {
+            masterfade = max(0.f, masterfade - preloadedPatchFadeStep);
+        }
+        mfade = masterfade * masterfade;
+    }
     else if (patchid_queue >= 0 || has_patchid_file)
     {
+        fadingInPreloadedPatch = false;
         masterfade = max(0.f, masterfade - 0.05f);
         mfade = masterfade * masterfade;
 
@@ -4639,6 +4933,12 @@ void SurgeSynthesizer::process()
             approachingAllSoundOff = false;
         }
     }
+    else if (fadingInPreloadedPatch)
+    {
+        masterfade = min(1.f, masterfade + preloadedPatchFadeStep);
+        mfade = masterfade * masterfade;
+        fadingInPreloadedPatch = masterfade < 1.f;
+    }
 
     // process inputs (upsample & halfrate)
     if (process_input)
@@ -4675,7 +4975,6 @@ void SurgeSynthesizer::process()
         }
     }
 
-    storage.modRoutingMutex.lock();
     processControl();
 
     amp.set_target_smoothed(
@@ -4709,8 +5008,6 @@ void SurgeSynthesizer::process()
         }
     }
 
-    list<SurgeVoice *>::iterator iter;
-
     for (int sc = 0; sc < n_scenes; sc++)
     {
         play_scene[sc] = (!voices[sc].empty());
@@ -4719,111 +5016,64 @@ void SurgeSynthesizer::process()
     int FBentry[n_scenes];
     int vcount = 0;
 
+    bool onPool[n_scenes];
     for (int s = 0; s < n_scenes; s++)
     {
-        FBentry[s] = 0;
-        iter = voices[s].begin();
-        while (iter != voices[s].end())
-        {
-            SurgeVoice *v = *iter;
-            assert(v);
-            bool resume = v->process_block(FBQ[s][FBentry[s] >> 2], FBentry[s] & 3);
-            FBentry[s]++;
-
-            vcount++;
-
-            if (!resume)
-            {
-                freeVoice(v);
-                iter = voices[s].erase(iter);
-            }
-            else
-                iter++;
-        }
-
-        storage.modRoutingMutex.unlock();
+        onPool[s] = canRenderSceneOnPool(s);
+    }
 
-        using sst::filters::FilterType, sst::filters::FilterSubType;
-        fbq_global g;
-        if (storage.getPatch().scene[s].filterunit[0].type.deactivated)
-        {
-            g.FU1ptr = nullptr;
-        }
-        else
-        {
-            g.FU1ptr = sst::filters::GetQFPtrFilterUnit(
-                static_cast<FilterType>(storage.getPatch().scene[s].filterunit[0].type.val.i),
-                static_cast<FilterSubType>(
-                    storage.getPatch().scene[s].filterunit[0].subtype.val.i));
-        }
-        if (storage.getPatch().scene[s].filterunit[1].type.deactivated)
-        {
-            g.FU2ptr = nullptr;
-        }
-        else
-        {
-            g.FU2ptr = sst::filters::GetQFPtrFilterUnit(
-                static_cast<FilterType>(storage.getPatch().scene[s].filterunit[1].type.val.i),
-                static_cast<FilterSubType>(
-                    storage.getPatch().scene[s].filterunit[1].subtype.val.i));
-        }
+    /*
+     * The scenes don't meet until they're summed below, unless scene B reads scene A's
+     * output, so both scenes' quad groups can usually go to the pool as one batch.
+     */
+    if (onPool[0] && onPool[1] && storage.otherscene_clients == 0)
+    {
+        renderScenesOnPool(0, n_scenes, FBentry);
 
-        if (storage.getPatch().scene[s].wsunit.type.deactivated)
-        {
-            g.WSptr = nullptr;
-        }
-        else
+        for (int s = 0; s < n_scenes; s++)
         {
-            g.WSptr =
-                sst::waveshapers::GetQuadWaveshaper(static_cast<sst::waveshapers::WaveshaperType>(
-                    storage.getPatch().scene[s].wsunit.type.val.i));
-        }
-
-        FBQFPtr ProcessQuadFB =
-            GetFBQPointer(storage.getPatch().scene[s].filterblock_configuration.val.i,
-                          g.FU1ptr != 0, g.WSptr != 0, g.FU2ptr != 0);
+            vcount += FBentry[s];
 
-        for (int e = 0; e < FBentry[s]; e += 4)
-        {
-            int units = FBentry[s] - e;
-            for (int i = units; i < 4; i++)
+            if (storage.getPatch().scene[s].volume.deactivated)
             {
-                FBQ[s][e >> 2].FU[0].active[i] = 0;
-                FBQ[s][e >> 2].FU[1].active[i] = 0;
-                FBQ[s][e >> 2].FU[2].active[i] = 0;
-                FBQ[s][e >> 2].FU[3].active[i] = 0;
+                mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][0]);
+                mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][1]);
             }
-            ProcessQuadFB(FBQ[s][e >> 2], g, sceneout[s][0], sceneout[s][1]);
         }
-
-        if (s == 0 && storage.otherscene_clients > 0)
+    }
+    else
+    {
+        for (int s = 0; s < n_scenes; s++)
         {
-            // Make available for scene B
-            mech::copy_from_to<BLOCK_SIZE_OS>(sceneout[0][0], storage.audio_otherscene[0]);
-            mech::copy_from_to<BLOCK_SIZE_OS>(sceneout[0][1], storage.audio_otherscene[1]);
-        }
-
-        iter = voices[s].begin();
+            if (onPool[s])
+            {
+                renderScenesOnPool(s, s + 1, FBentry);
+                vcount += FBentry[s];
+            }
+            else
+            {
+                FBentry[s] = processSceneVoices(s);
+                vcount += FBentry[s];
 
-        while (iter != voices[s].end())
-        {
-            SurgeVoice *v = *iter;
-            assert(v);
-            v->GetQFB(); // save filter state in voices after quad processing is done
-            iter++;
-        }
+                processSceneFilterBlocks(s, FBentry[s]);
+            }
 
-        storage.modRoutingMutex.lock();
+            if (s == 0 && storage.otherscene_clients > 0)
+            {
+                // Make available for scene B
+                mech::copy_from_to<BLOCK_SIZE_OS>(sceneout[0][0], storage.audio_otherscene[0]);
+                mech::copy_from_to<BLOCK_SIZE_OS>(sceneout[0][1], storage.audio_otherscene[1]);
+            }
 
-        // mute scene
-        if (storage.getPatch().scene[s].volume.deactivated)
-        {
-            mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][0]);
-            mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][1]);
+            // mute scene
+            if (storage.getPatch().scene[s].volume.deactivated)
+            {
+                mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][0]);
+                mech::clear_block<BLOCK_SIZE_OS>(sceneout[s][1]);
+            }
         }
     }
 
-    storage.modRoutingMutex.unlock();
     storage.activeVoiceCount = vcount;
 
     // TODO: FIX SCENE ASSUMPTION
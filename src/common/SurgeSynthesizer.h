@@ -24,6 +24,9 @@
 #define SURGE_SRC_COMMON_SURGESYNTHESIZER_H
 #include "SurgeStorage.h"
 #include "SurgeVoice.h"
+#include "VoiceSet.h"
+#include "PatchPreloader.h"
+#include "VoiceModulationPlan.h"
 #include "Effect.h"
 #include "BiquadFilter.h"
 #include <set>
@@ -424,10 +427,14 @@ class alignas(16) SurgeSynthesizer
     void enqueuePatchForLoad(const void *data, int size); // safe from any thread
     void processEnqueuedPatchIfNeeded();                  // only safe from audio thread
 
-    void loadRaw(const void *data, int size, bool preset = false);
+    void loadRaw(const void *data, int size, bool preset = false,
+                 TiXmlDocument *parsedXml = nullptr);
     void loadPatch(int id);
     bool loadPatchByPath(const char *fxpPath, int categoryId, const char *name,
                          bool forceIsPreset = true);
+    // The part of loadPatchByPath after the file is read
+    void loadPatchChunk(const void *data, int size, int categoryId, const char *name,
+                        bool forceIsPreset, TiXmlDocument *parsedXml = nullptr);
     void selectRandomPatch();
     std::unique_ptr<std::thread> patchLoadThread;
 
@@ -458,6 +465,22 @@ class alignas(16) SurgeSynthesizer
     }
     void deletePatchLoadedListener(std::string key) { patchLoadedListeners.erase(key); }
 
+    /*
+     * Patches from the patch list can be read into memory ahead of time. Switching to one
+     * through patchid_queue as usual then loads it on the audio thread at a block boundary,
+     * with a fade of a few blocks either side, rather than fading out over twenty blocks and
+     * staying silent while a thread reads it. preloadPatches is for setlists: it keeps just
+     * the listed patches in memory. Neither is for the audio thread.
+     */
+    void preloadPatch(int id);
+    void preloadPatches(const std::vector<int> &ids);
+    bool isPreloadedPatchReady(int id); // only safe from audio thread
+    bool loadPreloadedPatch(int id);    // only safe from audio thread
+    // After the listeners, since its worker calls them
+    Surge::Storage::PatchPreloader patchPreloader;
+    static constexpr float preloadedPatchFadeStep = 0.25f;
+    bool fadingInPreloadedPatch{false};
+
     //==============================================================================
     // Parameter changes coming from within the synth (e.g. from MIDI-learned input)
     // are communicated to listeners here
@@ -504,7 +527,25 @@ class alignas(16) SurgeSynthesizer
     bool approachingAllSoundOff{false};
     // TODO: FIX SCENE ASSUMPTION (for halfbandA/B - use std::array)
     sst::filters::HalfRate::HalfRateFilter halfbandA, halfbandB, halfbandIN;
-    std::list<SurgeVoice *> voices[n_scenes];
+    Surge::Voice::VoiceSet voices[n_scenes];
+    // Compiled in processControl, so a scene's voices see the same plan for the whole block
+    Surge::Voice::VoiceModulationPlan voiceModulationPlan[n_scenes];
+
+    /*
+     * The audio thread never waits on storage.modRoutingMutex. Instead it reads its own
+     * copy of the routings, which it refreshes whenever it can take the mutex without
+     * waiting, so while an editor holds it the synth keeps playing the routings from
+     * before the edit. Returns whether the copy was refreshed.
+     */
+    bool updateModulationRoutingSnapshot();
+    std::vector<ModulationRouting> sceneRoutingSnapshot[n_scenes], globalRoutingSnapshot;
+    // Reserved up front so that taking a copy doesn't allocate for any reasonable patch
+    static constexpr int routingSnapshotCapacity = 512;
+
+    // A scene's voice formula LFOs go to Lua in one batch per block; off, a call per voice
+    bool batchFormulaLFOs{true};
+    Surge::Formula::VoiceBatch formulaBatch;
+
     std::unique_ptr<Effect> fx[n_fx_slots];
     std::atomic<bool> halt_engine;
     MidiChannelState channelState[16];
@@ -568,6 +609,15 @@ class alignas(16) SurgeSynthesizer
 
     QuadFilterChainState *FBQ[n_scenes];
 
+    /*
+     * With parallel scene rendering on, the two scenes' voices and filter chains render on
+     * the storage's render pool whenever nothing in scene B listens to scene A's output.
+     * This is shorthand for a render thread count of at least 2; see
+     * SurgeStorage::setRenderThreadCount, which also splits voices within a scene.
+     */
+    void setParallelSceneRendering(bool b);
+    bool isParallelSceneRendering() const { return storage.getRenderThreadCount() > 1; }
+
     std::string hostProgram = "Unknown Host";
     std::string juceWrapperType = "Unknown Wrapper Type";
     bool activateExtraOutputs = true;
@@ -582,6 +632,29 @@ class alignas(16) SurgeSynthesizer
 
     void switch_toggled();
 
+    // Per-block state for rendering quad groups on the render pool
+    struct RenderTask
+    {
+        int scene, group;
+    };
+    RenderTask renderTasks[n_scenes * (MAX_VOICES >> 2)];
+    SurgeVoice *renderVoices[n_scenes][MAX_VOICES];
+    bool renderVoiceEnded[n_scenes][MAX_VOICES];
+    float groupout alignas(16)[n_scenes][MAX_VOICES >> 2][N_OUTPUTS][BLOCK_SIZE_OS];
+    fbq_global sceneFBGlobal[n_scenes];
+    FBQFPtr sceneProcessQuadFB[n_scenes];
+
+    int processSceneVoices(int scene);
+    // Runs a quad group's voice modulators up to their envelopes, then all the envelopes at once
+    void processGroupEnvelopes(SurgeVoice *const *group, int n);
+    void prepareSceneFilterBlock(int scene);
+    void processFilterGroup(int scene, int group, int voiceCount, float *outL, float *outR);
+    void processSceneFilterBlocks(int scene, int voiceCount);
+    bool sceneHasFormulaLFOs(int scene) const;
+    bool canRenderSceneOnPool(int scene) const;
+    void renderQuadGroup(int scene, int group, int voiceCount);
+    void renderScenesOnPool(int firstScene, int endScene, int *voiceCount);
+
     // MIDI control interpolators
     static constexpr int num_controlinterpolators = 128;
     ControllerModulationSource mControlInterpolator[num_controlinterpolators];
@@ -206,13 +206,71 @@ void SurgeSynthesizer::loadPatch(int id)
     storage.getPatch().isDirty = false;
 }
 
+void SurgeSynthesizer::preloadPatch(int id)
+{
+    if (id < 0 || id >= storage.patch_list.size())
+        return;
+
+    const auto &p = storage.patch_list[id];
+    patchPreloader.preload(id, p.category, p.name, p.path);
+}
+
+void SurgeSynthesizer::preloadPatches(const std::vector<int> &ids)
+{
+    std::vector<Surge::Storage::PatchPreloader::Entry> q;
+    for (auto id : ids)
+    {
+        if (id < 0 || id >= storage.patch_list.size())
+            continue;
+
+        Surge::Storage::PatchPreloader::Entry e;
+        e.patchId = id;
+        e.categoryId = storage.patch_list[id].category;
+        e.name = storage.patch_list[id].name;
+        e.path = storage.patch_list[id].path;
+        q.push_back(std::move(e));
+    }
+    patchPreloader.setQueue(std::move(q));
+}
+
+bool SurgeSynthesizer::isPreloadedPatchReady(int id)
+{
+    bool ready{false};
+    patchPreloader.withPreloadedPatch(id, [this, id, &ready](const auto &e) {
+        // The patch list may have been rescanned since this was read
+        ready = id < storage.patch_list.size() && storage.patch_list[id].path == e.path &&
+                e.categoryId < (int)storage.patch_category.size();
+    });
+    return ready;
+}
+
+bool SurgeSynthesizer::loadPreloadedPatch(int id)
+{
+    if (!isPreloadedPatchReady(id))
+        return false;
+
+    /*
+     * Like the rest of the audio thread, this doesn't wait on the routing mutex. While
+     * something else holds it the synth stays faded out and tries again next block.
+     */
+    std::unique_lock<std::recursive_mutex> ml(storage.modRoutingMutex, std::try_to_lock);
+    if (!ml.owns_lock())
+        return false;
+
+    return patchPreloader.withPreloadedPatch(id, [this, id](auto &e) {
+        patchid = id;
+        // The preloader parsed the xml, which leaves applying it to the patch
+        loadPatchChunk(e.data.get(), e.size, e.categoryId, e.name.c_str(), true, e.xml.get());
+        patchChanged = true;
+        updateDisplay();
+
+        patchPreloader.postPatchSwitched(id);
+    });
+}
+
 bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, const char *patchName,
                                        bool forceIsPreset)
 {
-    storage.getPatch().dawExtraState.editor.clearAllFormulaStates();
-    storage.getPatch().dawExtraState.editor.clearAllWTEStates();
-    storage.getPatch().dawExtraState.editor.clearAllModulationSourceButtonStates();
-
     using namespace sst::io;
 
     std::filebuf f;
@@ -270,6 +328,26 @@ bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, cons
 
     f.close();
 
+    loadPatchChunk(data.get(), cs, categoryId, patchName, forceIsPreset);
+    data.reset();
+
+    masterfade = 1.f;
+
+    // Notify the host display that the patch name has changed
+    storage.getPatch().isDirty = false;
+    updateDisplay();
+
+    return true;
+}
+
+void SurgeSynthesizer::loadPatchChunk(const void *data, int size, int categoryId,
+                                      const char *patchName, bool forceIsPreset,
+                                      TiXmlDocument *parsedXml)
+{
+    storage.getPatch().dawExtraState.editor.clearAllFormulaStates();
+    storage.getPatch().dawExtraState.editor.clearAllWTEStates();
+    storage.getPatch().dawExtraState.editor.clearAllModulationSourceButtonStates();
+
     storage.getPatch().comment = "";
     storage.getPatch().author = "";
 
@@ -285,8 +363,7 @@ bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, cons
     current_category_id = categoryId;
     storage.getPatch().name = patchName;
 
-    loadRaw(data.get(), cs, forceIsPreset);
-    data.reset();
+    loadRaw(data, size, forceIsPreset, parsedXml);
 
     // OK so at this point we may have loaded a patch with a tuning override
     if (storage.getPatch().patchTuning.tuningStoredInPatch)
@@ -371,13 +448,7 @@ bool SurgeSynthesizer::loadPatchByPath(const char *fxpPath, int categoryId, cons
         storage.patchStoredTuning = Tunings::Tuning();
     }
 
-    masterfade = 1.f;
-
-    // Notify the host display that the patch name has changed
     storage.getPatch().isDirty = false;
-    updateDisplay();
-
-    return true;
 }
 
 void SurgeSynthesizer::enqueuePatchForLoad(const void *data, int size)
@@ -413,6 +484,9 @@ void SurgeSynthesizer::processEnqueuedPatchIfNeeded()
             patchid_queue = -1;
         }
         std::lock_guard<std::mutex> g(rawLoadQueueMutex);
+        // The load rewrites the routings which editors read under this. The audio thread
+        // doesn't otherwise wait on it, but a patch load isn't realtime safe anyway.
+        std::lock_guard<std::recursive_mutex> ml(storage.modRoutingMutex);
         rawLoadEnqueued = false;
         loadRaw(enqueuedLoadData.get(), enqueuedLoadSize);
         loadFromDawExtraState();
@@ -422,7 +496,7 @@ void SurgeSynthesizer::processEnqueuedPatchIfNeeded()
     }
 }
 
-void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
+void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset, TiXmlDocument *parsedXml)
 {
     halt_engine = true;
     stopSound();
@@ -431,7 +505,7 @@ void SurgeSynthesizer::loadRaw(const void *data, int size, bool preset)
             storage.getPatch().scene[s].modsources[ms_ctrl1 + i]->reset();
 
     storage.getPatch().init_default_values();
-    storage.getPatch().load_patch(data, size, preset);
+    storage.getPatch().load_patch(data, size, preset, parsedXml);
     storage.getPatch().update_controls(false, nullptr, true);
     for (int i = 0; i < n_fx_slots; i++)
     {
@@ -0,0 +1,91 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#include "VoiceModulationPlan.h"
+
+#include <cstring>
+
+namespace Surge
+{
+namespace Voice
+{
+
+// Enough for any reasonable patch, so compiling doesn't allocate on the audio thread.
+// A patch with more routings grows the vector once and keeps it.
+static constexpr int initialRoutingCapacity = 512;
+
+VoiceModulationPlan::VoiceModulationPlan()
+{
+    routings.reserve(initialRoutingCapacity);
+    aftertouch.reserve(initialRoutingCapacity / 8);
+
+    memset(refresh, 0, sizeof(refresh));
+    memset(applied, 0, sizeof(applied));
+    // The synth zeroes the scene data too, so this is in step with it from the start
+    memset(previous, 0, sizeof(previous));
+}
+
+void VoiceModulationPlan::updateRoutings(const SurgeSceneStorage &scene)
+{
+    routings.clear();
+    for (const auto &r : scene.modulation_voice)
+    {
+        routings.push_back({r.source_id, r.source_index, r.destination_id, r.depth, r.muted});
+        applied[r.destination_id] = true;
+    }
+
+    aftertouch.clear();
+    for (const auto &r : scene.modulation_scene)
+    {
+        if (r.source_id == ms_aftertouch && r.destination_id >= 0 &&
+            r.destination_id < n_scene_params)
+        {
+            aftertouch.push_back({r.source_id, r.source_index, r.destination_id, r.depth, r.muted});
+            applied[r.destination_id] = true;
+        }
+    }
+}
+
+void VoiceModulationPlan::compile(const pdata *scenedata)
+{
+    refreshCount = 0;
+
+    for (int i = 0; i < n_scene_params; ++i)
+    {
+        bool changed = scenedata[i].i != previous[i].i;
+        previous[i] = scenedata[i];
+
+        if (changed || applied[i])
+            refresh[refreshCount++] = (int16_t)i;
+
+        applied[i] = false;
+    }
+
+    // From here until the next compile, voices apply the current routings
+    for (const auto &r : routings)
+        applied[r.destination_id] = true;
+    for (const auto &r : aftertouch)
+        applied[r.destination_id] = true;
+}
+
+} // namespace Voice
+} // namespace Surge
@@ -0,0 +1,103 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#ifndef SURGE_SRC_COMMON_VOICEMODULATIONPLAN_H
+#define SURGE_SRC_COMMON_VOICEMODULATIONPLAN_H
+
+#include <cstdint>
+#include <vector>
+
+#include "SurgeStorage.h"
+
+namespace Surge
+{
+namespace Voice
+{
+
+/*
+ * What a scene's voices need to refresh and apply to their parameter copy
+ * each block, compiled once per scene per block rather than worked out by
+ * every voice.
+ *
+ * A voice used to copy all of the scene data into its localcopy and then add
+ * its routings on top. Most of those parameters neither change from block to
+ * block nor have a voice routing, so the copy is the same every time. Instead,
+ * a voice's localcopy keeps matching the scene data everywhere except on
+ * modulated parameters, and each block it only refreshes the parameters
+ * listed here:
+ *
+ * - destinations of every set of routings applied since the previous block,
+ *   so a routing which was removed gets its unmodulated value back
+ * - parameters whose scene data changed since the previous block, including
+ *   anything modulated at scene level
+ *
+ * plus its own polyphonic parameter modulations. A voice copies everything
+ * when it starts.
+ *
+ * The routings are the audio thread's own copy of the scene's, kept in a dense
+ * array with only the fields a voice reads. Editors change the patch's routing
+ * vectors under the routing mutex, so the synth only takes a new copy when it
+ * can get that mutex without waiting, and otherwise keeps using this one.
+ */
+class VoiceModulationPlan
+{
+  public:
+    struct Routing
+    {
+        int source_id;
+        int source_index;
+        int destination_id;
+        float depth;
+        bool muted;
+    };
+
+    VoiceModulationPlan();
+
+    // Audio thread, holding the routing mutex
+    void updateRoutings(const SurgeSceneStorage &scene);
+
+    // Audio thread, after the scene data for this block is final and before any voice renders
+    void compile(const pdata *scenedata);
+
+    const std::vector<Routing> &voiceRoutings() const { return routings; }
+    // Channel aftertouch routed at scene level, which MPE voices apply themselves
+    const std::vector<Routing> &aftertouchRoutings() const { return aftertouch; }
+
+    const int16_t *refreshBegin() const { return refresh; }
+    const int16_t *refreshEnd() const { return refresh + refreshCount; }
+    int getRefreshCount() const { return refreshCount; }
+
+  private:
+    std::vector<Routing> routings, aftertouch;
+
+    int16_t refresh[n_scene_params];
+    int refreshCount{0};
+
+    // Destinations of any routings voices may have applied since the last compile
+    bool applied[n_scene_params];
+    pdata previous[n_scene_params];
+};
+
+} // namespace Voice
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_VOICEMODULATIONPLAN_H
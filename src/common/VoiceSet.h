@@ -0,0 +1,153 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#ifndef SURGE_SRC_COMMON_VOICESET_H
+#define SURGE_SRC_COMMON_VOICESET_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "globals.h"
+#include "SurgeVoice.h"
+
+namespace Surge
+{
+namespace Voice
+{
+
+/*
+ * The playing voices of one scene, in the order they started.
+ *
+ * Every voice a scene can play lives in a fixed array of MAX_VOICES slots,
+ * so rather than linking list nodes we keep the slot indices in start order,
+ * plus a bitmask of the occupied slots. Nothing here ever allocates. Adding a
+ * voice and testing membership are O(1), and erasing shuffles at most
+ * MAX_VOICES bytes down to keep the order.
+ *
+ * The interface is the part of std::list the synth used, so iteration hands
+ * out SurgeVoice pointers, and erase returns an iterator to the next voice.
+ * Iterators are positions, so one which was at or after an erased voice now
+ * refers to the voice which followed it.
+ */
+class VoiceSet
+{
+    static_assert(MAX_VOICES <= 64, "The occupied slots have to fit in a 64 bit mask");
+
+  public:
+    static constexpr int capacity = MAX_VOICES;
+
+    // The slots the indices refer to; set once, before anything is added
+    void bindSlots(SurgeVoice *s)
+    {
+        assert(count == 0);
+        slots = s;
+    }
+
+    class iterator
+    {
+      public:
+        iterator() = default;
+        iterator(const VoiceSet *set, int pos) : set(set), pos(pos) {}
+
+        SurgeVoice *operator*() const
+        {
+            assert(pos < set->count);
+            return set->slots + set->order[pos];
+        }
+        iterator &operator++()
+        {
+            pos++;
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            auto res = *this;
+            pos++;
+            return res;
+        }
+        bool operator==(const iterator &other) const { return pos == other.pos; }
+        bool operator!=(const iterator &other) const { return pos != other.pos; }
+
+      private:
+        const VoiceSet *set{nullptr};
+        int pos{0};
+        friend class VoiceSet;
+    };
+    typedef iterator const_iterator;
+
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, count}; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    SurgeVoice *front() const { return *begin(); }
+
+    bool contains(const SurgeVoice *v) const { return occupied & bitFor(slotOf(v)); }
+    uint64_t occupiedSlots() const { return occupied; }
+
+    void push_back(SurgeVoice *v)
+    {
+        auto slot = slotOf(v);
+        assert(count < capacity);
+        assert(!contains(v));
+
+        order[count++] = (uint8_t)slot;
+        occupied |= bitFor(slot);
+    }
+
+    iterator erase(iterator it)
+    {
+        assert(it.pos < count);
+
+        occupied &= ~bitFor(order[it.pos]);
+        std::memmove(&order[it.pos], &order[it.pos + 1], count - it.pos - 1);
+        count--;
+
+        return {this, it.pos};
+    }
+
+    void clear()
+    {
+        count = 0;
+        occupied = 0;
+    }
+
+  private:
+    SurgeVoice *slots{nullptr};
+    uint8_t order[capacity]{};
+    int count{0};
+    uint64_t occupied{0};
+
+    int slotOf(const SurgeVoice *v) const
+    {
+        auto slot = (int)(v - slots);
+        assert(slot >= 0 && slot < capacity);
+        return slot;
+    }
+    static uint64_t bitFor(int slot) { return (uint64_t)1 << slot; }
+};
+
+} // namespace Voice
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_VOICESET_H
@@ -0,0 +1,232 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#include "WavetableLoader.h"
+#include "SurgeStorage.h"
+
+namespace Surge
+{
+namespace Storage
+{
+
+// The audio thread doesn't wake the worker, since notifying can take a lock,
+// so a request waits at most this long to be picked up
+static constexpr int workerPollIntervalMs = 5;
+
+WavetableLoader::WavetableLoader(SurgeStorage *storage) : storage(storage)
+{
+    worker = std::thread([this]() { run(); });
+}
+
+WavetableLoader::~WavetableLoader()
+{
+    {
+        std::lock_guard<std::mutex> g(sleepMutex);
+        running = false;
+    }
+    sleepCV.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+bool WavetableLoader::request(int scene, int osc, OscillatorStorage &oscdata)
+{
+    auto &slot = slots[scene * n_oscs + osc];
+    if (slot.state.load(std::memory_order_acquire) != Idle)
+        return false;
+
+    auto &wt = oscdata.wt;
+
+    slot.requestGeneration = slot.generation.load(std::memory_order_relaxed);
+    slot.requestId = wt.queue_id;
+    wt.queue_id = -1;
+
+    // Swapping rather than copying keeps the audio thread free of allocations
+    slot.requestFilename.swap(wt.queue_filename);
+    wt.queue_filename.clear();
+
+    if (slot.requestId == -1 && !uses_wavetabledata(oscdata.type.val.i))
+        oscdata.queue_type = ot_wavetable;
+
+    slot.state.store(Requested, std::memory_order_release);
+    return true;
+}
+
+void WavetableLoader::installCompleted(SurgePatch &patch)
+{
+    for (int sc = 0; sc < n_scenes; sc++)
+    {
+        for (int o = 0; o < n_oscs; o++)
+        {
+            auto &slot = slots[sc * n_oscs + o];
+            if (slot.state.load(std::memory_order_acquire) != Ready)
+                continue;
+
+            if (slot.requestGeneration != slot.generation.load(std::memory_order_relaxed))
+            {
+                slot.state.store(Retired, std::memory_order_release);
+                continue;
+            }
+
+            // The waveform display holds this while it draws; try again next block
+            if (!storage->waveTableDataMutex.try_lock())
+                continue;
+
+            auto &oscdata = patch.scene[sc].osc[o];
+            auto &scratch = *slot.scratch;
+            bool byFilename = slot.requestId == -1;
+
+            if (!byFilename && oscdata.wt.everBuilt)
+                patch.isDirty = true;
+
+            oscdata.wt.current_id = slot.currentId;
+            if (slot.fromFile)
+                oscdata.wt.current_filename.swap(slot.currentFilename);
+
+            if (slot.loaded)
+                oscdata.wt.swapTableData(*slot.table);
+
+            if (!scratch.wavetable_display_name.empty())
+                oscdata.wavetable_display_name.swap(scratch.wavetable_display_name);
+
+            if (slot.loaded && slot.fromFile)
+            {
+                oscdata.wavetable_formula.swap(scratch.wavetable_formula);
+                oscdata.wavetable_formula_res_base = scratch.wavetable_formula_res_base;
+                oscdata.wavetable_formula_nframes = scratch.wavetable_formula_nframes;
+            }
+
+            oscdata.wt.is_dnd_imported = byFilename;
+            oscdata.wt.refresh_display = true;
+
+            if (byFilename && oscdata.wt.everBuilt)
+                patch.isDirty = true;
+
+            storage->waveTableDataMutex.unlock();
+
+            // The slot's table now holds the old data, which the worker frees
+            slot.state.store(Retired, std::memory_order_release);
+        }
+    }
+}
+
+void WavetableLoader::cancelPending()
+{
+    for (auto &slot : slots)
+        slot.generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool WavetableLoader::hasPending() const
+{
+    for (const auto &slot : slots)
+    {
+        auto s = slot.state.load(std::memory_order_acquire);
+        if (s == Requested || s == Loading || s == Ready)
+            return true;
+    }
+    return false;
+}
+
+void WavetableLoader::run()
+{
+    while (running)
+    {
+        bool loadedAny = false;
+
+        for (auto &slot : slots)
+        {
+            auto s = slot.state.load(std::memory_order_acquire);
+
+            if (s == Requested)
+            {
+                slot.state.store(Loading, std::memory_order_relaxed);
+                load(slot);
+                slot.state.store(Ready, std::memory_order_release);
+                loadedAny = true;
+            }
+            else if (s == Retired)
+            {
+                slot.table.reset();
+                slot.state.store(Idle, std::memory_order_release);
+            }
+        }
+
+        if (!loadedAny)
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCV.wait_for(lock, std::chrono::milliseconds(workerPollIntervalMs),
+                             [this]() { return !running; });
+        }
+    }
+}
+
+void WavetableLoader::load(Slot &slot)
+{
+    // Always a fresh table, so everBuilt tells us whether this load built it
+    slot.table = std::make_unique<Wavetable>();
+    if (!slot.scratch)
+        slot.scratch = std::make_unique<OscillatorStorage>();
+
+    auto &scratch = *slot.scratch;
+    scratch.wavetable_display_name.clear();
+    scratch.wavetable_formula.clear();
+    scratch.wavetable_formula_res_base = 5;
+    scratch.wavetable_formula_nframes = 10;
+
+    slot.currentFilename = slot.requestFilename;
+
+    try
+    {
+        if (slot.requestId != -1)
+        {
+            auto id = slot.requestId;
+            slot.currentId = id;
+            slot.fromFile = id >= 0 && id < (int)storage->wt_list.size();
+            storage->load_wt(id, slot.table.get(), &scratch);
+        }
+        else
+        {
+            // What used to be a scan of wt_list on the audio thread
+            slot.currentId = -1;
+            int ct = 0;
+            for (const auto &wti : storage->wt_list)
+            {
+                if (path_to_string(wti.path) == slot.requestFilename)
+                    slot.currentId = ct;
+                ct++;
+            }
+
+            slot.fromFile = true;
+            storage->load_wt(slot.requestFilename, slot.table.get(), &scratch);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        storage->reportError(e.what(), "Wavetable Loading Error");
+    }
+
+    slot.loaded = slot.table->everBuilt;
+}
+
+} // namespace Storage
+} // namespace Surge
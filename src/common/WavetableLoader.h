@@ -0,0 +1,125 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#ifndef SURGE_SRC_COMMON_WAVETABLELOADER_H
+#define SURGE_SRC_COMMON_WAVETABLELOADER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "globals.h"
+
+class SurgeStorage;
+class SurgePatch;
+class Wavetable;
+struct OscillatorStorage;
+
+namespace Surge
+{
+namespace Storage
+{
+
+/*
+ * Loads queued wavetables on a worker thread, so that reading the file and
+ * building the mipmaps never happens inside the render callback.
+ *
+ * Each scene oscillator has one slot which is passed back and forth between
+ * the audio thread and the worker through an atomic state:
+ *
+ *   Idle -> Requested    audio thread, from the oscillator's queue
+ *   Requested -> Loading -> Ready    worker, into a table of its own
+ *   Ready -> Retired     audio thread, swapping the new table data in
+ *   Retired -> Idle      worker, freeing the old table data
+ *
+ * The audio thread never allocates, frees, blocks or does file I/O here. A
+ * request made while its slot is still busy stays queued on the oscillator
+ * and goes out once the slot is idle again, so the last wavetable asked for
+ * is the one which ends up installed.
+ */
+class WavetableLoader
+{
+  public:
+    explicit WavetableLoader(SurgeStorage *storage);
+    ~WavetableLoader();
+
+    // Audio thread. Returns false, leaving the queue alone, while the slot is busy
+    bool request(int scene, int osc, OscillatorStorage &oscdata);
+
+    // Audio thread. Swaps finished tables into the patch unless the GUI holds the data mutex
+    void installCompleted(SurgePatch &patch);
+
+    // Loads requested before this are thrown away rather than installed
+    void cancelPending();
+
+    // True if any slot is requested, loading or waiting to be installed
+    bool hasPending() const;
+
+  private:
+    enum State : uint32_t
+    {
+        Idle,
+        Requested,
+        Loading,
+        Ready,
+        Retired
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> state{Idle};
+        std::atomic<uint32_t> generation{0};
+
+        // Written by the audio thread before Requested
+        uint32_t requestGeneration{0};
+        int requestId{-1};
+        std::string requestFilename;
+
+        // Written by the worker before Ready
+        std::unique_ptr<Wavetable> table;
+        std::unique_ptr<OscillatorStorage> scratch;
+        std::string currentFilename;
+        int currentId{-1};
+        bool loaded{false}, fromFile{false};
+    };
+
+    SurgeStorage *storage;
+    std::array<Slot, n_scenes * n_oscs> slots;
+
+    std::atomic<bool> running{true};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+    std::thread worker;
+
+    void run();
+    void load(Slot &slot);
+};
+
+} // namespace Storage
+} // namespace Surge
+
+#endif // SURGE_SRC_COMMON_WAVETABLELOADER_H
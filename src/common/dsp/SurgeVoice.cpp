@@ -21,6 +21,7 @@
  */
 
 #include "SurgeVoice.h"
+#include "VoiceModulationPlan.h"
 #include "UserDefaults.h"
 #include "DSPUtils.h"
 #include "QuadFilterChain.h"
@@ -143,7 +144,7 @@ SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *
                        float detune, MidiKeyState *keyState, MidiChannelState *mainChannelState,
                        MidiChannelState *voiceChannelState, bool mpeEnabled, int64_t voiceOrder,
                        int32_t host_nid, int16_t host_key, int16_t host_chan, float aegStart,
-                       float fegStart)
+                       float fegStart, const Surge::Voice::VoiceModulationPlan *plan)
 //: fb(storage,oscene)
 {
 #ifdef VOICE_LIFETIME_DEBUG
@@ -161,9 +162,12 @@ SurgeVoice::SurgeVoice(SurgeStorage *storage, SurgeSceneStorage *oscene, pdata *
     this->originating_host_channel = host_chan;
     this->tilt_noise.s = this;
     this->paramModulationCount = 0;
+    this->modulationPlan = plan;
     assert(storage);
     assert(oscene);
 
+    rng.g.seed(storage->rand_u32());
+
     sampleRateReset();
     memcpy(localcopy, paramptr, sizeof(localcopy));
 
@@ -499,20 +503,24 @@ void SurgeVoice::switch_toggled()
     /*
      * Since we have updated the keytrack output here we need to re-update the localcopy modulators
      */
-    vector<ModulationRouting>::iterator iter;
-    iter = scene->modulation_voice.begin();
-    while (iter != scene->modulation_voice.end())
-    {
-        int src_id = iter->source_id;
-        int dst_id = iter->destination_id;
-        float depth = iter->depth;
-        if (modsources[src_id] && src_id == ms_keytrack)
+    auto addKeytrack = [this](const auto &routings) {
+        for (const auto &r : routings)
         {
-            localcopy[dst_id].f +=
-                depth * modsources[ms_keytrack]->get_output(0) * (1 - iter->muted);
+            int src_id = r.source_id;
+            int dst_id = r.destination_id;
+            float depth = r.depth;
+            if (modsources[src_id] && src_id == ms_keytrack)
+            {
+                localcopy[dst_id].f +=
+                    depth * modsources[ms_keytrack]->get_output(0) * (1 - r.muted);
+            }
         }
-        iter++;
-    }
+    };
+
+    if (modulationPlan)
+        addKeytrack(modulationPlan->voiceRoutings());
+    else
+        addKeytrack(scene->modulation_voice);
 
     for (int i = 0; i < n_oscs; i++)
     {
@@ -719,8 +727,17 @@ int SurgeVoice::routefilter(int r)
     return r;
 }
 
-template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, int e)
+void SurgeVoice::processModulatorsBeforeEnvelopes()
+{
+    processLFOs();
+    retriggerEnvelopesFromLFOs();
+}
+
+void SurgeVoice::processLFOs(Surge::Formula::VoiceBatch *formulaBatch)
 {
+    for (int i = 0; i < n_lfos_voice; i++)
+        lfo[i].formulaBatch = formulaBatch;
+
     // Always process LFO1 so the gate retrigger always work
     lfo[0].process_block();
     velocitySource.process_block();
@@ -740,6 +757,15 @@ template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, in
         }
     }
 
+    for (int i = 0; i < n_lfos_voice; i++)
+        lfo[i].formulaBatch = nullptr;
+}
+
+void SurgeVoice::retriggerEnvelopesFromLFOs()
+{
+    for (int i = 0; i < n_lfos_voice; i++)
+        lfo[i].completeFormulaBlock();
+
     auto pm = scene->polymode.val.i;
 
     bool fromCurrent = (pm == pm_poly && scene->polyVoiceRepeatedKeyMode ==
@@ -764,21 +790,45 @@ template <bool first> void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, in
             ms->retriggerFrom(val);
         }
     }
+}
+
+void SurgeVoice::processEnvelopesQuad(SurgeVoice *const *voices, int n)
+{
+    ADSRModulationSource *aeg[4], *feg[4];
+
+    for (int i = 0; i < n; ++i)
+    {
+        aeg[i] = &voices[i]->ampEGSource;
+        feg[i] = &voices[i]->filterEGSource;
+    }
+
+    ADSRModulationSource::process_block_quad(aeg, n);
+    ADSRModulationSource::process_block_quad(feg, n);
+}
 
-    modsources[ms_ampeg]->process_block();
-    modsources[ms_filtereg]->process_block();
+template <bool first>
+void SurgeVoice::calc_ctrldata(QuadFilterChainState *Q, int e, bool envelopesDone)
+{
+    if (!envelopesDone)
+    {
+        processModulatorsBeforeEnvelopes();
+        modsources[ms_ampeg]->process_block();
+        modsources[ms_filtereg]->process_block();
+    }
 
     if (((ADSRModulationSource *)modsources[ms_ampeg])->is_idle())
     {
         state.keep_playing = false;
     }
 
-    // TODO: memcpy is bottleneck
-    // don't actually need to copy everything
-    // LFOs could be ignored when unused
-    // same for FX & OSCs
-    // also ignore integer parameters
-    memcpy(localcopy, paramptr, sizeof(localcopy));
+    if (!first && modulationPlan)
+    {
+        refreshLocalcopy();
+    }
+    else
+    {
+        memcpy(localcopy, paramptr, sizeof(localcopy));
+    }
 
     applyModulationToLocalcopy();
     update_portamento();
@@ -1014,9 +1064,9 @@ inline void all_ring_modes_block(float *__restrict src1_l, float *__restrict src
     }
 }
 
-bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
+bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe, bool envelopesDone)
 {
-    calc_ctrldata<0>(&Q, Qe);
+    calc_ctrldata<0>(&Q, Qe, envelopesDone);
 
     bool is_wide = scene->filterblock_configuration.val.i == fc_wide;
     float tblock alignas(16)[BLOCK_SIZE_OS], tblock2 alignas(16)[BLOCK_SIZE_OS];
@@ -1246,50 +1296,75 @@ bool SurgeVoice::process_block(QuadFilterChainState &Q, int Qe)
     return state.keep_playing;
 }
 
-template <bool noLFOSources> void SurgeVoice::applyModulationToLocalcopy()
+void SurgeVoice::refreshLocalcopy()
+{
+    for (auto p = modulationPlan->refreshBegin(); p != modulationPlan->refreshEnd(); ++p)
+    {
+        localcopy[*p] = paramptr[*p];
+    }
+
+    // Polyphonic modulations are only ever added to a voice, so these cover every block's
+    for (int i = 0; i < paramModulationCount; ++i)
+    {
+        auto id = polyphonicParamModulations[i].param_id;
+        localcopy[id] = paramptr[id];
+    }
+}
+
+template <bool noLFOSources, typename Routings>
+void SurgeVoice::applyRoutingsToLocalcopy(const Routings &routings)
 {
-    vector<ModulationRouting>::iterator iter;
-    iter = scene->modulation_voice.begin();
-    while (iter != scene->modulation_voice.end())
+    for (const auto &r : routings)
     {
-        int src_id = iter->source_id;
-        int dst_id = iter->destination_id;
-        float depth = iter->depth;
+        int src_id = r.source_id;
 
         if (noLFOSources && isLFO((::modsources)src_id))
         {
         }
         else if (modsources[src_id])
         {
-            localcopy[dst_id].f +=
-                depth * modsources[src_id]->get_output(iter->source_index) * (1.0 - iter->muted);
+            localcopy[r.destination_id].f +=
+                r.depth * modsources[src_id]->get_output(r.source_index) * (1.0 - r.muted);
         }
-        iter++;
     }
+}
 
-    if (mpeEnabled)
+template <typename Routings>
+void SurgeVoice::applySceneAftertouchToLocalcopy(const Routings &routings)
+{
+    for (const auto &r : routings)
     {
-        // See github issue 1214. This basically compensates for
-        // channel AT being per-voice in MPE mode (since it is per channel)
-        // vs per-scene (since it is per keyboard in non MPE mode).
-        iter = scene->modulation_scene.begin();
-        while (iter != scene->modulation_scene.end())
+        int src_id = r.source_id;
+        if (src_id == ms_aftertouch && modsources[src_id])
         {
-            int src_id = iter->source_id;
-            if (src_id == ms_aftertouch && modsources[src_id])
+            int dst_id = r.destination_id;
+            // I don't THINK we need this but am not sure the global params are in my localcopy
+            // span
+            if (dst_id >= 0 && dst_id < n_scene_params)
             {
-                int dst_id = iter->destination_id;
-                // I don't THINK we need this but am not sure the global params are in my localcopy
-                // span
-                if (dst_id >= 0 && dst_id < n_scene_params)
-                {
-                    float depth = iter->depth;
-                    localcopy[dst_id].f +=
-                        depth * modsources[src_id]->get_output(0) * (1.0 - iter->muted);
-                }
+                localcopy[dst_id].f +=
+                    r.depth * modsources[src_id]->get_output(0) * (1.0 - r.muted);
             }
-            iter++;
         }
+    }
+}
+
+template <bool noLFOSources> void SurgeVoice::applyModulationToLocalcopy()
+{
+    if (modulationPlan)
+        applyRoutingsToLocalcopy<noLFOSources>(modulationPlan->voiceRoutings());
+    else
+        applyRoutingsToLocalcopy<noLFOSources>(scene->modulation_voice);
+
+    if (mpeEnabled)
+    {
+        // See github issue 1214. This basically compensates for
+        // channel AT being per-voice in MPE mode (since it is per channel)
+        // vs per-scene (since it is per keyboard in non MPE mode).
+        if (modulationPlan)
+            applySceneAftertouchToLocalcopy(modulationPlan->aftertouchRoutings());
+        else
+            applySceneAftertouchToLocalcopy(scene->modulation_scene);
 
         monoAftertouchSource.set_target(state.voiceChannelState->pressure +
                                         noteExpressions[PRESSURE]);
@@ -35,6 +35,14 @@
 
 struct QuadFilterChainState;
 
+namespace Surge
+{
+namespace Voice
+{
+class VoiceModulationPlan;
+}
+} // namespace Surge
+
 enum lag_entries
 {
     le_osc1,
@@ -63,14 +71,29 @@ class alignas(16) SurgeVoice
                MidiKeyState *keyState, MidiChannelState *mainChannelState,
                MidiChannelState *voiceChannelState, bool mpeEnabled, int64_t voiceOrder,
                int32_t host_note_id, int16_t originating_host_key, int16_t originating_host_channel,
-               float aegStart, float fegStart);
+               float aegStart, float fegStart,
+               const Surge::Voice::VoiceModulationPlan *modulationPlan = nullptr);
     ~SurgeVoice();
 
     void release();
     void uber_release();
 
     void sampleRateReset();
-    bool process_block(QuadFilterChainState &, int);
+    /*
+     * A quad group's voices can run their envelopes together. Each runs the modulators
+     * its envelopes depend on, then processEnvelopesQuad steps all of them, and then
+     * process_block is told the envelopes are done. The result is the same as a plain
+     * process_block per voice.
+     */
+    bool process_block(QuadFilterChainState &, int, bool envelopesDone = false);
+    void processModulatorsBeforeEnvelopes();
+    /*
+     * processModulatorsBeforeEnvelopes in two parts, so a scene's formula LFOs can go to
+     * Lua in one batch, which has to be evaluated before the retriggers.
+     */
+    void processLFOs(Surge::Formula::VoiceBatch *formulaBatch = nullptr);
+    void retriggerEnvelopesFromLFOs();
+    static void processEnvelopesQuad(SurgeVoice *const *voices, int n);
     void GetQFB(); // Get the updated registers from the QuadFB
     void legato(int key, int velocity, char detune);
     void switch_toggled();
@@ -226,7 +249,8 @@ class alignas(16) SurgeVoice
                                       SurgeStorage *storage, bool remapKeyForTuning = true);
 
   private:
-    template <bool first> void calc_ctrldata(QuadFilterChainState *, int);
+    template <bool first>
+    void calc_ctrldata(QuadFilterChainState *, int, bool envelopesDone = false);
 
     /*
      * Some modulations at the voice level were applied to the local
@@ -241,6 +265,12 @@ class alignas(16) SurgeVoice
      * calc_ctrldata)
      */
     template <bool noLFOSources = false> void applyModulationToLocalcopy();
+    template <bool noLFOSources, typename Routings>
+    void applyRoutingsToLocalcopy(const Routings &routings);
+    template <typename Routings> void applySceneAftertouchToLocalcopy(const Routings &routings);
+
+    // Brings localcopy back to the scene data on everything the plan says may differ
+    void refreshLocalcopy();
 
     void update_portamento();
     void set_path(bool osc1, bool osc2, bool osc3, int FMmode, bool ring12, bool ring23,
@@ -293,6 +323,12 @@ class alignas(16) SurgeVoice
     std::array<ModulationSource *, n_modsources> modsources;
     SurgeStorage *storage;
 
+    // Seeded when the voice starts and installed as the storage RNG while it renders
+    SurgeStorage::RNGGen rng;
+
+    // The scene's plan from the synth; without one every block copies all params
+    const Surge::Voice::VoiceModulationPlan *modulationPlan{nullptr};
+
   public:
     ControllerModulationSource velocitySource;
     ModulationSource releaseVelocitySource;
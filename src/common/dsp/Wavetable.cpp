@@ -21,9 +21,16 @@
  */
 #include "Wavetable.h"
 #include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "DSPUtils.h"
 #include <vembertech/basic_dsp.h>
 #include "SurgeStorage.h"
+#include "SurgeMemoryPools.h"
 
 #include "sst/basic-blocks/mechanics/endian-ops.h"
 namespace mech = sst::basic_blocks::mechanics;
@@ -97,13 +104,181 @@ int GetWTIndex(int WaveIdx, int WaveSize, int NumWaves, int MipMap, int Padding
     return Index;
 }
 
+WavetableData::WavetableData(size_t samples) : dataSizes(samples)
+{
+    // Large blocks come zeroed from the system, which beats clearing them ourselves
+    TableF32Data = (float *)calloc(dataSizes, sizeof(float));
+    TableI16Data = (short *)calloc(dataSizes, sizeof(short));
+}
+
+WavetableData::~WavetableData()
+{
+    free(TableF32Data);
+    free(TableI16Data);
+}
+
+namespace
+{
+uint64_t fnv1a64(const unsigned char *d, size_t n, uint64_t h)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        h ^= d[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+struct CacheRegistry
+{
+    std::mutex mutex;
+    std::unordered_multimap<uint64_t, std::weak_ptr<WavetableData>> entries;
+    uint64_t hits{0}, misses{0};
+
+    void sweep()
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+};
+
+CacheRegistry &cacheRegistry()
+{
+    static CacheRegistry r;
+    return r;
+}
+
+/*
+ * Data a table lets go of may still be read by the audio thread, which doesn't take the
+ * wavetable mutex, so it is kept for a while, far longer than any block takes, and
+ * released off the audio thread.
+ */
+constexpr auto retireGracePeriod = std::chrono::milliseconds(500);
+
+struct RetiredData
+{
+    std::mutex mutex;
+    std::vector<std::pair<std::chrono::steady_clock::time_point, std::shared_ptr<WavetableData>>>
+        entries;
+
+    RetiredData() { entries.reserve(256); }
+};
+
+RetiredData &retiredData()
+{
+    static RetiredData r;
+    return r;
+}
+
+void retire(std::shared_ptr<WavetableData> d)
+{
+    auto &ret = retiredData();
+    std::lock_guard<std::mutex> g(ret.mutex);
+    ret.entries.emplace_back(std::chrono::steady_clock::now(), std::move(d));
+}
+
+// Never built tables all hold this, since nothing writes into it
+const std::shared_ptr<WavetableData> &emptyData()
+{
+    static auto d = std::make_shared<WavetableData>(35000);
+    return d;
+}
+
+size_t sourceBytes(int flags, unsigned int tables, int size)
+{
+    return (size_t)tables * size * ((flags & wtf_int16) ? sizeof(short) : sizeof(float));
+}
+
+/*
+ * The hash only finds candidates. BuildWT copies the source into the first row of each
+ * table unchanged, after the endian swap, so compare those with the source as well.
+ */
+bool isBuiltFrom(const WavetableData &d, void *wdata)
+{
+    // Compared a piece at a time, so this doesn't allocate while the cache is locked
+    constexpr int chunk = 256;
+
+    for (unsigned int j = 0; j < d.sourceTables; j++)
+    {
+        for (int i = 0; i < d.size; i += chunk)
+        {
+            int n = std::min(chunk, d.size - i);
+
+            if (d.flags & wtf_int16)
+            {
+                short row[chunk];
+                mech::endian_copyblock16LE(row, &((short *)wdata)[d.size * j + i], n);
+                auto built = d.TableI16Data + GetWTIndex(j, d.size, 0, 0, FIRipolI16_N);
+                if (memcmp(row, built + FIRoffsetI16 + i, n * sizeof(short)) != 0)
+                    return false;
+            }
+            else
+            {
+                int32_t row[chunk];
+                mech::endian_copyblock32LE(row, &((int32_t *)wdata)[d.size * j + i], n);
+                auto built = d.TableF32Data + GetWTIndex(j, d.size, 0, 0);
+                if (memcmp(row, built + i, n * sizeof(float)) != 0)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+} // namespace
+
+WavetableCache::Stats WavetableCache::stats()
+{
+    auto &reg = cacheRegistry();
+    std::lock_guard<std::mutex> g(reg.mutex);
+
+    reg.sweep();
+
+    Stats res;
+    for (auto &[h, e] : reg.entries)
+    {
+        auto d = e.lock();
+        if (!d)
+            continue;
+
+        auto bytes = d->dataSizes * (sizeof(float) + sizeof(short));
+        auto users = (size_t)d.use_count() - 1; // not counting ours
+
+        res.tables++;
+        res.bytes += bytes;
+        res.references += users;
+        res.referencedBytes += users * bytes;
+    }
+    res.hits = reg.hits;
+    res.misses = reg.misses;
+    return res;
+}
+
+void WavetableCache::releaseRetired(bool evenIfRecent)
+{
+    auto &ret = retiredData();
+    auto releaseBefore = std::chrono::steady_clock::now() - retireGracePeriod;
+
+    // Released outside the lock, so a table retiring meanwhile doesn't wait on the frees
+    std::vector<std::shared_ptr<WavetableData>> toRelease;
+    {
+        std::lock_guard<std::mutex> g(ret.mutex);
+        auto keep = std::partition(ret.entries.begin(), ret.entries.end(), [&](auto &e) {
+            return !evenIfRecent && e.first >= releaseBefore;
+        });
+        for (auto it = keep; it != ret.entries.end(); ++it)
+            toRelease.push_back(std::move(it->second));
+        ret.entries.erase(keep, ret.entries.end());
+    }
+}
+
 Wavetable::Wavetable()
 {
-    dataSizes = 35000;
-    TableF32Data = (float *)malloc(dataSizes * sizeof(float));
-    TableI16Data = (short *)malloc(dataSizes * sizeof(short));
-    memset(TableF32Data, 0, dataSizes * sizeof(float));
-    memset(TableI16Data, 0, dataSizes * sizeof(short));
+    setData(emptyData());
     memset(TableF32WeakPointers, 0, sizeof(TableF32WeakPointers));
     memset(TableI16WeakPointers, 0, sizeof(TableI16WeakPointers));
     current_id = -1;
@@ -112,21 +287,22 @@ Wavetable::Wavetable()
     refresh_display = true; // I have never been drawn so assume I need refresh if asked
 }
 
-Wavetable::~Wavetable()
+Wavetable::~Wavetable() = default;
+
+void Wavetable::setData(std::shared_ptr<WavetableData> d)
 {
-    free(TableF32Data);
-    free(TableI16Data);
+    if (data && data != emptyData())
+        retire(std::move(data));
+
+    data = std::move(d);
+    dataSizes = data->dataSizes;
+    TableF32Data = data->TableF32Data;
+    TableI16Data = data->TableI16Data;
 }
 
 void Wavetable::allocPointers(size_t newSize)
 {
-    free(TableF32Data);
-    free(TableI16Data);
-    dataSizes = newSize;
-    TableF32Data = (float *)malloc(dataSizes * sizeof(float));
-    TableI16Data = (short *)malloc(dataSizes * sizeof(short));
-    memset(TableF32Data, 0, dataSizes * sizeof(float));
-    memset(TableI16Data, 0, dataSizes * sizeof(short));
+    setData(std::make_shared<WavetableData>(newSize));
 }
 
 void Wavetable::Copy(Wavetable *wt)
@@ -141,37 +317,68 @@ void Wavetable::Copy(Wavetable *wt)
     queue_id = -1;
     everBuilt = wt->everBuilt;
 
-    if (dataSizes < wt->dataSizes)
+    // The data is never written once built, so sharing it is as good as a copy
+    setData(wt->data);
+    memcpy(TableF32WeakPointers, wt->TableF32WeakPointers, sizeof(TableF32WeakPointers));
+    memcpy(TableI16WeakPointers, wt->TableI16WeakPointers, sizeof(TableI16WeakPointers));
+
+    current_id = wt->current_id;
+}
+
+void Wavetable::swapTableData(Wavetable &other)
+{
+    std::swap(everBuilt, other.everBuilt);
+    std::swap(size, other.size);
+    std::swap(n_tables, other.n_tables);
+    std::swap(size_po2, other.size_po2);
+    std::swap(flags, other.flags);
+    std::swap(dt, other.dt);
+    std::swap(TableF32WeakPointers, other.TableF32WeakPointers);
+    std::swap(TableI16WeakPointers, other.TableI16WeakPointers);
+    std::swap(data, other.data);
+    std::swap(dataSizes, other.dataSizes);
+    std::swap(TableF32Data, other.TableF32Data);
+    std::swap(TableI16Data, other.TableI16Data);
+}
+
+void Wavetable::pointTables()
+{
+    memset(TableF32WeakPointers, 0, sizeof(TableF32WeakPointers));
+    memset(TableI16WeakPointers, 0, sizeof(TableI16WeakPointers));
+
+    for (int j = 0; j < this->n_tables; j++)
     {
-        allocPointers(wt->dataSizes);
+        TableF32WeakPointers[0][j] = TableF32Data + GetWTIndex(j, size, n_tables, 0);
+        // + padding for a non-wrapping interpolator
+        TableI16WeakPointers[0][j] = TableI16Data + GetWTIndex(j, size, n_tables, 0, FIRipolI16_N);
+    }
+    for (int j = this->n_tables; j < min_F32_tables; j++)
+    {
+        unsigned int s = this->size;
+        int l = 0;
+
+        while (s && (l < max_mipmap_levels))
+        {
+            TableF32WeakPointers[l][j] = TableF32Data + GetWTIndex(j, size, n_tables, l);
+            s = s >> 1;
+            l++;
+        }
     }
 
-    memcpy(TableF32Data, wt->TableF32Data, dataSizes * sizeof(float));
-    memcpy(TableI16Data, wt->TableI16Data, dataSizes * sizeof(short));
+    // the same levels as MipMapWT
+    int levels = 1;
+    while (((1 << levels) < size) & (levels < max_mipmap_levels))
+        levels++;
 
-    for (int i = 0; i < max_mipmap_levels; i++)
+    for (int l = 1; l < levels; l++)
     {
-        for (int j = 0; j < max_subtables; j++)
+        for (int s = 0; s < this->n_tables; s++)
         {
-            if (wt->TableF32WeakPointers[i][j])
-            {
-                size_t Offset = wt->TableF32WeakPointers[i][j] - wt->TableF32Data;
-                TableF32WeakPointers[i][j] = TableF32Data + Offset;
-            }
-            else
-                TableF32WeakPointers[i][j] = NULL;
-
-            if (wt->TableI16WeakPointers[i][j])
-            {
-                size_t Offset = wt->TableI16WeakPointers[i][j] - wt->TableI16Data;
-                TableI16WeakPointers[i][j] = TableI16Data + Offset;
-            }
-            else
-                TableI16WeakPointers[i][j] = NULL;
+            TableF32WeakPointers[l][s] = TableF32Data + GetWTIndex(s, size, n_tables, l);
+            TableI16WeakPointers[l][s] =
+                TableI16Data + GetWTIndex(s, size, n_tables, l, FIRipolI16_N);
         }
     }
-
-    current_id = wt->current_id;
 }
 
 bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
@@ -184,11 +391,6 @@ bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 
     size_t req_size = RequiredWTSize(size, n_tables);
 
-    if (req_size > dataSizes)
-    {
-        allocPointers(req_size);
-    }
-
     int wdata_tables = n_tables;
 
     if (AppendSilence)
@@ -208,23 +410,52 @@ bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 
     dt = 1.0f / size;
 
-    for (int i = 0; i < max_mipmap_levels; i++)
+    /*
+     * Loads queued without the background loader still build on the audio thread. That
+     * stays away from the cache and its lock, and as before the cache writes over this
+     * table's own data where nobody else can see it, allocating only if it has to.
+     */
+    bool useCache = !Surge::Memory::AudioThreadScope::active();
+
+    uint64_t hash{0};
+    auto &reg = cacheRegistry();
+    std::shared_ptr<WavetableData> built;
+
+    if (useCache)
     {
-        for (int j = 0; j < max_subtables; j++)
+        hash = fnv1a64((const unsigned char *)wdata, sourceBytes(flags, wdata_tables, size),
+                       0xcbf29ce484222325ULL);
+
+        std::lock_guard<std::mutex> g(reg.mutex);
+        auto range = reg.entries.equal_range(hash);
+        for (auto it = range.first; it != range.second && !built; ++it)
         {
-            // TODO WARNING: Crashes here with patchbyte!
-            /*free(wt->TableF32WeakPointers[i][j]);
-            free(wt->TableI16WeakPointers[i][j]);
-            wt->TableF32WeakPointers[i][j] = 0;
-            wt->TableI16WeakPointers[i][j] = 0;*/
+            auto d = it->second.lock();
+            if (d && d->size == size && d->flags == flags &&
+                d->sourceTables == (unsigned int)wdata_tables &&
+                d->appendSilence == AppendSilence && isBuiltFrom(*d, wdata))
+                built = std::move(d);
         }
+        if (built)
+            reg.hits++;
+        else
+            reg.misses++;
     }
-    for (int j = 0; j < this->n_tables; j++)
+
+    if (built)
     {
-        TableF32WeakPointers[0][j] = TableF32Data + GetWTIndex(j, size, n_tables, 0);
-        // + padding for a non-wrapping interpolator
-        TableI16WeakPointers[0][j] = TableI16Data + GetWTIndex(j, size, n_tables, 0, FIRipolI16_N);
+        setData(std::move(built));
+        pointTables();
+        everBuilt = true;
+        return true;
     }
+
+    // Never into data we might share; whoever holds that keeps it as it is
+    bool ownData = !data->published && data.use_count() == 1 && data != emptyData();
+    if (useCache || !ownData || data->dataSizes < req_size)
+        allocPointers(req_size);
+    pointTables();
+
     for (int j = this->n_tables; j < min_F32_tables; j++)
     {
         unsigned int s = this->size;
@@ -232,7 +463,6 @@ bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 
         while (s && (l < max_mipmap_levels))
         {
-            TableF32WeakPointers[l][j] = TableF32Data + GetWTIndex(j, size, n_tables, l);
             memset(TableF32WeakPointers[l][j], 0, s * sizeof(float));
             s = s >> 1;
             l++;
@@ -285,6 +515,19 @@ bool Wavetable::BuildWT(void *wdata, wt_header &wh, bool AppendSilence)
 
     MipMapWT();
 
+    if (useCache)
+    {
+        data->size = size;
+        data->flags = flags;
+        data->sourceTables = wdata_tables;
+        data->appendSilence = AppendSilence;
+
+        std::lock_guard<std::mutex> g(reg.mutex);
+        reg.sweep();
+        data->published = true;
+        reg.entries.emplace(hash, data);
+    }
+
     everBuilt = true;
     return true;
 }
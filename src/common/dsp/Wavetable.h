@@ -21,6 +21,8 @@
  */
 #ifndef SURGE_SRC_COMMON_DSP_WAVETABLE_H
 #define SURGE_SRC_COMMON_DSP_WAVETABLE_H
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <StringOps.h>
 const int max_wtable_size = 4096;
@@ -39,27 +41,88 @@ struct wt_header
 };
 #pragma pack(pop)
 
+/*
+ * The sample memory of a built wavetable, with its mipmaps. Nothing writes into it once it
+ * has been built, so wavetables built from the same data hold the same one, and a table which
+ * is built again gets new memory rather than changing what the others see. The memory a table
+ * replaces is released later, off the audio thread.
+ */
+struct WavetableData
+{
+    explicit WavetableData(size_t samples);
+    ~WavetableData();
+
+    WavetableData(const WavetableData &) = delete;
+    WavetableData &operator=(const WavetableData &) = delete;
+
+    size_t dataSizes;
+    float *TableF32Data;
+    short *TableI16Data;
+
+    // What it was built from, which the cache checks before handing it out
+    int size{0}, flags{0};
+    unsigned int sourceTables{0};
+    bool appendSilence{false};
+    // Once in the cache, other tables may pick it up at any time
+    bool published{false};
+};
+
+/*
+ * Finds the built data for wavetable content which is already in memory anywhere in the
+ * process, be it another oscillator, scene or plugin instance. Entries don't keep their data
+ * alive; it goes away with the last wavetable which uses it.
+ */
+class WavetableCache
+{
+  public:
+    struct Stats
+    {
+        size_t tables{0};          // distinct built tables in memory
+        size_t bytes{0};           // the memory they use
+        size_t references{0};      // wavetables using them
+        size_t referencedBytes{0}; // the memory those would use without sharing
+        uint64_t hits{0}, misses{0};
+    };
+
+    static Stats stats();
+
+    /*
+     * Data a table has replaced is kept until the audio thread can't be reading it any more.
+     * The pool refill service calls this; tests can ask for all of it to go at once.
+     */
+    static void releaseRetired(bool evenIfRecent = false);
+};
+
 class Wavetable
 {
   public:
     Wavetable();
     ~Wavetable();
     void Copy(Wavetable *wt);
+    // Exchanges the built table data, but not the queue or file identity, without allocating
+    void swapTableData(Wavetable &other);
     bool BuildWT(void *wdata, wt_header &wh, bool AppendSilence);
     void MipMapWT();
 
     void allocPointers(size_t newSize);
 
+  private:
+    void setData(std::shared_ptr<WavetableData> d);
+    // Points the tables and mipmaps at data for the current size and table count
+    void pointTables();
+
   public:
     bool everBuilt = false;
-    int size;
-    unsigned int n_tables;
-    int size_po2;
-    int flags;
-    float dt;
+    int size{0};
+    unsigned int n_tables{0};
+    int size_po2{0};
+    int flags{0};
+    float dt{0.f};
     float *TableF32WeakPointers[max_mipmap_levels][max_subtables];
     short *TableI16WeakPointers[max_mipmap_levels][max_subtables];
 
+    std::shared_ptr<WavetableData> data;
+    // These alias data, and are read only unless data was just allocated for this table
     size_t dataSizes;
     float *TableF32Data;
     short *TableI16Data;
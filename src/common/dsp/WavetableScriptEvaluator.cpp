@@ -23,6 +23,15 @@
 #include "WavetableScriptEvaluator.h"
 #include "LuaSupport.h"
 #include "lua/LuaSources.h"
+#include "filesystem/import.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <thread>
 
 // #define LOG(...) std::cout << __FILE__ << ":" << __LINE__ << " " << __VA_ARGS__ << std::endl;
 #define LOG(...)
@@ -35,6 +44,223 @@ namespace WavetableScript
 static constexpr const char *statetable{"statetable"};
 
 #if HAS_LUA
+namespace
+{
+// Frames render on at most this many threads, the calling one included
+static constexpr size_t maxRenderThreads = 8;
+
+/*
+ * Rendered tables by the content they came from: the script, the prelude it runs against,
+ * and the size. The memory tier is shared by every evaluator in the process, and the disk
+ * tier is one file per table in the user data folder, which survives restarts. Disk hits
+ * are promoted into memory. All of this is safe to call from any thread.
+ */
+class RenderCache
+{
+  public:
+    static std::string makeKey(const std::string &script, size_t resolution, size_t frameCount)
+    {
+        // Length prefixed, so that text moving between the parts can't give the same key
+        std::string material;
+        for (const auto *part : {&script, &Surge::LuaSources::wtse_prelude})
+        {
+            material += std::to_string(part->size());
+            material += ':';
+            material += *part;
+        }
+        material += std::to_string(resolution) + ":" + std::to_string(frameCount);
+
+        std::string key;
+        appendHex(key, fnv1a64(material, 0xcbf29ce484222325ULL));
+        appendHex(key, fnv1a64(material, 0x84222325cbf29ce4ULL));
+        return key;
+    }
+
+    static fs::path directoryFor(SurgeStorage *storage)
+    {
+        if (!storage || storage->userDataPath.empty())
+            return {};
+        return storage->userDataPath / "Wavetable Script Cache";
+    }
+
+    LuaWTEvaluator::rendered_t lookup(const std::string &key, const fs::path &dir)
+    {
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            auto it = std::find_if(lru.begin(), lru.end(),
+                                   [&key](const auto &e) { return e.first == key; });
+            if (it != lru.end())
+            {
+                lru.splice(lru.begin(), lru, it);
+                return it->second;
+            }
+        }
+
+        auto r = readDisk(key, dir);
+        if (r)
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            insertMemory(key, r);
+        }
+        return r;
+    }
+
+    void store(const std::string &key, const LuaWTEvaluator::rendered_t &r, const fs::path &dir)
+    {
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            insertMemory(key, r);
+        }
+        writeDisk(key, *r, dir);
+    }
+
+    void clear(const fs::path &dir)
+    {
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            lru.clear();
+        }
+
+        if (dir.empty())
+            return;
+
+        std::error_code ec;
+        for (const auto &e : fs::directory_iterator(dir, ec))
+        {
+            if (e.path().extension() == fileExtension)
+                fs::remove(e.path(), ec);
+        }
+    }
+
+  private:
+    // The largest tables are a few MB, so only a handful stay in memory
+    static constexpr size_t memoryCapacity = 8, diskCapacity = 64;
+    static constexpr const char *fileExtension = ".wtsc";
+    static constexpr uint32_t fileVersion = 1;
+
+    struct FileHeader
+    {
+        char tag[4];
+        uint32_t version, resolution, frameCount, nameLength;
+    };
+
+    std::mutex mutex;
+    std::list<std::pair<std::string, LuaWTEvaluator::rendered_t>> lru; // most recent first
+
+    static uint64_t fnv1a64(const std::string &s, uint64_t h)
+    {
+        for (auto c : s)
+        {
+            h ^= (uint8_t)c;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static void appendHex(std::string &out, uint64_t v)
+    {
+        static const char *digits = "0123456789abcdef";
+        for (int i = 60; i >= 0; i -= 4)
+            out += digits[(v >> i) & 0xF];
+    }
+
+    void insertMemory(const std::string &key, const LuaWTEvaluator::rendered_t &r)
+    {
+        lru.remove_if([&key](const auto &e) { return e.first == key; });
+        lru.emplace_front(key, r);
+        if (lru.size() > memoryCapacity)
+            lru.pop_back();
+    }
+
+    LuaWTEvaluator::rendered_t readDisk(const std::string &key, const fs::path &dir)
+    {
+        if (dir.empty())
+            return nullptr;
+
+        std::ifstream in(dir / (key + fileExtension), std::ios::binary);
+        FileHeader h;
+        if (!in || !in.read(reinterpret_cast<char *>(&h), sizeof(h)) ||
+            memcmp(h.tag, "WTSC", 4) != 0 || h.version != fileVersion ||
+            h.resolution > (uint32_t)max_wtable_size || h.frameCount > 4096 || h.nameLength > 1024)
+            return nullptr;
+
+        auto r = std::make_shared<LuaWTEvaluator::Rendered>();
+        r->resolution = h.resolution;
+        r->frameCount = h.frameCount;
+        r->name.resize(h.nameLength);
+        r->data.resize((size_t)h.resolution * h.frameCount);
+
+        if (!in.read(r->name.data(), h.nameLength) ||
+            !in.read(reinterpret_cast<char *>(r->data.data()), r->data.size() * sizeof(float)))
+            return nullptr;
+
+        return r;
+    }
+
+    void writeDisk(const std::string &key, const LuaWTEvaluator::Rendered &r,
+                   const fs::path &dir)
+    {
+        if (dir.empty())
+            return;
+
+        try
+        {
+            fs::create_directories(dir);
+
+            auto tmp = dir / (key + ".tmp");
+            {
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                FileHeader h{{'W', 'T', 'S', 'C'},
+                             fileVersion,
+                             (uint32_t)r.resolution,
+                             (uint32_t)r.frameCount,
+                             (uint32_t)r.name.size()};
+                out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+                out.write(r.name.data(), r.name.size());
+                out.write(reinterpret_cast<const char *>(r.data.data()),
+                          r.data.size() * sizeof(float));
+                if (!out)
+                    return;
+            }
+            fs::rename(tmp, dir / (key + fileExtension));
+
+            pruneDisk(dir);
+        }
+        catch (const fs::filesystem_error &)
+        {
+            // The disk tier is best effort; the table is still in memory
+        }
+    }
+
+    void pruneDisk(const fs::path &dir)
+    {
+        std::vector<std::pair<fs::file_time_type, fs::path>> files;
+        for (const auto &e : fs::directory_iterator(dir))
+        {
+            if (e.is_regular_file() && e.path().extension() == fileExtension)
+                files.emplace_back(e.last_write_time(), e.path());
+        }
+
+        if (files.size() <= diskCapacity)
+            return;
+
+        // Oldest first
+        std::sort(files.begin(), files.end(),
+                  [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        std::error_code ec;
+        for (size_t i = 0; i < files.size() - diskCapacity; ++i)
+            fs::remove(files[i].second, ec);
+    }
+};
+
+RenderCache &renderCache()
+{
+    static RenderCache cache;
+    return cache;
+}
+} // namespace
+
 struct LuaWTEvaluator::Details
 {
     SurgeStorage *storage{nullptr};
@@ -49,10 +275,46 @@ struct LuaWTEvaluator::Details
 
     lua_State *L{nullptr};
 
+    // The whole table for the current settings, once rendered or found in the cache
+    LuaWTEvaluator::rendered_t rendered;
+    bool lookedForRendered{false};
+
+    // When set, errors are collected here rather than reported, for the thread running a render
+    std::vector<std::pair<std::string, std::string>> *deferredErrors{nullptr};
+
+    ~Details()
+    {
+        if (L)
+            lua_close(L);
+    }
+
     void invalidate()
     {
         isValid = false;
         frameCache.clear();
+        rendered.reset();
+        lookedForRendered = false;
+    }
+
+    void reportError(const std::string &msg, const std::string &title)
+    {
+        if (deferredErrors)
+            deferredErrors->emplace_back(msg, title);
+        else if (storage)
+            storage->reportError(msg, title);
+        else
+            std::cerr << msg;
+    }
+
+    LuaWTEvaluator::rendered_t findRendered()
+    {
+        if (!lookedForRendered)
+        {
+            rendered = renderCache().lookup(RenderCache::makeKey(script, resolution, frameCount),
+                                             RenderCache::directoryFor(storage));
+            lookedForRendered = true;
+        }
+        return rendered;
     }
     void makeEmptyState(bool pushToGlobal)
     {
@@ -81,9 +343,7 @@ struct LuaWTEvaluator::Details
         lua_getglobal(L, "generate");
         if (!lua_isfunction(L, -1))
         {
-            if (storage)
-                storage->reportError("Unable to locate generate function",
-                                     "Wavetable Script Evaluator");
+            reportError("Unable to locate generate function", "Wavetable Script Evaluator");
             lua_pop(L, 1); // pop the generate non-function
             return std::nullopt;
         }
@@ -185,10 +445,7 @@ struct LuaWTEvaluator::Details
             // Fallback if error(nil)
             std::string luaerr = err ? err : "Lua error: Value is nil";
 
-            if (storage)
-                storage->reportError(luaerr, "Wavetable Evaluator Runtime Error");
-            else
-                std::cerr << luaerr;
+            reportError(luaerr, "Wavetable Evaluator Runtime Error");
         }
         lua_pop(L, 1); // Error string or pcall result
 
@@ -220,9 +477,7 @@ struct LuaWTEvaluator::Details
                 }
                 else
                 {
-                    if (storage)
-                        storage->reportError("Init function returned a non-table",
-                                             "Wavetable Script Evaluator");
+                    reportError("Init function returned a non-table", "Wavetable Script Evaluator");
                     makeEmptyState(true);
                 }
             }
@@ -233,10 +488,7 @@ struct LuaWTEvaluator::Details
                 // Fallback if error(nil)
                 std::string luaerr = err ? err : "Lua error: Value is nil";
 
-                if (storage)
-                    storage->reportError(luaerr, "Wavetable Evaluator Init Error");
-                else
-                    std::cerr << luaerr;
+                reportError(luaerr, "Wavetable Evaluator Init Error");
                 lua_pop(L, -1);
 
                 makeEmptyState(true);
@@ -282,9 +534,9 @@ struct LuaWTEvaluator::Details
             std::string emsg;
             auto res = Surge::LuaSupport::parseStringDefiningMultipleFunctions(
                 L, script, {"init", "generate"}, emsg);
-            if (!res && storage)
+            if (!res)
             {
-                storage->reportError(emsg, "Wavetable Parse Error");
+                reportError(emsg, "Wavetable Parse Error");
             }
 
             lua_pop(L, 2); // remove the 2 functions added in the global state
@@ -316,6 +568,98 @@ struct LuaWTEvaluator::Details
         return true;
     }
 };
+
+namespace
+{
+/*
+ * Renders every frame the lead hasn't already, with the lead itself and up to
+ * maxRenderThreads - 1 helpers, each of which runs the script's init in a Lua state of its
+ * own. Frames are handed out in order, and since each is rendered just as getFrame would,
+ * the table is the same as rendering them one after another. The lead has to be valid, and
+ * has reported any parse and init errors, so the helpers keep theirs to themselves.
+ */
+LuaWTEvaluator::rendered_t renderFrames(LuaWTEvaluator::Details &lead)
+{
+    auto frames = lead.frameCount;
+    auto resolution = lead.resolution;
+
+    std::vector<std::optional<LuaWTEvaluator::frame_t>> results(frames);
+    std::vector<std::vector<std::pair<std::string, std::string>>> errors(frames);
+    size_t pending{0};
+
+    // Frames the editor already showed needn't be made again
+    for (size_t i = 0; i < frames; ++i)
+    {
+        if (i < lead.frameCache.size())
+            results[i] = lead.frameCache[i];
+        if (!results[i].has_value())
+            pending++;
+    }
+
+    std::atomic<size_t> nextFrame{0};
+    auto work = [&](LuaWTEvaluator::Details &d) {
+        for (auto f = nextFrame++; f < frames; f = nextFrame++)
+        {
+            if (results[f].has_value())
+                continue;
+
+            d.deferredErrors = &errors[f];
+            results[f] = d.generateScriptAtFrame(f);
+            d.deferredErrors = nullptr;
+        }
+    };
+
+    auto cores = std::max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+    auto helpers = std::min({pending, cores, maxRenderThreads}) - (pending > 0 ? 1 : 0);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        threads.emplace_back([&]() {
+            LuaWTEvaluator::Details helper;
+            helper.script = lead.script;
+            helper.resolution = resolution;
+            helper.frameCount = frames;
+
+            std::vector<std::pair<std::string, std::string>> initErrors;
+            helper.deferredErrors = &initErrors;
+            helper.makeValid();
+
+            work(helper);
+        });
+    }
+
+    work(lead);
+
+    for (auto &t : threads)
+        t.join();
+
+    lead.frameCache = results;
+
+    // As a serial render would, give up at the first frame which failed, with its errors
+    for (size_t f = 0; f < frames; ++f)
+    {
+        if (!results[f].has_value() || !results[f]->has_value())
+        {
+            for (const auto &[msg, title] : errors[f])
+                lead.reportError(msg, title);
+            return nullptr;
+        }
+    }
+
+    auto r = std::make_shared<LuaWTEvaluator::Rendered>();
+    r->resolution = resolution;
+    r->frameCount = frames;
+    r->name = lead.wtName;
+    r->data.reserve(frames * resolution);
+    for (const auto &fr : results)
+        r->data.insert(r->data.end(), (*fr)->begin(), (*fr)->end());
+
+    renderCache().store(RenderCache::makeKey(lead.script, resolution, frames), r,
+                        RenderCache::directoryFor(lead.storage));
+    return r;
+}
+} // namespace
 #else
 struct LuaWTEvaluator::Details
 {
@@ -366,6 +710,15 @@ void LuaWTEvaluator::setFrameCount(size_t n)
 LuaWTEvaluator::frame_t LuaWTEvaluator::getFrame(size_t frame)
 {
 #if HAS_LUA
+    if (auto r = details->findRendered())
+    {
+        if (frame >= r->frameCount)
+            return std::nullopt;
+
+        auto b = r->data.begin() + frame * r->resolution;
+        return validFrame_t(b, b + r->resolution);
+    }
+
     if (!details->makeValid())
         return std::nullopt;
     if (frame > details->frameCount)
@@ -389,9 +742,11 @@ LuaWTEvaluator::frame_t LuaWTEvaluator::getFrame(size_t frame)
 bool LuaWTEvaluator::populateWavetable(wt_header &wh, float **wavdata)
 {
 #if HAS_LUA
-    if (!details->makeValid())
+    if (!details->findRendered() && !details->makeValid())
         return false;
 
+    auto r = renderWavetable();
+
     auto resolution = details->resolution;
     auto frames = details->frameCount;
 
@@ -401,27 +756,78 @@ bool LuaWTEvaluator::populateWavetable(wt_header &wh, float **wavdata)
     wh.flags = 0;
     *wavdata = wd;
 
-    for (int i = 0; i < frames; ++i)
+    if (!r)
     {
-        auto v = getFrame(i);
-        if (v.has_value())
-        {
-            memcpy(&(wd[i * resolution]), &((*v)[0]), resolution * sizeof(float));
-        }
-        else
-        {
-            return false;
-        }
+        std::fill(wd, wd + frames * resolution, 0.f);
+        return false;
     }
+
+    std::copy(r->data.begin(), r->data.end(), wd);
     return true;
 #else
     return false;
 #endif
 }
 
+LuaWTEvaluator::rendered_t LuaWTEvaluator::renderWavetable()
+{
+#if HAS_LUA
+    if (auto r = details->findRendered())
+        return r;
+
+    if (!details->makeValid())
+        return nullptr;
+
+    details->rendered = renderFrames(*details);
+    return details->rendered;
+#else
+    return nullptr;
+#endif
+}
+
+std::future<LuaWTEvaluator::rendered_t> LuaWTEvaluator::renderWavetableAsync()
+{
+#if HAS_LUA
+    auto storage = details->storage;
+    auto script = details->script;
+    auto resolution = details->resolution;
+    auto frames = details->frameCount;
+
+    return std::async(std::launch::async, [=]() -> rendered_t {
+        Details lead;
+        lead.storage = storage;
+        lead.script = script;
+        lead.resolution = resolution;
+        lead.frameCount = frames;
+
+        if (auto r = lead.findRendered())
+            return r;
+
+        if (!lead.makeValid())
+            return nullptr;
+
+        return renderFrames(lead);
+    });
+#else
+    std::promise<rendered_t> none;
+    none.set_value(nullptr);
+    return none.get_future();
+#endif
+}
+
+void LuaWTEvaluator::clearRenderCache(SurgeStorage *storage)
+{
+#if HAS_LUA
+    renderCache().clear(RenderCache::directoryFor(storage));
+#endif
+}
+
 std::string LuaWTEvaluator::getSuggestedWavetableName()
 {
 #if HAS_LUA
+    if (auto r = details->findRendered())
+        return r->name;
+
     details->makeValid();
     return details->wtName;
 #else
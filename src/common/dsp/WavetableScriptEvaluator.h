@@ -23,6 +23,9 @@
 #ifndef SURGE_SRC_COMMON_DSP_WAVETABLESCRIPTEVALUATOR_H
 #define SURGE_SRC_COMMON_DSP_WAVETABLESCRIPTEVALUATOR_H
 
+#include <future>
+#include <memory>
+
 #include "SurgeStorage.h"
 #include "StringOps.h"
 #include "Wavetable.h"
@@ -46,12 +49,42 @@ struct LuaWTEvaluator
     using validFrame_t = std::vector<float>;
     using frame_t = std::optional<validFrame_t>;
 
+    /*
+     * A whole rendered table. The same one is handed to everyone who renders the same
+     * script at the same size, so it never changes once made.
+     */
+    struct Rendered
+    {
+        size_t resolution{0}, frameCount{0};
+        std::vector<float> data; // frameCount frames of resolution samples each
+        std::string name;
+    };
+    using rendered_t = std::shared_ptr<const Rendered>;
+
     /*
      * Generate all the data required to call BuildWT. The wavdata here is data you
      * must free with delete[]
      */
     bool populateWavetable(wt_header &wh, float **wavdata);
 
+    /*
+     * Render every frame, or find the table rendered before for the same script, resolution
+     * and frame count, by this evaluator or any other. Rendered tables are kept in memory,
+     * and on disk when there is a storage to say where. Frames which aren't cached render
+     * in parallel, each worker with a Lua state of its own. Returns nullptr if a frame fails.
+     */
+    rendered_t renderWavetable();
+
+    /*
+     * The same on a thread of its own, for the script, resolution and frame count set now.
+     * The evaluator can be changed or destroyed meanwhile, but as with any std::async,
+     * dropping the future waits for the render to finish.
+     */
+    std::future<rendered_t> renderWavetableAsync();
+
+    // Forgets every rendered table, including the ones on disk if given a storage
+    static void clearRenderCache(SurgeStorage *storage = nullptr);
+
     frame_t getFrame(size_t frame);
 
     std::string getSuggestedWavetableName();
@@ -23,6 +23,8 @@
 #ifndef SURGE_SRC_COMMON_DSP_MODULATORS_ADSRMODULATIONSOURCE_H
 #define SURGE_SRC_COMMON_DSP_MODULATORS_ADSRMODULATIONSOURCE_H
 
+#include <cassert>
+
 #include "DSPUtils.h"
 #include "SurgeStorage.h"
 #include "SurgeVoiceState.h"
@@ -461,7 +463,329 @@ class ADSRModulationSource : public ModulationSource
 
     int getEnvState() { return envstate; }
 
+    /*
+     * Advances up to four envelopes by a block, such as the amp or filter EGs of a quad
+     * filter group's voices. The arithmetic runs a lane per envelope in full-width SIMD
+     * and follows process_block operation for operation, so each envelope ends up exactly
+     * where its own process_block would have taken it. What stays scalar is what differs
+     * per envelope: parameters and rate lookups, state changes, the cube root decay shape,
+     * idle envelopes, and the corrected analog mode, which just run process_block.
+     */
+    static void process_block_quad(ADSRModulationSource *const *env, int n)
+    {
+        assert(n <= 4);
+
+        int analog[4], digital[4];
+        int na = 0, nd = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            auto *e = env[i];
+            if (e->lc[e->mode].b)
+            {
+                if (e->correctAnalogMode)
+                    e->process_block();
+                else
+                    analog[na++] = i;
+            }
+            else if (e->envstate == s_attack || e->envstate == s_release ||
+                     e->envstate == s_uberrelease ||
+                     (e->envstate == s_decay && e->lc[e->d_s].i != 2))
+            {
+                digital[nd++] = i;
+            }
+            else
+            {
+                e->process_block();
+            }
+        }
+
+        if (na)
+            process_analog_quad(env, analog, na);
+        if (nd)
+            process_digital_quad(env, digital, nd);
+    }
+
   private:
+    static void process_analog_quad(ADSRModulationSource *const *env, const int *lane, int n)
+    {
+        const float v_cc = 1.5f;
+
+        float c1 alignas(16)[4]{}, c1d alignas(16)[4]{}, dis alignas(16)[4]{};
+        float vg alignas(16)[4]{}, sp alignas(16)[4]{};
+        float cA alignas(16)[4]{}, cD alignas(16)[4]{}, cR alignas(16)[4]{};
+        bool gate[4]{};
+
+        for (int k = 0; k < n; ++k)
+        {
+            auto *e = env[lane[k]];
+            auto *lc = e->lc;
+            auto *adsr = e->adsr;
+            auto *storage = e->storage;
+
+            c1[k] = e->_v_c1;
+            c1d[k] = e->_v_c1_delayed;
+            dis[k] = e->_discharge;
+            gate[k] = (e->envstate == s_attack) || (e->envstate == s_decay);
+            vg[k] = gate[k] ? v_cc : 0.f;
+            sp[k] = limit_range(lc[e->s].f, 0.f, 1.f);
+
+            const float coeff_offset = 2.f - log(storage->samplerate / BLOCK_SIZE) / log(2.f);
+
+            cA[k] = powf(2.f, std::min(0.f, coeff_offset -
+                                                lc[e->a].f * (adsr->a.temposync
+                                                                  ? storage->temposyncratio
+                                                                  : 1.f)));
+            cD[k] = powf(2.f, std::min(0.f, coeff_offset -
+                                                lc[e->d].f * (adsr->d.temposync
+                                                                  ? storage->temposyncratio
+                                                                  : 1.f)));
+            cR[k] = e->envstate == s_uberrelease
+                        ? 6.f
+                        : powf(2.f, std::min(0.f, coeff_offset -
+                                                      lc[e->r].f * (adsr->r.temposync
+                                                                        ? storage->temposyncratio
+                                                                        : 1.f)));
+        }
+
+        auto v_c1 = SIMD_MM(load_ps)(c1);
+        auto v_c1_delayed = SIMD_MM(load_ps)(c1d);
+        auto discharge = SIMD_MM(load_ps)(dis);
+        const auto one = SIMD_MM(set1_ps)(1.0f);
+        const auto v_cc_vec = SIMD_MM(set1_ps)(v_cc);
+        auto v_gate = SIMD_MM(load_ps)(vg);
+        auto v_is_gate = SIMD_MM(cmpgt_ps)(v_gate, SIMD_MM(setzero_ps)());
+
+        discharge = SIMD_MM(and_ps)(
+            SIMD_MM(or_ps)(SIMD_MM(cmpgt_ps)(v_c1_delayed, one), discharge), v_is_gate);
+
+        v_c1_delayed = v_c1;
+
+        auto S = SIMD_MM(load_ps)(sp);
+        S = SIMD_MM(mul_ps)(S, S);
+        auto v_attack = SIMD_MM(andnot_ps)(discharge, v_gate);
+        auto v_decay = SIMD_MM(or_ps)(SIMD_MM(andnot_ps)(discharge, v_cc_vec),
+                                      SIMD_MM(and_ps)(discharge, S));
+        auto v_release = v_gate;
+
+        auto diff_v_a = SIMD_MM(max_ps)(SIMD_MM(setzero_ps)(), SIMD_MM(sub_ps)(v_attack, v_c1));
+
+        auto diff_vd_kernel = SIMD_MM(sub_ps)(v_decay, v_c1);
+        auto diff_vd_kernel_min = SIMD_MM(min_ps)(SIMD_MM(setzero_ps)(), diff_vd_kernel);
+        auto dis_and_gate = SIMD_MM(and_ps)(discharge, v_is_gate);
+        auto diff_v_d = SIMD_MM(or_ps)(SIMD_MM(and_ps)(dis_and_gate, diff_vd_kernel),
+                                       SIMD_MM(andnot_ps)(dis_and_gate, diff_vd_kernel_min));
+
+        auto diff_v_r = SIMD_MM(min_ps)(SIMD_MM(setzero_ps)(), SIMD_MM(sub_ps)(v_release, v_c1));
+
+        v_c1 = SIMD_MM(add_ps)(v_c1, SIMD_MM(mul_ps)(diff_v_a, SIMD_MM(load_ps)(cA)));
+        v_c1 = SIMD_MM(add_ps)(v_c1, SIMD_MM(mul_ps)(diff_v_d, SIMD_MM(load_ps)(cD)));
+        v_c1 = SIMD_MM(add_ps)(v_c1, SIMD_MM(mul_ps)(diff_v_r, SIMD_MM(load_ps)(cR)));
+
+        SIMD_MM(store_ps)(c1, v_c1);
+        SIMD_MM(store_ps)(c1d, v_c1_delayed);
+        SIMD_MM(store_ps)(dis, discharge);
+
+        for (int k = 0; k < n; ++k)
+        {
+            auto *e = env[lane[k]];
+            const bool r_gated = e->adsr->r.deform_type;
+
+            e->_v_c1 = c1[k];
+            e->_v_c1_delayed = c1d[k];
+            e->_discharge = dis[k];
+
+            e->output = c1[k];
+            if (gate[k])
+            {
+                e->_ungateHold = e->output;
+            }
+            else
+            {
+                if (r_gated)
+                {
+                    e->output = e->_ungateHold;
+                }
+            }
+
+            const float SILENCE_THRESHOLD = 1e-6;
+
+            if (!gate[k] && e->_discharge == 0.f && e->_v_c1 < SILENCE_THRESHOLD)
+            {
+                e->envstate = s_idle;
+                e->output = 0;
+                e->idlecount++;
+            }
+        }
+    }
+
+    static void process_digital_quad(ADSRModulationSource *const *env, const int *lane, int n)
+    {
+        float ph alignas(16)[4]{}, rt alignas(16)[4]{}, sc alignas(16)[4]{};
+        int32_t rs alignas(16)[4]{};
+        int maxRs = 0;
+
+        for (int k = 0; k < n; ++k)
+        {
+            auto *e = env[lane[k]];
+            auto *lc = e->lc;
+            auto *adsr = e->adsr;
+            auto *storage = e->storage;
+
+            ph[k] = e->phase;
+            sc[k] = e->scalestage;
+
+            switch (e->envstate)
+            {
+            case s_attack:
+                rt[k] = storage->envelope_rate_linear_nowrap(lc[e->a].f) *
+                        (adsr->a.temposync ? storage->temposyncratio : 1.f);
+                break;
+            case s_decay:
+                rt[k] = storage->envelope_rate_linear_nowrap(lc[e->d].f) *
+                        (adsr->d.temposync ? storage->temposyncratio : 1.f);
+                break;
+            case s_release:
+                rt[k] = storage->envelope_rate_linear_nowrap(lc[e->r].f) *
+                        (adsr->r.temposync ? storage->temposyncratio : 1.f);
+                rs[k] = lc[e->r_s].i;
+                break;
+            case s_uberrelease:
+                rt[k] = storage->envelope_rate_linear_nowrap(-6.5);
+                rs[k] = lc[e->r_s].i;
+                break;
+            }
+
+            maxRs = std::max(maxRs, (int)rs[k]);
+        }
+
+        const auto one = SIMD_MM(set1_ps)(1.f);
+        const auto two = SIMD_MM(set1_ps)(2.f);
+
+        auto P = SIMD_MM(load_ps)(ph);
+        auto R = SIMD_MM(load_ps)(rt);
+
+        // Attack moves the phase up, capped at one, then shapes it
+        auto up = SIMD_MM(add_ps)(P, R);
+        auto capped = SIMD_MM(cmpge_ps)(up, one);
+        auto atk = SIMD_MM(or_ps)(SIMD_MM(and_ps)(capped, one), SIMD_MM(andnot_ps)(capped, up));
+        auto atkSqrt = SIMD_MM(sqrt_ps)(atk);
+        auto atkSquare = SIMD_MM(mul_ps)(atk, atk);
+
+        // Release moves it down, and raises it to the power of the shape
+        auto down = SIMD_MM(sub_ps)(P, R);
+        auto rel = down;
+        auto rsv = SIMD_MM(load_si128)((const SIMD_M128I *)rs);
+        for (int i = 0; i < maxRs; ++i)
+        {
+            auto m = SIMD_MM(castsi128_ps)(SIMD_MM(cmplt_epi32)(SIMD_MM(set1_epi32)(i), rsv));
+            rel = SIMD_MM(or_ps)(SIMD_MM(and_ps)(m, SIMD_MM(mul_ps)(rel, down)),
+                                 SIMD_MM(andnot_ps)(m, rel));
+        }
+        rel = SIMD_MM(mul_ps)(rel, SIMD_MM(load_ps)(sc));
+
+        // The bounds the quadratic decay shape can move the phase within this block
+        auto sx2r = SIMD_MM(mul_ps)(SIMD_MM(mul_ps)(two, SIMD_MM(sqrt_ps)(P)), R);
+        auto rr = SIMD_MM(mul_ps)(R, R);
+        auto quadLo = SIMD_MM(add_ps)(SIMD_MM(sub_ps)(P, sx2r), rr);
+        auto quadHi = SIMD_MM(add_ps)(SIMD_MM(add_ps)(P, sx2r), rr);
+
+        float upA alignas(16)[4], atkA alignas(16)[4], atkSqrtA alignas(16)[4];
+        float atkSquareA alignas(16)[4], downA alignas(16)[4], relA alignas(16)[4];
+        float quadLoA alignas(16)[4], quadHiA alignas(16)[4];
+        SIMD_MM(store_ps)(upA, up);
+        SIMD_MM(store_ps)(atkA, atk);
+        SIMD_MM(store_ps)(atkSqrtA, atkSqrt);
+        SIMD_MM(store_ps)(atkSquareA, atkSquare);
+        SIMD_MM(store_ps)(downA, down);
+        SIMD_MM(store_ps)(relA, rel);
+        SIMD_MM(store_ps)(quadLoA, quadLo);
+        SIMD_MM(store_ps)(quadHiA, quadHi);
+
+        for (int k = 0; k < n; ++k)
+        {
+            auto *e = env[lane[k]];
+            auto *lc = e->lc;
+            const bool r_gated = e->adsr->r.deform_type;
+
+            switch (e->envstate)
+            {
+            case s_attack:
+            {
+                e->phase = atkA[k];
+                if (upA[k] >= 1)
+                {
+                    e->envstate = s_decay;
+                    e->sustain = lc[e->s].f;
+                }
+
+                switch (lc[e->a_s].i)
+                {
+                case 0:
+                    e->output = atkSqrtA[k];
+                    break;
+                case 1:
+                    e->output = e->phase;
+                    break;
+                case 2:
+                    e->output = atkSquareA[k];
+                    break;
+                };
+            }
+            break;
+            case s_decay:
+            {
+                float rate = rt[k];
+                float l_lo, l_hi;
+
+                if (lc[e->d_s].i == 1)
+                {
+                    l_lo = quadLoA[k];
+                    l_hi = quadHiA[k];
+
+                    // The same special cases as process_block; see the comments there
+                    if ((lc[e->s].f < 1e-3 && ph[k] < 1e-4) || (lc[e->s].f == 0 && lc[e->d].f < -7))
+                    {
+                        l_lo = 0;
+                    }
+                    if (rate > 1.0 && l_lo > lc[e->s].f)
+                    {
+                        l_lo = lc[e->s].f;
+                    }
+                }
+                else
+                {
+                    l_lo = downA[k];
+                    l_hi = upA[k];
+                }
+
+                e->phase = limit_range(lc[e->s].f, l_lo, l_hi);
+                e->output = e->phase;
+            }
+            break;
+            case s_release:
+            case s_uberrelease:
+            {
+                e->phase = downA[k];
+
+                if (!r_gated)
+                {
+                    e->output = relA[k];
+                }
+
+                if (e->phase < 0)
+                {
+                    e->envstate = s_idle;
+                    e->output = 0;
+                }
+            }
+            break;
+            };
+
+            e->output = limit_range(e->output, 0.f, 1.f);
+        }
+    }
+
     ADSRStorage *adsr = nullptr;
     SurgeVoiceState *state = nullptr;
     SurgeStorage *storage = nullptr;
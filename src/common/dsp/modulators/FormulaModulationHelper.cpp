@@ -34,6 +34,231 @@ namespace Surge
 namespace Formula
 {
 
+namespace
+{
+/*
+ * What the batch driver says about each voice it reached. The driver below uses the same
+ * numbers; a voice it never reached is still pending and goes through valueAt's path.
+ */
+enum BatchStatus
+{
+    batchPending = 0,
+    batchOK = 1,
+    batchReturnedNumber = 2,
+    batchCallFailed = 3,
+    batchBadReturn = 4,
+    batchBadOutputIndex = 5,
+    batchMissingOutput = 6,
+    batchNotAFunction = 7,
+};
+
+static_assert(n_customcontrollers == 8 && max_formula_outputs == 8,
+              "The batch driver's declaration of BatchVoice has these sizes built in");
+static_assert(sizeof(BatchVoice) == 66 * sizeof(double),
+              "The batch driver's declaration of BatchVoice has to match this one");
+
+static constexpr const char *batchDriverName{"surge_reserved_formula_process_batch"};
+
+/*
+ * Does for each voice in the buffer what valueAt does with the C API, in the same order, then
+ * records which way it went. Error messages, and the bad indices of a vector output, go in
+ * errors at the voice's position for evaluate to report.
+ */
+static constexpr const char *batchDriverSource = R"FN(
+local hasffi, ffi = pcall(require, "ffi")
+
+if hasffi then
+    ffi.cdef[[
+        typedef struct
+        {
+            double intphase, voice_count;
+            double delay, decay, attack, hold, sustain, release;
+            double rate, startphase, amplitude, deform;
+            double phase, tempo, songpos;
+            double pb, pb_range_up, pb_range_dn, chan_at, cc_mw, cc_breath, cc_expr, cc_sus;
+            double lowest_key, highest_key, latest_key;
+            double poly_limit, scene_mode, play_mode, split_point;
+            double released, is_rendering_to_ui, mpe_enabled, is_voice;
+            double key, velocity, rel_velocity, channel;
+            double poly_at, mpe_bend, mpe_bendrange, mpe_timbre, mpe_pressure, voice_id;
+            double macros[8];
+
+            double status, activeoutputs, use_envelope, retrigger_AEG, retrigger_FEG, clamp_output;
+            double output[8];
+        } surge_formula_batch_voice;
+    ]]
+
+    local voices_t = ffi.typeof("surge_formula_batch_voice *")
+
+    -- What lua_isnumber and lua_tonumber make of a value
+    local function as_number(x)
+        if type(x) == "number" then
+            return x
+        elseif type(x) == "string" then
+            return tonumber(x)
+        end
+        return nil
+    end
+
+    local function bool_or(x, default)
+        if type(x) == "boolean" then
+            return x
+        end
+        return default
+    end
+
+    function surge_reserved_formula_process_batch(funcs, states, errors, buffer, n)
+        local vs = ffi.cast(voices_t, buffer)
+
+        for i = 0, n - 1 do
+            local v = vs[i]
+            local fname = funcs[i + 1]
+            local fn = _G[fname]
+            local replace = true
+
+            if type(fn) ~= "function" then
+                v.status = 7
+            else
+                local sname = states[i + 1]
+                local st = _G[sname]
+
+                st.intphase = v.intphase
+                st.cycle = v.intphase
+                st.voice_count = v.voice_count
+
+                st.delay = v.delay
+                st.decay = v.decay
+                st.attack = v.attack
+                st.hold = v.hold
+                st.sustain = v.sustain
+                st.release = v.release
+
+                st.rate = v.rate
+                st.startphase = v.startphase
+                st.amplitude = v.amplitude
+                st.deform = v.deform
+
+                st.phase = v.phase
+                st.tempo = v.tempo
+                st.songpos = v.songpos
+
+                st.pb = v.pb
+                st.pb_range_up = v.pb_range_up
+                st.pb_range_dn = v.pb_range_dn
+                st.chan_at = v.chan_at
+                st.cc_mw = v.cc_mw
+                st.cc_breath = v.cc_breath
+                st.cc_expr = v.cc_expr
+                st.cc_sus = v.cc_sus
+                st.lowest_key = v.lowest_key
+                st.highest_key = v.highest_key
+                st.latest_key = v.latest_key
+
+                st.poly_limit = v.poly_limit
+                st.scene_mode = v.scene_mode
+                st.play_mode = v.play_mode
+                st.split_point = v.split_point
+
+                st.released = v.released ~= 0
+                st.is_rendering_to_ui = v.is_rendering_to_ui ~= 0
+                st.mpe_enabled = v.mpe_enabled ~= 0
+
+                st.retrigger_AEG = nil
+                st.retrigger_FEG = nil
+
+                if v.is_voice ~= 0 then
+                    st.key = v.key
+                    st.velocity = v.velocity
+                    st.rel_velocity = v.rel_velocity
+                    st.channel = v.channel
+
+                    st.poly_at = v.poly_at
+                    st.mpe_bend = v.mpe_bend
+                    st.mpe_bendrange = v.mpe_bendrange
+                    st.mpe_timbre = v.mpe_timbre
+                    st.mpe_pressure = v.mpe_pressure
+
+                    st.is_voice = true
+                    st.released = v.released ~= 0
+
+                    st.voice_id = v.voice_id
+                else
+                    st.is_voice = false
+                end
+
+                local macros = {}
+                for m = 1, 8 do
+                    macros[m] = v.macros[m - 1]
+                end
+                st.macros = macros
+
+                local ok, r = pcall(fn, st)
+
+                if not ok then
+                    v.status = 3
+                    if type(r) == "string" or type(r) == "number" then
+                        errors[i + 1] = tostring(r)
+                    end
+                elseif as_number(r) then
+                    v.status = 2
+                    v.output[0] = as_number(r)
+                elseif type(r) ~= "table" then
+                    v.status = 4
+                else
+                    _G[sname] = r
+                    v.status = 1
+
+                    local o = r.output
+                    if as_number(o) then
+                        v.output[0] = as_number(o)
+                    elseif type(o) == "table" then
+                        local len = 0
+                        for k, x in pairs(o) do
+                            local idx = -1
+                            local kn = as_number(k)
+                            if kn then
+                                -- lua_tointeger truncates
+                                if kn >= 0 then
+                                    idx = math.floor(kn)
+                                else
+                                    idx = math.ceil(kn)
+                                end
+                            end
+                            if idx <= 0 or idx > 8 then
+                                v.status = 5
+                                local bad = errors[i + 1] or {}
+                                bad[#bad + 1] = idx
+                                errors[i + 1] = bad
+                                idx = 0
+                            end
+                            if idx > 0 then
+                                v.output[idx - 1] = as_number(x) or 0
+                            end
+                            len = math.max(len, idx - 1)
+                        end
+                        v.activeoutputs = len + 1
+                    else
+                        v.status = 6
+                    end
+
+                    v.use_envelope = bool_or(r.use_envelope, true) and 1 or 0
+                    v.retrigger_AEG = bool_or(r.retrigger_AEG, false) and 1 or 0
+                    v.retrigger_FEG = bool_or(r.retrigger_FEG, false) and 1 or 0
+                    v.clamp_output = bool_or(r.clamp_output, true) and 1 or 0
+
+                    replace = false
+                end
+            end
+
+            if replace then
+                _G[fname] = surge_reserved_formula_error_stub
+            end
+        end
+    end
+end
+)FN";
+} // namespace
+
 void setupStorage(SurgeStorage *s) { s->formulaGlobalData = std::make_unique<GlobalData>(); }
 
 bool prepareForEvaluation(SurgeStorage *storage, FormulaModulatorStorage *fs, EvaluatorState &s,
@@ -101,6 +326,14 @@ end
         {
             lua_setglobal(s.L, "surge_reserved_formula_error_stub");
         }
+
+        // Without FFI this defines nothing, and batches fall back to a call per voice
+        std::string bmsg;
+        if (Surge::LuaSupport::parseStringDefiningFunction(s.L, batchDriverSource,
+                                                           batchDriverName, bmsg))
+            lua_setglobal(s.L, batchDriverName);
+        else
+            lua_pop(s.L, 1);
     }
 
     // OK so now evaluate the formula. This is a mistake - the loading and
@@ -417,19 +650,105 @@ bool initEvaluatorState(EvaluatorState &s)
     return true;
 }
 
-void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
-             FormulaModulatorStorage *fs, EvaluatorState *s, float output[max_formula_outputs],
-             bool justSetup)
+namespace
 {
-#if HAS_LUA
-    s->activeoutputs = 1;
-    memset(output, 0, max_formula_outputs * sizeof(float));
-    if (s->L == nullptr)
-        return;
+const char *badReturnMessage = "The return of your Lua function must be a number or table!\nJust "
+                               "return input with output set.";
+const char *missingOutputMessage =
+    "You must define the 'output' field in the returned table as a number or a float array!";
 
-    if (!s->isvalid)
-        return;
+std::string badOutputIndexMessage(int idx)
+{
+    std::ostringstream oss;
+    oss << "Error with vector output!\nThe vector output must be"
+        << " an array with size up to 8. Your table contained"
+        << " index " << idx;
+    if (idx == -1)
+        oss << ", which is not an integer array index.";
+    if (idx > max_formula_outputs)
+        oss << ", which means your array is too large.";
+    return oss.str();
+}
+
+void gatherInputs(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
+                  const EvaluatorState *s, BatchVoice &in)
+{
+    in.intphase = phaseIntPart;
 
+    // Fake a voice count of one for display calls
+    int voiceCount = storage->activeVoiceCount;
+    if (voiceCount == 0 && s->is_display)
+        voiceCount = 1;
+    in.voice_count = voiceCount;
+
+    in.delay = s->del;
+    in.decay = s->dec;
+    in.attack = s->a;
+    in.hold = s->h;
+    in.sustain = s->s;
+    in.release = s->r;
+
+    in.rate = s->rate;
+    in.startphase = s->phase;
+    in.amplitude = s->amp;
+    in.deform = s->deform;
+
+    in.phase = phaseFracPart;
+    in.tempo = s->tempo;
+    in.songpos = s->songpos;
+
+    in.pb = s->pitchbend;
+    in.pb_range_up = s->pbrange_up;
+    in.pb_range_dn = s->pbrange_dn;
+    in.chan_at = s->aftertouch;
+    in.cc_mw = s->modwheel;
+    in.cc_breath = s->breath;
+    in.cc_expr = s->expression;
+    in.cc_sus = s->sustain;
+    in.lowest_key = s->lowest_key;
+    in.highest_key = s->highest_key;
+    in.latest_key = s->latest_key;
+
+    in.poly_limit = s->polylimit;
+    in.scene_mode = s->scenemode;
+    in.play_mode = s->polymode;
+    in.split_point = s->splitpoint;
+
+    in.released = s->released;
+    in.is_rendering_to_ui = s->is_display;
+    in.mpe_enabled = s->mpeenabled;
+    in.is_voice = s->isVoice;
+
+    in.key = s->key;
+    in.velocity = s->velocity;
+    in.rel_velocity = s->releasevelocity;
+    in.channel = s->channel;
+
+    in.poly_at = s->polyat;
+    in.mpe_bend = s->mpebend;
+    in.mpe_bendrange = (float)s->mpebendrange;
+    in.mpe_timbre = s->mpetimbre;
+    in.mpe_pressure = s->mpepressure;
+    // This went through a float on its way to Lua, so keep doing that
+    in.voice_id = (float)s->voiceOrderAtCreate;
+
+    for (int i = 0; i < n_customcontrollers; ++i)
+        in.macros[i] = s->macrovalues[i];
+
+    in.status = 0;
+    in.activeoutputs = 1;
+    in.use_envelope = 0;
+    in.retrigger_AEG = 0;
+    in.retrigger_FEG = 0;
+    in.clamp_output = 0;
+    for (int i = 0; i < max_formula_outputs; ++i)
+        in.output[i] = 0;
+}
+
+#if HAS_LUA
+void evaluateInputs(SurgeStorage *storage, EvaluatorState *s, const BatchVoice &in,
+                    float output[max_formula_outputs], bool justSetup)
+{
     auto gs = Surge::LuaSupport::SGLD("valueAt", s->L);
     struct OnErrorReplaceWithZero
     {
@@ -482,73 +801,69 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
     };
 
     // Stack is now func > table so we can update the table
-    addi("intphase", phaseIntPart);
-    addi("cycle", phaseIntPart); // Alias cycle for intphase
-
-    // Fake a voice count of one for display calls
-    int voiceCount = storage->activeVoiceCount;
-    if (voiceCount == 0 && s->is_display)
-        voiceCount = 1;
-    addi("voice_count", voiceCount);
-
-    addn("delay", s->del);
-    addn("decay", s->dec);
-    addn("attack", s->a);
-    addn("hold", s->h);
-    addn("sustain", s->s);
-    addn("release", s->r);
-
-    addn("rate", s->rate);
-    addn("startphase", s->phase);
-    addn("amplitude", s->amp);
-    addn("deform", s->deform);
-
-    addn("phase", phaseFracPart);
-    addn("tempo", s->tempo);
-    addn("songpos", s->songpos);
-
-    addn("pb", s->pitchbend);
-    addn("pb_range_up", s->pbrange_up);
-    addn("pb_range_dn", s->pbrange_dn);
-    addn("chan_at", s->aftertouch);
-    addn("cc_mw", s->modwheel);
-    addn("cc_breath", s->breath);
-    addn("cc_expr", s->expression);
-    addn("cc_sus", s->sustain);
-    addn("lowest_key", s->lowest_key);
-    addn("highest_key", s->highest_key);
-    addn("latest_key", s->latest_key);
-
-    addi("poly_limit", s->polylimit);
-    addi("scene_mode", s->scenemode);
-    addi("play_mode", s->polymode);
-    addi("split_point", s->splitpoint);
-
-    addb("released", s->released);
-    addb("is_rendering_to_ui", s->is_display);
-    addb("mpe_enabled", s->mpeenabled);
+    addi("intphase", in.intphase);
+    addi("cycle", in.intphase); // Alias cycle for intphase
+
+    addi("voice_count", in.voice_count);
+
+    addn("delay", in.delay);
+    addn("decay", in.decay);
+    addn("attack", in.attack);
+    addn("hold", in.hold);
+    addn("sustain", in.sustain);
+    addn("release", in.release);
+
+    addn("rate", in.rate);
+    addn("startphase", in.startphase);
+    addn("amplitude", in.amplitude);
+    addn("deform", in.deform);
+
+    addn("phase", in.phase);
+    addn("tempo", in.tempo);
+    addn("songpos", in.songpos);
+
+    addn("pb", in.pb);
+    addn("pb_range_up", in.pb_range_up);
+    addn("pb_range_dn", in.pb_range_dn);
+    addn("chan_at", in.chan_at);
+    addn("cc_mw", in.cc_mw);
+    addn("cc_breath", in.cc_breath);
+    addn("cc_expr", in.cc_expr);
+    addn("cc_sus", in.cc_sus);
+    addn("lowest_key", in.lowest_key);
+    addn("highest_key", in.highest_key);
+    addn("latest_key", in.latest_key);
+
+    addi("poly_limit", in.poly_limit);
+    addi("scene_mode", in.scene_mode);
+    addi("play_mode", in.play_mode);
+    addi("split_point", in.split_point);
+
+    addb("released", in.released);
+    addb("is_rendering_to_ui", in.is_rendering_to_ui);
+    addb("mpe_enabled", in.mpe_enabled);
 
     addnil("retrigger_AEG");
     addnil("retrigger_FEG");
 
-    if (s->isVoice)
+    if (in.is_voice)
     {
-        addi("key", s->key);
-        addi("velocity", s->velocity);
-        addi("rel_velocity", s->releasevelocity);
-        addi("channel", s->channel);
+        addi("key", in.key);
+        addi("velocity", in.velocity);
+        addi("rel_velocity", in.rel_velocity);
+        addi("channel", in.channel);
 
-        addn("poly_at", s->polyat);
-        addn("mpe_bend", s->mpebend);
-        addn("mpe_bendrange", s->mpebendrange);
-        addn("mpe_timbre", s->mpetimbre);
-        addn("mpe_pressure", s->mpepressure);
+        addn("poly_at", in.poly_at);
+        addn("mpe_bend", in.mpe_bend);
+        addn("mpe_bendrange", in.mpe_bendrange);
+        addn("mpe_timbre", in.mpe_timbre);
+        addn("mpe_pressure", in.mpe_pressure);
 
-        addb("is_voice", s->isVoice);
-        addb("released", s->released);
+        addb("is_voice", in.is_voice);
+        addb("released", in.released);
 
         // LuaJIT has no exposed API for 64-bit int so push this as number
-        addn("voice_id", s->voiceOrderAtCreate);
+        addn("voice_id", in.voice_id);
     }
     else
     {
@@ -560,7 +875,7 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
     for (int i = 0; i < n_customcontrollers; ++i)
     {
         lua_pushinteger(s->L, i + 1);
-        lua_pushnumber(s->L, s->macrovalues[i]);
+        lua_pushnumber(s->L, in.macros[i]);
         lua_settable(s->L, -3);
     }
     lua_setfield(s->L, -2, "macros");
@@ -596,9 +911,7 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
         }
         if (!lua_istable(s->L, -1))
         {
-            s->adderror("The return of your Lua function must be a number or table!\nJust return "
-                        "input with "
-                        "output set.");
+            s->adderror(badReturnMessage);
             s->isvalid = false;
             lua_pop(s->L, 1);
             return;
@@ -629,15 +942,7 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
                 }
                 if (idx <= 0 || idx > max_formula_outputs)
                 {
-                    std::ostringstream oss;
-                    oss << "Error with vector output!\nThe vector output must be"
-                        << " an array with size up to 8. Your table contained"
-                        << " index " << idx;
-                    if (idx == -1)
-                        oss << ", which is not an integer array index.";
-                    if (idx > max_formula_outputs)
-                        oss << ", which means your array is too large.";
-                    s->adderror(oss.str());
+                    s->adderror(badOutputIndexMessage(idx));
                     auto &stateData = *storage->formulaGlobalData;
                     stateData.knownBadFunctions.insert(s->funcName);
                     s->isvalid = false;
@@ -658,9 +963,7 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
             auto &stateData = *storage->formulaGlobalData;
 
             if (stateData.knownBadFunctions.find(s->funcName) != stateData.knownBadFunctions.end())
-                s->adderror(
-                    "You must define the 'output' field in the returned table as a number or a "
-                    "float array!");
+                s->adderror(missingOutputMessage);
             stateData.knownBadFunctions.insert(s->funcName);
             s->isvalid = false;
         };
@@ -709,9 +1012,235 @@ void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
         lua_pop(s->L, 1);
         return;
     }
+}
+#endif
+} // namespace
+
+void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
+             FormulaModulatorStorage *fs, EvaluatorState *s, float output[max_formula_outputs],
+             bool justSetup)
+{
+#if HAS_LUA
+    s->activeoutputs = 1;
+    memset(output, 0, max_formula_outputs * sizeof(float));
+    if (s->L == nullptr)
+        return;
+
+    if (!s->isvalid)
+        return;
+
+    BatchVoice in;
+    gatherInputs(phaseIntPart, phaseFracPart, storage, s, in);
+    evaluateInputs(storage, s, in, output, justSetup);
+#endif
+}
+
+VoiceBatch::VoiceBatch()
+{
+    entries.reserve(capacity);
+    voices.reserve(capacity);
+    memberStateNames.reserve(capacity);
+}
+
+void VoiceBatch::add(int phaseIntPart, float phaseFracPart, SurgeStorage *storage,
+                     EvaluatorState *s, float output[max_formula_outputs])
+{
+    // Just as valueAt, an evaluator which can't run outputs zero
+    s->activeoutputs = 1;
+    memset(output, 0, max_formula_outputs * sizeof(float));
+    if (s->L == nullptr || !s->isvalid)
+        return;
+
+    assert(entries.size() < capacity);
+    entries.push_back({s, output});
+    voices.emplace_back();
+    gatherInputs(phaseIntPart, phaseFracPart, storage, s, voices.back());
+}
+
+void VoiceBatch::updateNameTables(lua_State *L)
+{
+#if HAS_LUA
+    auto n = size();
+    bool same = L == tablesL && (int)memberStateNames.size() == n;
+    for (int i = 0; same && i < n; ++i)
+        same = memberStateNames[i] == entries[i].state->stateName;
+
+    if (same)
+        return;
+
+    if (L != tablesL)
+    {
+        // The audio Lua state lives as long as the storage, so these are made once
+        for (auto ref : {&funcNamesRef, &stateNamesRef, &errorsRef})
+        {
+            lua_createtable(L, capacity, 0);
+            *ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        tablesL = L;
+    }
+
+    // The driver only reads the first n, so whatever is left past them doesn't matter
+    lua_rawgeti(L, LUA_REGISTRYINDEX, funcNamesRef);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, stateNamesRef);
+    memberStateNames.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        auto s = entries[i].state;
+        assert(s->L == L);
+        lua_pushstring(L, s->funcName);
+        lua_rawseti(L, -3, i + 1);
+        lua_pushstring(L, s->stateName);
+        lua_rawseti(L, -2, i + 1);
+        memberStateNames[i] = s->stateName;
+    }
+    lua_pop(L, 2);
 #endif
 }
 
+void VoiceBatch::evaluate(SurgeStorage *storage)
+{
+#if HAS_LUA
+    if (entries.empty())
+        return;
+
+    auto &stateData = *storage->formulaGlobalData;
+    auto L = entries[0].state->L;
+    auto n = size();
+
+    {
+        // Short enough for the label not to allocate
+        auto gs = Surge::LuaSupport::SGLD("VoiceBatch", L);
+
+        lua_getglobal(L, batchDriverName);
+        if (lua_isfunction(L, -1))
+        {
+            updateNameTables(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, errorsRef); // > errors
+            lua_insert(L, -2);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, funcNamesRef);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, stateNamesRef);
+            lua_pushvalue(L, -4);
+            lua_pushlightuserdata(L, voices.data());
+            lua_pushinteger(L, n);
+
+            // If the driver itself fails, whoever it didn't get to is still pending
+            if (lua_pcall(L, 5, 0, 0) != LUA_OK)
+                lua_pop(L, 1);
+        }
+        else
+        {
+            // Without a driver every voice is still pending, so nothing reads the errors
+            lua_pop(L, 1);
+            lua_pushnil(L); // > errors
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            auto s = entries[i].state;
+            auto output = entries[i].output;
+            auto &v = voices[i];
+
+            auto checkFinite = [s](float f) {
+                if (!std::isfinite(f))
+                {
+                    s->isFinite = false;
+                    return 0.f;
+                }
+                return f;
+            };
+
+            switch ((int)v.status)
+            {
+            case batchPending:
+                evaluateInputs(storage, s, v, output, false);
+                break;
+            case batchNotAFunction:
+                s->isvalid = false;
+                break;
+            case batchCallFailed:
+            {
+                s->isvalid = false;
+                lua_rawgeti(L, -1, i + 1);
+                std::ostringstream oss;
+                const char *err = lua_tostring(L, -1);
+                // Fallback if error(nil)
+                if (!err)
+                    err = "Lua error: Value is nil";
+                oss << "Failed to evaluate the process() function! " << err;
+                s->adderror(oss.str());
+                lua_pop(L, 1);
+
+                // The table is kept from block to block, so clear what was read
+                lua_pushnil(L);
+                lua_rawseti(L, -2, i + 1);
+            }
+            break;
+            case batchReturnedNumber:
+                s->isFinite = true;
+                output[0] = checkFinite(v.output[0]);
+                break;
+            case batchBadReturn:
+                s->isFinite = true;
+                s->adderror(badReturnMessage);
+                s->isvalid = false;
+                break;
+            default:
+            {
+                s->isFinite = true;
+                for (int o = 0; o < max_formula_outputs; ++o)
+                    output[o] = checkFinite(v.output[o]);
+                s->activeoutputs = (int)v.activeoutputs;
+
+                if (v.status == batchBadOutputIndex)
+                {
+                    lua_rawgeti(L, -1, i + 1);
+                    auto bad = (int)lua_objlen(L, -1);
+                    for (int b = 1; b <= bad; ++b)
+                    {
+                        lua_rawgeti(L, -1, b);
+                        int idx = lua_tointeger(L, -1);
+                        lua_pop(L, 1);
+
+                        s->adderror(badOutputIndexMessage(idx));
+                        stateData.knownBadFunctions.insert(s->funcName);
+                        s->isvalid = false;
+                    }
+                    lua_pop(L, 1);
+
+                    lua_pushnil(L);
+                    lua_rawseti(L, -2, i + 1);
+                }
+                else if (v.status == batchMissingOutput)
+                {
+                    if (stateData.knownBadFunctions.find(s->funcName) !=
+                        stateData.knownBadFunctions.end())
+                        s->adderror(missingOutputMessage);
+                    stateData.knownBadFunctions.insert(s->funcName);
+                    s->isvalid = false;
+                }
+
+                s->useEnvelope = v.use_envelope != 0;
+                s->retrigger_AEG = v.retrigger_AEG != 0;
+                s->retrigger_FEG = v.retrigger_FEG != 0;
+
+                if (v.clamp_output != 0)
+                {
+                    for (int o = 0; o < max_formula_outputs; ++o)
+                        output[o] = limitpm1(output[o]);
+                }
+            }
+            break;
+            }
+        }
+
+        lua_pop(L, 1); // > errors
+    }
+#endif
+
+    entries.clear();
+    voices.clear();
+}
+
 enum showFilter
 {
     SHOW_ALL,
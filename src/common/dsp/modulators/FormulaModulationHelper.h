@@ -28,6 +28,7 @@
 #include "LuaSupport.h"
 #include <variant>
 #include <memory>
+#include <vector>
 
 class SurgeVoice;
 
@@ -110,6 +111,76 @@ void setupEvaluatorStateFrom(EvaluatorState &s, const SurgeVoice *v);
 void valueAt(int phaseIntPart, float phaseFracPart, SurgeStorage *, FormulaModulatorStorage *fs,
              EvaluatorState *state, float output[max_formula_outputs], bool justSetup = false);
 
+/*
+ * Everything valueAt puts in the state table before calling process(), and what comes back.
+ * The batch driver in the Lua state reads this through an FFI declaration of the same layout,
+ * so it is all doubles, with no padding to disagree about.
+ */
+struct BatchVoice
+{
+    double intphase, voice_count;
+    double delay, decay, attack, hold, sustain, release;
+    double rate, startphase, amplitude, deform;
+    double phase, tempo, songpos;
+    double pb, pb_range_up, pb_range_dn, chan_at, cc_mw, cc_breath, cc_expr, cc_sus;
+    double lowest_key, highest_key, latest_key;
+    double poly_limit, scene_mode, play_mode, split_point;
+    double released, is_rendering_to_ui, mpe_enabled, is_voice;
+    double key, velocity, rel_velocity, channel;
+    double poly_at, mpe_bend, mpe_bendrange, mpe_timbre, mpe_pressure, voice_id;
+    double macros[n_customcontrollers];
+
+    double status, activeoutputs, use_envelope, retrigger_AEG, retrigger_FEG, clamp_output;
+    double output[max_formula_outputs];
+};
+
+/*
+ * Runs the process() calls of a scene's voice formula modulators with one call into Lua.
+ *
+ * valueAt pushes around fifty fields into the state table through the Lua C API and then
+ * makes a protected call, for every voice every block, and with many voices that boundary
+ * costs far more than most formulas do. Instead each voice adds its inputs here, as they
+ * are at that point, which just copies them into a flat buffer. evaluate then hands the
+ * buffer to a driver in the Lua state, which fills in each state table and calls process()
+ * from Lua, where LuaJIT compiles all of that marshalling.
+ *
+ * The calls happen in the order they were added, and the outputs, flags and errors come out
+ * exactly as valueAt's would. A Lua state without FFI support runs valueAt's path for each.
+ */
+class VoiceBatch
+{
+  public:
+    static constexpr int capacity = MAX_VOICES * n_lfos_voice;
+
+    VoiceBatch();
+
+    // In place of valueAt; output is filled in by evaluate
+    void add(int phaseIntPart, float phaseFracPart, SurgeStorage *storage, EvaluatorState *state,
+             float output[max_formula_outputs]);
+    void evaluate(SurgeStorage *storage);
+
+    int size() const { return (int)entries.size(); }
+
+  private:
+    struct Entry
+    {
+        EvaluatorState *state;
+        float *output;
+    };
+    std::vector<Entry> entries;
+    std::vector<BatchVoice> voices;
+
+    /*
+     * The driver's function name, state name and error tables live in the Lua registry, and
+     * the names are only pushed again when the batch's members differ from the last block's.
+     * A state name is unique to each prepareForEvaluation, so it identifies a member.
+     */
+    void updateNameTables(lua_State *L);
+    lua_State *tablesL{nullptr};
+    int funcNamesRef{0}, stateNamesRef{0}, errorsRef{0};
+    std::vector<std::string> memberStateNames;
+};
+
 struct DebugRow
 {
     explicit DebugRow(int r, const std::string &s, const std::string &v)
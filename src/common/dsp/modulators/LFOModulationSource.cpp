@@ -1214,41 +1214,19 @@ void LFOModulationSource::process_block()
 
         formulastate.isVoice = isVoice;
 
-        float tmpout[Surge::Formula::max_formula_outputs] = {0, 0, 0, 0, 0, 0, 0, 0};
-
-        Surge::Formula::valueAt(unwrappedphase_intpart, phase, storage, fs, &formulastate, tmpout);
-
-        if (!formulastate.useEnvelope)
-        {
-            useenvval = 1.0;
-        }
-
-        retrigger_AEG = formulastate.retrigger_AEG;
-        retrigger_FEG = formulastate.retrigger_FEG;
-
-        if (formulastate.raisedError)
+        if (formulaBatch)
         {
-            auto em = *formulastate.error;
-            formulastate.error.reset();
-            formulastate.raisedError = false;
-            storage->reportError(em, "Formula Evaluator Error");
-            std::cout << "ERROR: " << em << std::endl;
+            formulaBatch->add(unwrappedphase_intpart, phase, storage, &formulastate,
+                              formulaOutput);
+            formulaEnvVal = useenvval;
+            formulaPending = true;
+            return;
         }
 
-        // Since I'm (right now) the only vector valued modulator just do a little
-        // chute and ladder dance here on the output and return
-        auto magnf = limit_range(lfo->magnitude.get_extended(localcopy[magn].f), -3.f, 3.f);
-        auto uni = lfo->unipolar.val.b;
-
-        for (auto i = 0; i < formulastate.activeoutputs; ++i)
-        {
-            if (uni)
-            {
-                tmpout[i] = 0.5f + 0.5f * tmpout[i];
-            }
+        float tmpout[Surge::Formula::max_formula_outputs] = {0, 0, 0, 0, 0, 0, 0, 0};
 
-            output_multi[i] = useenvval * magnf * tmpout[i];
-        }
+        Surge::Formula::valueAt(unwrappedphase_intpart, phase, storage, fs, &formulastate, tmpout);
+        completeFormulaBlock(tmpout, useenvval);
 
         return;
     }
@@ -1346,6 +1324,50 @@ void LFOModulationSource::process_block()
     }
 }
 
+void LFOModulationSource::completeFormulaBlock()
+{
+    if (!formulaPending)
+        return;
+
+    formulaPending = false;
+    completeFormulaBlock(formulaOutput, formulaEnvVal);
+}
+
+void LFOModulationSource::completeFormulaBlock(float *tmpout, float useenvval)
+{
+    if (!formulastate.useEnvelope)
+    {
+        useenvval = 1.0;
+    }
+
+    retrigger_AEG = formulastate.retrigger_AEG;
+    retrigger_FEG = formulastate.retrigger_FEG;
+
+    if (formulastate.raisedError)
+    {
+        auto em = *formulastate.error;
+        formulastate.error.reset();
+        formulastate.raisedError = false;
+        storage->reportError(em, "Formula Evaluator Error");
+        std::cout << "ERROR: " << em << std::endl;
+    }
+
+    // Since I'm (right now) the only vector valued modulator just do a little
+    // chute and ladder dance here on the output and return
+    auto magnf = limit_range(lfo->magnitude.get_extended(localcopy[magn].f), -3.f, 3.f);
+    auto uni = lfo->unipolar.val.b;
+
+    for (auto i = 0; i < formulastate.activeoutputs; ++i)
+    {
+        if (uni)
+        {
+            tmpout[i] = 0.5f + 0.5f * tmpout[i];
+        }
+
+        output_multi[i] = useenvval * magnf * tmpout[i];
+    }
+}
+
 void LFOModulationSource::completedModulation()
 {
     if (lfo->shape.val.i == lt_formula)
@@ -63,6 +63,13 @@ class LFOModulationSource : public ModulationSource
     virtual void retriggerEnvelopeFrom(float);
     virtual void completedModulation();
 
+    /*
+     * While a batch is set, a formula LFO's process_block adds its evaluation to it and stops
+     * short, and once the batch has been evaluated completeFormulaBlock finishes the block.
+     */
+    Surge::Formula::VoiceBatch *formulaBatch{nullptr};
+    void completeFormulaBlock();
+
     enum EnvelopeRetriggerMode
     {
         FROM_ZERO,
@@ -129,6 +136,11 @@ class LFOModulationSource : public ModulationSource
     bool phaseInitialized;
     void initPhaseFromStartPhase();
     void msegEnvelopePhaseAdjustment();
+    void completeFormulaBlock(float *tmpout, float useenvval);
+
+    float formulaOutput[Surge::Formula::max_formula_outputs];
+    float formulaEnvVal{0.f};
+    bool formulaPending{false};
 
     float phase, target, noise, noised1, env_phase, priorPhase;
     int unwrappedphase_intpart;
@@ -21,6 +21,7 @@
  */
 
 #include "MSEGModulationHelper.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include "DebugHelpers.h"
@@ -32,6 +33,131 @@ namespace Surge
 namespace MSEG
 {
 
+namespace
+{
+void compileCurve(float cpv, MSEGStorage::segmentCurve &c)
+{
+    c.cpv = cpv;
+
+    /*
+     * The control point exponent of linear and s-curve segments.
+     *
+     * Alright so we have a functional form (e^ax-1)/(e^a-1) = y;
+     * We also know that since we have vertical only motion here x = 1/2 and y is where we want
+     * to hit ( specifically since we are generating a 0,1 line and cpv is -1,1 then
+     * here we get y = 0.5 * cpv + 0.5.
+     *
+     * Fine so lets show our work. I'm going to use X and V for now
+     *
+     * (e^aX-1)/(e^a-1) = V  @ x=1/2
+     * introduce Q = e^a/2
+     * (Q - 1) / ( Q^2 - 1 ) = V
+     * Q - 1 = V Q^2 - V
+     * V Q^2 - Q + ( 1-V ) = 0
+     *
+     * OK cool we know how to solve that (for V != 0)
+     *
+     * Q = (1 +/- sqrt( 1 - 4 * V * (1-V) )) / 2 V
+     *
+     * and since Q = e^a/2
+     *
+     * a = 2 * log(Q)
+     *
+     */
+    float V = 0.5 * cpv + 0.5;
+    float amul = 1;
+
+    if (V < 0.5)
+    {
+        amul = -1;
+        V = 1 - V;
+    }
+
+    float disc = (1 - 4 * V * (1 - V));
+    c.a = 0;
+
+    if (fabs(V) > 1e-3)
+    {
+        float Q = limit_range((1 - sqrt(disc)) / (2 * V), 0.00001f, 1000000.f);
+        c.a = amul * 2 * log(Q);
+    }
+
+    c.expAm1 = exp(c.a) - 1;
+
+    // The sine, sawtooth, triangle and square segments
+    {
+        float pct = (cpv + 1) * 0.5;
+        float as = 5.0;
+        float scaledpct = (exp(as * pct) - 1) / (exp(as) - 1);
+        c.oscSteps = (int)(scaledpct * 100);
+    }
+
+    // and the stairs, which work it out in double
+    {
+        auto pct = (cpv + 1) * 0.5;
+        auto as = 5.0;
+        auto scaledpct = (exp(as * pct) - 1) / (exp(as) - 1);
+        c.stairSteps = (int)(scaledpct * 100) + 2;
+    }
+}
+
+// The cached curve, unless the control point moved since rebuildCache, in which case into scratch
+const MSEGStorage::segmentCurve &curveFor(const MSEGStorage *ms, int idx,
+                                          MSEGStorage::segmentCurve &scratch)
+{
+    const auto &c = ms->segmentCurves[idx];
+
+    if (c.cpv == ms->segments[idx].cpv)
+    {
+        return c;
+    }
+
+    compileCurve(ms->segments[idx].cpv, scratch);
+    return scratch;
+}
+
+/*
+ * The first segment with start <= t < end, or start <= t <= end if includeEnd, or -1 if none.
+ *
+ * When rebuildCache found the segments end to end in time order, the starts and ends are both
+ * sorted and there is no need to look at every segment. The first segment ending at or after t
+ * is the only one which can contain it inclusively, and the last segment starting at or before
+ * t is the only one which can contain it exclusively, since any earlier one ends where the next
+ * starts.
+ */
+int segmentAt(const MSEGStorage *ms, double t, bool includeEnd)
+{
+    auto n = ms->n_activeSegments;
+
+    if (ms->orderedSegments == n)
+    {
+        if (includeEnd)
+        {
+            auto b = ms->segmentEnd.begin();
+            auto idx = (int)(std::lower_bound(b, b + n, t) - b);
+
+            return (idx < n && ms->segmentStart[idx] <= t) ? idx : -1;
+        }
+
+        auto b = ms->segmentStart.begin();
+        auto idx = (int)(std::upper_bound(b, b + n, t) - b) - 1;
+
+        return (idx >= 0 && t < ms->segmentEnd[idx]) ? idx : -1;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (t >= ms->segmentStart[i] &&
+            (t < ms->segmentEnd[i] || (includeEnd && t == ms->segmentEnd[i])))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+} // namespace
+
 void rebuildCache(MSEGStorage *ms)
 {
     forceToConstrainedNormalForm(ms);
@@ -98,8 +224,20 @@ void rebuildCache(MSEGStorage *ms)
     for (int i = 0; i < ms->n_activeSegments; ++i)
     {
         constrainControlPointAt(ms, i);
+        compileCurve(ms->segments[i].cpv, ms->segmentCurves[i]);
+    }
+
+    // An LFO whose durations don't quite add up to one has its last segment end moved
+    bool ordered = true;
+
+    for (int i = 0; i < ms->n_activeSegments && ordered; ++i)
+    {
+        ordered = ms->segmentStart[i] <= ms->segmentEnd[i] &&
+                  (i == 0 || ms->segmentStart[i] == ms->segmentEnd[i - 1]);
     }
 
+    ms->orderedSegments = ordered ? ms->n_activeSegments : -1;
+
     ms->durationToLoopEnd = ms->totalDuration;
     ms->durationLoopStartToLoopEnd = ms->totalDuration;
 
@@ -182,15 +320,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
             double adjustedPhase = up - es->releaseStartPhase + ms->segmentEnd[ms->loop_end];
 
             // so now find the index
-            idx = -1;
-
-            for (int ai = 0; ai < ms->n_activeSegments && idx < 0; ai++)
-            {
-                if (ms->segmentStart[ai] <= adjustedPhase && ms->segmentEnd[ai] > adjustedPhase)
-                {
-                    idx = ai;
-                }
-            }
+            idx = segmentAt(ms, adjustedPhase, false);
 
             if (idx < 0)
             {
@@ -209,7 +339,9 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
 
     // std::cout << up << " " << idx << std::endl;
 
-    auto r = ms->segments[idx];
+    const auto &r = ms->segments[idx];
+    MSEGStorage::segmentCurve scratchCurve;
+    const auto &curve = curveFor(ms, idx, scratchCurve);
     bool segInit = false;
 
     if (idx != es->lastEval || es->has_triggered)
@@ -324,57 +456,15 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
             }
         }
 
-        // So we want to handle control points
-        auto cpd = r.cpv;
-
-        /*
-         * Alright so we have a functional form (e^ax-1)/(e^a-1) = y;
-         * We also know that since we have vertical only motion here x = 1/2 and y is where we want
-         * to hit ( specifically since we are generating a 0,1 line and cpv is -1,1 then
-         * here we get y = 0.5 * cpv + 0.5.
-         *
-         * Fine so lets show our work. I'm going to use X and V for now
-         *
-         * (e^aX-1)/(e^a-1) = V  @ x=1/2
-         * introduce Q = e^a/2
-         * (Q - 1) / ( Q^2 - 1 ) = V
-         * Q - 1 = V Q^2 - V
-         * V Q^2 - Q + ( 1-V ) = 0
-         *
-         * OK cool we know how to solve that (for V != 0)
-         *
-         * Q = (1 +/- sqrt( 1 - 4 * V * (1-V) )) / 2 V
-         *
-         * and since Q = e^a/2
-         *
-         * a = 2 * log(Q)
-         *
-         */
-
-        float V = 0.5 * r.cpv + 0.5;
-        float amul = 1;
-
-        if (V < 0.5)
-        {
-            amul = -1;
-            V = 1 - V;
-        }
-
-        float disc = (1 - 4 * V * (1 - V));
-        float a = 0;
-
-        if (fabs(V) > 1e-3)
-        {
-            float Q = limit_range((1 - sqrt(disc)) / (2 * V), 0.00001f, 1000000.f);
-            a = amul * 2 * log(Q);
-        }
+        // So we want to handle control points, with the exponent worked out in compileCurve
+        float a = curve.a;
 
         // OK so frac is the 0,1 line point
         auto cpline = frac;
 
         if (fabs(a) > 1e-3)
         {
-            cpline = (exp(a * frac) - 1) / (exp(a) - 1);
+            cpline = (exp(a * frac) - 1) / curve.expAm1;
         }
 
         if (r.type == MSEGStorage::segment::LINEAR)
@@ -504,10 +594,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
     case MSEGStorage::segment::TRIANGLE:
     case MSEGStorage::segment::SQUARE:
     {
-        float pct = (r.cpv + 1) * 0.5;
-        float as = 5.0;
-        float scaledpct = (exp(as * pct) - 1) / (exp(as) - 1);
-        int steps = (int)(scaledpct * 100);
+        int steps = curve.oscSteps;
         auto frac = timeAlongSegment / r.duration;
         float kernel = 0;
 
@@ -577,10 +664,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
 
     case MSEGStorage::segment::STAIRS:
     {
-        auto pct = (r.cpv + 1) * 0.5;
-        auto as = 5.0;
-        auto scaledpct = (exp(as * pct) - 1) / (exp(as) - 1);
-        auto steps = (int)(scaledpct * 100) + 2;
+        auto steps = curve.stairSteps;
         auto frac = (float)((int)(steps * timeAlongSegment / r.duration)) / (steps - 1);
 
         if (df < 0)
@@ -598,10 +682,7 @@ float valueAt(int ip, float fup, float df, MSEGStorage *ms, EvaluatorState *es,
     }
     case MSEGStorage::segment::SMOOTH_STAIRS:
     {
-        auto pct = (r.cpv + 1) * 0.5;
-        auto as = 5.0;
-        auto scaledpct = (exp(as * pct) - 1) / (exp(as) - 1);
-        auto steps = (int)(scaledpct * 100) + 2;
+        auto steps = curve.stairSteps;
         auto frac = timeAlongSegment / r.duration;
 
         auto c = df < 0.f ? 1.0 + df * 0.7 : 1.0 + df * 3.0;
@@ -749,17 +830,11 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
             }
         }
 
-        int idx = -1;
+        int idx = segmentAt(ms, t, false);
 
-        for (int i = 0; i < ms->n_activeSegments; ++i)
+        if (idx >= 0)
         {
-            if (t >= ms->segmentStart[i] && t < ms->segmentEnd[i])
-            {
-                idx = i;
-                amountAlongSegment = t - ms->segmentStart[i];
-
-                break;
-            }
+            amountAlongSegment = t - ms->segmentStart[idx];
         }
 
         return idx;
@@ -773,13 +848,14 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
         // So are we before the first loop end point
         if (t <= ms->durationToLoopEnd)
         {
-            for (int i = 0; i < ms->n_activeSegments; ++i)
-                if (t >= ms->segmentStart[i] && t <= ms->segmentEnd[i])
-                {
-                    amountAlongSegment = t - ms->segmentStart[i];
+            auto i = segmentAt(ms, t, true);
 
-                    return i;
-                }
+            if (i >= 0)
+            {
+                amountAlongSegment = t - ms->segmentStart[i];
+
+                return i;
+            }
         }
         else if (ms->loop_start > ms->loop_end && ms->loop_start >= 0 && ms->loop_end >= 0)
         {
@@ -807,13 +883,14 @@ int timeToSegment(MSEGStorage *ms, double t, bool ignoreLoops, float &amountAlon
             // and we need to offset it by the starting point
             nt += ms->segmentStart[ls];
 
-            for (int i = 0; i < ms->n_activeSegments; ++i)
-                if (nt >= ms->segmentStart[i] && nt <= ms->segmentEnd[i])
-                {
-                    amountAlongSegment = nt - ms->segmentStart[i];
+            auto i = segmentAt(ms, nt, true);
 
-                    return i;
-                }
+            if (i >= 0)
+            {
+                amountAlongSegment = nt - ms->segmentStart[i];
+
+                return i;
+            }
         }
 
         return 0;
@@ -85,7 +85,7 @@ void SampleAndHoldOscillator::init(float pitch, bool is_display, bool nonzero_in
     {
         std::uniform_real_distribution<float> distro(-1.f, 1.f);
 #ifdef STORAGE_USES_INDEPENDENT_RNG
-        urng = std::bind(distro, storage->rngGen.g);
+        urng = std::bind(distro, storage->currentRNG().g);
 #else
         std::minstd_rand gen(std::rand());
         urng = std::bind(distro, gen);
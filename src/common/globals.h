@@ -52,6 +52,9 @@ const int NAMECHARS = 64;
 const int BLOCK_SIZE = SURGE_COMPILE_BLOCK_SIZE;
 const int OSC_OVERSAMPLING = 2;
 const int BLOCK_SIZE_OS = OSC_OVERSAMPLING * BLOCK_SIZE;
+// Host buffers are walked with BLOCK_SIZE - 1 as a mask, and the SIMD paths work in quads
+static_assert(BLOCK_SIZE >= 8 && (BLOCK_SIZE & (BLOCK_SIZE - 1)) == 0,
+              "SURGE_COMPILE_BLOCK_SIZE must be a power of two, and at least 8");
 const int BLOCK_SIZE_QUAD = BLOCK_SIZE >> 2;
 const int BLOCK_SIZE_OS_QUAD = BLOCK_SIZE_OS >> 2;
 const int OB_LENGTH = BLOCK_SIZE_OS << 1;
@@ -0,0 +1,61 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounting.h"
+#include "SurgeMemoryPools.h"
+
+namespace
+{
+thread_local int audioThreadAllocations{0};
+std::atomic<int> allAudioThreadAllocations{0};
+} // namespace
+
+namespace Surge
+{
+namespace Test
+{
+int audioThreadAllocationsOnThisThread() { return audioThreadAllocations; }
+int audioThreadAllocationsOnAnyThread() { return allAudioThreadAllocations.load(); }
+} // namespace Test
+} // namespace Surge
+
+void *operator new(std::size_t size)
+{
+    if (Surge::Memory::AudioThreadScope::active())
+    {
+        audioThreadAllocations++;
+        allAudioThreadAllocations++;
+    }
+
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
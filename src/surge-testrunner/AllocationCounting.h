@@ -0,0 +1,43 @@
+/*
+ * Surge XT - a free and open source hybrid synthesizer,
+ * built by Surge Synth Team
+ *
+ * Learn more at https://surge-synthesizer.github.io/
+ *
+ * Copyright 2018-2024, various authors, as described in the GitHub
+ * transaction log.
+ *
+ * Surge XT is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * Surge was a commercial product from 2004-2018, copyright and ownership
+ * held by Claes Johanson at Vember Audio during that period.
+ * Claes made Surge open source in September 2018.
+ *
+ * All source for Surge XT is available at
+ * https://github.com/surge-synthesizer/surge
+ */
+#ifndef SURGE_SRC_SURGE_TESTRUNNER_ALLOCATIONCOUNTING_H
+#define SURGE_SRC_SURGE_TESTRUNNER_ALLOCATIONCOUNTING_H
+
+namespace Surge
+{
+namespace Test
+{
+
+/*
+ * The test runner replaces the global operator new, in AllocationCounting.cpp and nowhere
+ * else, to count the heap allocations each thread makes inside a
+ * Surge::Memory::AudioThreadScope. SurgeSynthesizer::process opens one, and a test can open
+ * its own around anything else it wants to hold to the same rule.
+ */
+int audioThreadAllocationsOnThisThread();
+// Including the render pool workers, which open the scope for their tasks
+int audioThreadAllocationsOnAnyThread();
+
+} // namespace Test
+} // namespace Surge
+
+#endif // SURGE_SRC_SURGE_TESTRUNNER_ALLOCATIONCOUNTING_H
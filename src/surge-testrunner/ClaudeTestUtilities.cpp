@@ -14,10 +14,12 @@
  */
 
 #include "ClaudeTestUtilities.h"
+#include <algorithm>
 #include <sstream>
 #include <chrono>
 #include <iostream>
 #include <cmath>
+#include <thread>
 
 namespace Surge
 {
@@ -218,6 +220,193 @@ bool TestUtils::isValidNormalizedValue(float value)
     return value >= 0.0f && value <= 1.0f && !std::isnan(value) && !std::isinf(value);
 }
 
+LocalHTTPServer::LocalHTTPServer(const std::string& responseBody, int responseDelayMs)
+    : body(responseBody), delayMs(responseDelayMs)
+{
+}
+
+LocalHTTPServer::~LocalHTTPServer()
+{
+    stop();
+}
+
+bool LocalHTTPServer::start()
+{
+    // Port 0 lets the OS pick a free port
+    if (!listener.createListener(0, "127.0.0.1"))
+        return false;
+
+    running = true;
+    serverThread = std::thread([this]() { serve(); });
+    return true;
+}
+
+void LocalHTTPServer::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    // Closing the listener unblocks waitForNextConnection
+    listener.close();
+    if (serverThread.joinable())
+        serverThread.join();
+
+    while (activeConnections > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+std::string LocalHTTPServer::getURL() const
+{
+    return "http://127.0.0.1:" + std::to_string(listener.getBoundPort()) + "/v1/messages";
+}
+
+void LocalHTTPServer::serve()
+{
+    while (running)
+    {
+        std::unique_ptr<juce::StreamingSocket> connection(listener.waitForNextConnection());
+        if (!connection)
+            break;
+
+        // Each connection gets its own thread so delayed responses overlap
+        activeConnections++;
+        std::thread([this, c = std::shared_ptr<juce::StreamingSocket>(std::move(connection))]() {
+            handle(*c);
+            activeConnections--;
+        }).detach();
+    }
+}
+
+void LocalHTTPServer::handle(juce::StreamingSocket& connection)
+{
+    // Read the headers, then as much body as Content-Length says
+    std::string request;
+    char buffer[4096];
+    size_t headerEnd = std::string::npos;
+    size_t contentLength = 0;
+
+    while (true)
+    {
+        if (connection.waitUntilReady(true, 5000) != 1)
+            return;
+
+        int n = connection.read(buffer, sizeof(buffer), false);
+        if (n <= 0)
+            return;
+        request.append(buffer, n);
+
+        if (headerEnd == std::string::npos)
+        {
+            headerEnd = request.find("\r\n\r\n");
+            if (headerEnd != std::string::npos)
+            {
+                std::string headers = request.substr(0, headerEnd);
+                std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+                auto cl = headers.find("content-length:");
+                if (cl != std::string::npos)
+                    contentLength = std::stoul(headers.substr(cl + 15));
+            }
+        }
+
+        if (headerEnd != std::string::npos && request.size() >= headerEnd + 4 + contentLength)
+            break;
+    }
+
+    requestCount++;
+
+    if (delayMs > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+    if (!streamChunks.empty())
+    {
+        std::string header = "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: text/event-stream\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Connection: close\r\n\r\n";
+        connection.write(header.data(), (int)header.size());
+
+        for (const auto& chunk : streamChunks)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(chunkDelayMs));
+            connection.write(chunk.data(), (int)chunk.size());
+        }
+
+        connection.close();
+        return;
+    }
+
+    std::ostringstream oss;
+    oss << "HTTP/1.1 200 OK\r\n"
+        << "Content-Type: application/json\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+
+    auto response = oss.str();
+    connection.write(response.data(), (int)response.size());
+    connection.close();
+}
+
+void LocalHTTPServer::setStreamedResponse(const std::vector<std::string>& chunks, int delay)
+{
+    streamChunks = chunks;
+    chunkDelayMs = delay;
+}
+
+static std::string escapeJSON(const std::string& text)
+{
+    std::string escaped;
+    for (auto c : text)
+    {
+        switch (c)
+        {
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string LocalHTTPServer::makeMessagesResponse(const std::string& text)
+{
+    return "{\"id\":\"msg_test\",\"type\":\"message\",\"role\":\"assistant\","
+           "\"content\":[{\"type\":\"text\",\"text\":\"" +
+           escapeJSON(text) + "\"}]}";
+}
+
+std::vector<std::string> LocalHTTPServer::makeMessagesStream(const std::vector<std::string>& textDeltas)
+{
+    std::vector<std::string> events;
+    events.push_back("event: message_start\n"
+                     "data: {\"type\":\"message_start\",\"message\":{\"id\":\"msg_test\"}}\n\n"
+                     "event: content_block_start\n"
+                     "data: {\"type\":\"content_block_start\",\"index\":0,"
+                     "\"content_block\":{\"type\":\"text\",\"text\":\"\"}}\n\n");
+
+    for (const auto& delta : textDeltas)
+    {
+        events.push_back("event: content_block_delta\n"
+                         "data: {\"type\":\"content_block_delta\",\"index\":0,"
+                         "\"delta\":{\"type\":\"text_delta\",\"text\":\"" +
+                         escapeJSON(delta) + "\"}}\n\n");
+    }
+
+    events.push_back("event: content_block_stop\n"
+                     "data: {\"type\":\"content_block_stop\",\"index\":0}\n\n"
+                     "event: message_stop\n"
+                     "data: {\"type\":\"message_stop\"}\n\n");
+    return events;
+}
+
 } // namespace Claude
 } // namespace Test
 } // namespace Surge
\ No newline at end of file
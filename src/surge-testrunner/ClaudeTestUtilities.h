@@ -19,7 +19,9 @@
 #include "ClaudeAPIClient.h"
 #include "ClaudeParameterMapper.h"
 #include "SurgeSynthesizer.h"
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Surge
@@ -86,6 +88,56 @@ class TestUtils
     static bool isValidNormalizedValue(float value);
 };
 
+/**
+ * A minimal HTTP server on the loopback interface which answers every
+ * request with the same body, for exercising APIClient without the network.
+ * An optional delay holds each response back so concurrent requests overlap.
+ */
+class LocalHTTPServer
+{
+  public:
+    explicit LocalHTTPServer(const std::string& responseBody, int responseDelayMs = 0);
+    ~LocalHTTPServer();
+
+    bool start();
+    void stop();
+
+    std::string getURL() const;
+    int getRequestCount() const { return requestCount; }
+
+    /**
+     * Switches the server to a text/event-stream reply written as the given
+     * chunks, with a pause before each one, instead of the fixed body
+     */
+    void setStreamedResponse(const std::vector<std::string>& chunks, int chunkDelayMs);
+
+    /**
+     * Wraps text the way the messages API does, as the first text block of
+     * the content array
+     */
+    static std::string makeMessagesResponse(const std::string& text);
+
+    /**
+     * The server-sent events of a streamed messages reply, one
+     * content_block_delta per text delta
+     */
+    static std::vector<std::string> makeMessagesStream(const std::vector<std::string>& textDeltas);
+
+  private:
+    std::string body;
+    int delayMs;
+    std::vector<std::string> streamChunks;
+    int chunkDelayMs{0};
+    juce::StreamingSocket listener;
+    std::thread serverThread;
+    std::atomic<bool> running{false};
+    std::atomic<int> requestCount{0};
+    std::atomic<int> activeConnections{0};
+
+    void serve();
+    void handle(juce::StreamingSocket& connection);
+};
+
 } // namespace Claude
 } // namespace Test
 } // namespace Surge
@@ -26,6 +26,7 @@
 #include <sstream>
 #include <chrono>
 #include <deque>
+#include <vector>
 
 namespace Surge
 {
@@ -534,6 +535,104 @@ void filterAnalyzer(int ft, int sft, std::ostream &os)
     middleCSawIntoFilterVsReso(ft, sft, os);
 }
 
+void voiceRenderBenchmark(int maxThreads)
+{
+    /*
+     * Plays a 64 note chord into both scenes, so up to 128 voices, at each render
+     * thread count from 1 up to maxThreads, and reports the time per block and whether
+     * the output matched the single threaded render bit for bit.
+     *
+     * surge-testrunner --non-test --voice-render-benchmark 4
+     */
+    static constexpr int warmupBlocks = 100, timedBlocks = 4000;
+
+    auto render = [](int threads, std::vector<float> &out) {
+        auto surge = Surge::Headless::createSurge(48000);
+        surge->storage.rngGen.g.seed(2112);
+        surge->storage.getPatch().scenemode.val.i = sm_dual;
+        surge->storage.getPatch().polylimit.val.i = MAX_VOICES;
+        surge->storage.setRenderThreadCount(threads);
+
+        for (int i = 0; i < 10; ++i)
+            surge->process();
+
+        for (int k = 0; k < MAX_VOICES; ++k)
+            surge->playNote(0, 30 + k, 100, 0);
+
+        for (int i = 0; i < warmupBlocks; ++i)
+            surge->process();
+
+        auto voices = surge->voices[0].size() + surge->voices[1].size();
+
+        out.clear();
+        out.reserve(timedBlocks * BLOCK_SIZE * 2);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < timedBlocks; ++i)
+        {
+            surge->process();
+            out.insert(out.end(), surge->output[0], surge->output[0] + BLOCK_SIZE);
+            out.insert(out.end(), surge->output[1], surge->output[1] + BLOCK_SIZE);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "threads=" << surge->storage.getRenderThreadCount() << " voices=" << voices
+                  << " us/block=" << 1.0 * us / timedBlocks
+                  << " realtime%=" << 100.0 * us / (1e6 * timedBlocks * BLOCK_SIZE / 48000.0);
+    };
+
+    std::vector<float> reference, out;
+    render(1, reference);
+    std::cout << std::endl;
+
+    for (int threads = 2; threads <= maxThreads; ++threads)
+    {
+        render(threads, out);
+        std::cout << " identical=" << (out == reference ? "yes" : "NO") << std::endl;
+    }
+}
+
+void blockSizeBenchmark(int seconds)
+{
+    /*
+     * The engine block size is fixed when it is built (SURGE_COMPILE_BLOCK_SIZE), so
+     * this times one build. The surge-block-size-benchmark target builds a runner at
+     * every size, runs this in each and tabulates the lines, so keep the format stable.
+     * It renders the same audio with no voices, which is mostly the per block control
+     * and effect work that a bigger block amortizes, and with a 16 voice chord on top.
+     *
+     * surge-testrunner --non-test --block-size-benchmark 20
+     */
+    static constexpr int sampleRate = 48000;
+    int blocks = seconds * sampleRate / BLOCK_SIZE;
+
+    auto render = [blocks](int notes) {
+        auto surge = Surge::Headless::createSurge(sampleRate);
+        surge->storage.rngGen.g.seed(2112);
+
+        for (int i = 0; i < 10; ++i)
+            surge->process();
+
+        for (int k = 0; k < notes; ++k)
+            surge->playNote(0, 40 + k * 3, 100, 0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < blocks; ++i)
+            surge->process();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        return (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    };
+
+    auto idle = render(0);
+    auto chord = render(16);
+
+    std::cout << "BLOCK_SIZE=" << BLOCK_SIZE << " audio=" << seconds << "s"
+              << " idle us/block=" << idle / blocks << " idle realtime%=" << idle / seconds / 1e4
+              << " chord us/block=" << chord / blocks
+              << " chord realtime%=" << chord / seconds / 1e4 << std::endl;
+}
+
 [[noreturn]] void performancePlay(const std::string &patchName, int mode)
 {
     auto surge = Surge::Headless::createSurge(48000);
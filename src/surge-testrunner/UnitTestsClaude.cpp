@@ -22,11 +22,20 @@
 
 #include "ClaudeAPIClient.h"
 #include "ClaudeParameterMapper.h"
+#include "ClaudeStreaming.h"
+#include "ClaudeTestUtilities.h"
 #include "PatchVectorDB.h"
 #include "PatchParameterExtractor.h"
 #include "SurgeSynthesizer.h"
 #include "SurgeStorage.h"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
 using namespace Surge::Test;
 
 // Test Claude API Client functionality
@@ -64,6 +73,517 @@ TEST_CASE("Claude API Client", "[claude]")
 }
 
 // Test Claude Parameter Mapper functionality
+TEST_CASE("Claude Response Cache", "[claude][cache]")
+{
+    using Surge::Test::Claude::LocalHTTPServer;
+
+    auto waitFor = [](const std::atomic<int> &counter, int target) {
+        for (int i = 0; i < 1000 && counter < target; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return counter >= target;
+    };
+
+    auto cacheDir = (fs::temp_directory_path() / "surge-claude-cache-test").u8string();
+
+    auto makeClient = [&](SurgeStorage *storage, const std::string &url) {
+        auto client = std::make_unique<Surge::Claude::APIClient>(storage);
+        client->setAPIKey("sk-ant-test-key-12345");
+        client->setEndpoint(url);
+        client->getResponseCache().setDirectory(cacheDir);
+        client->setCallbackDispatcher([](std::function<void()> f) { f(); });
+        return client;
+    };
+
+    SECTION("Identical Requests Coalesce And Then Hit The Cache")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+
+        LocalHTTPServer server(
+            LocalHTTPServer::makeMessagesResponse("PARAMETERS:\n- filter1_cutoff: 0.25\n"), 300);
+        REQUIRE(server.start());
+
+        auto client = makeClient(&surge->storage, server.getURL());
+        client->getResponseCache().clear(true);
+        client->getResponseCache().resetStats();
+
+        std::atomic<int> done{0}, succeeded{0};
+        auto callback = [&](const Surge::Claude::ClaudeResponse &r) {
+            if (r.success && r.modifications.size() == 1 &&
+                r.modifications[0].parameterName == "filter1_cutoff")
+                succeeded++;
+            done++;
+        };
+
+        // Three identical requests while the first is still waiting on the server
+        for (int i = 0; i < 3; ++i)
+            client->generatePatch("a warm evolving pad", callback);
+
+        REQUIRE(waitFor(done, 3));
+        REQUIRE(succeeded == 3);
+        REQUIRE(server.getRequestCount() == 1);
+
+        auto stats = client->getCacheStats();
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.coalesced == 2);
+
+        // Same request again comes from memory
+        client->generatePatch("a warm evolving pad", callback);
+        REQUIRE(waitFor(done, 4));
+        REQUIRE(server.getRequestCount() == 1);
+        REQUIRE(client->getCacheStats().memoryHits == 1);
+
+        // A new client only has the disk tier to go on
+        auto second = makeClient(&surge->storage, server.getURL());
+        second->generatePatch("a warm evolving pad", callback);
+        REQUIRE(waitFor(done, 5));
+        REQUIRE(server.getRequestCount() == 1);
+        REQUIRE(second->getCacheStats().diskHits == 1);
+
+        // A different prompt or model is a different key
+        client->generatePatch("a plucky bass", callback);
+        REQUIRE(waitFor(done, 6));
+        REQUIRE(server.getRequestCount() == 2);
+
+        client->setModel("another-model");
+        client->generatePatch("a plucky bass", callback);
+        REQUIRE(waitFor(done, 7));
+        REQUIRE(server.getRequestCount() == 3);
+        REQUIRE(succeeded == 7);
+
+        client->getResponseCache().clear(true);
+        server.stop();
+    }
+
+    SECTION("Cache Hits Honour Cancellation And May Issue Requests")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+
+        LocalHTTPServer server(
+            LocalHTTPServer::makeMessagesResponse("PARAMETERS:\n- volume: 0.5\n"));
+        REQUIRE(server.start());
+
+        auto client = makeClient(&surge->storage, server.getURL());
+        client->getResponseCache().clear(true);
+
+        std::atomic<int> done{0};
+        client->generatePatch("a cached pad",
+                              [&](const Surge::Claude::ClaudeResponse &) { done++; });
+        REQUIRE(waitFor(done, 1));
+
+        // With a synchronous dispatcher this callback runs inside generatePatch
+        std::atomic<int> nested{0};
+        client->generatePatch("a cached pad", [&](const Surge::Claude::ClaudeResponse &r) {
+            REQUIRE(r.success);
+            client->generatePatch("a cached pad",
+                                  [&](const Surge::Claude::ClaudeResponse &) { nested++; });
+        });
+        REQUIRE(nested == 1);
+
+        Surge::Claude::RequestOptions options;
+        options.token.cancel();
+        std::string error;
+        client->generatePatch(
+            "a cached pad", [&](const Surge::Claude::ClaudeResponse &r) { error = r.errorMessage; },
+            nullptr, options);
+        REQUIRE(error == "Request cancelled");
+        REQUIRE(server.getRequestCount() == 1);
+
+        client->getResponseCache().clear(true);
+        server.stop();
+    }
+
+    SECTION("Keys Separate Model, Prompt And Context")
+    {
+        using Surge::Claude::ResponseCache;
+
+        auto k = ResponseCache::makeKey("m", "prompt", "context");
+        REQUIRE(k == ResponseCache::makeKey("m", "prompt", "context"));
+        REQUIRE(k != ResponseCache::makeKey("n", "prompt", "context"));
+        REQUIRE(k != ResponseCache::makeKey("m", "promptc", "ontext"));
+        REQUIRE(k != ResponseCache::makeKey("m", "prompt", ""));
+    }
+}
+
+TEST_CASE("Claude Streaming Responses", "[claude][streaming]")
+{
+    SECTION("Events And Modifications Parse Across Chunk Boundaries")
+    {
+        using namespace Surge::Claude;
+        using Surge::Test::Claude::LocalHTTPServer;
+
+        auto events = LocalHTTPServer::makeMessagesStream(
+            {"Sure.\nPARAMETERS:\n- filter1_cut", "off: 0.5 (dark)\n- amp_att",
+             "ack: 0.1\n- osc1_type: 2"});
+        std::string wire;
+        for (const auto &e : events)
+            wire += e;
+
+        ModificationStreamParser mods;
+        std::vector<size_t> batchSizes;
+        SSEParser sse([&](const std::string &event, const std::string &data) {
+            std::string text;
+            if (event == "content_block_delta" && extractJSONStringField(data, "text", text))
+            {
+                auto m = mods.feed(text);
+                if (!m.empty())
+                    batchSizes.push_back(m.size());
+            }
+        });
+
+        // Feed a few bytes at a time, so lines and events are split everywhere
+        for (size_t i = 0; i < wire.size(); i += 5)
+            sse.feed(wire.data() + i, std::min<size_t>(5, wire.size() - i));
+        sse.finish();
+
+        auto tail = mods.finish();
+
+        // filter1_cutoff completes in the second delta, amp_attack in the third
+        REQUIRE(batchSizes == std::vector<size_t>{1, 1});
+        REQUIRE(tail.size() == 1);
+        REQUIRE(tail[0].parameterName == "osc1_type");
+
+        // The streamed text parses to the same modifications as the batch parser
+        auto surge = Surge::Headless::createSurge(44100);
+        APIClient client(&surge->storage);
+        auto batch = client.extractModifications(mods.getText());
+        REQUIRE(batch.size() == mods.getModificationCount());
+        REQUIRE(batch[0].description == "dark");
+    }
+
+    SECTION("Undashed Lines Only Count Without Dashed Ones")
+    {
+        Surge::Claude::ModificationStreamParser mods;
+        REQUIRE(mods.feed("PARAMETERS:\nfilter1_cutoff: 0.3\nvolume: 0.8\n").empty());
+        REQUIRE(mods.finish().size() == 2);
+    }
+
+    SECTION("Time To First Modification Against A Local SSE Server")
+    {
+        using Surge::Test::Claude::LocalHTTPServer;
+
+        auto surge = Surge::Headless::createSurge(44100);
+
+        LocalHTTPServer server("");
+        server.setStreamedResponse(
+            LocalHTTPServer::makeMessagesStream({"Here is a warm pad.\n\nPARAMETERS:\n",
+                                                 "- filter1_cutoff: 0.3\n", "- amp_attack: 0.7\n",
+                                                 "- lfo1_rate: 0.15\n", "\nThe slow ", "attack ",
+                                                 "and low ", "cutoff ", "keep it ", "soft."}),
+            100);
+        REQUIRE(server.start());
+
+        Surge::Claude::APIClient client(&surge->storage);
+        client.setAPIKey("sk-ant-test-key-12345");
+        client.setEndpoint(server.getURL());
+        client.getResponseCache().setDirectory(
+            (fs::temp_directory_path() / "surge-claude-stream-test").u8string());
+        client.getResponseCache().clear(true);
+        client.setCallbackDispatcher([](std::function<void()> f) { f(); });
+
+        std::atomic<int> streamed{0};
+        std::atomic<bool> complete{false};
+        std::atomic<double> firstModification{-1.0}, total{-1.0};
+        Surge::Claude::ClaudeResponse finalResponse;
+
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [start]() {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        client.generatePatch(
+            "a warm pad",
+            [&](const Surge::Claude::ClaudeResponse &r) {
+                finalResponse = r;
+                total = elapsed();
+                complete = true;
+            },
+            [&](const std::vector<Surge::Claude::PatchModification> &mods) {
+                if (streamed == 0)
+                    firstModification = elapsed();
+                streamed += (int)mods.size();
+            });
+
+        for (int i = 0; i < 1000 && !complete; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        REQUIRE(complete);
+        REQUIRE(finalResponse.success);
+        REQUIRE(finalResponse.modifications.size() == 3);
+        REQUIRE(streamed == 3);
+
+        INFO("first modification " << firstModification.load() << "s of " << total.load() << "s");
+        REQUIRE(firstModification > 0.0);
+        REQUIRE(firstModification < total * 0.5);
+
+        client.getResponseCache().clear(true);
+        server.stop();
+    }
+
+    SECTION("Streamed Changes Are Applied Once")
+    {
+        using Surge::Claude::PatchModification;
+        using Surge::Test::Claude::LocalHTTPServer;
+
+        auto mod = [](const std::string &name, float v) {
+            PatchModification m;
+            m.parameterName = name;
+            m.value = v;
+            return m;
+        };
+
+        int applyCalls = 0;
+        size_t appliedMods = 0;
+        Surge::Claude::StreamedModificationApplier applier(
+            [&](const std::vector<PatchModification> &mods) {
+                applyCalls++;
+                appliedMods += mods.size();
+            });
+
+        // Without streaming the final response applies everything at once
+        std::vector<PatchModification> all{mod("filter1_cutoff", 0.3f), mod("amp_attack", 0.7f),
+                                           mod("lfo1_rate", 0.15f)};
+        REQUIRE(applier.finish(all) == 3);
+        REQUIRE(applyCalls == 1);
+
+        // A stream that stopped short leaves only its tail to the final response
+        applier.reset();
+        applyCalls = 0;
+        appliedMods = 0;
+        applier.streamed({all[0], all[1]});
+        REQUIRE(applier.finish(all) == 1);
+        REQUIRE(applyCalls == 2);
+        REQUIRE(appliedMods == 3);
+
+        // And a full stream against the local server leaves nothing for the final response
+        auto surge = Surge::Headless::createSurge(44100);
+
+        LocalHTTPServer server("");
+        server.setStreamedResponse(
+            LocalHTTPServer::makeMessagesStream({"A pad.\n\nPARAMETERS:\n",
+                                                 "- filter1_cutoff: 0.3\n", "- amp_attack: 0.7\n",
+                                                 "- lfo1_rate: 0.15\n", "\nSoft."}),
+            10);
+        REQUIRE(server.start());
+
+        Surge::Claude::APIClient client(&surge->storage);
+        client.setAPIKey("sk-ant-test-key-12345");
+        client.setEndpoint(server.getURL());
+        client.getResponseCache().setDirectory(
+            (fs::temp_directory_path() / "surge-claude-apply-once-test").u8string());
+        client.getResponseCache().clear(true);
+        client.setCallbackDispatcher([](std::function<void()> f) { f(); });
+
+        applier.reset();
+        applyCalls = 0;
+        appliedMods = 0;
+        int streamedBatches = 0;
+        size_t finalModifications = 0, finalApplied = 1000;
+        std::atomic<bool> complete{false};
+
+        client.generatePatch(
+            "a pad",
+            [&](const Surge::Claude::ClaudeResponse &r) {
+                finalModifications = r.modifications.size();
+                finalApplied = applier.finish(r.modifications);
+                complete = true;
+            },
+            [&](const std::vector<PatchModification> &mods) {
+                streamedBatches++;
+                applier.streamed(mods);
+            });
+
+        for (int i = 0; i < 1000 && !complete; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        REQUIRE(complete);
+        REQUIRE(finalModifications == 3);
+        REQUIRE(finalApplied == 0);
+        REQUIRE(appliedMods == 3);
+        REQUIRE(applyCalls == streamedBatches);
+
+        client.getResponseCache().clear(true);
+        server.stop();
+    }
+}
+
+TEST_CASE("Claude Request Executor", "[claude][executor]")
+{
+    using Surge::Claude::CancellationToken;
+    using Surge::Claude::RequestExecutor;
+    using Surge::Claude::RequestPriority;
+
+    SECTION("Priorities, Cancellation, Deadlines And Rejection")
+    {
+        RequestExecutor executor(1, 4);
+
+        std::mutex orderLock;
+        std::vector<std::string> order;
+        std::atomic<bool> release{false};
+
+        auto makeJob = [&](const std::string &name, RequestPriority p) {
+            RequestExecutor::Job job;
+            job.priority = p;
+            job.run = [&, name](const RequestExecutor::Context &) {
+                while (name == "blocker" && !release)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard<std::mutex> g(orderLock);
+                order.push_back(name);
+            };
+            job.onDropped = [&, name](RequestExecutor::Outcome o) {
+                std::lock_guard<std::mutex> g(orderLock);
+                order.push_back(name + (o == RequestExecutor::Outcome::Cancelled  ? ":cancelled"
+                                        : o == RequestExecutor::Outcome::Rejected ? ":rejected"
+                                                                                  : ":expired"));
+            };
+            return job;
+        };
+
+        // Occupy the only worker so everything else queues up
+        executor.submit(makeJob("blocker", RequestPriority::Normal));
+        while (executor.getMetrics().activeJobs == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        executor.submit(makeJob("background", RequestPriority::Background));
+        executor.submit(makeJob("normal", RequestPriority::Normal));
+        executor.submit(makeJob("interactive", RequestPriority::Interactive));
+
+        CancellationToken token;
+        auto cancelled = makeJob("cancelled", RequestPriority::Interactive);
+        cancelled.isCancelled = [token]() { return token.isCancelled(); };
+        executor.submit(cancelled);
+        token.cancel();
+
+        REQUIRE_FALSE(executor.submit(makeJob("overflow", RequestPriority::Interactive)));
+        REQUIRE(executor.getMetrics().queueDepth == 4);
+
+        release = true;
+        while (executor.getMetrics().queueDepth > 0 || executor.getMetrics().activeJobs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto late = makeJob("late", RequestPriority::Normal);
+        late.deadline = RequestExecutor::Clock::now() - std::chrono::milliseconds(1);
+        executor.submit(late);
+        executor.shutdown();
+
+        std::vector<std::string> expected = {"overflow:rejected", "blocker",          "interactive",
+                                             "cancelled:cancelled", "normal", "background",
+                                             "late:expired"};
+        REQUIRE(order == expected);
+
+        auto m = executor.getMetrics();
+        REQUIRE(m.submitted == 7);
+        REQUIRE(m.completed == 4);
+        REQUIRE(m.cancelled == 1);
+        REQUIRE(m.expired == 1);
+        REQUIRE(m.rejected == 1);
+        REQUIRE(m.peakQueueDepth == 4);
+
+        uint64_t histogramTotal = 0;
+        for (auto h : m.latencyHistogram)
+            histogramTotal += h;
+        REQUIRE(histogramTotal == m.completed);
+    }
+
+    SECTION("APIClient Requests Run On The Pool")
+    {
+        using Surge::Test::Claude::LocalHTTPServer;
+
+        auto surge = Surge::Headless::createSurge(44100);
+
+        LocalHTTPServer server(
+            LocalHTTPServer::makeMessagesResponse("PARAMETERS:\n- volume: 0.5\n"), 200);
+        REQUIRE(server.start());
+
+        Surge::Claude::APIClient client(&surge->storage);
+        client.setAPIKey("sk-ant-test-key-12345");
+        client.setEndpoint(server.getURL());
+        client.getResponseCache().setDirectory(
+            (fs::temp_directory_path() / "surge-claude-executor-test").u8string());
+        client.getResponseCache().clear(true);
+        client.setCallbackDispatcher([](std::function<void()> f) { f(); });
+        client.getExecutor().resetMetrics();
+
+        std::atomic<int> done{0}, succeeded{0}, cancelled{0};
+        auto callback = [&](const Surge::Claude::ClaudeResponse &r) {
+            if (r.success)
+                succeeded++;
+            else if (r.errorMessage == "Request cancelled")
+                cancelled++;
+            done++;
+        };
+
+        // Four distinct prompts on two workers: two run and two wait
+        for (int i = 0; i < 4; ++i)
+            client.generatePatch("patch number " + std::to_string(i), callback);
+
+        // A fifth is cancelled while it is still queued and never reaches the server
+        Surge::Claude::RequestOptions options;
+        options.priority = RequestPriority::Background;
+        client.generatePatch("never sent", callback, nullptr, options);
+        options.token.cancel();
+
+        for (int i = 0; i < 1000 && done < 5; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        REQUIRE(done == 5);
+        REQUIRE(succeeded == 4);
+        REQUIRE(cancelled == 1);
+        REQUIRE(server.getRequestCount() == 4);
+
+        auto m = client.getRequestMetrics();
+        REQUIRE(m.workers == 2);
+        REQUIRE(m.completed == 4);
+        REQUIRE(m.cancelled == 1);
+        REQUIRE(m.peakQueueDepth >= 2);
+        REQUIRE(m.meanLatencyMs() >= 200.0);
+        REQUIRE(m.meanQueueWaitMs() > 0.0);
+
+        client.getResponseCache().clear(true);
+        server.stop();
+    }
+
+    SECTION("Destroying The Client Cancels Open Requests")
+    {
+        using Surge::Test::Claude::LocalHTTPServer;
+
+        auto surge = Surge::Headless::createSurge(44100);
+
+        // The server sits on each request far longer than the client should block for
+        LocalHTTPServer server(
+            LocalHTTPServer::makeMessagesResponse("PARAMETERS:\n- volume: 0.5\n"), 3000);
+        REQUIRE(server.start());
+
+        auto client = std::make_unique<Surge::Claude::APIClient>(&surge->storage);
+        client->setAPIKey("sk-ant-test-key-12345");
+        client->setEndpoint(server.getURL());
+        client->getResponseCache().setDirectory(
+            (fs::temp_directory_path() / "surge-claude-shutdown-test").u8string());
+        client->getResponseCache().clear(true);
+        client->setCallbackDispatcher([](std::function<void()> f) { f(); });
+
+        std::atomic<int> delivered{0};
+        auto callback = [&](const Surge::Claude::ClaudeResponse &) { delivered++; };
+
+        // Two on the wire, two queued behind them
+        for (int i = 0; i < 4; ++i)
+            client->generatePatch("slow patch " + std::to_string(i), callback);
+
+        for (int i = 0; i < 500 && server.getRequestCount() < 2; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(server.getRequestCount() == 2);
+
+        auto start = std::chrono::steady_clock::now();
+        client.reset();
+        auto took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        INFO("destroying the client took " << took << "s");
+        REQUIRE(took < 1.0);
+        REQUIRE(delivered == 0);
+
+        server.stop();
+    }
+}
+
 TEST_CASE("Claude Parameter Mapper", "[claude][parameter-mapping]")
 {
     SECTION("Parameter Mapper Construction")
@@ -137,6 +657,32 @@ TEST_CASE("Claude Parameter Mapper", "[claude][parameter-mapping]")
         REQUIRE(mapper.setParameterFromName("filter1_cutoff", 1.5f));  // Should clamp to 1.0
         REQUIRE(mapper.setParameterFromName("osc1_type", 100.0f));     // Should clamp to valid range
     }
+
+    SECTION("Resolver Normalizes Names And Prefers Scene A")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::Claude::ParameterMapper mapper(surge.get());
+        auto &patch = surge->storage.getPatch();
+
+        int cutoffA = patch.scene[0].filterunit[0].cutoff.id;
+        int cutoffB = patch.scene[1].filterunit[0].cutoff.id;
+        REQUIRE(cutoffA != cutoffB);
+
+        // Case, separators and letter/digit runs don't matter
+        REQUIRE(mapper.findParameterIndex("A Filter 1 Cutoff") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("a_filter1_cutoff") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("A-FILTER-1-CUTOFF") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("b filter 1 cutoff") == cutoffB);
+
+        // Aliases, and partial names shared by both scenes, land on scene A
+        REQUIRE(mapper.findParameterIndex("cutoff") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("filter1_cutoff") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("Filter 1 Cutoff") == cutoffA);
+        REQUIRE(mapper.findParameterIndex("scene_b_filter1_cutoff") == cutoffB);
+
+        REQUIRE(mapper.findParameterIndex("invalid_parameter") == -1);
+        REQUIRE(mapper.getResolver().exactKeyCount() > patch.param_ptr.size());
+    }
 }
 
 // Test Claude response parsing
@@ -384,6 +930,135 @@ TEST_CASE("Claude Performance", "[claude][performance]")
         // Should complete within reasonable time
         REQUIRE(duration.count() < 2000);
     }
+
+    SECTION("Resolve A 50 Modification Response")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::Claude::APIClient client(&surge->storage);
+
+        // A mix of the name styles responses use: aliases, display names in
+        // any case, and partial names which need the substring index
+        std::vector<std::string> names = {
+            "osc1_type",         "osc2_pitch",       "filter1_cutoff",  "filter2_resonance",
+            "amp_attack",        "amp_release",      "lfo1_rate",       "lfo2_amount",
+            "reverb_mix",        "delay_mix",        "A Osc 1 Pitch",   "a osc 3 volume",
+            "B Filter 1 Cutoff", "A_Amp_EG_Sustain", "Filter EG Decay", "osc 2 pitch",
+            "LFO 3 Rate",        "Feedback",         "Portamento",      "Noise Volume"};
+
+        std::string response = "PARAMETERS:\n";
+        for (int i = 0; i < 50; ++i)
+            response += "- " + names[i % names.size()] + ": 0." + std::to_string(i % 10) + "\n";
+
+        auto modifications = client.extractModifications(response);
+        REQUIRE(modifications.size() == 50);
+
+        auto buildStart = std::chrono::high_resolution_clock::now();
+        Surge::Claude::ParameterMapper mapper(surge.get());
+        auto buildEnd = std::chrono::high_resolution_clock::now();
+
+        for (const auto &mod : modifications)
+            REQUIRE(mapper.findParameterIndex(mod.parameterName) >= 0);
+
+        static constexpr int iterations = 2000;
+        int checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            for (const auto &mod : modifications)
+                checksum += mapper.findParameterIndex(mod.parameterName);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto buildUs = std::chrono::duration<double, std::micro>(buildEnd - buildStart).count();
+        auto responseUs =
+            std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+        std::cout << "Parameter resolver: built in " << buildUs << " us, resolves a 50 modification "
+                  << "response in " << responseUs << " us" << std::endl;
+
+        REQUIRE(checksum > 0);
+        // Generous, but the old linear scans took milliseconds per response
+        REQUIRE(responseUs < 1000.0);
+
+        REQUIRE(mapper.applyModifications(modifications));
+    }
+
+    SECTION("Directory Extraction Throughput")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        auto factoryPath = surge->storage.datapath / "patches_factory";
+
+        if (!fs::exists(factoryPath))
+        {
+            SUCCEED("No factory patches available in this environment");
+            return;
+        }
+
+        Surge::PatchDB::PatchParameterExtractor serial(&surge->storage);
+        serial.setMaxThreads(1);
+        auto serialResults = serial.extractFromDirectory(factoryPath.u8string());
+        const auto &ss = serial.getLastExtractionStats();
+        std::cout << "Serial extraction: " << ss.extracted << " patches at "
+                  << ss.patchesPerSecond() << " patches/sec" << std::endl;
+
+        Surge::PatchDB::PatchParameterExtractor parallel(&surge->storage);
+        auto parallelResults = parallel.extractFromDirectory(factoryPath.u8string());
+        const auto &ps = parallel.getLastExtractionStats();
+        std::cout << "Parallel extraction (" << ps.threads << " threads): " << ps.extracted
+                  << " patches at " << ps.patchesPerSecond() << " patches/sec" << std::endl;
+
+        REQUIRE(parallelResults.size() == serialResults.size());
+        for (size_t i = 0; i < serialResults.size(); ++i)
+        {
+            REQUIRE(parallelResults[i].name == serialResults[i].name);
+            REQUIRE(parallelResults[i].toNormalizedVector() ==
+                    serialResults[i].toNormalizedVector());
+        }
+
+        // Nothing changed on disk, so a rebuild comes entirely from the manifest
+        auto again = parallel.extractFromDirectory(factoryPath.u8string());
+        const auto &rs = parallel.getLastExtractionStats();
+        std::cout << "Incremental rebuild: " << rs.reused << " patches at "
+                  << rs.patchesPerSecond() << " patches/sec" << std::endl;
+
+        REQUIRE(again.size() == parallelResults.size());
+        REQUIRE(rs.extracted == 0);
+        REQUIRE(rs.reused == parallelResults.size());
+    }
+
+    SECTION("Rescanning A Directory Keeps Its Namesake Sibling")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+
+        fs::path anyPatch;
+        std::error_code ec;
+        fs::recursive_directory_iterator it(surge->storage.datapath / "patches_factory", ec), end;
+        for (; !ec && it != end && anyPatch.empty(); it.increment(ec))
+            if (it->path().extension() == ".fxp")
+                anyPatch = it->path();
+
+        if (anyPatch.empty())
+        {
+            SUCCEED("No factory patches available in this environment");
+            return;
+        }
+
+        auto root = fs::temp_directory_path() / "surge-extractor-prefix-test";
+        fs::remove_all(root, ec);
+        for (auto sub : {"User", "User Backup"})
+        {
+            fs::create_directories(root / sub);
+            fs::copy_file(anyPatch, root / sub / "Patch.fxp");
+        }
+
+        Surge::PatchDB::PatchParameterExtractor extractor(&surge->storage);
+        REQUIRE(extractor.extractFromDirectory((root / "User Backup").u8string()).size() == 1);
+        REQUIRE(extractor.extractFromDirectory((root / "User").u8string()).size() == 1);
+
+        // Scanning "User" must not drop what it knows about "User Backup"
+        REQUIRE(extractor.getManifestSize() == 2);
+        extractor.extractFromDirectory((root / "User Backup").u8string());
+        REQUIRE(extractor.getLastExtractionStats().reused == 1);
+
+        fs::remove_all(root, ec);
+    }
 }
 
 // Test Patch Vector Database functionality
@@ -554,6 +1229,133 @@ TEST_CASE("Patch Vector Database", "[claude][vector-db]")
         REQUIRE(leadResults[0].name == "Bright Lead");
     }
     
+    SECTION("Text Embedding And Inverted Index")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        std::vector<std::pair<std::string, std::string>> named = {
+            {"Deep Bass", "Basses"},   {"Bassline Acid", "Basses"}, {"Bright Lead", "Leads"},
+            {"Warm Pad", "Pads"},      {"Glass Bells", "Keys"},     {"FM EP", "Keys"},
+            {"Dark Drone", "Drones"}};
+        for (const auto &n : named)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = n.first;
+            pv.category = n.second;
+            vectorDB.patches.push_back(pv);
+        }
+
+        // Substrings of a word still match, through the trigram postings
+        auto bass = vectorDB.findSimilarByText("bass", 10);
+        REQUIRE(bass.size() == 2);
+        for (const auto &r : bass)
+            REQUIRE(r.category == "Basses");
+
+        // Short words go through their own postings
+        auto fm = vectorDB.findSimilarByText("fm", 10);
+        REQUIRE(fm.size() == 1);
+        REQUIRE(fm[0].name == "FM EP");
+
+        // Words that appear nowhere prune everything
+        REQUIRE(vectorDB.findSimilarByText("zzyzx", 10).empty());
+
+        // Multi word queries rank the patch matching most words first
+        auto pad = vectorDB.findSimilarByText("warm dark pad", 10);
+        REQUIRE(pad.size() == 2);
+        REQUIRE(pad[0].name == "Warm Pad");
+
+        // Every patch now carries a unit length embedding
+        for (const auto &p : vectorDB.patches)
+        {
+            REQUIRE(p.textEmbedding.size() == Surge::PatchDB::TextIndex::embeddingDims);
+            float norm = 0.f;
+            for (auto f : p.textEmbedding)
+                norm += f * f;
+            REQUIRE(norm == Catch::Approx(1.f).margin(1e-4));
+        }
+    }
+
+    SECTION("Text Index Adds Share The Built Weights")
+    {
+        using Surge::PatchDB::PatchVector;
+        using Surge::PatchDB::TextIndex;
+
+        auto make = [](const std::string &name, const std::string &category) {
+            PatchVector pv;
+            pv.name = name;
+            pv.category = category;
+            return pv;
+        };
+
+        std::vector<PatchVector> patches = {make("Deep Bass", "Basses"),
+                                            make("Bright Lead", "Leads"),
+                                            make("Warm Pad", "Pads")};
+        TextIndex index;
+        index.build(patches);
+        REQUIRE(index.fittedSize() == 3);
+
+        // Adding, even a lot of one word, doesn't reweight what is already stored
+        auto first = patches[0].textEmbedding;
+        std::vector<PatchVector> added;
+        for (int i = 0; i < 20; ++i)
+            added.push_back(make("Bass " + std::to_string(i), "Basses"));
+        for (auto &pv : added)
+            index.add(pv);
+
+        auto copy = make("Deep Bass", "Basses");
+        index.add(copy);
+        REQUIRE(copy.textEmbedding == first);
+        REQUIRE(index.size() == 24);
+        REQUIRE(index.fittedSize() == 3);
+
+        auto hits = index.search("bass", 5);
+        REQUIRE(hits.size() == 5);
+    }
+
+    SECTION("Batched Multi Query Search")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        const char *names[] = {"Deep Bass", "Bright Lead", "Warm Pad", "Bass Lead", "Dark Pad"};
+        for (int i = 0; i < 500; ++i)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = std::string(names[i % 5]) + " " + std::to_string(i);
+            pv.category = "Test";
+            vectorDB.patches.push_back(pv);
+        }
+
+        std::vector<std::string> queries = {"bass", "lead", "pad", "zzyzx"};
+        auto merged = vectorDB.searchMany(queries, 3);
+
+        // Each query contributes its own top 3, and "Bass Lead" patches may be shared
+        std::set<size_t> expected;
+        for (const auto &q : queries)
+        {
+            for (const auto &p : vectorDB.findSimilarByText(q, 3))
+            {
+                for (size_t i = 0; i < vectorDB.patches.size(); ++i)
+                    if (vectorDB.patches[i].name == p.name)
+                        expected.insert(i);
+            }
+        }
+
+        std::set<size_t> got;
+        for (const auto &h : merged)
+            got.insert(h.index);
+
+        REQUIRE(got.size() == merged.size());
+        REQUIRE(got == expected);
+
+        for (size_t i = 1; i < merged.size(); ++i)
+            REQUIRE(merged[i - 1].score >= merged[i].score);
+
+        REQUIRE(vectorDB.searchMany({}, 3).empty());
+        REQUIRE(vectorDB.searchMany(queries, 0).empty());
+    }
+
     SECTION("Vector-based Similarity Search")
     {
         auto surge = Surge::Headless::createSurge(44100);
@@ -585,6 +1387,174 @@ TEST_CASE("Patch Vector Database", "[claude][vector-db]")
         REQUIRE(results[1].name == "Similar");
         REQUIRE(results[2].name == "Different");
     }
+
+    SECTION("Matrix Search Matches Brute Force")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        std::mt19937 gen(2112);
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+        // 50 wide matches toNormalizedVector and leaves a ragged tail in the last 32 byte block
+        for (int i = 0; i < 2000; ++i)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = "Patch " + std::to_string(i);
+            pv.parameterVector.resize(50);
+            for (auto &f : pv.parameterVector)
+                f = dist(gen);
+            vectorDB.patches.push_back(pv);
+        }
+
+        for (int q = 0; q < 10; ++q)
+        {
+            const auto &query = vectorDB.patches[q * 97];
+
+            std::vector<std::pair<float, size_t>> brute;
+            for (size_t i = 0; i < vectorDB.patches.size(); ++i)
+                brute.push_back({query.cosineSimilarity(vectorDB.patches[i]), i});
+            std::sort(brute.begin(), brute.end(),
+                      [](const auto &a, const auto &b) { return a.first > b.first; });
+
+            auto hits = vectorDB.findSimilarPatchHits(query.parameterVector, 8);
+            REQUIRE(hits.size() == 8);
+            REQUIRE(hits[0].index == (size_t)(q * 97));
+
+            for (size_t i = 0; i < hits.size(); ++i)
+            {
+                REQUIRE(hits[i].score == Catch::Approx(brute[i].first).margin(1e-5));
+                if (i > 0)
+                    REQUIRE(hits[i - 1].score >= hits[i].score);
+            }
+        }
+
+        // Replacing entries in place needs an explicit invalidate
+        vectorDB.patches[5].parameterVector = vectorDB.patches[0].parameterVector;
+        vectorDB.invalidateSearchIndex();
+        auto hits = vectorDB.findSimilarPatchHits(vectorDB.patches[0].parameterVector, 2);
+        REQUIRE(hits.size() == 2);
+        REQUIRE(hits[0].index == 0);
+        REQUIRE(hits[1].index == 5);
+    }
+
+    SECTION("Save And Memory Mapped Load")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        std::mt19937 gen(77);
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+        for (int i = 0; i < 300; ++i)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = "Patch " + std::to_string(i);
+            pv.category = i % 2 ? "Basses" : "Leads";
+            pv.description = "Description " + std::to_string(i);
+            pv.filePath = "/some/path/" + std::to_string(i) + ".fxp";
+            pv.tags["index"] = std::to_string(i);
+            pv.parameterVector.resize(50);
+            for (auto &f : pv.parameterVector)
+                f = dist(gen);
+            vectorDB.patches.push_back(pv);
+        }
+        // A patch with no parameters survives the round trip as one
+        vectorDB.patches[7].parameterVector.clear();
+
+        auto dbPath = (fs::temp_directory_path() / "surge-vectordb-test.bin").u8string();
+        REQUIRE(vectorDB.saveToFile(dbPath));
+        REQUIRE_FALSE(vectorDB.isFileStale(dbPath));
+
+        Surge::PatchDB::VectorDatabase loaded(&surge->storage);
+        REQUIRE(loaded.loadFromFile(dbPath));
+        REQUIRE(loaded.patches.size() == vectorDB.patches.size());
+
+        for (size_t i = 0; i < vectorDB.patches.size(); ++i)
+        {
+            const auto &a = vectorDB.patches[i];
+            const auto &b = loaded.patches[i];
+            REQUIRE(a.name == b.name);
+            REQUIRE(a.category == b.category);
+            REQUIRE(a.description == b.description);
+            REQUIRE(a.filePath == b.filePath);
+            REQUIRE(a.tags == b.tags);
+            // Rows are read in place from the mapped file rather than copied out
+            REQUIRE(b.parameterVector.empty());
+            REQUIRE(a.parameterVector == b.parameters().toVector());
+        }
+
+        auto query = vectorDB.patches[42].parameterVector;
+        auto before = vectorDB.findSimilarPatchHits(query, 10);
+        auto after = loaded.findSimilarPatchHits(query, 10);
+        REQUIRE(before.size() == after.size());
+        for (size_t i = 0; i < before.size(); ++i)
+        {
+            REQUIRE(before[i].index == after[i].index);
+            REQUIRE(before[i].score == after[i].score);
+        }
+
+        /*
+         * Loading a different library of the same size must not keep the old text index. The
+         * second library has the first's names in reverse, so a stale index finds row 42.
+         */
+        auto hits = loaded.searchMany({"Patch 42"}, 1);
+        REQUIRE(hits.size() == 1);
+        REQUIRE(hits[0].index == 42);
+
+        auto last = vectorDB.patches.size() - 1;
+        for (size_t i = 0; i < vectorDB.patches.size(); ++i)
+        {
+            vectorDB.patches[i].name = "Patch " + std::to_string(last - i);
+            vectorDB.patches[i].description = "Description " + std::to_string(last - i);
+        }
+        auto otherPath = (fs::temp_directory_path() / "surge-vectordb-test-2.bin").u8string();
+        REQUIRE(vectorDB.saveToFile(otherPath));
+        REQUIRE(loaded.loadFromFile(otherPath));
+        REQUIRE(loaded.patches.size() == vectorDB.patches.size());
+
+        hits = loaded.searchMany({"Patch 42"}, 1);
+        REQUIRE(hits.size() == 1);
+        REQUIRE(hits[0].index == last - 42);
+        auto text = loaded.findSimilarByText("Patch 42", 1);
+        REQUIRE(text.size() == 1);
+        REQUIRE(text[0].name == "Patch 42");
+        fs::remove(fs::path(otherPath));
+
+        // A truncated file must be rejected rather than read out of bounds
+        fs::resize_file(fs::path(dbPath), fs::file_size(fs::path(dbPath)) / 2);
+        Surge::PatchDB::VectorDatabase truncated(&surge->storage);
+        REQUIRE_FALSE(truncated.loadFromFile(dbPath));
+        REQUIRE(truncated.patches.empty());
+
+        fs::remove(fs::path(dbPath));
+        REQUIRE(vectorDB.isFileStale(dbPath));
+    }
+
+    SECTION("SIMD Dot Product And Top K Selector")
+    {
+        Surge::PatchDB::PatchMatrix::AlignedBuffer a(4), b(4);
+        for (int n = 0; n <= 32; ++n)
+        {
+            for (int i = 0; i < 32; ++i)
+            {
+                a[i / 8].v[i % 8] = 0.1f * i;
+                b[i / 8].v[i % 8] = 1.f - 0.03f * i;
+            }
+            auto simd = Surge::PatchDB::dotProduct(a[0].v, b[0].v, n);
+            auto scalar = Surge::PatchDB::dotProductScalar(a[0].v, b[0].v, n);
+            REQUIRE(simd == Catch::Approx(scalar).margin(1e-4));
+        }
+
+        Surge::PatchDB::TopKSelector sel(3);
+        std::vector<float> scores = {0.1f, 0.9f, 0.5f, 0.9f, 0.2f, 0.7f};
+        for (size_t i = 0; i < scores.size(); ++i)
+            sel.push(i, scores[i]);
+        auto top = sel.take();
+        REQUIRE(top.size() == 3);
+        REQUIRE(top[0].index == 1);
+        REQUIRE(top[1].index == 3);
+        REQUIRE(top[2].index == 5);
+    }
     
     SECTION("Real Factory Patch Loading")
     {
@@ -621,4 +1591,210 @@ TEST_CASE("Patch Vector Database", "[claude][vector-db]")
             std::cout << "No factory patches found - this is normal in test environment" << std::endl;
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Patch Vector ANN Index", "[claude][vector-db]")
+{
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+    auto randomVector = [&]() {
+        std::vector<float> v(50);
+        for (auto &f : v)
+            f = dist(gen);
+        return v;
+    };
+
+    SECTION("HNSW Recall Against Brute Force")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        for (int i = 0; i < 3000; ++i)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = "Patch " + std::to_string(i);
+            pv.parameterVector = randomVector();
+            vectorDB.patches.push_back(pv);
+        }
+
+        auto hnswOwned = std::make_unique<Surge::PatchDB::HNSWIndex>();
+        auto *hnsw = hnswOwned.get();
+        vectorDB.setNearestNeighbourIndex(std::move(hnswOwned));
+
+        auto recallAt = [&](size_t ef) {
+            hnsw->setEfSearch(ef);
+            std::mt19937 qgen(99);
+            std::uniform_real_distribution<float> qdist(0.f, 1.f);
+            int found = 0, total = 0;
+            for (int q = 0; q < 50; ++q)
+            {
+                std::vector<float> query(50);
+                for (auto &f : query)
+                    f = qdist(qgen);
+
+                auto exact = vectorDB.findSimilarPatchHitsExact(query, 10);
+                auto approx = vectorDB.findSimilarPatchHits(query, 10);
+                REQUIRE(approx.size() == 10);
+
+                std::set<size_t> truth;
+                for (const auto &h : exact)
+                    truth.insert(h.index);
+                for (const auto &h : approx)
+                    found += truth.count(h.index);
+                total += 10;
+            }
+            return (float)found / total;
+        };
+
+        auto lowRecall = recallAt(16);
+        auto highRecall = recallAt(128);
+        INFO("Recall@10 ef=16 " << lowRecall << " ef=128 " << highRecall);
+        REQUIRE(hnsw->size() == vectorDB.patches.size());
+        REQUIRE(highRecall >= 0.95f);
+        REQUIRE(highRecall >= lowRecall);
+
+        // An exact duplicate of a stored patch comes back first
+        auto self = vectorDB.findSimilarPatchHits(vectorDB.patches[1234].parameterVector, 1);
+        REQUIRE(self.size() == 1);
+        REQUIRE(self[0].index == 1234);
+    }
+
+    SECTION("HNSW Is Saved With The Database")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+        vectorDB.setNearestNeighbourIndex(std::make_unique<Surge::PatchDB::HNSWIndex>());
+
+        for (int i = 0; i < 500; ++i)
+        {
+            Surge::PatchDB::PatchVector pv;
+            pv.name = "Patch " + std::to_string(i);
+            pv.parameterVector = randomVector();
+            vectorDB.patches.push_back(pv);
+        }
+
+        auto query = randomVector();
+        auto before = vectorDB.findSimilarPatchHits(query, 10);
+
+        auto dbPath = (fs::temp_directory_path() / "surge-vectordb-hnsw-test.bin").u8string();
+        REQUIRE(vectorDB.saveToFile(dbPath));
+
+        Surge::PatchDB::VectorDatabase loaded(&surge->storage);
+        loaded.setNearestNeighbourIndex(std::make_unique<Surge::PatchDB::HNSWIndex>());
+        REQUIRE(loaded.loadFromFile(dbPath));
+        REQUIRE(loaded.getNearestNeighbourIndex()->size() == 500);
+
+        // The graph read back is the one saved, so the approximate results agree exactly
+        auto after = loaded.findSimilarPatchHits(query, 10);
+        REQUIRE(before.size() == after.size());
+        for (size_t i = 0; i < before.size(); ++i)
+            REQUIRE(before[i].index == after[i].index);
+
+        // A graph which doesn't match the matrix is refused
+        std::vector<char> image;
+        loaded.getNearestNeighbourIndex()->save(image);
+        Surge::PatchDB::PatchMatrix smaller;
+        REQUIRE(smaller.append(randomVector()));
+        Surge::PatchDB::HNSWIndex other;
+        REQUIRE_FALSE(other.load(image.data(), image.size(), smaller));
+        REQUIRE(other.size() == 0);
+        REQUIRE_FALSE(other.load(image.data(), image.size() / 2, smaller));
+
+        fs::remove(fs::path(dbPath));
+    }
+
+    SECTION("HNSW Incremental Insertion")
+    {
+        Surge::PatchDB::PatchMatrix matrix;
+        Surge::PatchDB::HNSWIndex index;
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            REQUIRE(matrix.append(randomVector()));
+            index.add(matrix, matrix.rows() - 1);
+        }
+        REQUIRE(index.size() == 1000);
+
+        index.setEfSearch(128);
+        for (size_t row = 0; row < 1000; row += 111)
+        {
+            Surge::PatchDB::PatchMatrix::AlignedBuffer q;
+            std::vector<float> v(matrix.row(row), matrix.row(row) + matrix.dims());
+            REQUIRE(matrix.prepareQuery(v, q));
+            auto hits = index.search(matrix, q.front().v, 5);
+            REQUIRE(hits.size() == 5);
+            REQUIRE(hits[0].index == row);
+        }
+    }
+
+    SECTION("HNSW Searches From Several Threads At Once")
+    {
+        Surge::PatchDB::PatchMatrix matrix;
+        Surge::PatchDB::HNSWIndex index;
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            REQUIRE(matrix.append(randomVector()));
+            index.add(matrix, matrix.rows() - 1);
+        }
+
+        std::vector<Surge::PatchDB::PatchMatrix::AlignedBuffer> queries(64);
+        for (auto &q : queries)
+            REQUIRE(matrix.prepareQuery(randomVector(), q));
+
+        std::vector<std::vector<Surge::PatchDB::SearchHit>> expected;
+        for (const auto &q : queries)
+            expected.push_back(index.search(matrix, q.front().v, 10));
+
+        // Each thread must see exactly what a lone search sees
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                for (int rep = 0; rep < 20; ++rep)
+                {
+                    for (size_t q = t; q < queries.size(); q += 2)
+                    {
+                        auto hits = index.search(matrix, queries[q].front().v, 10);
+                        for (size_t i = 0; i < hits.size(); ++i)
+                            if (hits.size() != expected[q].size() ||
+                                hits[i].index != expected[q][i].index)
+                                mismatches++;
+                    }
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+
+        REQUIRE(mismatches == 0);
+    }
+
+    SECTION("Hybrid Search Blends Text And Parameters")
+    {
+        auto surge = Surge::Headless::createSurge(44100);
+        Surge::PatchDB::VectorDatabase vectorDB(&surge->storage);
+
+        Surge::PatchDB::PatchVector a, b, c;
+        a.name = "Warm Pad";
+        a.parameterVector = {1.f, 0.f, 0.f};
+        b.name = "Cold Pad";
+        b.parameterVector = {0.f, 1.f, 0.f};
+        c.name = "Fat Bass";
+        c.parameterVector = {0.f, 0.f, 1.f};
+        vectorDB.patches = {a, b, c};
+
+        // Text alone can't split the two pads, the parameters can
+        auto res = vectorDB.hybridSearch("pad", {0.f, 1.f, 0.1f}, 0.5f, 3);
+        REQUIRE(res.size() == 3);
+        REQUIRE(res[0].name == "Cold Pad");
+        REQUIRE(res[1].name == "Warm Pad");
+
+        // Pure text weighting ignores the parameters
+        auto textOnly = vectorDB.hybridSearch("bass", {0.f, 1.f, 0.f}, 1.0f, 1);
+        REQUIRE(textOnly.size() == 1);
+        REQUIRE(textOnly[0].name == "Fat Bass");
+    }
+}
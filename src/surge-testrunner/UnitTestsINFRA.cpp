@@ -21,10 +21,15 @@
  */
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include "HeadlessUtils.h"
 #include "BiquadFilter.h"
 #include "MemoryPool.h"
+#include "SurgeMemoryPools.h"
+#include "AllocationCounting.h"
 
 #include "sst/plugininfra/strnatcmp.h"
 
@@ -179,7 +184,96 @@ TEST_CASE("Memory Pool Works", "[infra]")
         REQUIRE(CountAlloc<3>::alloc == 160);
         REQUIRE(CountAlloc<3>::ct == 0);
     }
+
+    SECTION("Refill From Another Thread")
+    {
+        {
+            auto pool = std::make_unique<Surge::Memory::MemoryPool<CountAlloc<4>, 8, 4, 500>>();
+            std::vector<CountAlloc<4> *> held;
+            for (int i = 0; i < 6; ++i)
+                held.push_back(pool->getItem());
+            REQUIRE(CountAlloc<4>::alloc == 8);
+
+            // Running low asked for a refill up to preAlloc + growBy, which the owner
+            // doesn't make itself
+            std::thread refill([&pool]() { pool->serviceRefills(); });
+            refill.join();
+            REQUIRE(CountAlloc<4>::alloc == 18);
+
+            // So handing out the lot doesn't allocate
+            for (int i = 0; i < 12; ++i)
+                held.push_back(pool->getItem());
+            REQUIRE(CountAlloc<4>::alloc == 18);
+            REQUIRE(pool->position == 0);
+
+            for (auto h : held)
+                pool->returnItem(h);
+        }
+        REQUIRE(CountAlloc<4>::ct == 0);
+    }
+
+    SECTION("Release Deletes On Another Thread")
+    {
+        {
+            auto pool = std::make_unique<Surge::Memory::MemoryPool<CountAlloc<5>, 8, 4, 500>>();
+            pool->setupPoolToSize(40);
+            pool->releaseToPreAllocSize();
+            REQUIRE(pool->position == 8);
+            REQUIRE(CountAlloc<5>::ct == 40);
+
+            std::thread refill([&pool]() { pool->serviceRefills(); });
+            refill.join();
+            REQUIRE(CountAlloc<5>::ct == 8);
+        }
+        REQUIRE(CountAlloc<5>::ct == 0);
+    }
+}
+
+#if SURGE_CHECK_AUDIO_THREAD_ALLOCATIONS
+TEST_CASE("No Heap Allocation On The Audio Thread", "[infra]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+
+    auto playAndRender = [&surge](int blocks) {
+        for (int i = 0; i < blocks; ++i)
+        {
+            // Notes come in on the audio thread too
+            Surge::Memory::AudioThreadScope audioThread;
+            if (i % 40 == 0)
+                surge->playNote(0, 48 + (i / 40) % 24, 100, 0);
+            if (i % 40 == 30)
+                surge->releaseNote(0, 48 + (i / 40) % 24, 0);
+            surge->process();
+        }
+    };
+
+    SECTION("Init Patch")
+    {
+        playAndRender(200);
+
+        auto before = Surge::Test::audioThreadAllocationsOnAnyThread();
+        playAndRender(2000);
+        REQUIRE(Surge::Test::audioThreadAllocationsOnAnyThread() == before);
+    }
+
+    SECTION("String Oscillators")
+    {
+        auto *pt = &(surge->storage.getPatch().scene[0].osc[0].type);
+        auto did = surge->idForParameter(pt);
+        surge->setParameter01(did, 1.f * ot_string / (pt->val_max.i - pt->val_min.i), false);
+        for (int i = 0; i < 10; ++i)
+            surge->process();
+
+        // The synth only asked for the delay lines, so give the refill thread a moment
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        playAndRender(200);
+
+        auto before = Surge::Test::audioThreadAllocationsOnAnyThread();
+        playAndRender(2000);
+        REQUIRE(Surge::Test::audioThreadAllocationsOnAnyThread() == before);
+    }
 }
+#endif
 
 TEST_CASE("strnatcmp With Spaces", "[infra]")
 {
@@ -97,6 +97,165 @@ TEST_CASE("All Factory Wavetables Are Loadable", "[io]")
     }
 }
 
+TEST_CASE("Wavetables Load In The Background", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100, true);
+    REQUIRE(surge);
+    REQUIRE(surge->storage.wt_list.size() > 2);
+
+    surge->storage.setBackgroundWavetableLoading(true);
+    REQUIRE(surge->storage.isBackgroundWavetableLoading());
+
+    auto &osc = surge->storage.getPatch().scene[0].osc[0];
+    osc.type.val.i = ot_wavetable;
+    for (int i = 0; i < 2; ++i)
+        surge->process();
+
+    // A block hands the request over once the slot is free, later ones install the result
+    auto processUntil = [&surge](auto done) {
+        auto giveUpAt = std::chrono::steady_clock::now() + 10s;
+        while (!done() && std::chrono::steady_clock::now() < giveUpAt)
+        {
+            surge->process();
+            std::this_thread::sleep_for(1ms);
+        }
+        REQUIRE(done());
+    };
+    auto processUntilInstalled = [&]() {
+        processUntil([&]() {
+            return osc.wt.queue_id == -1 && !surge->storage.wavetableLoader->hasPending();
+        });
+    };
+
+    auto sameTableAs = [&surge, &osc](int wti) {
+        auto &ref = surge->storage.getPatch().scene[1].osc[0];
+        surge->storage.load_wt(wti, &ref.wt, &ref);
+
+        REQUIRE(osc.wt.current_id == wti);
+        REQUIRE(osc.wt.queue_id == -1);
+        REQUIRE(osc.wavetable_display_name == ref.wavetable_display_name);
+        REQUIRE(osc.wt.size == ref.wt.size);
+        REQUIRE(osc.wt.n_tables == ref.wt.n_tables);
+        REQUIRE(osc.wt.flags == ref.wt.flags);
+        for (int t = 0; t < osc.wt.n_tables; ++t)
+            REQUIRE(memcmp(osc.wt.TableF32WeakPointers[0][t], ref.wt.TableF32WeakPointers[0][t],
+                           osc.wt.size * sizeof(float)) == 0);
+    };
+
+    SECTION("Matches A Synchronous Load")
+    {
+        for (int wti : {0, 1, (int)surge->storage.wt_list.size() - 1})
+        {
+            INFO("Loading wavetable " << wti);
+            osc.wt.queue_id = wti;
+            processUntilInstalled();
+            sameTableAs(wti);
+        }
+    }
+
+    SECTION("The Last Request Wins And Cancelled Loads Are Dropped")
+    {
+        osc.wt.queue_id = 1;
+        processUntil([&]() { return osc.wt.queue_id == -1; });
+
+        // Stays queued on the oscillator until the first load is installed
+        osc.wt.queue_id = 2;
+        processUntilInstalled();
+        sameTableAs(2);
+
+        osc.wt.queue_id = 0;
+        processUntil([&]() { return osc.wt.queue_id == -1; });
+        surge->storage.cancel_background_wtloads();
+        processUntilInstalled();
+        REQUIRE(osc.wt.current_id == 2);
+    }
+}
+
+TEST_CASE("Wavetables Are Shared Between Oscillators And Instances", "[io]")
+{
+    auto a = Surge::Headless::createSurge(44100, true);
+    auto b = Surge::Headless::createSurge(44100, true);
+    REQUIRE(a);
+    REQUIRE(b);
+    REQUIRE(a->storage.wt_list.size() > 2);
+
+    auto tableIn = [](auto &surge, int scene, int osc) {
+        return &surge->storage.getPatch().scene[scene].osc[osc].wt;
+    };
+    auto load = [&tableIn](auto &surge, int scene, int osc, int wti) {
+        surge->storage.load_wt(wti, tableIn(surge, scene, osc),
+                               &surge->storage.getPatch().scene[scene].osc[osc]);
+    };
+    // Replaced data is otherwise kept for a while in case the audio thread is reading it
+    auto stats = []() {
+        WavetableCache::releaseRetired(true);
+        return WavetableCache::stats();
+    };
+    auto bytesOf = [](const Wavetable *wt) {
+        return wt->dataSizes * (sizeof(float) + sizeof(short));
+    };
+
+    // Start from unbuilt tables, whatever the init patch had
+    Wavetable unbuilt;
+    auto *a00 = tableIn(a, 0, 0), *a01 = tableIn(a, 0, 1), *b10 = tableIn(b, 1, 0);
+    for (auto *wt : {a00, a01, b10})
+        wt->Copy(&unbuilt);
+
+    auto start = stats();
+
+    load(a, 0, 0, 1);
+    load(a, 0, 1, 1);
+    load(b, 1, 0, 1);
+
+    REQUIRE(a00->everBuilt);
+    REQUIRE(a00->TableF32Data == a01->TableF32Data);
+    REQUIRE(a00->TableF32Data == b10->TableF32Data);
+    REQUIRE(a00->TableF32WeakPointers[0][0] == b10->TableF32WeakPointers[0][0]);
+
+    auto shared = stats();
+    REQUIRE(shared.tables == start.tables + 1);
+    REQUIRE(shared.bytes == start.bytes + bytesOf(a00));
+    REQUIRE(shared.references == start.references + 3);
+    REQUIRE(shared.referencedBytes == start.referencedBytes + 3 * bytesOf(a00));
+    REQUIRE(shared.hits >= start.hits + 2);
+
+    SECTION("Loading Another Table Leaves The Others Alone")
+    {
+        std::vector<float> before(a00->TableF32WeakPointers[0][0],
+                                  a00->TableF32WeakPointers[0][0] + a00->size);
+
+        load(a, 0, 1, 2);
+        REQUIRE(a01->current_id == 2);
+        REQUIRE(a01->TableF32Data != a00->TableF32Data);
+        REQUIRE(a00->TableF32Data == b10->TableF32Data);
+        REQUIRE(memcmp(before.data(), a00->TableF32WeakPointers[0][0],
+                       before.size() * sizeof(float)) == 0);
+
+        auto after = stats();
+        REQUIRE(after.tables == shared.tables + 1);
+        REQUIRE(after.references == shared.references);
+        REQUIRE(after.bytes == shared.bytes + bytesOf(a01));
+    }
+
+    SECTION("Copies Share And The Last User Frees")
+    {
+        {
+            Wavetable copy;
+            copy.Copy(a00);
+            REQUIRE(copy.TableF32Data == a00->TableF32Data);
+            REQUIRE(stats().references == shared.references + 1);
+            REQUIRE(stats().bytes == shared.bytes);
+
+            b.reset();
+            a00->Copy(&unbuilt);
+            a01->Copy(&unbuilt);
+            REQUIRE(stats().bytes == shared.bytes);
+        }
+
+        REQUIRE(stats().bytes == start.bytes);
+    }
+}
+
 TEST_CASE("All Patches Are Loadable", "[io]")
 {
     auto surge = Surge::Headless::createSurge(44100, true);
@@ -785,3 +944,62 @@ TEST_CASE("XML Direct", "[io]")
         surge->storage.getPatch().load_xml(test.c_str(), test.size(), false);
     }
 }
+
+TEST_CASE("Preloaded Patch Switch", "[io]")
+{
+    auto surge = Surge::Headless::createSurge(44100, true);
+    REQUIRE(surge->storage.patch_list.size() > 3);
+
+    auto waitForPreload = [&surge](int id) {
+        for (int i = 0; i < 500 && !surge->patchPreloader.isPreloaded(id); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return surge->patchPreloader.isPreloaded(id);
+    };
+
+    surge->preloadPatches({1, 2});
+    REQUIRE(waitForPreload(1));
+    REQUIRE(waitForPreload(2));
+    REQUIRE(!surge->patchPreloader.isPreloaded(3));
+
+    surge->playNote(0, 60, 100, 0);
+    for (int i = 0; i < 20; ++i)
+        surge->process();
+
+    surge->patchid_queue = 2;
+
+    int blocks = 0;
+    while (surge->patchid_queue >= 0 && blocks < 100)
+    {
+        surge->process();
+        REQUIRE(!surge->halt_engine);
+        blocks++;
+    }
+    REQUIRE(surge->patchid_queue == -1);
+    REQUIRE(blocks <= 1 + (int)(1.f / surge->preloadedPatchFadeStep));
+    REQUIRE(surge->patchid == 2);
+
+    // The new patch fades straight back in
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+    REQUIRE(!surge->fadingInPreloadedPatch);
+
+    // And ends up just as if it had been loaded from disk
+    auto fromDisk = Surge::Headless::createSurge(44100, true);
+    fromDisk->loadPatch(2);
+    REQUIRE(surge->storage.getPatch().name == fromDisk->storage.getPatch().name);
+
+    auto &pa = surge->storage.getPatch().param_ptr;
+    auto &pb = fromDisk->storage.getPatch().param_ptr;
+    REQUIRE(pa.size() == pb.size());
+    for (int i = 0; i < pa.size(); ++i)
+    {
+        INFO("Parameter " << pa[i]->get_storage_name());
+        REQUIRE(pa[i]->val.i == pb[i]->val.i);
+    }
+
+    // A setlist keeps just its own patches
+    surge->preloadPatches({3});
+    REQUIRE(waitForPreload(3));
+    REQUIRE(!surge->patchPreloader.isPreloaded(1));
+    REQUIRE(!surge->patchPreloader.isPreloaded(2));
+}
@@ -708,6 +708,99 @@ end
     }
 }
 
+TEST_CASE("Wavetable Script Rendering", "[formula]")
+{
+    using Surge::WavetableScript::LuaWTEvaluator;
+
+    auto s = std::string(R"FN(
+function init(wt)
+    wt.name = "Rendered Harmonics"
+    wt.phase = math.linspace(0.0, 1.0, wt.sample_count)
+    return wt
+end
+
+function generate(wt)
+    local res = {}
+
+    for i,x in ipairs(wt.phase) do
+        local lv = 0
+        for q = 1,wt.frame do
+            lv = lv + sin(2 * pi * q * x) / q
+        end
+        res[i] = lv
+    end
+    return res
+end
+        )FN");
+
+    auto make = [](const std::string &script) {
+        auto la = std::make_unique<LuaWTEvaluator>();
+        la->setStorage(nullptr);
+        la->setResolution(256);
+        la->setFrameCount(12);
+        la->setScript(script);
+        return la;
+    };
+
+    LuaWTEvaluator::clearRenderCache();
+
+    SECTION("Rendered Table Matches Frames")
+    {
+        auto serial = make(s);
+        std::vector<float> frames;
+        for (int fno = 0; fno < 12; ++fno)
+        {
+            auto fr = serial->getFrame(fno);
+            REQUIRE(fr.has_value());
+            frames.insert(frames.end(), fr->begin(), fr->end());
+        }
+
+        auto rendered = make(s)->renderWavetable();
+        REQUIRE(rendered);
+        REQUIRE(rendered->frameCount == 12);
+        REQUIRE(rendered->resolution == 256);
+        REQUIRE(rendered->name == "Rendered Harmonics");
+        REQUIRE(rendered->data == frames);
+
+        // Any evaluator with the same script and size gets the same table back
+        REQUIRE(make(s)->renderWavetable() == rendered);
+        REQUIRE(make(s)->renderWavetableAsync().get() == rendered);
+        REQUIRE(make(s + "\n")->renderWavetable() != rendered);
+
+        auto fromCache = make(s);
+        auto fr = fromCache->getFrame(7);
+        REQUIRE(fr.has_value());
+        REQUIRE(std::equal(fr->begin(), fr->end(), rendered->data.begin() + 7 * 256));
+        REQUIRE(fromCache->getSuggestedWavetableName() == "Rendered Harmonics");
+    }
+
+    SECTION("Failed Frames Are Not Cached")
+    {
+        auto failing = std::string(R"FN(
+function generate(wt)
+    if wt.frame == 4 then
+        error("no frame four")
+    end
+    local res = {}
+    for i = 1,wt.sample_count do
+        res[i] = wt.frame / wt.frame_count
+    end
+    return res
+end
+        )FN");
+
+        REQUIRE(!make(failing)->renderWavetable());
+        REQUIRE(!make(failing)->renderWavetableAsync().get());
+
+        wt_header wh;
+        float *wd{nullptr};
+        REQUIRE(!make(failing)->populateWavetable(wh, &wd));
+        REQUIRE(wd);
+        REQUIRE(wh.n_tables == 12);
+        delete[] wd;
+    }
+}
+
 TEST_CASE("Simple Used Formula Modulator", "[formula]")
 {
     SECTION("Run Formula on Voice And Scene")
@@ -980,4 +1073,85 @@ TEST_CASE("Two Surge XTs", "[formula]")
     }
 }
 
+TEST_CASE("Batched Formula Evaluation", "[formula]")
+{
+    auto render = [](bool batch) {
+        auto surge = Surge::Test::surgeOnSine();
+        surge->batchFormulaLFOs = batch;
+
+        auto &sc = surge->storage.getPatch().scene[0];
+        sc.lfo[0].shape.val.i = lt_formula;
+        sc.lfo[1].shape.val.i = lt_formula;
+        surge->setModDepth01(sc.osc[0].pitch.id, ms_lfo1, 0, 0, 0.1);
+        surge->setModDepth01(sc.osc[0].pitch.id, ms_lfo2, 0, 2, 0.05);
+
+        surge->storage.getPatch().formulamods[0][0].setFormula(R"FN(
+function init(state)
+   state.count = 0
+   return state
+end
+
+function process(state)
+    state.count = state.count + 1
+    local depth = state.released and 0.5 or 1
+    state.output = math.sin(state.phase * 2 * math.pi + state.key / 12) * depth
+    return state
+end)FN");
+        surge->storage.getPatch().formulamods[0][1].setFormula(R"FN(
+function process(state)
+    state.output = { state.phase, 1 - state.phase, state.velocity / 127 + state.macros[1] }
+    state.use_envelope = state.cycle % 2 == 0
+    return state
+end)FN");
+
+        std::vector<float> res;
+        auto proc = [&](int blocks) {
+            for (int b = 0; b < blocks; ++b)
+            {
+                surge->process();
+                for (int i = 0; i < BLOCK_SIZE; ++i)
+                    res.push_back(surge->output[0][i]);
+                for (auto v : surge->voices[0])
+                {
+                    res.push_back(v->modsources[ms_lfo1]->get_output(0));
+                    for (int o = 0; o < 3; ++o)
+                        res.push_back(v->modsources[ms_lfo2]->get_output(o));
+                }
+            }
+        };
+
+        surge->playNote(0, 60, 100, 0);
+        surge->playNote(0, 64, 80, 0);
+        surge->playNote(0, 67, 60, 0);
+        proc(40);
+        surge->setMacroParameter01(0, 0.3);
+        surge->releaseNote(0, 64, 100);
+        proc(40);
+
+        REQUIRE(!surge->voices[0].empty());
+        auto lms =
+            dynamic_cast<LFOModulationSource *>(surge->voices[0].front()->modsources[ms_lfo1]);
+        REQUIRE(lms);
+        auto c = Surge::Formula::extractModStateKeyForTesting("count", lms->formulastate);
+        auto count = std::get_if<float>(&c);
+        REQUIRE(count);
+        res.push_back(*count);
+
+        return res;
+    };
+
+    auto batched = render(true);
+    auto single = render(false);
+
+    REQUIRE(batched.size() == single.size());
+    int mismatches = 0;
+    for (size_t i = 0; i < batched.size(); ++i)
+    {
+        if (batched[i] != single[i])
+            mismatches++;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(batched.back() >= 80);
+}
+
 #endif
@@ -23,6 +23,10 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 #include "HeadlessUtils.h"
 #include "Player.h"
@@ -1435,3 +1439,193 @@ TEST_CASE("Mod LFO Is Well Behaved", "[mod]")
         }
     }
 }
+
+TEST_CASE("Sparse Voice Parameter Refresh", "[mod]")
+{
+    auto render = [](bool sparse, int &steadyRefreshCount) {
+        auto surge = Surge::Headless::createSurge(44100);
+        surge->storage.rngGen.g.seed(23);
+
+        auto &sc = surge->storage.getPatch().scene[0];
+        surge->setModDepth01(sc.filterunit[0].cutoff.id, ms_velocity, 0, 0, 0.3);
+        surge->setModDepth01(sc.osc[0].pitch.id, ms_lfo1, 0, 0, 0.2);
+        surge->setModDepth01(sc.osc[0].p[0].id, ms_keytrack, 0, 0, 0.1);
+
+        std::vector<float> res;
+        auto proc = [&](int blocks) {
+            for (int b = 0; b < blocks; ++b)
+            {
+                // Without a plan a voice copies all of its params every block, as it used to
+                if (!sparse)
+                    for (auto v : surge->voices[0])
+                        v->modulationPlan = nullptr;
+
+                surge->process();
+                for (int i = 0; i < BLOCK_SIZE; ++i)
+                {
+                    res.push_back(surge->output[0][i]);
+                    res.push_back(surge->output[1][i]);
+                }
+            }
+        };
+
+        surge->playNote(0, 60, 100, 0, 1001);
+        surge->playNote(0, 67, 80, 0, 1002);
+        proc(50);
+        steadyRefreshCount = surge->voiceModulationPlan[0].getRefreshCount();
+
+        // A param with no routing changes; a routing goes away; another arrives
+        sc.filterunit[0].resonance.set_value_f01(0.7);
+        proc(20);
+        surge->clearModulation(sc.osc[0].pitch.id, ms_lfo1, 0, 0, false);
+        proc(20);
+        surge->setModDepth01(sc.filterunit[0].cutoff.id, ms_lfo1, 0, 0, -0.2);
+        proc(20);
+
+        // A voice started after all that, then a polyphonic modulation on one voice
+        surge->playNote(0, 64, 90, 0, 1003);
+        proc(20);
+        surge->applyParameterPolyphonicModulation(&sc.osc[0].p[1], 1002, 67, 0, 0.3);
+        proc(20);
+
+        REQUIRE(surge->voices[0].size() == 3);
+        return res;
+    };
+
+    int sparseCount, fullCount;
+    auto sparse = render(true, sparseCount);
+    auto full = render(false, fullCount);
+
+    REQUIRE(sparse.size() == full.size());
+
+    float peak = 0.f;
+    int mismatches = 0;
+    for (size_t i = 0; i < sparse.size(); ++i)
+    {
+        peak = std::max(peak, std::fabs(sparse[i]));
+        if (sparse[i] != full[i])
+            mismatches++;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(peak > 0.01f);
+
+    // Once nothing is moving only the routed params need refreshing
+    REQUIRE(sparseCount < n_scene_params / 4);
+}
+
+TEST_CASE("Routing Edits Don't Block The Audio Thread", "[mod]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    auto &sc = surge->storage.getPatch().scene[0];
+
+    surge->playNote(0, 60, 100, 0);
+    for (int i = 0; i < 10; ++i)
+        surge->process();
+
+    auto &plan = surge->voiceModulationPlan[0];
+    auto before = plan.voiceRoutings().size();
+
+    // An editor which adds a routing and then holds on to the mutex for a while
+    std::atomic<bool> edited{false}, release{false};
+    std::thread editor([&]() {
+        std::lock_guard<std::recursive_mutex> g(surge->storage.modRoutingMutex);
+        surge->setModDepth01(sc.filterunit[0].cutoff.id, ms_velocity, 0, 0, 0.4);
+        edited = true;
+        while (!release)
+            std::this_thread::yield();
+    });
+
+    while (!edited)
+        std::this_thread::yield();
+
+    // Blocks keep coming, with the routings from before the edit
+    for (int i = 0; i < 50; ++i)
+        surge->process();
+    REQUIRE(plan.voiceRoutings().size() == before);
+
+    release = true;
+    editor.join();
+
+    surge->process();
+    REQUIRE(plan.voiceRoutings().size() == before + 1);
+    REQUIRE(plan.voiceRoutings().back().source_id == ms_velocity);
+}
+
+TEST_CASE("ADSR Quad Matches Single", "[mod]")
+{
+    auto surge = Surge::Headless::createSurge(44100);
+    auto *adsrstorage = &(surge->storage.getPatch().scene[0].adsr[0]);
+
+    // Every shape in each mode, on envelopes released at different times, one uber released
+    for (int shapes = 0; shapes < 3 * 3 * 3 * 2; ++shapes)
+    {
+        pdata lc[4][n_scene_params];
+        ADSRModulationSource single[4], quad[4];
+        ADSRModulationSource *quadptrs[4];
+
+        for (int k = 0; k < 4; ++k)
+        {
+            memcpy(lc[k], surge->storage.getPatch().scenedata[0], sizeof(lc[k]));
+
+            lc[k][adsrstorage->a.param_id_in_scene].f = -6.f + 2.f * k;
+            lc[k][adsrstorage->d.param_id_in_scene].f = -5.f + 1.5f * k;
+            lc[k][adsrstorage->s.param_id_in_scene].f = k * 0.3f;
+            lc[k][adsrstorage->r.param_id_in_scene].f = -4.f + k;
+            lc[k][adsrstorage->a_s.param_id_in_scene].i = (shapes + k) % 3;
+            lc[k][adsrstorage->d_s.param_id_in_scene].i = (shapes / 3 + k) % 3;
+            lc[k][adsrstorage->r_s.param_id_in_scene].i = (shapes / 9 + k) % 3;
+            lc[k][adsrstorage->mode.param_id_in_scene].b = ((shapes / 27) + k) % 2;
+
+            single[k].init(&(surge->storage), adsrstorage, lc[k], nullptr);
+            quad[k].init(&(surge->storage), adsrstorage, lc[k], nullptr);
+            single[k].attack();
+            quad[k].attack();
+            quadptrs[k] = &quad[k];
+        }
+
+        for (int n = 1; n <= 4; ++n)
+        {
+            INFO("Shapes " << shapes << " with " << n << " envelopes");
+
+            for (int k = 0; k < n; ++k)
+            {
+                single[k].attack();
+                quad[k].attack();
+            }
+
+            int mismatches = 0;
+            for (int b = 0; b < 3000; ++b)
+            {
+                for (int k = 0; k < n; ++k)
+                {
+                    if (b == 200 + 150 * k)
+                    {
+                        if (k == 3)
+                        {
+                            single[k].uber_release();
+                            quad[k].uber_release();
+                        }
+                        else
+                        {
+                            single[k].release();
+                            quad[k].release();
+                        }
+                    }
+
+                    single[k].process_block();
+                }
+
+                ADSRModulationSource::process_block_quad(quadptrs, n);
+
+                for (int k = 0; k < n; ++k)
+                {
+                    if (quad[k].get_output(0) != single[k].get_output(0) ||
+                        quad[k].getEnvState() != single[k].getEnvState() ||
+                        quad[k].is_idle() != single[k].is_idle())
+                        mismatches++;
+                }
+            }
+            REQUIRE(mismatches == 0);
+        }
+    }
+}
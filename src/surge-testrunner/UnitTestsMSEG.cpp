@@ -542,6 +542,81 @@ TEST_CASE("Zero Size Loops", "[mseg]")
     }
 }
 
+TEST_CASE("Long MSEG Segment Lookup", "[mseg]")
+{
+    SECTION("Bisection Finds Every Segment")
+    {
+        MSEGStorage ms;
+        ms.n_activeSegments = max_msegs;
+        ms.loopMode = MSEGStorage::LoopMode::GATED_LOOP;
+        ms.endpointMode = MSEGStorage::EndpointMode::LOCKED;
+
+        for (int i = 0; i < ms.n_activeSegments; ++i)
+        {
+            // Some zero length segments, which nothing should ever land in
+            ms.segments[i].duration = (i % 5 == 3) ? 0 : 0.01 * (1 + i % 3);
+            ms.segments[i].type = MSEGStorage::segment::LINEAR;
+            ms.segments[i].v0 = (i % 2) ? 0.5 : -0.5;
+        }
+
+        ms.loop_start = 10;
+        ms.loop_end = 20;
+
+        resetCP(&ms);
+        Surge::MSEG::rebuildCache(&ms);
+        REQUIRE(ms.orderedSegments == ms.n_activeSegments);
+
+        for (int i = 0; i < ms.n_activeSegments; ++i)
+        {
+            if (ms.segments[i].duration == 0)
+                continue;
+
+            auto mid = (ms.segmentStart[i] + ms.segmentEnd[i]) * 0.5;
+            float along;
+
+            REQUIRE(Surge::MSEG::timeToSegment(&ms, mid, true, along) == i);
+            REQUIRE(along == Approx(ms.segments[i].duration * 0.5).margin(1e-5));
+            REQUIRE(Surge::MSEG::timeToSegment(&ms, ms.segmentStart[i]) == i);
+        }
+
+        float along;
+        REQUIRE(Surge::MSEG::timeToSegment(&ms, ms.totalDuration + 0.005, true, along) == 0);
+
+        // Release from the loop and run through to the end
+        auto res = runMSEG(&ms, 0.00731, ms.totalDuration + 1, 0, 0.5);
+        REQUIRE(res.back().v == ms.segments[ms.n_activeSegments - 1].nv1);
+    }
+
+    SECTION("Control Point Edits Without Rebuild")
+    {
+        MSEGStorage ms;
+        ms.n_activeSegments = 2;
+        ms.loopMode = MSEGStorage::LoopMode::ONESHOT;
+
+        for (int i = 0; i < ms.n_activeSegments; ++i)
+        {
+            ms.segments[i].duration = 0.5;
+            ms.segments[i].type = MSEGStorage::segment::LINEAR;
+            ms.segments[i].v0 = i;
+            ms.segments[i].cpv = 0;
+        }
+
+        Surge::MSEG::rebuildCache(&ms);
+
+        // The cached curve is for the old control point, so the evaluator has to notice
+        ms.segments[0].cpv = 0.8;
+        auto edited = runMSEG(&ms, 0.01, 0.5);
+
+        Surge::MSEG::rebuildCache(&ms);
+        auto rebuilt = runMSEG(&ms, 0.01, 0.5);
+
+        REQUIRE(edited.size() == rebuilt.size());
+        for (auto i = 0U; i < edited.size(); ++i)
+            REQUIRE(edited[i].v == rebuilt[i].v);
+        REQUIRE(edited[25].v > 0.5 * 1.1);
+    }
+}
+
 /*
  * Tests to add
  * - loop point 0 (start = end + 1)
@@ -24,6 +24,9 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
 
 #include "HeadlessUtils.h"
 #include "Player.h"
@@ -31,6 +34,9 @@
 #include "catch2/catch_amalgamated.hpp"
 
 #include "UnitTestUtilities.h"
+#include "AllocationCounting.h"
+#include "SurgeMemoryPools.h"
+#include "RenderThreadPool.h"
 
 using namespace Surge::Test;
 
@@ -327,3 +333,235 @@ TEST_CASE("Play and release Frequency and Note ID", "[voice]")
         }
     }
 }
+
+TEST_CASE("Parallel Scene Rendering", "[voice]")
+{
+    auto render = [](bool parallel, int blocks) {
+        auto s = surgeOnSine();
+        s->storage.getPatch().scenemode.val.i = sm_dual;
+        s->storage.rngGen.g.seed(17);
+        s->setParallelSceneRendering(parallel);
+        REQUIRE(s->isParallelSceneRendering() == parallel);
+
+        std::vector<float> res;
+        auto proc = [&]() {
+            s->process();
+            for (int i = 0; i < BLOCK_SIZE; ++i)
+            {
+                res.push_back(s->output[0][i]);
+                res.push_back(s->output[1][i]);
+            }
+        };
+
+        for (int i = 0; i < 10; ++i)
+            proc();
+
+        s->playNote(0, 60, 127, 0, 173);
+        s->playNote(0, 64, 127, 0, 177);
+        s->playNote(0, 67, 127, 0, 179);
+        for (int i = 0; i < blocks; ++i)
+            proc();
+
+        REQUIRE(s->voices[0].size() == 3);
+        REQUIRE(s->voices[1].size() == 3);
+
+        s->releaseNoteByHostNoteID(177, 0);
+        for (int i = 0; i < blocks * 4; ++i)
+            proc();
+
+        // The released voice has ended in both scenes and been freed after the join
+        REQUIRE(s->voices[0].size() == 2);
+        REQUIRE(s->voices[1].size() == 2);
+
+        return res;
+    };
+
+    SECTION("Parallel Output Matches Serial")
+    {
+        auto serial = render(false, 100);
+        auto parallel = render(true, 100);
+
+        REQUIRE(serial.size() == parallel.size());
+
+        float peak = 0.f;
+        int mismatches = 0;
+        for (size_t i = 0; i < serial.size(); ++i)
+        {
+            peak = std::max(peak, std::fabs(parallel[i]));
+            if (parallel[i] != serial[i])
+                mismatches++;
+        }
+        REQUIRE(mismatches == 0);
+        REQUIRE(peak > 0.01f);
+    }
+
+    SECTION("Scene B Listening To Scene A Stays Serial")
+    {
+        auto s = surgeOnSine();
+        s->storage.getPatch().scenemode.val.i = sm_dual;
+        s->setParallelSceneRendering(true);
+        s->storage.otherscene_clients = 1;
+
+        s->playNote(0, 60, 127, 0, 173);
+        for (int i = 0; i < 50; ++i)
+            s->process();
+
+        float peak = 0.f;
+        for (int i = 0; i < BLOCK_SIZE_OS; ++i)
+            peak = std::max(peak, std::fabs(s->storage.audio_otherscene[0][i]));
+        REQUIRE(peak > 0.f);
+
+        s->storage.otherscene_clients = 0;
+    }
+}
+
+TEST_CASE("Voice Rendering Across Threads", "[voice]")
+{
+    auto render = [](int threads, bool formula) {
+        auto s = surgeOnSine();
+        s->storage.rngGen.g.seed(2112);
+        s->storage.getPatch().scenemode.val.i = sm_dual;
+        s->storage.getPatch().polylimit.val.i = MAX_VOICES;
+        if (formula)
+            s->storage.getPatch().scene[1].lfo[0].shape.val.i = lt_formula;
+        s->storage.setRenderThreadCount(threads);
+        REQUIRE((s->storage.getRenderThreadCount() > 1) == (threads > 1));
+
+        std::vector<float> res;
+        auto proc = [&]() {
+            s->process();
+            for (int i = 0; i < BLOCK_SIZE; ++i)
+            {
+                res.push_back(s->output[0][i]);
+                res.push_back(s->output[1][i]);
+            }
+        };
+
+        for (int i = 0; i < 10; ++i)
+            proc();
+
+        // A chord of 120 voices across both scenes, with every fourth note let go part way
+        static constexpr int notes = 60;
+        for (int k = 0; k < notes; ++k)
+            s->playNote(0, 30 + k, 100, 0, 1000 + k);
+        for (int i = 0; i < 50; ++i)
+            proc();
+
+        REQUIRE(s->voices[0].size() == notes);
+        REQUIRE(s->voices[1].size() == notes);
+
+        for (int k = 0; k < notes; k += 4)
+            s->releaseNoteByHostNoteID(1000 + k, 0);
+        for (int i = 0; i < 4000 && s->voices[0].size() + s->voices[1].size() > notes * 3 / 2; ++i)
+            proc();
+        for (int i = 0; i < 20; ++i)
+            proc();
+
+        REQUIRE(s->voices[0].size() == notes * 3 / 4);
+        REQUIRE(s->voices[1].size() == notes * 3 / 4);
+
+        return res;
+    };
+
+    for (auto formula : {false, true})
+    {
+        DYNAMIC_SECTION("Threaded Output Is Bit Identical" << (formula ? " With Formula" : ""))
+        {
+            auto serial = render(1, formula);
+
+            for (auto threads : {2, 3})
+            {
+                INFO("Rendering with " << threads << " threads");
+                auto threaded = render(threads, formula);
+                REQUIRE(threaded.size() == serial.size());
+
+                int mismatches = 0;
+                for (size_t i = 0; i < serial.size(); ++i)
+                {
+                    if (threaded[i] != serial[i])
+                        mismatches++;
+                }
+                REQUIRE(mismatches == 0);
+            }
+        }
+    }
+
+    SECTION("Instances Share One Pool And Render At Once")
+    {
+        auto make = [](int threads) {
+            auto s = surgeOnSine();
+            s->storage.getPatch().scenemode.val.i = sm_dual;
+            s->storage.getPatch().polylimit.val.i = MAX_VOICES;
+            s->storage.setRenderThreadCount(threads);
+            return s;
+        };
+
+        // No REQUIRE in here, since it runs on threads of its own
+        auto play = [](SurgeSynthesizer *s, std::vector<float> &res) {
+            s->storage.rngGen.g.seed(2112);
+            for (int k = 0; k < 40; ++k)
+                s->playNote(0, 30 + k, 100, 0, 1000 + k);
+            for (int i = 0; i < 200; ++i)
+            {
+                s->process();
+                res.insert(res.end(), s->output[0], s->output[0] + BLOCK_SIZE);
+            }
+        };
+
+        auto a = make(2), b = make(3);
+        auto pool = a->storage.getRenderPool();
+        REQUIRE(pool);
+        REQUIRE(pool == b->storage.getRenderPool());
+        REQUIRE(pool->getUserCount() == 2);
+
+        std::vector<float> serial, outA, outB;
+        play(make(1).get(), serial);
+
+        // Whichever instance finds the pool busy renders its block inline
+        std::thread ta(play, a.get(), std::ref(outA)), tb(play, b.get(), std::ref(outB));
+        ta.join();
+        tb.join();
+
+        REQUIRE(outA == serial);
+        REQUIRE(outB == serial);
+    }
+}
+
+TEST_CASE("Voice Bookkeeping Does Not Allocate", "[voice]")
+{
+    auto s = surgeOnSine();
+    s->storage.getPatch().scenemode.val.i = sm_dual;
+    s->storage.getPatch().polylimit.val.i = 16;
+
+    // More notes than the polyphony limit, so voices get stolen, then released both ways
+    auto churn = [&s]() {
+        for (int round = 0; round < 8; ++round)
+        {
+            for (int k = 0; k < 24; ++k)
+                s->playNote(0, 40 + round + k, 100, 0, 2000 + k);
+            for (int i = 0; i < 5; ++i)
+                s->process();
+
+            for (int k = 0; k < 24; k += 2)
+                s->releaseNote(0, 40 + round + k, 0);
+            for (int k = 1; k < 24; k += 2)
+                s->releaseNoteByHostNoteID(2000 + k, 0);
+            for (int i = 0; i < 5; ++i)
+                s->process();
+        }
+
+        for (int i = 0; i < 4000 && !(s->voices[0].empty() && s->voices[1].empty()); ++i)
+            s->process();
+    };
+
+    // Anything set up lazily on the first notes is left out of the count
+    churn();
+
+    auto before = audioThreadAllocationsOnThisThread();
+    {
+        // Note on and off count too, not just what process does
+        Surge::Memory::AudioThreadScope audioThread;
+        churn();
+    }
+    REQUIRE(audioThreadAllocationsOnThisThread() == before);
+}
@@ -69,6 +69,14 @@ int main(int argc, char **argv)
             Surge::Headless::NonTest::filterAnalyzer(std::atoi(argv[3]), std::atoi(argv[4]),
                                                      std::cout);
         }
+        if (strcmp(argv[2], "--voice-render-benchmark") == 0)
+        {
+            Surge::Headless::NonTest::voiceRenderBenchmark(argc > 3 ? std::atoi(argv[3]) : 4);
+        }
+        if (strcmp(argv[2], "--block-size-benchmark") == 0)
+        {
+            Surge::Headless::NonTest::blockSizeBenchmark(argc > 3 ? std::atoi(argv[3]) : 20);
+        }
         if (strcmp(argv[2], "--performance") == 0)
         {
             Surge::Headless::NonTest::performancePlay(argv[3], std::atoi(argv[4]));
@@ -87,6 +95,12 @@ int main(int argc, char **argv)
                 << "   --non-test --stats-from-every-patch    # play every patch and show RMS\n"
                 << "   --non-test --filter-analyzer ft fst    # analyze filter type/subtype for "
                    "response\n"
+                << "   --non-test --voice-render-benchmark n  # time a 128 voice chord on 1 to n "
+                   "threads\n"
+                << "   --non-test --block-size-benchmark s    # time s seconds of audio at this "
+                   "build's block size\n"
+                << "                                          # (build surge-block-size-benchmark "
+                   "to compare sizes)\n"
                 << "\n"
                 << "If you exclude the `--non-test` argument, standard catch2 arguments, below, "
                    "apply\n\n";
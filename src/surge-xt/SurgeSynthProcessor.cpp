@@ -28,6 +28,7 @@
 #include "globals.h"
 #include "UserDefaults.h"
 #include "UnitConversions.h"
+#include <algorithm>
 #include <any>
 
 #if LINUX
@@ -77,6 +78,9 @@ SurgeSynthProcessor::SurgeSynthProcessor()
         return;
     }
 
+    // Wavetable switches from the UI or automation shouldn't read files inside processBlock
+    surge->storage.setBackgroundWavetableLoading(true);
+
 #if BUILD_IS_DEBUG
     oss << "  - Data         : " << surge->storage.datapath.u8string() << "\n"
         << "  - User Data    : " << surge->storage.userDataPath.u8string() << std::endl;
@@ -500,6 +504,39 @@ void SurgeSynthProcessor::releaseResources()
     // When playback stops, you can use this as an opportunity to free up any spare memory, etc.
 }
 
+void SurgeSynthProcessor::setNonRealtime(bool nonRealtime) noexcept
+{
+    auto wasNonRealtime = isNonRealtime();
+    juce::AudioProcessor::setNonRealtime(nonRealtime);
+
+    if (!surge || nonRealtime == wasNonRealtime)
+    {
+        return;
+    }
+
+    /*
+     * Only the render thread count changes here. The block size is BLOCK_SIZE from the build, so
+     * the per block control work costs the same offline as it does live. The threaded render is
+     * bit identical, so a bounce sounds the same as playback.
+     */
+    try
+    {
+        if (nonRealtime)
+        {
+            realtimeRenderThreadCount = surge->storage.getRenderThreadCount();
+            surge->storage.setRenderThreadCount(SurgeStorage::maxRenderThreads);
+        }
+        else
+        {
+            surge->storage.setRenderThreadCount(realtimeRenderThreadCount);
+        }
+    }
+    catch (const std::exception &)
+    {
+        // Starting the render threads failed, so keep rendering on the audio thread alone
+    }
+}
+
 bool SurgeSynthProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
 {
     auto mocs = layouts.getMainOutputChannelSet();
@@ -637,7 +674,13 @@ void SurgeSynthProcessor::processBlock(juce::AudioBuffer<float> &buffer,
         inputIsLatent = true;
     }
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    /*
+     * Work through the buffer in chunks which never cross a synth block boundary or a MIDI
+     * event, so each chunk is a straight copy out of the synth's block. With a host buffer
+     * which is a multiple of BLOCK_SIZE and no MIDI, every chunk is a whole block.
+     */
+    int i = 0;
+    while (i < sc)
     {
         while (i == nextMidi)
         {
@@ -654,9 +697,6 @@ void SurgeSynthProcessor::processBlock(juce::AudioBuffer<float> &buffer,
             }
         }
 
-        auto outL = mainOutput.getWritePointer(0, i);
-        auto outR = mainOutput.getWritePointer(1, i);
-
         if (blockPos == 0 && incL && incR)
         {
             surge->process_input = true;
@@ -687,14 +727,30 @@ void SurgeSynthProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                 (double)BLOCK_SIZE * surge->time_data.tempo / (60. * surge->storage.samplerate);
         }
 
+        auto n = std::min(sc - i, BLOCK_SIZE - blockPos);
+        if (nextMidi > i)
+        {
+            n = std::min(n, nextMidi - i);
+        }
+        auto bytes = n * sizeof(float);
+
         if (inputIsLatent && incL && incR)
         {
-            inputLatentBuffer[0][blockPos] = incL[i];
-            inputLatentBuffer[1][blockPos] = incR[i];
+            memcpy(&inputLatentBuffer[0][blockPos], incL + i, bytes);
+            memcpy(&inputLatentBuffer[1][blockPos], incR + i, bytes);
         }
 
-        *outL = surge->output[0][blockPos];
-        *outR = surge->output[1][blockPos];
+        if (n == BLOCK_SIZE)
+        {
+            // The common case, where the fixed size lets the copy be fully unrolled
+            memcpy(mainOutput.getWritePointer(0, i), surge->output[0], BLOCK_SIZE * sizeof(float));
+            memcpy(mainOutput.getWritePointer(1, i), surge->output[1], BLOCK_SIZE * sizeof(float));
+        }
+        else
+        {
+            memcpy(mainOutput.getWritePointer(0, i), &surge->output[0][blockPos], bytes);
+            memcpy(mainOutput.getWritePointer(1, i), &surge->output[1][blockPos], bytes);
+        }
 
         if (surge->activateExtraOutputs)
         {
@@ -705,8 +761,8 @@ void SurgeSynthProcessor::processBlock(juce::AudioBuffer<float> &buffer,
 
                 if (sAL && sAR)
                 {
-                    *sAL = surge->sceneout[0][0][blockPos];
-                    *sAR = surge->sceneout[0][1][blockPos];
+                    memcpy(sAL, &surge->sceneout[0][0][blockPos], bytes);
+                    memcpy(sAR, &surge->sceneout[0][1][blockPos], bytes);
                 }
             }
 
@@ -717,13 +773,14 @@ void SurgeSynthProcessor::processBlock(juce::AudioBuffer<float> &buffer,
 
                 if (sBL && sBR)
                 {
-                    *sBL = surge->sceneout[1][0][blockPos];
-                    *sBR = surge->sceneout[1][1][blockPos];
+                    memcpy(sBL, &surge->sceneout[1][0][blockPos], bytes);
+                    memcpy(sBR, &surge->sceneout[1][1][blockPos], bytes);
                 }
             }
         }
 
-        blockPos = (blockPos + 1) & (BLOCK_SIZE - 1);
+        blockPos = (blockPos + n) & (BLOCK_SIZE - 1);
+        i += n;
     }
 
     // This should, in theory, never happen, but better safe than sorry
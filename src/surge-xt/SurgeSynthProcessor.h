@@ -269,6 +269,14 @@ class SurgeSynthProcessor : public juce::AudioProcessor,
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    /*
+     * While the host renders offline, throughput matters rather than latency, so the
+     * voices spread over every core until realtime playback comes back. This is the
+     * whole of offline mode: the engine block size is fixed at build time.
+     */
+    void setNonRealtime(bool isNonRealtime) noexcept override;
+    int realtimeRenderThreadCount{1};
+
     bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
     bool canRemoveBusValue = false;
     bool canRemoveBus(bool isInput) const override { return canRemoveBusValue; }
@@ -22,6 +22,7 @@
 #include "SurgeImageStore.h"
 #include "ClaudeParameterMapper.h"
 #include "ClaudeAPIClient.h"
+#include "ClaudeStreaming.h"
 #include "PatchVectorDB.h"
 #include "widgets/MainFrame.h"
 #include "SkinColors.h"
@@ -40,6 +41,11 @@ DeepSynthPanel::DeepSynthPanel(SurgeGUIEditor *editor, SurgeStorage *storage)
 {
     std::cout << "DEBUG: DeepSynthPanel constructor called" << std::endl;
     claudeClient = std::make_unique<Surge::Claude::APIClient>(storage);
+    modificationApplier = std::make_unique<Surge::Claude::StreamedModificationApplier>(
+        [this](const std::vector<Surge::Claude::PatchModification> &mods) {
+            Surge::Claude::ParameterMapper mapper(this->editor->synth);
+            mapper.applyModifications(mods);
+        });
     
     // Initialize vector database for RAG functionality
     vectorDatabase = std::make_shared<Surge::PatchDB::VectorDatabase>(storage);
@@ -47,7 +53,8 @@ DeepSynthPanel::DeepSynthPanel(SurgeGUIEditor *editor, SurgeStorage *storage)
     
     // Build database with error handling for corrupted patches
     try {
-        vectorDatabase->buildFromFactoryPatches();
+        vectorDatabase->buildFromFactoryPatchesCached(
+            Surge::PatchDB::VectorDatabase::getDefaultCachePath(storage));
         std::cout << "DEBUG: Vector database built with " << vectorDatabase->patches.size() << " patches" << std::endl;
     } catch (const std::exception& e) {
         std::cout << "WARNING: Vector database build failed: " << e.what() << std::endl;
@@ -284,17 +291,28 @@ void DeepSynthPanel::processPrompt(bool isModification)
         });
     };
 
+    // Parameter changes stream in and are applied while the rest of the reply is generated
+    modificationApplier->reset();
+    auto onModifications = [this](const std::vector<Surge::Claude::PatchModification> &mods)
+    {
+        modificationApplier->streamed(mods);
+        
+        editor->synth->refresh_editor = true;
+        updateStatus("Applying... " + std::to_string(modificationApplier->getAppliedCount()) +
+                     " changes so far");
+    };
+
     if (isModification)
     {
         // Get current patch information
         Surge::Claude::ParameterMapper mapper(editor->synth);
         std::string patchInfo = mapper.exportCurrentPatchInfo();
         
-        claudeClient->modifyPatch(prompt, patchInfo, callback);
+        claudeClient->modifyPatch(prompt, patchInfo, callback, onModifications);
     }
     else
     {
-        claudeClient->generatePatch(prompt, callback);
+        claudeClient->generatePatch(prompt, callback, onModifications);
     }
 }
 
@@ -340,11 +358,10 @@ void DeepSynthPanel::handleClaudeResponse(const Surge::Claude::ClaudeResponse &r
         responseDisplay->setFont(juce::Font(11.0f));
         responseDisplay->setColour(juce::TextEditor::textColourId, juce::Colours::white);
         
-        // Apply modifications
+        // Apply whatever the stream didn't already, so nothing is set twice
         if (!response.modifications.empty())
         {
-            Surge::Claude::ParameterMapper mapper(editor->synth);
-            mapper.applyModifications(response.modifications);
+            modificationApplier->finish(response.modifications);
             
             // Refresh UI
             editor->synth->refresh_editor = true;
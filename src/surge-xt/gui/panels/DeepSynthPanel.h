@@ -29,6 +29,7 @@ namespace Claude
 {
 class APIClient;
 class ParameterMapper;
+class StreamedModificationApplier;
 struct ClaudeResponse;
 }
 namespace PatchDB
@@ -99,6 +100,9 @@ class DeepSynthPanel : public juce::Component,
     bool isProcessing = false;
     bool hasResponse = false;
     std::string lastResponseText = "";
+
+    // Applies each change of a reply once, whether it streamed in or came with the response
+    std::unique_ptr<Surge::Claude::StreamedModificationApplier> modificationApplier;
     
     // For dragging
     juce::Point<int> dragStartPosition;